@@ -0,0 +1,339 @@
+/******************************************************************************
+ * Copyright (C) 2025 Rebecca Pelke                                           *
+ * All Rights Reserved                                                        *
+ *                                                                            *
+ * This work is licensed under the terms described in the LICENSE file        *
+ * found in the root directory of this source tree.                           *
+ ******************************************************************************/
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "helper/config.h"
+#include "xbar/crossbar.h"
+
+/*
+Throughput benchmarks of the crossbar simulation.
+Every scenario (mapping mode plus non-idealities) is run for square crossbars
+of 32..1024 rows/columns and batches of 1 and 16 MVMs per iteration. Results
+can be written as JSON (--benchmark_out=<file> --benchmark_out_format=json)
+and compared with util/compare_bench.py.
+*/
+
+namespace {
+
+using json = nlohmann::json;
+
+const std::vector<int64_t> batch_sizes = {1, 16};
+constexpr int64_t min_size = 32;
+constexpr int64_t max_size = 1024;
+
+struct Scenario {
+    std::string name;
+    json cfg;
+    int64_t max_size;       // Largest crossbar size (slow non-idealities)
+    int64_t matrix_div = 1; // Matrix size is crossbar size / matrix_div
+    bool accuracy = false;  // Compare the results with fp32 conductances
+    bool relu = false;      // Output range [0, INT32_MAX] (early termination)
+};
+
+const std::vector<std::string> int_modes = {
+    "I_DIFF_W_DIFF_1XB", "I_DIFF_W_DIFF_2XB", "I_OFFS_W_DIFF",
+    "I_TC_W_DIFF",       "I_UINT_W_DIFF",     "I_UINT_W_OFFS"};
+const std::vector<std::string> bnn_modes = {"BNN_I",  "BNN_II", "BNN_III",
+                                            "BNN_IV", "BNN_V",  "BNN_VI"};
+const std::vector<std::string> tnn_modes = {"TNN_I", "TNN_II", "TNN_III",
+                                            "TNN_IV", "TNN_V"};
+
+bool is_int_mode(const std::string &m_mode) {
+    return m_mode.rfind("I_", 0) == 0;
+}
+
+bool is_tnn_mode(const std::string &m_mode) {
+    return m_mode.rfind("TNN_", 0) == 0;
+}
+
+/** Mappings with a positive-only column current (POS_RANGE_ONLY_ADC) */
+bool is_pos_mode(const std::string &m_mode) {
+    for (const char *mode : {"I_UINT_W_OFFS", "BNN_III", "BNN_IV", "BNN_V",
+                             "TNN_IV", "TNN_V"}) {
+        if (m_mode == mode) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/** Noise-free 8-bit ADC config of a mapping mode (32x32 crossbar). */
+json base_cfg(const std::string &m_mode, bool digital_only) {
+    json cfg = {{"M", 32},
+                {"N", 32},
+                {"digital_only", digital_only},
+                {"HRS", 5.0},
+                {"LRS", 30.0},
+                {"adc_type", is_pos_mode(m_mode) ? "POS_RANGE_ONLY_ADC"
+                                                 : "SYM_RANGE_ADC"},
+                {"resolution", 8},
+                {"m_mode", m_mode},
+                {"HRS_NOISE", 0.0},
+                {"LRS_NOISE", 0.0},
+                {"verbose", false},
+                {"rng_seed", 42}};
+    if (is_int_mode(m_mode)) {
+        cfg["W_BIT"] = 8;
+        cfg["I_BIT"] = 8;
+        cfg["SPLIT"] = {1, 3, 4};
+    } else if ((m_mode == "TNN_IV") || (m_mode == "TNN_V")) {
+        cfg["W_BIT"] = 2;
+        cfg["SPLIT"] = {1, 1};
+    }
+    return cfg;
+}
+
+json with(json cfg, const json &updates) {
+    cfg.update(updates);
+    return cfg;
+}
+
+std::vector<Scenario> get_scenarios() {
+    std::vector<Scenario> scenarios;
+
+    // All mapping modes, digital and analog
+    for (const auto *modes : {&int_modes, &bnn_modes, &tnn_modes}) {
+        for (const std::string &m_mode : *modes) {
+            scenarios.push_back(
+                {m_mode + "/digital", base_cfg(m_mode, true), max_size});
+            scenarios.push_back(
+                {m_mode + "/analog", base_cfg(m_mode, false), max_size});
+        }
+    }
+
+    // ADC types
+    for (const char *m_mode : {"I_DIFF_W_DIFF_1XB", "I_UINT_W_OFFS", "BNN_I",
+                               "BNN_III", "TNN_I", "TNN_IV"}) {
+        json cfg = base_cfg(m_mode, false);
+        const std::string range_adc = cfg["adc_type"];
+        scenarios.push_back(
+            {std::string(m_mode) + "/INF_ADC",
+             with(cfg, {{"adc_type", "INF_ADC"}, {"resolution", -1}}),
+             max_size});
+        for (int32_t resolution : {4, 12}) {
+            scenarios.push_back({std::string(m_mode) + "/" + range_adc + "_" +
+                                     std::to_string(resolution),
+                                 with(cfg, {{"resolution", resolution}}),
+                                 max_size});
+        }
+    }
+
+    // Multi-bit DAC inputs (I_BIT / dac_bits array reads per MVM)
+    for (const char *m_mode : {"I_DIFF_W_DIFF_1XB", "I_UINT_W_OFFS"}) {
+        for (int32_t dac_bits : {2, 4}) {
+            scenarios.push_back(
+                {std::string(m_mode) + "/dac" + std::to_string(dac_bits),
+                 with(base_cfg(m_mode, false), {{"dac_bits", dac_bits}}),
+                 max_size});
+        }
+    }
+
+    // Output range of a following ReLU (MSB-first reads, the rows with a
+    // negative result are not read to the end)
+    for (const char *m_mode : {"I_DIFF_W_DIFF_1XB", "I_UINT_W_OFFS"}) {
+        scenarios.push_back({std::string(m_mode) + "/relu",
+                             base_cfg(m_mode, false), max_size, 1, false,
+                             true});
+    }
+
+    // Parasitics (the solver runs on every MVM). TNN_I places each weight
+    // on 2x2 cells, so the matrix is half the crossbar size.
+    const json parasitics = {
+        {"parasitics", true}, {"w_res", 0.001}, {"V_read", -0.4}};
+    for (const char *m_mode : {"I_DIFF_W_DIFF_1XB", "BNN_I"}) {
+        scenarios.push_back({std::string(m_mode) + "/parasitics",
+                             with(base_cfg(m_mode, false), parasitics), 256});
+    }
+    scenarios.push_back({"TNN_I/parasitics",
+                         with(base_cfg("TNN_I", false), parasitics), 256, 2});
+
+    // Read disturb with all mitigation strategies
+    const json read_disturb = {{"read_disturb", true},
+                               {"V_read", -0.4},
+                               {"t_read", 100e-9},
+                               {"read_disturb_mitigation_fp", 1.0},
+                               {"read_disturb_update_tolerance", 0.0}};
+    for (const char *m_mode : {"I_DIFF_W_DIFF_1XB", "BNN_I"}) {
+        for (const char *strategy : {"OFF", "SOFTWARE", "CELL_BASED"}) {
+            scenarios.push_back(
+                {std::string(m_mode) + "/read_disturb_" + strategy,
+                 with(with(base_cfg(m_mode, false), read_disturb),
+                      {{"read_disturb_mitigation_strategy", strategy}}),
+                 max_size});
+        }
+    }
+
+    // Device variability (BNN/TNN only)
+    const json noise = {{"HRS_NOISE", 1.0}, {"LRS_NOISE", 2.0}};
+    for (const char *m_mode : {"BNN_I", "BNN_III", "TNN_I", "TNN_IV"}) {
+        json cfg = with(base_cfg(m_mode, false), noise);
+        scenarios.push_back({std::string(m_mode) + "/d2d",
+                             with(cfg, {{"d2d_var", true}, {"c2c_var", false}}),
+                             max_size});
+        scenarios.push_back({std::string(m_mode) + "/c2c",
+                             with(cfg, {{"d2d_var", false}, {"c2c_var", true}}),
+                             max_size});
+        scenarios.push_back(
+            {std::string(m_mode) + "/c2c_column",
+             with(cfg, {{"d2d_var", false},
+                        {"c2c_var", true},
+                        {"c2c_model", "column_aggregate"}}),
+             max_size});
+    }
+
+    // Conductance storage precision; counters compare the results with fp32.
+    // HRS/LRS are not exactly representable in 16 bits, the BNN/TNN kernels
+    // run without the exact fast path (the d2d noise is not reproducible).
+    for (const char *m_mode : {"I_DIFF_W_DIFF_1XB", "BNN_I", "TNN_I"}) {
+        json cfg = with(base_cfg(m_mode, false), {{"HRS", 5.03},
+                                                  {"LRS", 29.71},
+                                                  {"exact_fast_path", false}});
+        for (const char *precision : {"fp32", "fp16", "bf16"}) {
+            scenarios.push_back(
+                {std::string(m_mode) + "/" + precision,
+                 with(cfg, {{"conductance_precision", precision}}), max_size,
+                 1, true});
+        }
+    }
+    return scenarios;
+}
+
+/** Load a config through a temporary file (the regular load_cfg path). */
+void load_cfg(const json &cfg) {
+    const std::filesystem::path path =
+        std::filesystem::temp_directory_path() /
+        ("acs_bench_" + std::to_string(getpid()) + ".json");
+    {
+        std::ofstream file_stream(path);
+        file_stream << cfg.dump();
+    }
+    bool loaded = nq::Config::get_cfg().load_cfg(path.c_str());
+    std::filesystem::remove(path);
+    if (!loaded) {
+        std::cerr << "Could not load benchmark config: " << cfg.dump()
+                  << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+/** Random weights or inputs in the value range of the mapping mode. */
+std::vector<int32_t> random_values(const std::string &m_mode, size_t size,
+                                   bool is_input, std::mt19937 &gen) {
+    int32_t lo = -1;
+    int32_t hi = 1;
+    if (is_int_mode(m_mode)) {
+        const bool is_unsigned = is_input && (m_mode.rfind("I_UINT", 0) == 0);
+        lo = is_unsigned ? 0 : -128;
+        hi = is_unsigned ? 255 : 127;
+    }
+    std::uniform_int_distribution<int32_t> dist(lo, hi);
+    std::vector<int32_t> values(size);
+    for (int32_t &value : values) {
+        value = dist(gen);
+        // BNN values are -1 or +1
+        while (!is_int_mode(m_mode) && !is_tnn_mode(m_mode) && (value == 0)) {
+            value = dist(gen);
+        }
+    }
+    return values;
+}
+
+/** Batch of MVMs on a square crossbar (state.range(0): size, 1: batch). */
+void run_mvm(benchmark::State &state, const Scenario &scenario) {
+    const int64_t xbar_size = state.range(0);
+    const int64_t size = xbar_size / scenario.matrix_div;
+    const int64_t batch = state.range(1);
+    const std::string m_mode = scenario.cfg["m_mode"];
+    std::mt19937 gen(42);
+    std::vector<int32_t> mat = random_values(m_mode, size * size, false, gen);
+    std::vector<int32_t> vecs =
+        random_values(m_mode, batch * size, true, gen);
+    std::vector<int32_t> res(size);
+
+    // Reference results with fp32 conductances (same d2d variability)
+    std::vector<int32_t> ref;
+    if (scenario.accuracy) {
+        load_cfg(with(scenario.cfg, {{"M", xbar_size},
+                                     {"N", xbar_size},
+                                     {"conductance_precision", "fp32"}}));
+        nq::Crossbar ref_crossbar;
+        ref_crossbar.write(mat.data(), size, size);
+        ref.assign(batch * size, 0);
+        for (int64_t b = 0; b < batch; ++b) {
+            ref_crossbar.mvm(ref.data() + b * size, vecs.data() + b * size,
+                             mat.data(), size, size);
+        }
+    }
+    load_cfg(with(scenario.cfg, {{"M", xbar_size}, {"N", xbar_size}}));
+    nq::Crossbar crossbar;
+    crossbar.write(mat.data(), size, size);
+    const nq::OutputRange relu{0, INT32_MAX};
+    const nq::OutputRange *out_range = scenario.relu ? &relu : nullptr;
+
+    for (auto _ : state) {
+        for (int64_t b = 0; b < batch; ++b) {
+            std::fill(res.begin(), res.end(), 0);
+            crossbar.mvm(res.data(), vecs.data() + b * size, mat.data(), size,
+                         size, nq::LayerRegistry::unknown_layer, out_range);
+            benchmark::DoNotOptimize(res.data());
+        }
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * batch);
+    state.counters["MACs"] = benchmark::Counter(
+        double(state.iterations()) * batch * size * size,
+        benchmark::Counter::kIsRate);
+
+    if (scenario.accuracy) {
+        // Share of results that differ from fp32 and their mean abs. error
+        int64_t mismatches = 0;
+        double abs_error = 0.0;
+        for (int64_t b = 0; b < batch; ++b) {
+            std::fill(res.begin(), res.end(), 0);
+            crossbar.mvm(res.data(), vecs.data() + b * size, mat.data(), size,
+                         size);
+            for (int64_t m = 0; m < size; ++m) {
+                const int64_t diff = int64_t(res[m]) - ref[b * size + m];
+                mismatches += (diff != 0);
+                abs_error += std::abs(double(diff));
+            }
+        }
+        state.counters["mismatch"] = double(mismatches) / (batch * size);
+        state.counters["abs_error"] = abs_error / (batch * size);
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return EXIT_FAILURE;
+    }
+    for (const Scenario &scenario : get_scenarios()) {
+        benchmark::RegisterBenchmark(scenario.name.c_str(), run_mvm, scenario)
+            ->ArgNames({"size", "batch"})
+            ->ArgsProduct(
+                {benchmark::CreateRange(min_size, scenario.max_size, 2),
+                 batch_sizes})
+            ->Unit(benchmark::kMicrosecond);
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,96 @@
+/******************************************************************************
+ * Copyright (C) 2025 Rebecca Pelke                                           *
+ * All Rights Reserved                                                        *
+ *                                                                            *
+ * This work is licensed under the terms described in the LICENSE file        *
+ * found in the root directory of this source tree.                           *
+ ******************************************************************************/
+#ifndef ASYNC_EXECUTOR_H
+#define ASYNC_EXECUTOR_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "oneapi/tbb/concurrent_queue.h"
+
+namespace nq {
+
+/** Completion state of an asynchronously executed task. */
+class AsyncTask {
+  public:
+    explicit AsyncTask(std::function<int32_t()> fn);
+    AsyncTask(const AsyncTask &) = delete;
+    virtual ~AsyncTask() = default;
+
+    /** True if the task has finished (non-blocking). */
+    bool done() const;
+    /** Block until the task has finished and return its status. */
+    int32_t wait();
+
+  private:
+    friend class AsyncExecutor;
+    void run();
+
+    std::function<int32_t()> fn_;
+    std::atomic<bool> done_;
+    int32_t status_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+};
+
+/*
+Worker pool that executes tasks asynchronously.
+Every task belongs to a strand (e.g., one strand per crossbar). Tasks of the
+same strand are executed one after another in submission order, tasks of
+different strands run in parallel. Pending tasks are kept in lock-free queues;
+a strand is scheduled on the ready queue whenever it has pending work and no
+worker is executing it. A strand is removed as soon as its last task has
+finished, so keys of destroyed objects do not accumulate.
+*/
+class AsyncExecutor {
+  public:
+    explicit AsyncExecutor(size_t num_workers);
+    AsyncExecutor(const AsyncExecutor &) = delete;
+    virtual ~AsyncExecutor();
+
+    /** Enqueue fn on the strand identified by strand_key. */
+    std::shared_ptr<AsyncTask> submit(const void *strand_key,
+                                      std::function<int32_t()> fn);
+    /** Block until all submitted tasks have finished. */
+    void wait_all();
+    /** Number of submitted tasks that have not finished yet. */
+    size_t num_pending() const;
+    /** Number of strands with unfinished tasks. */
+    size_t num_strands() const;
+
+  private:
+    struct Strand {
+        const void *key;
+        tbb::concurrent_queue<std::shared_ptr<AsyncTask>> tasks;
+        size_t num_pending = 0; // Guarded by strands_mutex_
+    };
+
+    void worker_loop();
+
+    std::vector<std::thread> workers_;
+    tbb::concurrent_queue<Strand *> ready_;
+    std::unordered_map<const void *, std::unique_ptr<Strand>> strands_;
+    mutable std::mutex strands_mutex_; // Strand creation, removal and counters
+
+    std::atomic<size_t> num_pending_;
+    std::atomic<bool> stop_;
+    std::mutex mutex_;
+    std::condition_variable work_cv_; // Signals new ready strands
+    std::condition_variable idle_cv_; // Signals that all tasks finished
+};
+
+} // namespace nq
+
+#endif
@@ -0,0 +1,116 @@
+/******************************************************************************
+ * Copyright (C) 2025 Rebecca Pelke                                           *
+ * All Rights Reserved                                                        *
+ *                                                                            *
+ * This work is licensed under the terms described in the LICENSE file        *
+ * found in the root directory of this source tree.                           *
+ ******************************************************************************/
+#ifndef CONDUCTANCE_MATRIX_H
+#define CONDUCTANCE_MATRIX_H
+
+#include <cstdint>
+#include <cstring>
+
+#include "helper/definitions.h"
+#include "helper/matrix.h"
+#include "helper/snapshot.h"
+
+namespace nq {
+
+/** IEEE half precision conversion (round to nearest even). */
+uint16_t float_to_fp16(float value);
+float fp16_to_float(uint16_t value);
+
+/** bfloat16 conversion (round to nearest even). */
+inline uint16_t float_to_bf16(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    if ((bits & 0x7fffffff) > 0x7f800000) {
+        return static_cast<uint16_t>((bits >> 16) | 0x40); // Quiet NaN
+    }
+    bits += 0x7fff + ((bits >> 16) & 1);
+    return static_cast<uint16_t>(bits >> 16);
+}
+
+inline float bf16_to_float(uint16_t value) {
+    const uint32_t bits = uint32_t(value) << 16;
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+/*
+Cell currents of an analog crossbar (in uA).
+FP32 stores the currents in a Matrix<float>. FP16 and BF16 store them in 16
+bits, which halves the memory footprint and bandwidth. Every value that is
+set is rounded to the precision. The kernels read a row as fp32 (row()) and
+accumulate in fp32; fp16 rows are converted with F16C if the CPU supports it.
+*/
+class ConductanceMatrix {
+  public:
+    ConductanceMatrix() :
+        precision_(ConductancePrecision::FP32), rows_(0), cols_(0) {}
+    ConductanceMatrix(size_t rows, size_t cols, float value,
+                      ConductancePrecision precision) {
+        assign(rows, cols, value, precision);
+    }
+
+    void assign(size_t rows, size_t cols, float value,
+                ConductancePrecision precision);
+
+    float get(size_t row, size_t col) const {
+        switch (precision_) {
+        case ConductancePrecision::FP16:
+            return fp16_to_float(half_[row][col]);
+        case ConductancePrecision::BF16:
+            return bf16_to_float(half_[row][col]);
+        default:
+            return fp32_[row][col];
+        }
+    }
+    void set(size_t row, size_t col, float value) {
+        switch (precision_) {
+        case ConductancePrecision::FP16:
+            half_[row][col] = float_to_fp16(value);
+            break;
+        case ConductancePrecision::BF16:
+            half_[row][col] = float_to_bf16(value);
+            break;
+        default:
+            fp32_[row][col] = value;
+            break;
+        }
+    }
+    /** Value as it is stored (rounded to the precision). */
+    float round(float value) const;
+
+    /** The first n values of a row as fp32. Points into the storage (FP32)
+     * or to buf (converted, at least n values). */
+    const float *row(size_t row, size_t n, float *buf) const;
+
+    /** fp32 copy of all values (FP32: the storage itself). The copy is
+     * updated on every call and is not reallocated. */
+    const Matrix<float> &to_float() const;
+
+    void save(SnapshotWriter &writer, SnapshotSection id) const;
+    bool load(const SnapshotReader &reader, SnapshotSection id);
+    /** Check that load would succeed (element type and shape). */
+    bool check(const SnapshotReader &reader, SnapshotSection id) const;
+
+    size_t rows() const { return rows_; }
+    size_t cols() const { return cols_; }
+    bool empty() const { return rows_ * cols_ == 0; }
+    ConductancePrecision precision() const { return precision_; }
+
+  private:
+    ConductancePrecision precision_;
+    size_t rows_;
+    size_t cols_;
+    Matrix<float> fp32_;         // FP32
+    Matrix<uint16_t> half_;      // FP16/BF16 bit patterns
+    mutable Matrix<float> copy_; // to_float() (FP16/BF16)
+};
+
+} // namespace nq
+
+#endif
@@ -10,6 +10,10 @@
 
 #include <cstdint>
 #include <cstdlib>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
 #include <vector>
 
 #include "helper/definitions.h"
@@ -20,42 +24,19 @@
 
 namespace nq {
 
-class Config {
+/** Simulation parameters (copyable, e.g., per-layer profiles) */
+class ConfigParams {
   public:
-    Config(const Config &) = delete;
-    Config &operator=(const Config &) = delete;
-    virtual ~Config();
+    virtual ~ConfigParams() = default;
 
-    static Config &get_cfg();
-    bool load_cfg(const char *cfg_file);
-    bool is_int_mapping(const MappingMode &mode);
-    bool is_bnn_mapping(const MappingMode &mode);
-    bool is_tnn_mapping(const MappingMode &mode);
-    bool update_cfg(const char *json_string, bool *recreate_xbar = nullptr,
-                    const std::vector<std::string> &recreation_keys = {
-                        "W_BIT",
-                        "M",
-                        "N",
-                        "SPLIT",
-                        "digital_only",
-                        "HRS",
-                        "LRS",
-                        "adc_type",
-                        "resolution",
-                        "adc_profile",
-                        "adc_calib_mode",
-                        "adc_calib_dict",
-                        "m_mode",
-                        "HRS_NOISE",
-                        "LRS_NOISE",
-                        "read_disturb",
-                        "V_read",
-                        "t_read",
-                        "read_disturb_update_freq",
-                        "read_disturb_mitigation_strategy",
-                        "read_disturb_mitigation_fp",
-                        "read_disturb_update_tolerance",
-                        "parasitics"});
+    /** Read the parameters from a JSON config. Parameters that are not
+     * used by the config (e.g., HRS if digital_only) keep their value. */
+    bool from_json(const nlohmann::json &cfg_data);
+    bool is_int_mapping(const MappingMode &mode) const;
+    bool is_bnn_mapping(const MappingMode &mode) const;
+    bool is_tnn_mapping(const MappingMode &mode) const;
+    /** Rebuild adc_calib_ranges from adc_calib_dict. */
+    void index_adc_calib_dict();
 
     // Matrix dimensions MxN
     uint32_t M;
@@ -67,10 +48,18 @@ class Config {
     // Bit width of weights and inputs
     uint32_t W_BIT;
     uint32_t I_BIT;
+    // Input bits applied per array read in analog INT mappings (multi-level
+    // DAC). BNN/TNN inputs are always applied bit by bit (1).
+    uint32_t dac_bits;
 
     // No conversion to analog values
     bool digital_only;
 
+    // Digital INT mappings: packed integer GEMV instead of the weight slices
+    // (packed_gemv), cross-checked against the slices (packed_gemv_check)
+    bool packed_gemv;
+    bool packed_gemv_check;
+
     // LRS and HRS current (in uA)
     float HRS;
     float LRS;
@@ -88,6 +77,9 @@ class Config {
     int adc_profile_bin_size;
     ADCCalibMode adc_calib_mode;
     std::map<std::string, std::pair<float, float>> adc_calib_dict;
+    // adc_calib_dict indexed by layer ID (see LayerRegistry), nullopt for
+    // layers without calibrated range
+    std::vector<std::optional<std::pair<float, float>>> adc_calib_ranges;
 
     // Mapping strategy
     MappingMode m_mode;
@@ -100,14 +92,24 @@ class Config {
     float LRS_NOISE;
     bool d2d_var; // Model device-to-device variation
     bool c2c_var; // Model cycle-to-cycle variation
+    // c2c_model: per_cell samples the noise of every cell per MVM,
+    // column_aggregate adds one sample with the same variance per column
+    // current (BNN/TNN, without parasitics)
+    C2CModel c2c_model;
+
+    // Seed of the counter-based random number generators (random if not set)
+    uint64_t rng_seed;
 
     // Read disturb parameters
     // t_read: time of a read pulse (in s)
     // read_disturb_update_freq: how often (in number of MVMs) the conductance
     // is updated
+    // read_disturb_level_scaling: scaling of the drift power factor per
+    // conductance level (entry l-1 for level l, default 1.0)
     bool read_disturb;
     float t_read;
     uint32_t read_disturb_update_freq;
+    std::vector<float> read_disturb_level_scaling;
 
     // Read disturb mitigation parameters
     // read_disturb_mitigation_strategy:
@@ -126,15 +128,100 @@ class Config {
     bool parasitics;
     float w_res;
 
+    // exact_fast_path: compute noise-free BNN/TNN MVMs from popcounts and
+    // convert every ADC level only once (same results, see Mapper)
+    bool exact_fast_path;
+
+    // conductance_precision: storage format of the cell currents (fp32,
+    // fp16 or bf16); the MVMs accumulate in fp32
+    ConductancePrecision conductance_precision;
+
     // V_read: read voltage (in V, negative) - Needed for parasitics and read
     // disturb modelling.
     float V_read;
 
+};
+
+/** Parameters of a layer: base config plus the overrides of the layer in the
+ * "layers" config section */
+struct LayerProfile {
+    ConfigParams params;
+    std::vector<std::string> diff_keys; // Keys that differ from the base
+};
+
+class Config : public ConfigParams {
+  public:
+    Config(const Config &) = delete;
+    Config &operator=(const Config &) = delete;
+    virtual ~Config();
+
+    static Config &get_cfg();
+    bool load_cfg(const char *cfg_file);
+    /** Apply a JSON object of updates to the configuration.
+     *
+     * @param json_string JSON object with the keys to update
+     * @param recreate_xbar Set if a key in recreation_keys changed
+     * @param changed_keys Keys whose value changed (optional)
+     * @param recreation_keys Keys that change the crossbar dimensions
+     * @return True if the configuration was modified and applied
+     */
+    bool update_cfg(const char *json_string, bool *recreate_xbar = nullptr,
+                    std::vector<std::string> *changed_keys = nullptr,
+                    const std::vector<std::string> &recreation_keys = {
+                        "W_BIT", "M", "N", "SPLIT", "digital_only",
+                        "m_mode", "conductance_precision"});
+    /** Install per-layer ADC current ranges and switch to CALIB mode. The
+     * ADCs read the ranges on every conversion (no crossbar recreation). */
+    void set_adc_calib_dict(
+        const std::map<std::string, std::pair<float, float>> &calib_dict);
+
+    /** Layer ID of the base parameters (no layer profile applied) */
+    static constexpr uint32_t base_layer = UINT32_MAX;
+
+    /** True if the config has a "layers" section. */
+    bool has_layer_profiles() const;
+    /** Layer whose profile the parameters currently hold (base_layer after
+     * load_cfg/update_cfg). */
+    uint32_t get_active_layer() const { return active_layer_; }
+    /** Switch the parameters to the profile of a layer (base parameters if
+     * the layer has no profile). No JSON is parsed. */
+    void activate_layer(uint32_t layer_id);
+    /** activate_layer and report the keys a crossbar has to apply.
+     *
+     * The parameters are shared by all crossbars, but each crossbar built
+     * its ADC, cell currents, etc. with the profile it applied last.
+     * applied_layer is the layer of that profile; the keys are reported
+     * relative to it and it is set to layer_id.
+     *
+     * @param layer_id Interned layer name (see LayerRegistry)
+     * @param applied_layer Layer whose profile the caller's state holds
+     * @param changed_keys Keys whose value may differ from applied_layer
+     * @return True if the caller must apply changed_keys
+     */
+    bool select_layer(uint32_t layer_id, uint32_t &applied_layer,
+                      std::vector<std::string> &changed_keys);
+    /** select_layer relative to the active layer of the parameters. */
+    bool select_layer(uint32_t layer_id,
+                      std::vector<std::string> &changed_keys);
+    /** True if both layers use the same profile. */
+    bool same_profile(uint32_t layer_a, uint32_t layer_b) const {
+        return get_profile(layer_a) == get_profile(layer_b);
+    }
+    /** After update_cfg (base parameters): add the keys overridden by the
+     * profile of applied_layer to changed_keys and set it to base_layer. */
+    void reset_layer(uint32_t &applied_layer,
+                     std::vector<std::string> &changed_keys) const;
+
   private:
+    const LayerProfile *get_profile(uint32_t layer_id) const;
     Config();
     bool apply_config();
+    bool build_layer_profiles();
     static Config cfg_;
     nlohmann::json cfg_data_;
+    ConfigParams base_params_; // Parameters without layer overrides
+    std::vector<std::unique_ptr<LayerProfile>> layer_profiles_; // By layer ID
+    uint32_t active_layer_; // base_layer: base parameters
 };
 
 } // namespace nq
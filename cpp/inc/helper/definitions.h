@@ -100,6 +100,12 @@ static std::string m_mode_to_string(MappingMode mode) {
 
 enum class ReadDisturbMitigationStrategy { SOFTWARE, CELL_BASED, OFF };
 
+/** Storage format of the analog cell currents (accumulation in fp32) */
+enum class ConductancePrecision { FP32, FP16, BF16 };
+
+/** Cycle-to-cycle variability: noise per cell or per column current */
+enum class C2CModel { PER_CELL, COLUMN_AGGREGATE };
+
 } // namespace nq
 
 #endif
@@ -10,15 +10,23 @@
 #define HISTOGRAM_H
 
 #include <cstdint>
+#include <functional>
+#include <limits>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <vector>
 
 #include "nlohmann/json.hpp"
+#include "oneapi/tbb/enumerable_thread_specific.h"
 using json = nlohmann::json;
 
 namespace nq {
 
-/** Simple histogram for profiling integer arrays. */
+/** Simple histogram for profiling integer arrays. Values outside
+ * [min, max] are not stored but counted as underflow/overflow.
+ */
 class SimpleHistogram {
   public:
     /** Constructor
@@ -45,6 +53,12 @@ class SimpleHistogram {
     /** Get variance. */
     float get_variance();
 
+    /** Get number of values below the histogram range. */
+    uint64_t get_underflow();
+
+    /** Get number of values above the histogram range. */
+    uint64_t get_overflow();
+
     /** Get histogram data as a JSON object. */
     json to_json();
 
@@ -54,9 +68,17 @@ class SimpleHistogram {
 
     std::vector<int32_t> data_;   /**< Histogram data */
     std::vector<int32_t> values_; /**< Sample values stored in histogram */
+    uint64_t underflow_ = 0;      /**< Values below min */
+    uint64_t overflow_ = 0;       /**< Values above max */
 };
 
-/** Histogram for profiling float arrays with binning. */
+/** Histogram for profiling float arrays with binning.
+ *
+ * Every thread updates its own shard of 64-bit bins, so concurrent updates
+ * need no locks or atomics. The shards are merged when the histogram is read.
+ * Reading must not overlap with updates. Values outside [min, max) are not
+ * binned but counted as underflow/overflow.
+ */
 class BinnedHistogram {
   public:
     /** Constructor
@@ -67,11 +89,14 @@ class BinnedHistogram {
      */
     BinnedHistogram(float min, float max, float bin_size);
     BinnedHistogram() = delete;
-    BinnedHistogram(const SimpleHistogram &) = delete;
+    BinnedHistogram(const BinnedHistogram &) = delete;
 
     /** Destructor */
     virtual ~BinnedHistogram() = default;
 
+    /** Update histogram with len values (binned in place). */
+    void update(const float *values, size_t len);
+
     /** Update histogram with a vector of values. */
     void update(const std::vector<float> &values);
 
@@ -84,20 +109,158 @@ class BinnedHistogram {
     /** Get variance. */
     float get_variance();
 
+    /** Get number of values below the histogram range. */
+    uint64_t get_underflow();
+
+    /** Get number of values above the histogram range. */
+    uint64_t get_overflow();
+
     /** Get histogram data as a JSON object. */
     json to_json();
 
   private:
+    /** Sum of all thread shards (bins, underflow, overflow). */
+    std::vector<uint64_t> get_data();
+
     float min_;      /**< Minimum value */
     float max_;      /**< Maximum value */
     float bin_size_; /**< Bin size */
     float num_bins_; /**< Number of bins */
 
-    std::vector<int32_t> data_; /**< Histogram data */
+    tbb::enumerable_thread_specific<std::vector<uint64_t>>
+        shards_;                /**< Per-thread histogram data */
     std::vector<float> values_; /**< Sample values (mid-point of bins)
                                        stored in histogram */
 };
 
+/** Streaming histogram with log-linear buckets (HDR histogram style).
+ *
+ * The range of |value| is split into powers of two, and each power of two
+ * into 2^sub_bucket_bits linear buckets. The bucket index is taken directly
+ * from the float bit pattern, so no range has to be known in advance. The
+ * bucket storage grows with the range of the observed values. Quantiles have
+ * a relative error below 2^-(sub_bucket_bits + 1). Count, mean, variance,
+ * minimum and maximum are exact. Like BinnedHistogram, the histogram is
+ * sharded per thread.
+ */
+class StreamingHistogram {
+  public:
+    /** Constructor
+     *
+     * @param sub_bucket_bits Linear buckets per power of two (log2)
+     */
+    explicit StreamingHistogram(int32_t sub_bucket_bits = 7);
+    StreamingHistogram(const StreamingHistogram &) = delete;
+
+    /** Destructor */
+    virtual ~StreamingHistogram() = default;
+
+    /** Update histogram with len values (shifted by offset). Non-finite
+     * values are skipped. */
+    void update(const float *values, size_t len, float offset = 0.0);
+
+    /** Get number of (finite) samples present in histogram. */
+    int64_t get_samples();
+
+    /** Get mean value. */
+    float get_mean();
+
+    /** Get variance. */
+    float get_variance();
+
+    /** Get minimum value. */
+    float get_min();
+
+    /** Get maximum value. */
+    float get_max();
+
+    /** Get the value below which a fraction q of the samples lies. */
+    float get_quantile(double q);
+
+    /** Get several quantiles with a single pass over the buckets. */
+    std::vector<float> get_quantiles(const std::vector<double> &qs);
+
+    /** Get the non-empty buckets (mid-point, count) in ascending order. */
+    std::vector<std::pair<float, uint64_t>> get_buckets();
+
+    /** Get histogram data as a JSON object. */
+    json to_json();
+
+  private:
+    /** Counts of a contiguous range of bucket keys. */
+    struct Buckets {
+        uint32_t first = 0;            /**< Key of counts[0] */
+        std::vector<uint64_t> counts; /**< Bucket counts */
+
+        void add(uint32_t key, uint64_t count = 1);
+        void merge(const Buckets &other);
+    };
+
+    /** Histogram state updated by one thread. */
+    struct Shard {
+        Buckets pos; /**< Buckets of values >= 0 */
+        Buckets neg; /**< Buckets of -value for values < 0 */
+        uint64_t samples = 0;
+        double sum = 0.0;
+        double sum_sq = 0.0;
+        float min = std::numeric_limits<float>::infinity();
+        float max = -std::numeric_limits<float>::infinity();
+
+        void merge(const Shard &other);
+    };
+
+    /** Sum of all thread shards. */
+    Shard get_data();
+
+    /** Non-empty buckets of merged data in ascending order. */
+    std::vector<std::pair<float, uint64_t>> get_buckets(const Shard &data);
+
+    /** Bucket key of a non-negative finite value. */
+    uint32_t get_key(float abs_value) const;
+
+    /** Mid-point of a bucket. */
+    float get_value(uint32_t key) const;
+
+    int32_t shift_; /**< Mantissa bits dropped to get the bucket key */
+    tbb::enumerable_thread_specific<Shard> shards_; /**< Per-thread data */
+};
+
+/** Histograms of one layer.
+ *
+ * Inputs are always profiled with a StreamingHistogram. A BinnedHistogram is
+ * only added if the range [min, max] is finite (e.g. not for INF_ADC).
+ */
+class LayerHistogram {
+  public:
+    /** Constructor
+     *
+     * @param min Minimum value of the binned histogram
+     * @param max Maximum value of the binned histogram
+     * @param bin_size Bin size of the binned histogram
+     */
+    LayerHistogram(float min, float max, float bin_size);
+    LayerHistogram(const LayerHistogram &) = delete;
+
+    /** Destructor */
+    virtual ~LayerHistogram() = default;
+
+    /** Update all histograms with len values. */
+    void update(const float *values, size_t len);
+
+    /** Binned histogram (nullptr if the range is unbounded). */
+    BinnedHistogram *get_binned();
+
+    /** Streaming histogram. */
+    StreamingHistogram &get_streaming();
+
+    /** Get histogram data as a JSON object. */
+    json to_json();
+
+  private:
+    std::optional<BinnedHistogram> binned_; /**< Fixed-range histogram */
+    StreamingHistogram streaming_;          /**< Auto-ranging histogram */
+};
+
 /** Collection of histograms associated with each operator in a NN
  * workload.
  */
@@ -110,6 +273,14 @@ class WorkloadHistograms {
     /** Destructor */
     virtual ~WorkloadHistograms();
 
+    /** Get histogram of a layer. It is created if it does not exist yet.
+     * The returned reference stays valid for the lifetime of this object.
+     */
+    LayerHistogram &get_or_add_histogram(uint32_t layer_id, float min,
+                                         float max, float bin_size = 1.0);
+    LayerHistogram &get_or_add_histogram(const char *l_name, float min,
+                                         float max, float bin_size = 1.0);
+
     /** Check if histogram already exists for a layer. */
     bool has_histogram(std::string l_name);
 
@@ -118,7 +289,7 @@ class WorkloadHistograms {
                        float bin_size = 1.0);
 
     /** Get histogram associated with a layer. */
-    std::optional<std::reference_wrapper<BinnedHistogram>>
+    std::optional<std::reference_wrapper<LayerHistogram>>
     get_histogram(std::string l_name);
 
     /** Get histogram data as a JSON object. */
@@ -128,7 +299,9 @@ class WorkloadHistograms {
     std::string to_json_string();
 
   protected:
-    std::map<std::string, BinnedHistogram> hists_; /**< Layer histograms */
+    /** Layer histograms indexed by layer ID (see LayerRegistry) */
+    std::vector<std::unique_ptr<LayerHistogram>> hists_;
+    std::mutex mutex_; /**< Guards insertion and lookup in hists_ */
 };
 
 /** Singleton collection of histograms profiling ADC inputs. */
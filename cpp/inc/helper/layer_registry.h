@@ -0,0 +1,57 @@
+/******************************************************************************
+ * Copyright (C) 2025 Rebecca Pelke                                           *
+ * All Rights Reserved                                                        *
+ *                                                                            *
+ * This work is licensed under the terms described in the LICENSE file        *
+ * found in the root directory of this source tree.                           *
+ ******************************************************************************/
+#ifndef LAYER_REGISTRY_H
+#define LAYER_REGISTRY_H
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace nq {
+
+/*
+Interned layer names.
+Every layer name (l_name) is mapped to a dense ID (0, 1, 2, ...) on first use.
+IDs are never reused, so per-layer data can be stored in vectors indexed by
+the layer ID. Callers intern a name once and pass the ID on every operation.
+ID 0 is the default layer "Unknown".
+*/
+class LayerRegistry {
+  public:
+    LayerRegistry(const LayerRegistry &) = delete;
+    LayerRegistry &operator=(const LayerRegistry &) = delete;
+    virtual ~LayerRegistry() = default;
+
+    /** ID of the default layer name "Unknown" */
+    static constexpr uint32_t unknown_layer = 0;
+
+    /** Get singleton instance. */
+    static LayerRegistry &get_instance();
+
+    /** Get the ID of a layer. The layer is registered if it is unknown. */
+    uint32_t intern(const char *l_name);
+
+    /** Name of a registered layer. */
+    const std::string &get_name(uint32_t layer_id) const;
+
+    /** Number of registered layers. */
+    uint32_t size() const;
+
+  private:
+    LayerRegistry();
+
+    std::unordered_map<std::string, uint32_t> ids_;
+    std::deque<std::string> names_; // Stable references (get_name)
+    mutable std::mutex mutex_;
+};
+
+} // namespace nq
+
+#endif
@@ -0,0 +1,63 @@
+/******************************************************************************
+ * Copyright (C) 2025 Rebecca Pelke                                           *
+ * All Rights Reserved                                                        *
+ *                                                                            *
+ * This work is licensed under the terms described in the LICENSE file        *
+ * found in the root directory of this source tree.                           *
+ ******************************************************************************/
+#ifndef MATRIX_H
+#define MATRIX_H
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace nq {
+
+/*
+Dense row-major matrix with contiguous storage.
+mat[m][n] accesses element (m, n) like a nested std::vector, while data()
+exposes the complete matrix as one flat buffer (e.g. for numpy views or C
+callers). The storage is never reallocated unless assign() is called.
+*/
+template <typename T> class Matrix {
+  public:
+    Matrix() : rows_(0), cols_(0) {}
+    Matrix(size_t rows, size_t cols, const T &value = T()) :
+        rows_(rows), cols_(cols), data_(rows * cols, value) {}
+
+    void assign(size_t rows, size_t cols, const T &value = T()) {
+        rows_ = rows;
+        cols_ = cols;
+        data_.assign(rows * cols, value);
+    }
+    void fill(const T &value) { std::fill(data_.begin(), data_.end(), value); }
+
+    /** Pointer to the first element of a row. */
+    T *operator[](size_t row) { return data_.data() + row * cols_; }
+    const T *operator[](size_t row) const {
+        return data_.data() + row * cols_;
+    }
+
+    T *data() { return data_.data(); }
+    const T *data() const { return data_.data(); }
+    size_t rows() const { return rows_; }
+    size_t cols() const { return cols_; }
+    size_t size() const { return data_.size(); }
+    bool empty() const { return data_.empty(); }
+
+    bool operator==(const Matrix &other) const {
+        return (rows_ == other.rows_) && (cols_ == other.cols_) &&
+               (data_ == other.data_);
+    }
+    bool operator!=(const Matrix &other) const { return !(*this == other); }
+
+  private:
+    size_t rows_;
+    size_t cols_;
+    std::vector<T> data_;
+};
+
+} // namespace nq
+
+#endif
@@ -0,0 +1,68 @@
+/******************************************************************************
+ * Copyright (C) 2025 Rebecca Pelke                                           *
+ * All Rights Reserved                                                        *
+ *                                                                            *
+ * This work is licensed under the terms described in the LICENSE file        *
+ * found in the root directory of this source tree.                           *
+ ******************************************************************************/
+#ifndef PACKED_GEMV_H
+#define PACKED_GEMV_H
+
+#include <cstdint>
+#include <vector>
+
+#include "helper/matrix.h"
+
+namespace nq {
+
+/*
+Integer GEMV on a packed copy of a weight matrix.
+The weights are stored as int8 if all of them fit, otherwise as int16. The
+rows are padded with zeros to a multiple of 32 values. The inputs are
+converted to int16 for every GEMV. All products and sums are exact; the
+accumulation wraps around like int32 arithmetic, so the result is bit-exact
+with a scalar int32 loop.
+The kernel is selected at runtime: AVX-512 VNNI (vpdpwssd), AVX2 (vpmaddwd),
+or a scalar loop. The int8 weights are sign-extended to int16 in registers
+(vpmaddubsw is not used, its int16 pair sums saturate).
+*/
+class PackedGemv {
+  public:
+    enum class Kernel { SCALAR, AVX2, AVX512_VNNI };
+
+    PackedGemv();
+
+    /** Pack a row-major m_matrix x n_matrix matrix. Returns false (and
+     * clears the packed matrix) if a value does not fit int16. */
+    bool pack(const int64_t *mat, int32_t m_matrix, int32_t n_matrix);
+    void clear();
+    bool empty() const { return m_matrix_ == 0; }
+
+    /** Add the first m_matrix rows times vec[0..n_matrix) to res. Returns
+     * false (res unchanged) if the matrix is too small or an input does not
+     * fit int16. */
+    bool gemv(int32_t *res, const int32_t *vec, int32_t m_matrix,
+              int32_t n_matrix);
+
+    /** Best kernel supported by the CPU. */
+    static Kernel best_kernel();
+    /** Use another kernel, e.g. for testing (limited to best_kernel()). */
+    void set_kernel(Kernel kernel);
+    Kernel get_kernel() const { return kernel_; }
+    bool is_int8() const { return int8_; }
+
+  private:
+    static constexpr size_t pad = 32;
+
+    Kernel kernel_;
+    bool int8_;
+    int32_t m_matrix_;
+    int32_t n_matrix_;
+    Matrix<int8_t> w8_;   // Padded rows (int8_)
+    Matrix<int16_t> w16_; // Padded rows (!int8_)
+    std::vector<int16_t> vec_;
+};
+
+} // namespace nq
+
+#endif
@@ -0,0 +1,185 @@
+/******************************************************************************
+ * Copyright (C) 2025 Rebecca Pelke                                           *
+ * All Rights Reserved                                                        *
+ *                                                                            *
+ * This work is licensed under the terms described in the LICENSE file        *
+ * found in the root directory of this source tree.                           *
+ ******************************************************************************/
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "nlohmann/json.hpp"
+
+namespace nq {
+
+/** Phases of a crossbar operation */
+enum class ProfilePhase : uint32_t {
+    MVM,            // Crossbar::mvm (including digital MVMs)
+    WRITE,          // Crossbar::write
+    INPUT_ENCODING, // Input vector to read voltages
+    BIT_SLICING,    // Input bit slices (INT mappings)
+    ACCUMULATION,   // Column currents without parasitics
+    PARASITICS,     // Column currents with parasitics (solver)
+    ADC,            // ADC conversion
+    VARIABILITY,    // Cycle-to-cycle variation
+    READ_DISTURB,   // Read disturb conductance update
+    REFRESH,        // Read disturb mitigation
+    NUM_PHASES
+};
+
+/** Name of a phase in the exported profiles. */
+const char *phase_to_string(ProfilePhase phase);
+
+/*
+Per-phase and per-layer timers.
+Every ProfileScope adds its duration to the counter of its phase and of the
+current layer (ProfileLayerScope). Nested scopes are subtracted from the self
+time of the enclosing scope, so the self times of all phases add up to the
+profiled time. Counters are kept per thread and merged on export. Export and
+reset must not run concurrently with profiled operations.
+*/
+class Profiler {
+  public:
+    Profiler(const Profiler &) = delete;
+    Profiler &operator=(const Profiler &) = delete;
+    virtual ~Profiler() = default;
+
+    /** Get singleton instance. */
+    static Profiler &get_instance();
+
+    /** True if the library was built with profiling scopes (PROFILING). */
+    static bool is_compiled();
+
+    /** Enable or disable recording at runtime.
+     *
+     * @param enabled Record the counters
+     * @param trace Additionally record every scope as a trace event
+     */
+    void set_enabled(bool enabled, bool trace = false);
+
+    bool is_enabled() const {
+        return enabled_.load(std::memory_order_relaxed);
+    }
+    bool is_tracing() const {
+        return tracing_.load(std::memory_order_relaxed);
+    }
+
+    /** Discard all counters and trace events. */
+    void reset();
+
+    /** Record one scope.
+     *
+     * @param phase Phase of the scope
+     * @param layer_id Layer ID (see LayerRegistry)
+     * @param start_ns Start time (now_ns)
+     * @param total_ns Duration including nested scopes
+     * @param self_ns Duration without nested scopes
+     */
+    void record(ProfilePhase phase, uint32_t layer_id, uint64_t start_ns,
+                uint64_t total_ns, uint64_t self_ns);
+
+    /** Calls, total and self nanoseconds per layer and phase. */
+    nlohmann::json to_json() const;
+
+    /** Trace events in Chrome trace-event format (chrome://tracing). */
+    nlohmann::json to_chrome_trace() const;
+
+    /** Monotonic time in nanoseconds. */
+    static uint64_t now_ns();
+
+  private:
+    Profiler();
+
+    struct Counter {
+        uint64_t calls = 0;
+        uint64_t total_ns = 0;
+        uint64_t self_ns = 0;
+    };
+
+    struct TraceEvent {
+        ProfilePhase phase;
+        uint32_t layer_id;
+        uint64_t start_ns;
+        uint64_t dur_ns;
+    };
+
+    struct ThreadData {
+        uint32_t tid;
+        std::vector<Counter> counters; // Index: layer_id * NUM_PHASES + phase
+        std::vector<TraceEvent> events;
+        uint64_t dropped_events = 0;
+    };
+
+    ThreadData &get_thread_data();
+
+    std::atomic<bool> enabled_;
+    std::atomic<bool> tracing_;
+    std::atomic<uint64_t> epoch_ns_; // Time origin of the trace events
+    mutable std::mutex mutex_;       // Guards threads_
+    std::vector<std::unique_ptr<ThreadData>> threads_;
+};
+
+/** Times the enclosing block (see ACS_PROFILE_SCOPE). */
+class ProfileScope {
+  public:
+    explicit ProfileScope(ProfilePhase phase) :
+        phase_(phase), active_(Profiler::get_instance().is_enabled()) {
+        if (active_) {
+            begin();
+        }
+    }
+    ProfileScope(const ProfileScope &) = delete;
+    ~ProfileScope() {
+        if (active_) {
+            end();
+        }
+    }
+
+  private:
+    void begin();
+    void end();
+
+    ProfilePhase phase_;
+    bool active_;
+    uint64_t start_ns_ = 0;
+    uint64_t child_ns_ = 0; // Time of nested scopes
+    ProfileScope *parent_ = nullptr;
+};
+
+/** Assigns the scopes of the enclosing block to a layer. */
+class ProfileLayerScope {
+  public:
+    explicit ProfileLayerScope(uint32_t layer_id);
+    ProfileLayerScope(const ProfileLayerScope &) = delete;
+    ~ProfileLayerScope();
+
+  private:
+    uint32_t prev_layer_id_;
+};
+
+} // namespace nq
+
+#define ACS_PROFILE_CONCAT_(a, b) a##b
+#define ACS_PROFILE_CONCAT(a, b) ACS_PROFILE_CONCAT_(a, b)
+
+// The scopes are only compiled in with -DPROFILING=ON (ACS_PROFILING)
+#ifdef ACS_PROFILING
+#define ACS_PROFILE_SCOPE(phase)                                               \
+    ::nq::ProfileScope ACS_PROFILE_CONCAT(acs_profile_scope_, __LINE__)(       \
+        ::nq::ProfilePhase::phase)
+#define ACS_PROFILE_LAYER(layer_id)                                            \
+    ::nq::ProfileLayerScope ACS_PROFILE_CONCAT(acs_profile_layer_,             \
+                                               __LINE__)(layer_id)
+#else
+#define ACS_PROFILE_SCOPE(phase)
+#define ACS_PROFILE_LAYER(layer_id)
+#endif
+
+#endif
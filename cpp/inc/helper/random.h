@@ -0,0 +1,61 @@
+/******************************************************************************
+ * Copyright (C) 2025 Rebecca Pelke                                           *
+ * All Rights Reserved                                                        *
+ *                                                                            *
+ * This work is licensed under the terms described in the LICENSE file        *
+ * found in the root directory of this source tree.                           *
+ ******************************************************************************/
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <cmath>
+#include <cstdint>
+
+namespace nq {
+
+/*
+Counter-based (stateless) random number generator.
+Every sample is a pure function of (seed, key, counter), e.g. (cell, epoch).
+Samples can therefore be drawn in any order and from any thread while the
+result stays identical, independent of the number of threads used.
+*/
+class CounterRNG {
+  public:
+    explicit CounterRNG(uint64_t seed = 0) : seed_(seed) {}
+
+    /** Uniformly distributed 64-bit value for (key, counter). */
+    uint64_t bits(uint64_t key, uint64_t counter) const {
+        uint64_t x = mix(seed_ ^ mix(key + 0x9E3779B97F4A7C15ULL));
+        return mix(x ^ mix(counter + 0xD1B54A32D192ED03ULL));
+    }
+
+    /** Uniformly distributed float in (0, 1]. */
+    float uniform(uint64_t key, uint64_t counter) const {
+        return ((bits(key, counter) >> 40) + 1) * (1.0f / 16777216.0f);
+    }
+
+    /** Standard normal distributed sample (Box-Muller). */
+    float normal(uint64_t key, uint64_t counter) const {
+        uint64_t b = bits(key, counter);
+        float u1 = ((b >> 40) + 1) * (1.0f / 16777216.0f);
+        float u2 = ((b & 0xFFFFFF) + 1) * (1.0f / 16777216.0f);
+        return std::sqrt(-2.0f * std::log(u1)) *
+               std::cos(6.28318530717958647692f * u2);
+    }
+
+    uint64_t get_seed() const { return seed_; }
+
+  private:
+    // Finalizer of SplitMix64
+    static uint64_t mix(uint64_t x) {
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return x ^ (x >> 31);
+    }
+
+    uint64_t seed_;
+};
+
+} // namespace nq
+
+#endif
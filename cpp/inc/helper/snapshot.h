@@ -0,0 +1,176 @@
+/******************************************************************************
+ * Copyright (C) 2025 Rebecca Pelke                                           *
+ * All Rights Reserved                                                        *
+ *                                                                            *
+ * This work is licensed under the terms described in the LICENSE file        *
+ * found in the root directory of this source tree.                           *
+ ******************************************************************************/
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include "helper/matrix.h"
+
+namespace nq {
+
+/*
+Binary snapshot of the crossbar state.
+
+Layout (host byte order, version 6):
+  [Header]         magic "ACSSNAP\0", version, number of sections
+  [Section table]  per section: id, dtype, rows, cols, byte offset
+  [Payload]        row-major section data, each section 64-byte aligned
+
+The payload of every section is stored contiguously. A snapshot can
+therefore be memory-mapped and restored with one memcpy per row.
+State that a config does not use is not allocated; its sections are empty
+(0 x 0).
+*/
+enum class SnapshotSection : uint32_t {
+    XBAR_CONFIG = 0,
+    XBAR_COUNTERS = 1,
+    GD_P = 2,
+    GD_M = 3,
+    SUM_W = 4,
+    IA_P = 5,
+    IA_M = 6,
+    IA_P_ORIG = 7,
+    IA_M_ORIG = 8,
+    MAPPER_COUNTERS = 9,
+    PAR_GA_MAT = 10,
+    PAR_GA_WIRE = 11,
+    RD_CYCLES_P = 12,
+    RD_CYCLES_M = 13,
+    RD_CONSECUTIVE_READS_P = 14,
+    RD_CONSECUTIVE_READS_M = 15
+};
+
+/** Data type tag of a section: kind (float/signed/unsigned) | size */
+template <typename T> constexpr uint32_t snapshot_dtype() {
+    return (std::is_floating_point_v<T> ? 0x100
+            : std::is_signed_v<T>       ? 0x200
+                                        : 0x300) |
+           sizeof(T);
+}
+
+class SnapshotWriter {
+  public:
+    SnapshotWriter() = default;
+    SnapshotWriter(const SnapshotWriter &) = delete;
+    virtual ~SnapshotWriter() = default;
+
+    /** Add a matrix section. The data is referenced until write(). */
+    template <typename T>
+    void add(SnapshotSection id, const std::vector<std::vector<T>> &mat) {
+        Section section{id, snapshot_dtype<T>(), sizeof(T), mat.size(),
+                        mat.empty() ? 0 : mat[0].size(), {}};
+        for (const std::vector<T> &row : mat) {
+            section.rows_data.push_back(row.data());
+        }
+        sections_.push_back(section);
+    }
+
+    /** Add a contiguous matrix section. */
+    template <typename T> void add(SnapshotSection id, const Matrix<T> &mat) {
+        Section section{id, snapshot_dtype<T>(), sizeof(T), mat.rows(),
+                        mat.cols(), {}};
+        for (size_t r = 0; r < mat.rows(); ++r) {
+            section.rows_data.push_back(mat[r]);
+        }
+        sections_.push_back(section);
+    }
+
+    /** Add a vector section (single row). */
+    template <typename T>
+    void add(SnapshotSection id, const std::vector<T> &vec) {
+        Section section{id,         snapshot_dtype<T>(), sizeof(T), 1,
+                        vec.size(), {vec.data()}};
+        sections_.push_back(section);
+    }
+
+    /** Write all sections to a snapshot file. */
+    bool write(const char *path) const;
+
+  private:
+    struct Section {
+        SnapshotSection id;
+        uint32_t dtype;
+        uint32_t elem_size;
+        uint64_t rows;
+        uint64_t cols;
+        std::vector<const void *> rows_data;
+    };
+    std::vector<Section> sections_;
+};
+
+class SnapshotReader {
+  public:
+    SnapshotReader() = default;
+    SnapshotReader(const SnapshotReader &) = delete;
+    virtual ~SnapshotReader();
+
+    /** Memory-map a snapshot file and validate its header. */
+    bool open(const char *path);
+    bool has(SnapshotSection id) const;
+    bool shape(SnapshotSection id, uint64_t &rows, uint64_t &cols) const;
+
+    /** Check that a section of element type T with the given shape exists
+     * (the condition of read), without copying it. */
+    template <typename T>
+    bool check(SnapshotSection id, uint64_t rows, uint64_t cols) const {
+        return find(id, snapshot_dtype<T>(), rows, cols) != nullptr;
+    }
+
+    /** Copy a matrix section into mat. The shape of mat must match. */
+    template <typename T>
+    bool read(SnapshotSection id, std::vector<std::vector<T>> &mat) const {
+        size_t cols = mat.empty() ? 0 : mat[0].size();
+        const char *src = find(id, snapshot_dtype<T>(), mat.size(), cols);
+        if (src == nullptr) {
+            return false;
+        }
+        for (size_t r = 0; r < mat.size(); ++r) {
+            std::memcpy(mat[r].data(), src + r * cols * sizeof(T),
+                        cols * sizeof(T));
+        }
+        return true;
+    }
+
+    /** Copy a contiguous matrix section into mat. The shape must match. */
+    template <typename T>
+    bool read(SnapshotSection id, Matrix<T> &mat) const {
+        const char *src =
+            find(id, snapshot_dtype<T>(), mat.rows(), mat.cols());
+        if (src == nullptr) {
+            return false;
+        }
+        std::memcpy(mat.data(), src, mat.size() * sizeof(T));
+        return true;
+    }
+
+    /** Copy a vector section into vec. The size of vec must match. */
+    template <typename T>
+    bool read(SnapshotSection id, std::vector<T> &vec) const {
+        const char *src = find(id, snapshot_dtype<T>(), 1, vec.size());
+        if (src == nullptr) {
+            return false;
+        }
+        std::memcpy(vec.data(), src, vec.size() * sizeof(T));
+        return true;
+    }
+
+  private:
+    const char *find(SnapshotSection id, uint32_t dtype, uint64_t rows,
+                     uint64_t cols) const;
+
+    const char *data_ = nullptr;
+    size_t size_ = 0;
+};
+
+} // namespace nq
+
+#endif
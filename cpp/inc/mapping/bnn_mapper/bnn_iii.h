@@ -28,7 +28,7 @@ class MapperBnnIII : public Mapper {
                int32_t m_matrix, int32_t n_matrix) override;
     void a_mvm(int32_t *res, const int32_t *vec, const int32_t *mat,
                int32_t m_matrix, int32_t n_matrix,
-               const char *l_name = "Unknown") override;
+               uint32_t layer_id = LayerRegistry::unknown_layer) override;
 
   private:
     // Temporary data for MVM
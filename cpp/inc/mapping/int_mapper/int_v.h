@@ -28,9 +28,11 @@ class MapperIntV : public Mapper {
                int32_t m_matrix, int32_t n_matrix) override;
     void a_mvm(int32_t *res, const int32_t *vec, const int32_t *mat,
                int32_t m_matrix, int32_t n_matrix,
-               const char *l_name = "Unknown") override;
+               uint32_t layer_id = LayerRegistry::unknown_layer) override;
+    void update_analog_params() override;
 
   private:
+    void update_delta();
     float delta_;
     // Temporary data for MVM
     std::vector<int32_t> vd_p_;
@@ -13,15 +13,37 @@
 #include <random>
 #include <vector>
 
+#include "helper/conductance_matrix.h"
+#include "helper/layer_registry.h"
+#include "helper/matrix.h"
+#include "helper/packed_gemv.h"
+#include "helper/profiler.h"
+#include "helper/random.h"
+#include "helper/snapshot.h"
 #include "xbar/adc.h"
 #include "xbar/parasitics.h"
 #include "xbar/read_disturb.h"
 
 namespace nq {
 
+/** Output range hint of an MVM: the caller clips the results to [min, max]
+ * (e.g. a following ReLU or clip), so a row only needs to be computed until
+ * its clipped result is decided. */
+struct OutputRange {
+    int32_t min;
+    int32_t max;
+};
+
 class Mapper {
   public:
-    Mapper(bool is_diff_weight_mapping);
+    /** Constructor
+     *
+     * @param is_diff_weight_mapping Weights are the difference of gd_p_ and
+     * gd_m_ (read disturb and refreshes affect both arrays)
+     * @param has_m_array The mapping uses gd_m_/ia_m_ (otherwise they are
+     * not allocated)
+     */
+    Mapper(bool is_diff_weight_mapping, bool has_m_array = true);
     Mapper(const Mapper &) = delete;
     virtual ~Mapper() = default;
 
@@ -32,27 +54,63 @@ class Mapper {
                        int32_t m_matrix, int32_t n_matrix) = 0;
     virtual void a_mvm(int32_t *res, const int32_t *vec, const int32_t *mat,
                        int32_t m_matrix, int32_t n_matrix,
-                       const char *l_name) = 0;
+                       uint32_t layer_id) = 0;
+    /** Digital MVM with the packed weights of INT mappings (see d_pack).
+     * Returns false if the packed GEMV does not apply, d_mvm is used then. */
+    bool d_mvm_packed(int32_t *res, const int32_t *vec, const int32_t *mat,
+                      int32_t m_matrix, int32_t n_matrix);
     static std::unique_ptr<Mapper> create_from_config();
-    const std::vector<std::vector<int32_t>> &get_gd_p() const;
-    const std::vector<std::vector<int32_t>> &get_gd_m() const;
-    const std::vector<std::vector<float>> &get_ia_p() const;
-    const std::vector<std::vector<float>> &get_ia_m() const;
+    const Matrix<uint8_t> &get_gd_p() const;
+    const Matrix<uint8_t> &get_gd_m() const;
+    const Matrix<float> &get_ia_p() const;
+    const Matrix<float> &get_ia_m() const;
     void rd_update_conductance(std::shared_ptr<const ReadDisturb> rd_model,
                                const uint64_t read_num);
     void rd_update_conductance(
         std::shared_ptr<const ReadDisturb> rd_model,
-        const std::vector<std::vector<uint64_t>> &consecutive_reads_p,
-        const std::vector<std::vector<uint64_t>> &consecutive_reads_m);
+        const Matrix<uint64_t> &consecutive_reads_p,
+        const Matrix<uint64_t> &consecutive_reads_m);
     bool rd_check_software_refresh(std::shared_ptr<const ReadDisturb> rd_model,
                                    const uint64_t read_num,
                                    const uint64_t write_num);
     int rd_cell_based_refresh(std::shared_ptr<ReadDisturb> rd_model);
     bool is_diff_weight_mapping() const;
+    bool has_m_array() const { return has_m_array_; }
 
     void a_add_c2c_var(int32_t m_matrix, int32_t n_matrix);
     void a_remove_c2c_var(int32_t m_matrix, int32_t n_matrix);
 
+    void save_state(SnapshotWriter &writer) const;
+    /** Restore the state of save_state. The exact path and the packed
+     * weights are rebuilt for the written region (m_written x n_written). */
+    bool load_state(const SnapshotReader &reader, int32_t m_written,
+                    int32_t n_written);
+    /** Check that load_state would succeed, without changing the state. */
+    bool check_state(const SnapshotReader &reader) const;
+
+    /** Key of the random streams of this crossbar (e.g. tile or instance
+     * index). Crossbars with the same rng_seed and stream draw the same
+     * samples. */
+    void set_rng_stream(uint64_t stream) { rng_stream_ = stream; }
+    /** Draw new device-to-device variability with the next a_write (a new
+     * write). Until then, a_write re-applies the last draw. */
+    void new_d2d_draw() { ++d2d_draw_; }
+
+    /** Output range of the next a_mvm calls (nullptr: exact, default). With
+     * a range, the analog INT mappings read the input bits MSB first and
+     * stop reading the rows whose clipped result is decided. */
+    void set_output_range(const OutputRange *range) { out_range_ = range; }
+
+    // Hot config updates (crossbar dimensions unchanged)
+    /** Recreate the ADC (adc_type, resolution). */
+    void reset_adc();
+    /** Recreate or remove the parasitic solver (parasitics, w_res, V_read).
+     * The conductances are set by the next a_write. */
+    void reset_par_solver();
+    /** Recompute the parameters derived from HRS, LRS, the state noise, and
+     * rng_seed. The currents are updated by the next a_write. */
+    virtual void update_analog_params();
+
   protected:
     void d_write_diff(const int32_t *mat, int32_t m_matrix, int32_t n_matrix);
     void d_write_diff_bnn(const int32_t *mat, int32_t m_matrix,
@@ -62,39 +120,187 @@ class Mapper {
     void d_write_offs(const int32_t *mat, int32_t m_matrix, int32_t n_matrix);
     void d_write_tc_tnn(const int32_t *mat, int32_t m_matrix, int32_t n_matrix,
                         bool offset);
+    void d_pack(int32_t m_matrix, int32_t n_matrix);
     void a_write_p_m(int32_t m_matrix, int32_t n_matrix);
     void a_write_p_m_bnn_tnn(int32_t m_matrix, int32_t n_matrix);
     void a_write_p(int32_t m_matrix, int32_t n_matrix);
     void a_write_p_bnn(int32_t m_matrix, int32_t n_matrix);
 
     bool is_diff_weight_mapping_;
+    bool has_m_array_;
 
     // Helper functions
-    void slice_vd(std::vector<int32_t> &vd, std::vector<int32_t> &vd_slice,
-                  size_t n, size_t i_bit);
+    /** Input chunk of the bits i_bit .. min(i_bit + CFG.dac_bits, end_bit)
+     * - 1 of vd (DAC level of one array read). */
+    void slice_vd(const std::vector<int32_t> &vd,
+                  std::vector<int32_t> &vd_slice, size_t n, size_t i_bit,
+                  size_t end_bit);
+
+    // Exact analog fast path (BNN/TNN, see update_exact_path)
+    bool use_exact_path(int32_t m_matrix, int32_t n_matrix) const;
+    void update_exact_path(int32_t m_matrix, int32_t n_matrix, bool with_m);
+    /** Pack the inputs vd[0..n_matrix) into 64-bit words. Returns false if an
+     * input is not binary (no fast path). */
+    bool pack_bits(const std::vector<int32_t> &vd, int32_t n_matrix,
+                   std::vector<uint64_t> &bits) const;
+    /** Add sign * popcount(gd_bits row & bits) to levels_ for every row. */
+    void add_levels(const std::vector<uint64_t> &gd_bits,
+                    const std::vector<uint64_t> &bits, int32_t sign,
+                    int32_t m_matrix, int32_t n_matrix);
+    /** Set tmp to the currents base + levels_ * (LRS - HRS) and convert
+     * them with the ADC lookup table of the slot. */
+    void convert_levels(std::vector<float> &tmp, int32_t m_matrix, float base,
+                        int32_t min_level, int32_t max_level, float scale,
+                        float offset, uint32_t layer_id, uint32_t slot);
+    /** Differential column currents sign * (ia_p_ - ia_m_) * vd, converted
+     * with scale (exact fast path). Returns false if the fast path does not
+     * apply, tmp is unchanged in this case. */
+    bool exact_diff_mvm(const std::vector<int32_t> &vd, int32_t sign,
+                        int32_t m_matrix, int32_t n_matrix, float scale,
+                        uint32_t layer_id, uint32_t slot,
+                        std::vector<float> &tmp);
+    /** Column currents ia * vd (exact from popcounts if possible). */
+    void column_currents(const ConductanceMatrix &ia,
+                         const std::vector<uint64_t> &gd_bits,
+                         const std::vector<int32_t> &vd, int32_t m_matrix,
+                         int32_t n_matrix, std::vector<float> &out);
+    /** Column currents of ia_p_ and ia_m_ for the inputs vd_p and vd_m in
+     * one sweep over the weights: out[0..4 * m_matrix) receives ia_p_ * vd_p,
+     * ia_p_ * vd_m, ia_m_ * vd_p and ia_m_ * vd_m (m_matrix values each,
+     * same values as column_currents). */
+    void column_currents_pm(const std::vector<int32_t> &vd_p,
+                            const std::vector<int32_t> &vd_m,
+                            int32_t m_matrix, int32_t n_matrix,
+                            std::vector<float> &out);
+    /** C2C variability with c2c_model column_aggregate (no-op otherwise):
+     * add one Gaussian sample per column current out[m] of the cells gd read
+     * with vd. Its variance is the sum of the variances of the cells. */
+    void add_column_noise(const Matrix<uint8_t> &gd,
+                          const std::vector<int32_t> &vd, int32_t m_matrix,
+                          int32_t n_matrix, std::vector<float> &out);
+    void add_column_noise(const Matrix<uint8_t> &gd,
+                          const std::vector<int32_t> &vd, int32_t m_matrix,
+                          int32_t n_matrix, float *out);
 
-    // Parameters for the digital crossbar
-    std::vector<std::vector<int32_t>> gd_p_;
-    std::vector<std::vector<int32_t>> gd_m_;
+    // Parameters for the digital crossbar (cell levels, at most 8 bits)
+    Matrix<uint8_t> gd_p_;
+    Matrix<uint8_t> gd_m_;
     std::vector<uint32_t> shift_;
     std::vector<int32_t> sum_w_;
+    PackedGemv d_gemv_;            // Packed weights (digital INT mappings)
+    std::vector<int32_t> d_vec_;   // Effective inputs of d_gemv_
+    std::vector<int32_t> d_check_; // Reference result (packed_gemv_check)
 
-    // Parameters for the analog crossbar
-    std::vector<std::vector<float>> ia_p_;
-    std::vector<std::vector<float>> ia_m_;
-    std::vector<std::vector<float>> ia_p_orig_;
-    std::vector<std::vector<float>> ia_m_orig_;
+    // Parameters for the analog crossbar (conductance_precision). The
+    // matrices are only allocated if the config uses them: ia_p_/ia_m_ in
+    // analog mode, ia_m_ (and gd_m_) if has_m_array_, and the currents as
+    // written (ia_*_orig_) once C2C variability is enabled (see keep_orig).
+    ConductanceMatrix ia_p_;
+    ConductanceMatrix ia_m_;
+    ConductanceMatrix ia_p_orig_;
+    ConductanceMatrix ia_m_orig_;
+    std::vector<float> ia_row_p_; // fp32 rows of ia_p_/ia_m_ (see row())
+    std::vector<float> ia_row_m_;
     std::vector<float> i_step_size_;
     int num_segments_;
     float i_mm_;
-    const std::unique_ptr<ADC> adc_;
+    std::unique_ptr<ADC> adc_;
     std::shared_ptr<ParasiticSolver> par_solver_; // Parasitic resistance solver
 
+    // Exact analog fast path: bit-packed rows of gd_p_/gd_m_ (LRS cells),
+    // packed inputs, and integer column levels
+    std::vector<uint64_t> gd_p_bits_;
+    std::vector<uint64_t> gd_m_bits_;
+    std::vector<uint64_t> vd_bits_;
+    std::vector<uint64_t> vd_bits_m_;
+    std::vector<int32_t> levels_;
+    float exact_hrs_; // Cell currents of the fast path
+    float exact_lrs_;
+
+    // Bit-serial reads of the analog INT mappings
+    /** One array read: the input chunk of *vd at i_bit (slice_vd up to
+     * end_bit), added to the result with sign * 2^i_bit. */
+    struct InputPlane {
+        const std::vector<int32_t> *vd;
+        uint32_t i_bit;
+        uint32_t end_bit;
+        int32_t sign;
+    };
+    std::vector<InputPlane> planes_; // Reads of one MVM (built by a_mvm)
+    /** Prepare the reads of planes_: unchanged without an output range.
+     * Otherwise they are sorted MSB first and the rows that are decided
+     * before the first read (res only) are marked. */
+    void begin_planes(const int32_t *res, int32_t m_matrix, int32_t n_matrix);
+    /** Mark the rows that are decided after the reads planes_[0..k]. The
+     * partial result of row m is res[m] (+ res_fp[m] if res_fp is given). */
+    void end_plane(size_t k, const int32_t *res, int32_t m_matrix,
+                   const float *res_fp = nullptr);
+    /** Row m is decided (output range only); its reads can be skipped. */
+    bool row_done(size_t m) const { return out_range_ && row_done_[m]; }
+    /** Number of decided rows (0 without output range). */
+    int32_t rows_done() const { return out_range_ ? rows_done_ : 0; }
+    /** ADC read of planes_ entry plane for the differential INT mappings
+     * (ia_p_ - ia_m_, all SPLIT segments), added to res. Decided rows are
+     * skipped. */
+    void a_read_plane_diff(int32_t *res, const InputPlane &plane,
+                           int32_t m_matrix, int32_t n_matrix,
+                           uint32_t layer_id, std::vector<int32_t> &vd_slice,
+                           std::vector<float> &tmp_out);
+    /** Record the ADC inputs tmp_out of the rows that are not decided. */
+    void observe_open_rows(const std::vector<float> &tmp_out,
+                           int32_t m_matrix, uint32_t layer_id);
+    const OutputRange *out_range_ = nullptr;
+
   private:
+    // Exact analog fast path: the currents of the region exact_m_ x exact_n_
+    // were checked by update_exact_path
+    bool exact_path_;
+    int32_t exact_m_;
+    int32_t exact_n_;
+    size_t bit_words_; // 64-bit words per packed row
+
+    // Early termination of the bit-serial reads (output range)
+    void decide_rows(size_t next, const int32_t *res, int32_t m_matrix,
+                     const float *res_fp);
+    /** Sums of the positive and negative weights per row (from gd_p_/gd_m_,
+     * cached until the next write). */
+    void update_weight_bounds(int32_t m_matrix, int32_t n_matrix);
+    std::vector<int64_t> w_pos_sum_;
+    std::vector<int64_t> w_neg_sum_;
+    int32_t w_bounds_m_ = -1; // Rows of the cached sums (-1: invalid)
+    int32_t w_bounds_n_ = -1;
+    // Largest contribution of the reads planes_[k..] with sign +1 (rem_p_)
+    // and -1 (rem_m_) per unit weight
+    std::vector<double> rem_p_;
+    std::vector<double> rem_m_;
+    std::vector<uint8_t> row_done_;
+    int32_t rows_done_ = 0;
+
     // State variability
-    float add_gaussian_noise(float mean, int32_t mask);
-    std::normal_distribution<float> hrs_var_;
-    std::normal_distribution<float> lrs_var_;
+    float add_gaussian_noise(float mean, int32_t mask, float normal);
+    float d2d_sample(const CounterRNG &rng, uint64_t key,
+                     uint64_t array) const;
+    /** Allocate ia_*_orig_ (copy of the current state) if C2C variability
+     * is enabled. Returns true if they are allocated. */
+    bool keep_orig();
+
+    // Read disturb
+    void rd_update_array(ConductanceMatrix &ia, const Matrix<uint8_t> &gd,
+                         const Matrix<uint64_t> &cycles,
+                         const Matrix<uint64_t> *reads,
+                         const uint64_t read_num, const ReadDisturb &rd_model);
+    float rd_level_current(size_t row, int32_t level) const;
+    std::vector<std::vector<float>> rd_level_current_; // [segment][level]
+    void rd_refresh_scan(ConductanceMatrix &ia, const Matrix<uint8_t> &gd,
+                         uint64_t key_offset, uint64_t epoch,
+                         std::vector<uint64_t> &candidates);
+    CounterRNG rd_refresh_rng_; // Noise of refreshed cells, keyed by cell
+    uint64_t rd_refresh_epoch_; // Number of cell-based refresh scans
+
+    // Random streams (see set_rng_stream)
+    uint64_t rng_stream_;
+    uint64_t d2d_draw_;  // Number of device-to-device draws
+    uint64_t c2c_reads_; // Number of reads with C2C variability
 };
 
 } // namespace nq
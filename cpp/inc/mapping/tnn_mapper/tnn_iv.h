@@ -28,16 +28,14 @@ class MapperTnnIV : public Mapper {
                int32_t m_matrix, int32_t n_matrix) override;
     void a_mvm(int32_t *res, const int32_t *vec, const int32_t *mat,
                int32_t m_matrix, int32_t n_matrix,
-               const char *l_name = "Unknown") override;
+               uint32_t layer_id = LayerRegistry::unknown_layer) override;
 
   private:
     // Temporary data for MVM
     std::vector<int32_t> vd_p_;
     std::vector<int32_t> vd_m_;
-    std::vector<float> tmp_out_;
-    std::vector<float> tmp_out_lsb_;
-    std::vector<float> tmp_out_msb_;
-    std::vector<float> tmp_out_fp_;
+    std::vector<float> tmp_out_; // Currents of the four reads (4 x M)
+    std::vector<float> par_out_; // Interleaved LSB/MSB currents (parasitics)
 };
 
 } // namespace nq
@@ -12,9 +12,11 @@
 #include <cstdint>
 #include <functional>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "helper/histogram.h"
+#include "helper/layer_registry.h"
 
 namespace nq {
 
@@ -39,23 +41,57 @@ class ADC {
     /** Convert a vector of analog input currents to digital outputs. */
     virtual void convert(const std::vector<float> &in, std::vector<float> &out,
                          const int32_t len, float scale = 1.0,
-                         float offset = 0.0, const char *l_name = "Unknown");
+                         float offset = 0.0,
+                         uint32_t layer_id = LayerRegistry::unknown_layer);
 
     /** Convert an analog input current to digital output. */
     virtual float convert(const float current, float scale = 1.0,
                           float offset = 0.0,
-                          const char *l_name = "Unknown") = 0;
+                          uint32_t layer_id = LayerRegistry::unknown_layer) = 0;
+
+    /** Convert segments blocks of len currents in one pass: the block s
+     * (in[s * len .. (s + 1) * len)) is converted with scales[s] and
+     * offsets[s]. Gives the same outputs as one vector conversion per
+     * block. */
+    void convert_segments(const std::vector<float> &in,
+                          std::vector<float> &out, const int32_t len,
+                          const int32_t segments, const float *scales,
+                          const float *offsets,
+                          uint32_t layer_id = LayerRegistry::unknown_layer);
+
+    /** Convert currents in[i] = base + level[i] * step (exact analog fast
+     * path). Gives the same outputs as the vector conversion, but every level
+     * is converted only once: the outputs are kept in a lookup table per
+     * layer and slot until the conversion parameters or the ADC range change.
+     *
+     * @param in Input currents (recorded for profiling and calibration)
+     * @param levels Level of each current in [min_level, max_level]
+     * @param slot Conversion of the mapper (one lookup table per slot)
+     */
+    void convert_levels(const std::vector<float> &in,
+                        const std::vector<int32_t> &levels,
+                        std::vector<float> &out, const int32_t len, float base,
+                        float step, int32_t min_level, int32_t max_level,
+                        float scale, float offset, uint32_t layer_id,
+                        uint32_t slot);
+
+    /** Record ADC input currents for profiling and calibration (if enabled).
+     * Called by the vector conversion. Mappers that convert single currents
+     * call it once per block of currents.
+     */
+    void observe(const float *in, const int32_t len, float offset,
+                 uint32_t layer_id);
 
   protected:
     /** Get maximum and minimum currents to the ADC. */
-    std::pair<float, float> get_currents(const char *l_name = "Unknown");
+    std::pair<float, float> get_currents(uint32_t layer_id);
 
     /** Clip input current for given ADC ranges. */
     float clip(float current, float min_curr, float max_curr);
 
     /** Profile ADC inputs using histograms. */
-    void profile_inputs(const std::vector<float> &in, const int32_t len,
-                        const char *l_name);
+    void profile_inputs(const float *in, const int32_t len,
+                        uint32_t layer_id);
 
     /** Get maximum possible current to ADC */
     virtual float maximum_max_current() = 0;
@@ -63,10 +99,35 @@ class ADC {
     /** Get minimum possible current to ADC */
     virtual float maximum_min_current() = 0;
 
+    /** Largest input level of one array read (multi-bit DAC, dac_bits) */
+    static float max_dac_level();
+
     int32_t resolution_; /**< ADC resolution (number of bits) */
     int32_t steps_;      /**< Number of quantization steps */
     std::reference_wrapper<ADCHistograms>
         hists_; /**< Reference to singleton ADC input histograms */
+    uint32_t profile_layer_;         /**< Layer of the cached histogram */
+    LayerHistogram *profile_hist_;   /**< Cached histogram of last layer */
+    uint32_t calib_layer_;           /**< Layer of calib_hist_ */
+    StreamingHistogram *calib_hist_; /**< Cached calibration histogram */
+    uint64_t calib_generation_;      /**< Calibration pass of calib_hist_ */
+
+  private:
+    /** Outputs of convert_levels for one set of conversion parameters */
+    struct LevelTable {
+        float base = 0.0;
+        float step = 0.0;
+        int32_t min_level = 0;
+        int32_t max_level = -1;
+        float scale = 0.0;
+        float offset = 0.0;
+        std::pair<float, float> currents; /**< ADC range of the outputs */
+        std::vector<float> out;           /**< Output per level */
+        std::vector<bool> valid;          /**< Level already converted */
+    };
+    static constexpr uint32_t num_level_slots = 2;
+    /** Index: layer_id * num_level_slots + slot */
+    std::vector<LevelTable> level_tables_;
 };
 
 /** Ideal ADC with infinite resolution (no clipping/quantization). */
@@ -78,9 +139,9 @@ class ADCInfinite : public ADC {
     virtual ~ADCInfinite() = default;
 
     /** Convert an analog input current to digital output. */
-    virtual float convert(const float current, float scale = 1.0,
-                          float offset = 0.0,
-                          const char *l_name = "Unknown") override;
+    virtual float
+    convert(const float current, float scale = 1.0, float offset = 0.0,
+            uint32_t layer_id = LayerRegistry::unknown_layer) override;
 
   protected:
     /** Get maximum possible current to ADC */
@@ -99,9 +160,9 @@ class ADCUnsigned : public ADC {
     virtual ~ADCUnsigned() = default;
 
     /** Convert an analog input current to digital output. */
-    virtual float convert(const float current, float scale = 1.0,
-                          float offset = 0.0,
-                          const char *l_name = "Unknown") override;
+    virtual float
+    convert(const float current, float scale = 1.0, float offset = 0.0,
+            uint32_t layer_id = LayerRegistry::unknown_layer) override;
 
   protected:
     /** Get maximum possible current to ADC */
@@ -0,0 +1,106 @@
+/******************************************************************************
+ * Copyright (C) 2025 Rebecca Pelke                                           *
+ * All Rights Reserved                                                        *
+ *                                                                            *
+ * This work is licensed under the terms described in the LICENSE file        *
+ * found in the root directory of this source tree.                           *
+ ******************************************************************************/
+
+#ifndef ADC_CALIBRATION_H
+#define ADC_CALIBRATION_H
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "helper/histogram.h"
+
+namespace nq {
+
+/** Policies to derive the ADC clip range from the observed currents */
+enum class ADCCalibPolicy {
+    PERCENTILE, // Clip the tails beyond the given percentile
+    MSE,        // Minimize clipping + quantization mean squared error
+    KL          // Minimize KL divergence of the quantized distribution
+};
+
+/*
+In-process ADC calibration.
+Between begin() and end(), every ADC conversion records its input currents
+(including the conversion offset) in a per-layer streaming histogram. end()
+derives a clip range (min/max current) per layer and installs the result as
+adc_calib_dict in CALIB mode. The ADCs read the calibration dictionary on
+every conversion, so the crossbar does not need to be recreated.
+*/
+class ADCCalibration {
+  public:
+    ADCCalibration(const ADCCalibration &) = delete;
+    ADCCalibration &operator=(const ADCCalibration &) = delete;
+
+    /** Destructor */
+    virtual ~ADCCalibration() = default;
+
+    /** Get singleton instance. */
+    static ADCCalibration &get_instance();
+
+    /** Start a calibration pass. Previous statistics are discarded. */
+    void begin();
+
+    /** Stop the calibration pass and install the calibrated ranges.
+     *
+     * @param policy Policy to derive the clip range of a layer
+     * @param percentile Percentile (in %) for ADCCalibPolicy::PERCENTILE
+     * @param calib_dict Calibrated current range per layer
+     * @return False if the current ADC cannot be calibrated or no
+     * conversions were observed
+     */
+    bool end(ADCCalibPolicy policy, float percentile,
+             std::map<std::string, std::pair<float, float>> &calib_dict);
+
+    /** True while a calibration pass is running. */
+    bool is_active() const;
+
+    /** Incremented by every begin(). Invalidates cached histograms. */
+    uint64_t get_generation() const;
+
+    /** Get histogram of a layer. It is created if it does not exist yet.
+     *
+     * @param layer_id Layer ID (see LayerRegistry)
+     */
+    StreamingHistogram &get_or_add_histogram(uint32_t layer_id);
+
+    /** Derive the clip range of one layer.
+     *
+     * @param hist Histogram of the ADC input currents
+     * @param policy Calibration policy
+     * @param percentile Percentile (in %) for ADCCalibPolicy::PERCENTILE
+     * @param levels Number of ADC quantization levels
+     * @param symmetric Restrict to ranges symmetric around zero
+     */
+    static std::pair<float, float> clip_range(StreamingHistogram &hist,
+                                              ADCCalibPolicy policy,
+                                              float percentile, int64_t levels,
+                                              bool symmetric);
+
+  private:
+    /** Constructor
+     *
+     * Private constructor for singleton.
+     */
+    ADCCalibration();
+
+    std::atomic<bool> active_;         /**< Calibration pass is running */
+    std::atomic<uint64_t> generation_; /**< Number of calibration passes */
+    /** Layer currents, indexed by layer ID */
+    std::vector<std::unique_ptr<StreamingHistogram>> hists_;
+    std::mutex mutex_; /**< Guards insertion and lookup in hists_ */
+};
+
+} // namespace nq
+
+#endif
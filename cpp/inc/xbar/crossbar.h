@@ -10,6 +10,8 @@
 
 #include <cstdint>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "mapping/mapper.h"
 #include "xbar/read_disturb.h"
@@ -18,22 +20,32 @@ namespace nq {
 
 class Crossbar {
   public:
-    Crossbar();
+    /** rng_stream: key of the random streams of the crossbar (see
+     * Mapper::set_rng_stream). */
+    explicit Crossbar(uint64_t rng_stream = 0);
     Crossbar(const Crossbar &) = delete;
     virtual ~Crossbar();
 
     void write(const int32_t *mat, int32_t m_matrix, int32_t n_matrix);
+    /** res += mat * vec. With out_range, the results are clipped to the
+     * range and the analog INT mappings stop reading decided rows (see
+     * OutputRange). */
     void mvm(int32_t *res, const int32_t *vec, const int32_t *mat,
              int32_t m_matrix, int32_t n_matrix,
-             const char *l_name = "Unknown");
-    const std::vector<std::vector<int32_t>> &get_gd_p() const;
-    const std::vector<std::vector<int32_t>> &get_gd_m() const;
-    const std::vector<std::vector<float>> &get_ia_p() const;
-    const std::vector<std::vector<float>> &get_ia_m() const;
-    const std::vector<std::vector<uint64_t>> &get_cycles_p() const;
-    const std::vector<std::vector<uint64_t>> &get_cycles_m() const;
-    const std::vector<std::vector<uint64_t>> &get_consecutive_reads_p() const;
-    const std::vector<std::vector<uint64_t>> &get_consecutive_reads_m() const;
+             uint32_t layer_id = LayerRegistry::unknown_layer,
+             const OutputRange *out_range = nullptr);
+    const Matrix<uint8_t> &get_gd_p() const;
+    const Matrix<uint8_t> &get_gd_m() const;
+    const Matrix<float> &get_ia_p() const;
+    const Matrix<float> &get_ia_m() const;
+    const Matrix<uint64_t> &get_cycles_p() const;
+    const Matrix<uint64_t> &get_cycles_m() const;
+    const Matrix<uint64_t> &get_consecutive_reads_p() const;
+    const Matrix<uint64_t> &get_consecutive_reads_m() const;
+    /** Owner of the read disturb counters (nullptr if read disturb is
+     * disabled). It is replaced on V_read updates, so views of the counters
+     * must keep it alive. */
+    std::shared_ptr<const ReadDisturb> get_rd_model() const;
     uint64_t get_write_xbar_counter() const;
     uint64_t get_mvm_counter() const;
     uint64_t get_read_num() const;
@@ -41,7 +53,30 @@ class Crossbar {
     uint64_t get_refresh_cell_counter() const;
     bool get_rd_run_out_of_bounds() const;
 
+    /** Store the complete crossbar state in a binary snapshot file. */
+    bool save_state(const char *path) const;
+    /** Restore the crossbar state from a snapshot created by save_state.
+     * The crossbar configuration must match the one of the snapshot. */
+    bool load_state(const char *path);
+
+    /** Apply config updates that keep the crossbar dimensions (see
+     * Config::update_cfg). The ADC, parasitic solver, and read disturb model
+     * are recreated as needed and the stored weights are reprogrammed with
+     * the new cell currents. */
+    void reconfigure(const std::vector<std::string> &changed_keys);
+    /** Switch to the config profile of a layer (see Config::select_layer).
+     * The crossbar is reconfigured if its last applied profile differs,
+     * even if another crossbar already switched the config. */
+    void select_layer(uint32_t layer_id);
+    /** True if select_layer(layer_id) would neither switch the config nor
+     * reconfigure the crossbar. */
+    bool layer_selected(uint32_t layer_id) const;
+
   private:
+    /** Recreate/reprogram the parts of the crossbar that depend on the
+     * changed keys (reconfigure, select_layer). */
+    void apply_changed_keys(const std::vector<std::string> &changed_keys);
+
     std::unique_ptr<Mapper> mapper_;
     uint64_t write_xbar_counter_; // Number of write function calls
     uint64_t mvm_counter_;        // Number of MVM function calls
@@ -50,6 +85,10 @@ class Crossbar {
                                        // (without a write in between)
     uint64_t refresh_xbar_counter_;    // Number of complete crossbar refreshes
     uint64_t refresh_cell_counter_;    // Number of single-cell refreshes
+    int32_t m_written_; // Dimensions of the last write (for reconfigure)
+    int32_t n_written_;
+    uint32_t applied_layer_; // Config profile of the current state
+    std::vector<std::string> layer_changed_keys_; // Scratch (select_layer)
 };
 
 } // namespace nq
@@ -0,0 +1,82 @@
+/******************************************************************************
+ * Copyright (C) 2025 Rebecca Pelke                                           *
+ * All Rights Reserved                                                        *
+ *                                                                            *
+ * This work is licensed under the terms described in the LICENSE file        *
+ * found in the root directory of this source tree.                           *
+ ******************************************************************************/
+#ifndef LAYER_ENGINE_H
+#define LAYER_ENGINE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "xbar/crossbar.h"
+
+namespace nq {
+
+/*
+Weight matrix of arbitrary size on a grid of crossbar tiles.
+The matrix (m_matrix x n_matrix, row-major) is split into tiles of at most
+CFG.M x CFG.N values. Every tile is programmed once onto its own crossbar.
+The tile MVMs run in parallel; the partial sums of the tiles in one grid row
+(same outputs, different inputs) are added in a fixed order, so the result
+does not depend on the number of threads.
+*/
+class LayerEngine {
+  public:
+    LayerEngine() = default;
+    LayerEngine(const LayerEngine &) = delete;
+    virtual ~LayerEngine() = default;
+
+    /** Partition the matrix and program the tiles (new crossbars). */
+    void write(const int32_t *mat, int32_t m_matrix, int32_t n_matrix);
+    /** Add mat * vec to res (m_matrix values, like Crossbar::mvm). */
+    void mvm(int32_t *res, const int32_t *vec,
+             uint32_t layer_id = LayerRegistry::unknown_layer);
+
+    /** Apply non-structural config updates to all tiles (see
+     * Crossbar::reconfigure). */
+    void reconfigure(const std::vector<std::string> &changed_keys);
+    /** Rebuild the tiles with the current crossbar dimensions, e.g. after a
+     * structural config update. The stored weights are reprogrammed. */
+    void retile();
+    /** Switch to the config profile of a layer (see Config::select_layer). */
+    void select_layer(uint32_t layer_id);
+    /** See Crossbar::layer_selected (all tiles). */
+    bool layer_selected(uint32_t layer_id) const;
+
+    int32_t get_m_matrix() const { return m_matrix_; }
+    int32_t get_n_matrix() const { return n_matrix_; }
+    size_t get_grid_rows() const { return grid_rows_; }
+    size_t get_grid_cols() const { return grid_cols_; }
+    /** Crossbar of the tile in grid row r and grid column c. */
+    const Crossbar &get_tile(size_t r, size_t c) const;
+
+  private:
+    // Random streams of the tiles (the single crossbar uses stream 0)
+    static constexpr uint64_t rng_stream_base = uint64_t(1) << 32;
+
+    struct Tile {
+        std::unique_ptr<Crossbar> crossbar;
+        int32_t m_offset; // First output of the tile
+        int32_t n_offset; // First input of the tile
+        int32_t m_tile;
+        int32_t n_tile;
+        std::vector<int32_t> mat; // Tile weights (digital MVM)
+        std::vector<int32_t> res; // Partial sums of the last MVM
+    };
+
+    std::vector<int32_t> mat_; // Complete weight matrix (retile)
+    int32_t m_matrix_ = 0;
+    int32_t n_matrix_ = 0;
+    size_t grid_rows_ = 0;
+    size_t grid_cols_ = 0;
+    std::vector<Tile> tiles_; // Row-major grid
+};
+
+} // namespace nq
+
+#endif
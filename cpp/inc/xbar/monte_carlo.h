@@ -0,0 +1,88 @@
+/******************************************************************************
+ * Copyright (C) 2025 Rebecca Pelke                                           *
+ * All Rights Reserved                                                        *
+ *                                                                            *
+ * This work is licensed under the terms described in the LICENSE file        *
+ * found in the root directory of this source tree.                           *
+ ******************************************************************************/
+#ifndef MONTE_CARLO_H
+#define MONTE_CARLO_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "xbar/crossbar.h"
+
+namespace nq {
+
+/** Statistics of a Monte Carlo MVM batch (batch x m_matrix values are
+ * row-major per input vector) */
+struct MonteCarloStats {
+    std::vector<int64_t> digital; // Exact result, per output
+    std::vector<double> mean;     // Mean over the instances, per output
+    std::vector<double> var;      // Sample variance over the instances
+    std::vector<double> mse;      // Mean squared error vs digital, per instance
+    std::vector<double> mismatch; // Fraction != digital, per instance
+};
+
+/*
+Monte Carlo evaluation of one weight tile over device-to-device variability.
+The tile (at most CFG.M x CFG.N) is programmed onto num_instances crossbars;
+every write draws its own state noise (HRS_NOISE/LRS_NOISE), so the crossbars
+are independent device instances. An input batch is evaluated against all
+instances in one call: the instances run in parallel, and the outputs are
+stored instance-major (out[k][b][m]) so the statistics over the instances are
+accumulated on contiguous outputs. INT mappings and digital crossbars are
+programmed without state noise and are rejected (see check_config).
+*/
+class MonteCarlo {
+  public:
+    MonteCarlo() = default;
+    MonteCarlo(const MonteCarlo &) = delete;
+    virtual ~MonteCarlo() = default;
+
+    /** Program the matrix (row-major) onto num_instances new crossbars.
+     * Returns false (nothing programmed) if check_config fails. */
+    bool write(const int32_t *mat, int32_t m_matrix, int32_t n_matrix,
+               int32_t num_instances);
+    /** Evaluate batch input vectors (batch x n_matrix) on all instances.
+     * out receives num_instances x batch x m_matrix results (overwritten). */
+    void mvm(int32_t *out, const int32_t *vec, int32_t batch,
+             MonteCarloStats &stats,
+             uint32_t layer_id = LayerRegistry::unknown_layer);
+
+    /** Apply non-structural config updates to all instances (see
+     * Crossbar::reconfigure). */
+    void reconfigure(const std::vector<std::string> &changed_keys);
+    /** Reprogram new instances with the current config, e.g. after a
+     * structural config update (new device samples). Returns false if the
+     * programmed matrix no longer passes check_config. */
+    bool rewrite();
+    /** Switch to the config profile of a layer (see Config::select_layer). */
+    void select_layer(uint32_t layer_id);
+
+    /** Check that a m_matrix x n_matrix tile fits the crossbar and that the
+     * mapping draws device-to-device variability (BNN/TNN, not digital). */
+    static bool check_config(int32_t m_matrix, int32_t n_matrix);
+
+    int32_t get_m_matrix() const { return m_matrix_; }
+    int32_t get_n_matrix() const { return n_matrix_; }
+    int32_t get_num_instances() const { return instances_.size(); }
+    /** Crossbar of instance k. */
+    const Crossbar &get_instance(int32_t k) const;
+
+  private:
+    // Random streams of the instances (distinct from LayerEngine tiles)
+    static constexpr uint64_t rng_stream_base = uint64_t(2) << 32;
+
+    std::vector<int32_t> mat_;
+    int32_t m_matrix_ = 0;
+    int32_t n_matrix_ = 0;
+    std::vector<std::unique_ptr<Crossbar>> instances_;
+};
+
+} // namespace nq
+
+#endif
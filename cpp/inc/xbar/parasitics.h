@@ -13,7 +13,10 @@
 #include <unordered_map>
 #include <vector>
 
+#include "helper/conductance_matrix.h"
 #include "helper/definitions.h"
+#include "helper/matrix.h"
+#include "helper/snapshot.h"
 
 namespace nq {
 
@@ -38,7 +41,7 @@ class ParasiticSolver {
      * @param m_matrix Number of columns in conductance matrix
      * @param n_matrix Number of rows in conductance matrix
      */
-    void set_conductance_matrix(std::vector<std::vector<float>> &ia,
+    void set_conductance_matrix(const ConductanceMatrix &ia,
                                 int32_t m_matrix, int32_t n_matrix);
 
     /** Set conductance matrix for solver.
@@ -48,8 +51,8 @@ class ParasiticSolver {
      * @param m_matrix Number of columns in conductance matrix
      * @param n_matrix Number of rows in conductance matrix
      */
-    void set_conductance_matrix(std::vector<std::vector<float>> &ia_p,
-                                std::vector<std::vector<float>> &ia_m,
+    void set_conductance_matrix(const ConductanceMatrix &ia_p,
+                                const ConductanceMatrix &ia_m,
                                 int32_t m_matrix, int32_t n_matrix);
 
     /** Compute output current with parasitics.
@@ -80,6 +83,26 @@ class ParasiticSolver {
                           std::vector<int32_t> &vd_m, std::vector<float> &res,
                           int32_t m_matrix, int32_t n_matrix);
 
+    /** Add the conductance state of the solver to a snapshot.
+     *
+     * @param writer Snapshot writer
+     */
+    void save_state(SnapshotWriter &writer) const;
+
+    /** Restore the conductance state of the solver from a snapshot.
+     *
+     * @param reader Snapshot reader
+     * @return True if the state could be restored
+     */
+    bool load_state(const SnapshotReader &reader);
+
+    /** Check that load_state would succeed, without changing the state.
+     *
+     * @param reader Snapshot reader
+     * @return True if the snapshot holds a valid solver state
+     */
+    bool check_state(const SnapshotReader &reader) const;
+
     // Encoding function pointer types for different mappings
     typedef void (ParasiticSolver::*WeightEncFunc)(
         std::vector<std::vector<float>> &,
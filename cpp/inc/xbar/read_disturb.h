@@ -8,9 +8,13 @@
 #ifndef READ_DISTURB_H
 #define READ_DISTURB_H
 
+#include <atomic>
 #include <cstdint>
 #include <vector>
 
+#include "helper/matrix.h"
+#include "helper/snapshot.h"
+
 namespace nq {
 
 /*
@@ -20,18 +24,25 @@ Switching Memory", Link: https://ieeexplore.ieee.org/document/9580480
 */
 class ReadDisturb {
   public:
-    ReadDisturb(const float V_read);
+    /** Constructor
+     *
+     * @param V_read Read voltage applied to each crossbar row.
+     * @param has_m_array The mapping uses a second array (gd_m_), otherwise
+     * its counters are not allocated.
+     */
+    ReadDisturb(const float V_read, bool has_m_array = true);
     ReadDisturb(const ReadDisturb &) = delete;
     virtual ~ReadDisturb() = default;
 
-    const std::vector<std::vector<uint64_t>> &get_cycles_p() const;
-    const std::vector<std::vector<uint64_t>> &get_cycles_m() const;
-    const std::vector<std::vector<uint64_t>> &get_consecutive_reads_p() const;
-    const std::vector<std::vector<uint64_t>> &get_consecutive_reads_m() const;
+    const Matrix<uint64_t> &get_cycles_p() const;
+    const Matrix<uint64_t> &get_cycles_m() const;
+    const Matrix<uint64_t> &get_consecutive_reads_p() const;
+    const Matrix<uint64_t> &get_consecutive_reads_m() const;
     void update_cycles(const std::vector<std::vector<bool>> &update_p,
                        const std::vector<std::vector<bool>> &update_m);
     float calc_G0_scaling_factor(const uint64_t read_num,
-                                 const uint64_t N_cycles) const;
+                                 const uint64_t N_cycles,
+                                 const uint32_t level = 1) const;
     float calc_transition_time(const uint64_t N_cycles) const;
     void update_cycle_p(int m, int n, uint64_t cycles);
     void update_cycle_m(int m, int n, uint64_t cycles);
@@ -40,15 +51,29 @@ class ReadDisturb {
     void reset_consecutive_reads_p(int m, int n);
     void reset_consecutive_reads_m(int m, int n);
     bool get_run_out_of_bounds() const;
+    /** Take over the per-cell counters of a model with other parameters. */
+    void copy_cell_state(const ReadDisturb &other);
+    void save_state(SnapshotWriter &writer) const;
+    bool load_state(const SnapshotReader &reader);
+    /** Check that load_state would succeed, without changing the state. */
+    bool check_state(const SnapshotReader &reader) const;
 
   private:
     float calc_exp_tt(const float V_read) const;
     float calc_p(const float V_read) const;
+    float lookup_transition_time(const uint64_t N_cycles) const;
+    void extend_tt_table(const uint64_t N_cycles);
+    uint64_t max_cycles() const;
+    /** Allocate the consecutive read counters (CELL_BASED mitigation). */
+    void alloc_consecutive_reads();
 
-    std::vector<std::vector<uint64_t>> cycles_p_;
-    std::vector<std::vector<uint64_t>> cycles_m_;
-    std::vector<std::vector<uint64_t>> consecutive_reads_p_;
-    std::vector<std::vector<uint64_t>> consecutive_reads_m_;
+    // The *_m_ counters are empty if the mapping has no second array, the
+    // consecutive reads until the first CELL_BASED update
+    bool has_m_array_;
+    Matrix<uint64_t> cycles_p_;
+    Matrix<uint64_t> cycles_m_;
+    Matrix<uint64_t> consecutive_reads_p_;
+    Matrix<uint64_t> consecutive_reads_m_;
 
     const float t0_;
     const float fitting_param_; // Obtained from papers graphs
@@ -62,8 +87,10 @@ class ReadDisturb {
     const float V_read_;
     const float exp_tt_;             // Exponent for transition time calculation
     const float p_;                  // Power factor
-    mutable bool run_out_of_bounds_; // Flag to indicate if the model is run out
-                                     // of bounds
+    std::vector<float> p_levels_;    // Power factor per conductance level
+    std::vector<float> tt_table_;    // Transition time per number of cycles
+    // The model ran out of bounds (set by the parallel conductance updates)
+    mutable std::atomic<bool> run_out_of_bounds_;
 };
 
 } // namespace nq
@@ -0,0 +1,144 @@
+/******************************************************************************
+ * Copyright (C) 2025 Rebecca Pelke                                           *
+ * All Rights Reserved                                                        *
+ *                                                                            *
+ * This work is licensed under the terms described in the LICENSE file        *
+ * found in the root directory of this source tree.                           *
+ ******************************************************************************/
+#include "helper/async_executor.h"
+
+#include <algorithm>
+#include <exception>
+#include <iostream>
+
+namespace nq {
+
+AsyncTask::AsyncTask(std::function<int32_t()> fn) :
+    fn_(std::move(fn)),
+    done_(false),
+    status_(0) {}
+
+bool AsyncTask::done() const { return done_.load(std::memory_order_acquire); }
+
+int32_t AsyncTask::wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this] { return done(); });
+    return status_;
+}
+
+void AsyncTask::run() {
+    int32_t status = -1;
+    try {
+        status = fn_();
+    } catch (const std::exception &e) {
+        std::cerr << "Asynchronous task failed: " << e.what() << std::endl;
+    }
+    fn_ = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        status_ = status;
+        done_.store(true, std::memory_order_release);
+    }
+    cv_.notify_all();
+}
+
+AsyncExecutor::AsyncExecutor(size_t num_workers) :
+    num_pending_(0),
+    stop_(false) {
+    for (size_t w = 0; w < std::max<size_t>(num_workers, 1); ++w) {
+        workers_.emplace_back(&AsyncExecutor::worker_loop, this);
+    }
+}
+
+AsyncExecutor::~AsyncExecutor() {
+    wait_all();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    work_cv_.notify_all();
+    for (std::thread &worker : workers_) {
+        worker.join();
+    }
+}
+
+std::shared_ptr<AsyncTask>
+AsyncExecutor::submit(const void *strand_key, std::function<int32_t()> fn) {
+    auto task = std::make_shared<AsyncTask>(std::move(fn));
+    num_pending_++;
+    bool schedule = false;
+    Strand *strand = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(strands_mutex_);
+        std::unique_ptr<Strand> &entry = strands_[strand_key];
+        if (!entry) {
+            entry = std::make_unique<Strand>();
+            entry->key = strand_key;
+        }
+        strand = entry.get();
+        strand->tasks.push(task);
+        // Only the submission that makes the strand non-empty schedules it
+        schedule = (strand->num_pending++ == 0);
+    }
+    if (schedule) {
+        ready_.push(strand);
+        std::lock_guard<std::mutex> lock(mutex_);
+        work_cv_.notify_one();
+    }
+    return task;
+}
+
+void AsyncExecutor::worker_loop() {
+    while (true) {
+        Strand *strand = nullptr;
+        if (!ready_.try_pop(strand)) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_cv_.wait(lock,
+                          [&] { return stop_ || ready_.try_pop(strand); });
+            if (strand == nullptr) {
+                return;
+            }
+        }
+
+        // A scheduled strand is owned by exactly one worker. Tasks are pushed
+        // before they are counted, so the queue holds at least one task.
+        std::shared_ptr<AsyncTask> task;
+        while (!strand->tasks.try_pop(task)) {
+            std::this_thread::yield();
+        }
+        task->run();
+        task = nullptr;
+
+        bool reschedule = false;
+        {
+            std::lock_guard<std::mutex> lock(strands_mutex_);
+            reschedule = (--strand->num_pending > 0);
+            if (!reschedule) {
+                strands_.erase(strand->key);
+            }
+        }
+        if (reschedule) {
+            ready_.push(strand);
+            std::lock_guard<std::mutex> lock(mutex_);
+            work_cv_.notify_one();
+        }
+        if (--num_pending_ == 0) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            idle_cv_.notify_all();
+        }
+    }
+}
+
+void AsyncExecutor::wait_all() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_cv_.wait(lock, [this] { return num_pending_ == 0; });
+}
+
+size_t AsyncExecutor::num_pending() const { return num_pending_; }
+
+size_t AsyncExecutor::num_strands() const {
+    std::lock_guard<std::mutex> lock(strands_mutex_);
+    return strands_.size();
+}
+
+} // namespace nq
@@ -0,0 +1,192 @@
+/******************************************************************************
+ * Copyright (C) 2025 Rebecca Pelke                                           *
+ * All Rights Reserved                                                        *
+ *                                                                            *
+ * This work is licensed under the terms described in the LICENSE file        *
+ * found in the root directory of this source tree.                           *
+ ******************************************************************************/
+#include "helper/conductance_matrix.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define ACS_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace nq {
+
+namespace {
+
+float bits_to_float(uint32_t bits) {
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+uint32_t float_to_bits(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+void fp16_row_scalar(const uint16_t *src, float *dst, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        dst[i] = fp16_to_float(src[i]);
+    }
+}
+
+#ifdef ACS_X86_KERNELS
+__attribute__((target("avx,f16c"))) void
+fp16_row_f16c(const uint16_t *src, float *dst, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m128i half =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(half));
+    }
+    fp16_row_scalar(src + i, dst + i, n - i);
+}
+
+bool has_f16c() {
+    static const bool supported = []() {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c");
+    }();
+    return supported;
+}
+#endif
+
+} // namespace
+
+uint16_t float_to_fp16(float value) {
+    uint32_t bits = float_to_bits(value);
+    const uint16_t sign = (bits >> 16) & 0x8000;
+    bits &= 0x7fffffff;
+    uint16_t result;
+    if (bits >= 0x47800000) {
+        // Overflow (>= 2^16), Inf or NaN
+        result = (bits > 0x7f800000) ? 0x7e00 : 0x7c00;
+    } else if (bits < 0x38800000) {
+        // Subnormal or zero (< 2^-14): adding 0.5 moves the fp16 LSB to the
+        // float LSB, the float addition rounds to nearest even
+        result = float_to_bits(bits_to_float(bits) + 0.5f) - 0x3f000000;
+    } else {
+        // Normal: rebias the exponent and round the 13 dropped mantissa bits
+        // to nearest even (a carry into the exponent gives Inf)
+        const uint32_t odd = (bits >> 13) & 1;
+        bits += 0xc8000fff + odd;
+        result = bits >> 13;
+    }
+    return result | sign;
+}
+
+float fp16_to_float(uint16_t value) {
+    const uint32_t exp_mask = 0x7c00 << 13;
+    uint32_t bits = uint32_t(value & 0x7fff) << 13;
+    const uint32_t exp = bits & exp_mask;
+    bits += (127 - 15) << 23;
+    if (exp == exp_mask) {
+        // Inf or NaN
+        bits += (128 - 16) << 23;
+    } else if (exp == 0) {
+        // Subnormal or zero: renormalize with a float subtraction
+        bits = float_to_bits(bits_to_float(bits + (1 << 23)) -
+                             bits_to_float(113 << 23));
+    }
+    return bits_to_float(bits | (uint32_t(value & 0x8000) << 16));
+}
+
+void ConductanceMatrix::assign(size_t rows, size_t cols, float value,
+                               ConductancePrecision precision) {
+    precision_ = precision;
+    rows_ = rows;
+    cols_ = cols;
+    copy_.assign(0, 0);
+    switch (precision_) {
+    case ConductancePrecision::FP16:
+        fp32_.assign(0, 0);
+        half_.assign(rows, cols, float_to_fp16(value));
+        break;
+    case ConductancePrecision::BF16:
+        fp32_.assign(0, 0);
+        half_.assign(rows, cols, float_to_bf16(value));
+        break;
+    default:
+        half_.assign(0, 0);
+        fp32_.assign(rows, cols, value);
+        break;
+    }
+}
+
+float ConductanceMatrix::round(float value) const {
+    switch (precision_) {
+    case ConductancePrecision::FP16:
+        return fp16_to_float(float_to_fp16(value));
+    case ConductancePrecision::BF16:
+        return bf16_to_float(float_to_bf16(value));
+    default:
+        return value;
+    }
+}
+
+const float *ConductanceMatrix::row(size_t row, size_t n, float *buf) const {
+    switch (precision_) {
+    case ConductancePrecision::FP16:
+#ifdef ACS_X86_KERNELS
+        if (has_f16c()) {
+            fp16_row_f16c(half_[row], buf, n);
+            return buf;
+        }
+#endif
+        fp16_row_scalar(half_[row], buf, n);
+        return buf;
+    case ConductancePrecision::BF16: {
+        const uint16_t *src = half_[row];
+        for (size_t i = 0; i < n; ++i) {
+            buf[i] = bf16_to_float(src[i]);
+        }
+        return buf;
+    }
+    default:
+        return fp32_[row];
+    }
+}
+
+const Matrix<float> &ConductanceMatrix::to_float() const {
+    if (precision_ == ConductancePrecision::FP32) {
+        return fp32_;
+    }
+    if ((copy_.rows() != rows_) || (copy_.cols() != cols_)) {
+        copy_.assign(rows_, cols_);
+    }
+    for (size_t r = 0; r < rows_; ++r) {
+        row(r, cols_, copy_[r]);
+    }
+    return copy_;
+}
+
+void ConductanceMatrix::save(SnapshotWriter &writer,
+                             SnapshotSection id) const {
+    if (precision_ == ConductancePrecision::FP32) {
+        writer.add(id, fp32_);
+    } else {
+        writer.add(id, half_);
+    }
+}
+
+bool ConductanceMatrix::load(const SnapshotReader &reader,
+                             SnapshotSection id) {
+    if (precision_ == ConductancePrecision::FP32) {
+        return reader.read(id, fp32_);
+    }
+    return reader.read(id, half_);
+}
+
+bool ConductanceMatrix::check(const SnapshotReader &reader,
+                              SnapshotSection id) const {
+    if (precision_ == ConductancePrecision::FP32) {
+        return reader.check<float>(id, fp32_.rows(), fp32_.cols());
+    }
+    return reader.check<uint16_t>(id, half_.rows(), half_.cols());
+}
+
+} // namespace nq
@@ -6,15 +6,29 @@
  * found in the root directory of this source tree.                           *
  ******************************************************************************/
 #include "helper/config.h"
+#include "helper/layer_registry.h"
+
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <optional>
+#include <random>
 
 namespace nq {
 
+namespace {
+
+/** Parameters that determine the crossbar structure or its random state and
+ * cannot be overridden per layer */
+const std::vector<std::string> layer_fixed_keys = {
+    "M",        "N",      "SPLIT", "W_BIT", "digital_only", "m_mode",
+    "rng_seed", "layers", "conductance_precision"};
+
+} // namespace
+
 Config::~Config() {}
 
-Config::Config() {}
+Config::Config() : active_layer_(base_layer) {}
 
 Config &Config::get_cfg() {
     static Config instance;
@@ -55,17 +69,17 @@ bool Config::load_cfg(const char *cfg_file = "") {
     return apply_config();
 }
 
-bool Config::apply_config() {
+bool ConfigParams::from_json(const nlohmann::json &cfg_data) {
     try {
-        M = getConfigValue<uint32_t>(cfg_data_, "M");
-        N = getConfigValue<uint32_t>(cfg_data_, "N");
+        M = getConfigValue<uint32_t>(cfg_data, "M");
+        N = getConfigValue<uint32_t>(cfg_data, "N");
         if ((M <= 0) || (N <= 0)) {
             std::cerr << "Error in crossbar dimension." << std::endl;
             std::exit(EXIT_FAILURE);
         }
 
         std::string m_mode_name =
-            getConfigValue<std::string>(cfg_data_, "m_mode");
+            getConfigValue<std::string>(cfg_data, "m_mode");
         if (m_mode_name == "I_DIFF_W_DIFF_1XB") {
             m_mode = MappingMode::I_DIFF_W_DIFF_1XB;
         } else if (m_mode_name == "I_DIFF_W_DIFF_2XB") {
@@ -105,13 +119,18 @@ bool Config::apply_config() {
             std::exit(EXIT_FAILURE);
         }
 
-        digital_only = getConfigValue<bool>(cfg_data_, "digital_only");
+        digital_only = getConfigValue<bool>(cfg_data, "digital_only");
+        packed_gemv = getConfigValue<bool>(cfg_data, "packed_gemv", true);
+        packed_gemv_check =
+            getConfigValue<bool>(cfg_data, "packed_gemv_check", false);
+        // Digital crossbars store no currents
+        conductance_precision = ConductancePrecision::FP32;
         if (!digital_only) {
-            HRS = getConfigValue<float>(cfg_data_, "HRS");
-            LRS = getConfigValue<float>(cfg_data_, "LRS");
+            HRS = getConfigValue<float>(cfg_data, "HRS");
+            LRS = getConfigValue<float>(cfg_data, "LRS");
 
             std::string adc_type_name =
-                getConfigValue<std::string>(cfg_data_, "adc_type");
+                getConfigValue<std::string>(cfg_data, "adc_type");
             if (adc_type_name == "INF_ADC") {
                 adc_type = ADCType::INF_ADC;
             } else if (adc_type_name == "SYM_RANGE_ADC") {
@@ -134,32 +153,37 @@ bool Config::apply_config() {
                               << std::endl;
                     std::exit(EXIT_FAILURE);
                 }
-                resolution = getConfigValue<int32_t>(cfg_data_, "resolution");
+                resolution = getConfigValue<int32_t>(cfg_data, "resolution");
                 // Calibration mode
                 std::string adc_calib_mode_name = getConfigValue<std::string>(
-                    cfg_data_, "adc_calib_mode", "MAX");
+                    cfg_data, "adc_calib_mode", "MAX");
                 if (adc_calib_mode_name == "MAX") {
                     adc_calib_mode = ADCCalibMode::MAX;
+                    adc_calib_dict.clear();
+                    index_adc_calib_dict();
                 } else if (adc_calib_mode_name == "CALIB") {
                     adc_calib_mode = ADCCalibMode::CALIB;
                     adc_calib_dict = getConfigValue<
                         std::map<std::string, std::pair<float, float>>>(
-                        cfg_data_, "adc_calib_dict");
+                        cfg_data, "adc_calib_dict");
                     if (adc_calib_dict.empty()) {
                         std::cerr << "ADC calibration dict is empty!"
                                   << std::endl;
                         std::exit(EXIT_FAILURE);
                     }
+                    index_adc_calib_dict();
                 } else {
                     std::cerr << "Unknown ADC calibration mode." << std::endl;
                     std::exit(EXIT_FAILURE);
                 }
-                adc_profile =
-                    getConfigValue<bool>(cfg_data_, "adc_profile", false);
-                if (adc_profile) {
-                    adc_profile_bin_size = getConfigValue<int>(
-                        cfg_data_, "adc_profile_bin_size", 10);
-                }
+            }
+
+            // ADC input profiling (INF_ADC inputs are unbounded and are only
+            // profiled with streaming histograms)
+            adc_profile = getConfigValue<bool>(cfg_data, "adc_profile", false);
+            if (adc_profile) {
+                adc_profile_bin_size = getConfigValue<int>(
+                    cfg_data, "adc_profile_bin_size", 10);
             }
 
             if ((m_mode == MappingMode::I_UINT_W_OFFS) ||
@@ -202,10 +226,20 @@ bool Config::apply_config() {
 
             // Noise of a state is modeled as a Gaussian noise with mean 0
             // The standard deviation is HRS_NOISE for HRS and LRS_NOISE for LRS
-            HRS_NOISE = getConfigValue<float>(cfg_data_, "HRS_NOISE");
-            LRS_NOISE = getConfigValue<float>(cfg_data_, "LRS_NOISE");
-            d2d_var = getConfigValue<bool>(cfg_data_, "d2d_var", true);
-            c2c_var = getConfigValue<bool>(cfg_data_, "c2c_var", false);
+            HRS_NOISE = getConfigValue<float>(cfg_data, "HRS_NOISE");
+            LRS_NOISE = getConfigValue<float>(cfg_data, "LRS_NOISE");
+            d2d_var = getConfigValue<bool>(cfg_data, "d2d_var", true);
+            c2c_var = getConfigValue<bool>(cfg_data, "c2c_var", false);
+            std::string c2c_model_name = getConfigValue<std::string>(
+                cfg_data, "c2c_model", "per_cell");
+            if (c2c_model_name == "per_cell") {
+                c2c_model = C2CModel::PER_CELL;
+            } else if (c2c_model_name == "column_aggregate") {
+                c2c_model = C2CModel::COLUMN_AGGREGATE;
+            } else {
+                std::cerr << "Unknown C2C model." << std::endl;
+                std::exit(EXIT_FAILURE);
+            }
 
             if (is_int_mapping(m_mode) & (d2d_var & c2c_var)) {
                 std::cerr
@@ -217,12 +251,28 @@ bool Config::apply_config() {
 
             // Read disturb simulation
             read_disturb =
-                getConfigValue<bool>(cfg_data_, "read_disturb", false);
+                getConfigValue<bool>(cfg_data, "read_disturb", false);
             // Parasitics modelling
-            parasitics = getConfigValue<bool>(cfg_data_, "parasitics", false);
+            parasitics = getConfigValue<bool>(cfg_data, "parasitics", false);
+            exact_fast_path =
+                getConfigValue<bool>(cfg_data, "exact_fast_path", true);
+
+            // Storage format of the cell currents
+            std::string precision_name = getConfigValue<std::string>(
+                cfg_data, "conductance_precision", "fp32");
+            if (precision_name == "fp32") {
+                conductance_precision = ConductancePrecision::FP32;
+            } else if (precision_name == "fp16") {
+                conductance_precision = ConductancePrecision::FP16;
+            } else if (precision_name == "bf16") {
+                conductance_precision = ConductancePrecision::BF16;
+            } else {
+                std::cerr << "Unknown conductance precision." << std::endl;
+                std::exit(EXIT_FAILURE);
+            }
 
             if (parasitics | read_disturb) {
-                V_read = getConfigValue<float>(cfg_data_, "V_read");
+                V_read = getConfigValue<float>(cfg_data, "V_read");
                 if (V_read >= 0.0) {
                     std::cerr << "The implemented read disturb/parasitics "
                                  "model requires a negative V_read voltage."
@@ -232,22 +282,26 @@ bool Config::apply_config() {
             }
 
             if (read_disturb) {
-                if (is_int_mapping(m_mode)) {
-                    std::cerr
-                        << "read_disturb is not supported for int mapping."
-                        << std::endl;
-                    std::exit(EXIT_FAILURE);
-                }
-
                 // Parameters for read disturb model
-                t_read = getConfigValue<float>(cfg_data_, "t_read");
+                t_read = getConfigValue<float>(cfg_data, "t_read");
                 read_disturb_update_freq = getConfigValue<uint32_t>(
-                    cfg_data_, "read_disturb_update_freq", 1);
+                    cfg_data, "read_disturb_update_freq", 1);
+                read_disturb_level_scaling =
+                    getConfigValue<std::vector<float>>(
+                        cfg_data, "read_disturb_level_scaling",
+                        std::vector<float>{});
+                for (float scaling : read_disturb_level_scaling) {
+                    if (scaling <= 0.0) {
+                        std::cerr << "read_disturb_level_scaling must be > 0."
+                                  << std::endl;
+                        std::exit(EXIT_FAILURE);
+                    }
+                }
 
                 // Read disturb mitigation
                 std::string rd_mitigation_strategy_name =
                     getConfigValue<std::string>(
-                        cfg_data_, "read_disturb_mitigation_strategy", "OFF");
+                        cfg_data, "read_disturb_mitigation_strategy", "OFF");
                 if (rd_mitigation_strategy_name == "SOFTWARE") {
                     read_disturb_mitigation_strategy =
                         ReadDisturbMitigationStrategy::SOFTWARE;
@@ -267,7 +321,7 @@ bool Config::apply_config() {
                 if (read_disturb_mitigation_strategy ==
                     ReadDisturbMitigationStrategy::SOFTWARE) {
                     read_disturb_mitigation_fp = getConfigValue<float>(
-                        cfg_data_, "read_disturb_mitigation_fp");
+                        cfg_data, "read_disturb_mitigation_fp");
                     if (read_disturb_mitigation_fp < 1.0) {
                         std::cerr
                             << "read_disturb_mitigation_fp must be >= 1.0."
@@ -277,7 +331,7 @@ bool Config::apply_config() {
                 } else if (read_disturb_mitigation_strategy ==
                            ReadDisturbMitigationStrategy::CELL_BASED) {
                     read_disturb_update_tolerance = getConfigValue<float>(
-                        cfg_data_, "read_disturb_update_tolerance");
+                        cfg_data, "read_disturb_update_tolerance");
                     if (read_disturb_update_tolerance < 0.0 ||
                         read_disturb_update_tolerance > 1.0) {
                         std::cerr << "read_disturb_update_tolerance must be in "
@@ -290,26 +344,40 @@ bool Config::apply_config() {
 
             if (parasitics) {
                 // Parameters for parasitics modelling
-                w_res = getConfigValue<float>(cfg_data_, "w_res");
+                w_res = getConfigValue<float>(cfg_data, "w_res");
                 // Turn off parasitics if resistance is zero
                 if (w_res == 0)
                     parasitics = false;
             }
         }
 
+        dac_bits = 1;
         if (is_int_mapping(m_mode)) {
-            W_BIT = getConfigValue<uint32_t>(cfg_data_, "W_BIT");
-            I_BIT = getConfigValue<uint32_t>(cfg_data_, "I_BIT");
-            SPLIT = getConfigValue<std::vector<uint32_t>>(cfg_data_, "SPLIT");
+            W_BIT = getConfigValue<uint32_t>(cfg_data, "W_BIT");
+            I_BIT = getConfigValue<uint32_t>(cfg_data, "I_BIT");
+            SPLIT = getConfigValue<std::vector<uint32_t>>(cfg_data, "SPLIT");
+            dac_bits = getConfigValue<uint32_t>(cfg_data, "dac_bits", 1);
 
             if ((W_BIT <= 0) || (I_BIT <= 0)) {
                 std::cerr << "Error in config parameters." << std::endl;
                 std::exit(EXIT_FAILURE);
             }
+            if ((dac_bits < 1) || (dac_bits > 16)) {
+                std::cerr << "dac_bits must be between 1 and 16." << std::endl;
+                std::exit(EXIT_FAILURE);
+            }
+            // The level of a cell is stored in 8 bits
+            if (std::any_of(SPLIT.begin(), SPLIT.end(),
+                            [](uint32_t bits) { return bits > 8; })) {
+                std::cerr << "SPLIT entries larger than 8 bits are not "
+                             "supported."
+                          << std::endl;
+                std::exit(EXIT_FAILURE);
+            }
         } else if ((m_mode == MappingMode::TNN_IV) ||
                    (m_mode == MappingMode::TNN_V)) {
-            W_BIT = getConfigValue<uint32_t>(cfg_data_, "W_BIT");
-            SPLIT = getConfigValue<std::vector<uint32_t>>(cfg_data_, "SPLIT");
+            W_BIT = getConfigValue<uint32_t>(cfg_data, "W_BIT");
+            SPLIT = getConfigValue<std::vector<uint32_t>>(cfg_data, "SPLIT");
             if (W_BIT != 2) {
                 std::cerr << "Error in config parameters." << std::endl;
                 std::exit(EXIT_FAILURE);
@@ -323,7 +391,10 @@ bool Config::apply_config() {
             SPLIT = std::vector<uint32_t>{0};
         }
 
-        verbose = getConfigValue<bool>(cfg_data_, "verbose");
+        verbose = getConfigValue<bool>(cfg_data, "verbose");
+
+        rng_seed = getConfigValue<uint64_t>(cfg_data, "rng_seed",
+                                            std::random_device{}());
 
         return true;
     } catch (const std::exception &e) {
@@ -332,19 +403,181 @@ bool Config::apply_config() {
     }
 }
 
-bool Config::is_int_mapping(const MappingMode &mode) {
+bool Config::apply_config() {
+    ConfigParams params = base_params_;
+    if (!params.from_json(cfg_data_)) {
+        return false;
+    }
+    base_params_ = params;
+    static_cast<ConfigParams &>(*this) = params;
+    active_layer_ = base_layer;
+    return build_layer_profiles();
+}
+
+void ConfigParams::index_adc_calib_dict() {
+    adc_calib_ranges.clear();
+    LayerRegistry &layers = LayerRegistry::get_instance();
+    for (const auto &[l_name, range] : adc_calib_dict) {
+        uint32_t layer_id = layers.intern(l_name.c_str());
+        if (adc_calib_ranges.size() <= layer_id) {
+            adc_calib_ranges.resize(layer_id + 1);
+        }
+        adc_calib_ranges[layer_id] = range;
+    }
+}
+
+bool ConfigParams::is_int_mapping(const MappingMode &mode) const {
     return mode_to_type.at(mode) == MappingType::INT;
 }
 
-bool Config::is_bnn_mapping(const MappingMode &mode) {
+bool ConfigParams::is_bnn_mapping(const MappingMode &mode) const {
     return mode_to_type.at(mode) == MappingType::BNN;
 }
 
-bool Config::is_tnn_mapping(const MappingMode &mode) {
+bool ConfigParams::is_tnn_mapping(const MappingMode &mode) const {
     return mode_to_type.at(mode) == MappingType::TNN;
 }
 
+void Config::set_adc_calib_dict(
+    const std::map<std::string, std::pair<float, float>> &calib_dict) {
+    auto install = [&calib_dict](ConfigParams &params) {
+        params.adc_calib_mode = ADCCalibMode::CALIB;
+        params.adc_calib_dict = calib_dict;
+        params.index_adc_calib_dict();
+    };
+    install(*this);
+    install(base_params_);
+    // Layer profiles with their own calibration keep it
+    for (std::unique_ptr<LayerProfile> &profile : layer_profiles_) {
+        if (profile &&
+            std::none_of(profile->diff_keys.begin(), profile->diff_keys.end(),
+                         [](const std::string &key) {
+                             return key.rfind("adc_calib_", 0) == 0;
+                         })) {
+            install(profile->params);
+        }
+    }
+    // Keep the JSON config in sync for later update_cfg() calls
+    cfg_data_["adc_calib_mode"] = "CALIB";
+    cfg_data_["adc_calib_dict"] = calib_dict;
+}
+
+bool Config::build_layer_profiles() {
+    layer_profiles_.clear();
+    if (!cfg_data_.contains("layers")) {
+        return true;
+    }
+    const nlohmann::json &layers = cfg_data_.at("layers");
+    if (!layers.is_object()) {
+        std::cerr << "Config section 'layers' must map layer names to "
+                     "parameter overrides."
+                  << std::endl;
+        return false;
+    }
+    nlohmann::json base = cfg_data_;
+    base.erase("layers");
+
+    for (const auto &[l_name, overrides] : layers.items()) {
+        if (!overrides.is_object()) {
+            std::cerr << "Overrides of layer '" << l_name
+                      << "' must be a JSON object." << std::endl;
+            return false;
+        }
+        auto profile = std::make_unique<LayerProfile>();
+        nlohmann::json layer_cfg = base;
+        for (const auto &[key, value] : overrides.items()) {
+            if (std::find(layer_fixed_keys.begin(), layer_fixed_keys.end(),
+                          key) != layer_fixed_keys.end()) {
+                std::cerr << "Parameter '" << key
+                          << "' cannot be overridden per layer (layer '"
+                          << l_name << "')." << std::endl;
+                return false;
+            }
+            if (!base.contains(key) || (base.at(key) != value)) {
+                profile->diff_keys.push_back(key);
+            }
+            layer_cfg[key] = value;
+        }
+        profile->params = base_params_;
+        if (!profile->params.from_json(layer_cfg)) {
+            return false;
+        }
+        // The seed is drawn randomly if it is not part of the config
+        profile->params.rng_seed = base_params_.rng_seed;
+
+        uint32_t layer_id =
+            LayerRegistry::get_instance().intern(l_name.c_str());
+        if (layer_profiles_.size() <= layer_id) {
+            layer_profiles_.resize(layer_id + 1);
+        }
+        layer_profiles_[layer_id] = std::move(profile);
+    }
+    return true;
+}
+
+bool Config::has_layer_profiles() const { return !layer_profiles_.empty(); }
+
+const LayerProfile *Config::get_profile(uint32_t layer_id) const {
+    return (layer_id < layer_profiles_.size()) ? layer_profiles_[layer_id].get()
+                                               : nullptr;
+}
+
+void Config::activate_layer(uint32_t layer_id) {
+    const LayerProfile *profile = get_profile(layer_id);
+    if (profile != get_profile(active_layer_)) {
+        static_cast<ConfigParams &>(*this) =
+            profile ? profile->params : base_params_;
+    }
+    active_layer_ = layer_id;
+}
+
+bool Config::select_layer(uint32_t layer_id, uint32_t &applied_layer,
+                          std::vector<std::string> &changed_keys) {
+    activate_layer(layer_id);
+    const LayerProfile *profile = get_profile(layer_id);
+    const LayerProfile *applied = get_profile(applied_layer);
+    applied_layer = layer_id;
+    if (profile == applied) {
+        return false;
+    }
+
+    // Only keys overridden by the applied or the next layer can change
+    changed_keys.clear();
+    for (const LayerProfile *p : {applied, profile}) {
+        if (!p) {
+            continue;
+        }
+        for (const std::string &key : p->diff_keys) {
+            if (std::find(changed_keys.begin(), changed_keys.end(), key) ==
+                changed_keys.end()) {
+                changed_keys.push_back(key);
+            }
+        }
+    }
+    return true;
+}
+
+bool Config::select_layer(uint32_t layer_id,
+                          std::vector<std::string> &changed_keys) {
+    uint32_t applied_layer = active_layer_;
+    return select_layer(layer_id, applied_layer, changed_keys);
+}
+
+void Config::reset_layer(uint32_t &applied_layer,
+                         std::vector<std::string> &changed_keys) const {
+    if (const LayerProfile *applied = get_profile(applied_layer)) {
+        for (const std::string &key : applied->diff_keys) {
+            if (std::find(changed_keys.begin(), changed_keys.end(), key) ==
+                changed_keys.end()) {
+                changed_keys.push_back(key);
+            }
+        }
+    }
+    applied_layer = base_layer;
+}
+
 bool Config::update_cfg(const char *json_string, bool *recreate_xbar,
+                        std::vector<std::string> *changed_keys,
                         const std::vector<std::string> &recreation_keys) {
     if (!json_string) {
         std::cerr << "Error: JSON string is null." << std::endl;
@@ -362,6 +595,14 @@ bool Config::update_cfg(const char *json_string, bool *recreate_xbar,
         if (recreate_xbar) {
             *recreate_xbar = false;
         }
+        // The update returns to the base parameters, so the overrides of
+        // the active layer change as well
+        if (changed_keys) {
+            changed_keys->clear();
+            if (const LayerProfile *active = get_profile(active_layer_)) {
+                *changed_keys = active->diff_keys;
+            }
+        }
 
         // Apply updates to the configuration
         for (const auto &[key, new_value] : updates.items()) {
@@ -387,6 +628,9 @@ bool Config::update_cfg(const char *json_string, bool *recreate_xbar,
                 // Update the config data
                 cfg_data_[key] = new_value;
                 config_modified = true;
+                if (changed_keys) {
+                    changed_keys->push_back(key);
+                }
 
                 // Check if this key requires crossbar recreation
                 if (recreate_xbar &&
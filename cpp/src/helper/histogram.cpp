@@ -7,14 +7,20 @@
  ******************************************************************************/
 
 #include "helper/histogram.h"
+#include "helper/layer_registry.h"
 
 #include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <execution>
 #include <functional>
 #include <iterator>
+#include <sstream>
 #include <unordered_map>
 
+#include "oneapi/tbb/blocked_range.h"
+#include "oneapi/tbb/parallel_for.h"
+
 namespace nq {
 
 SimpleHistogram::SimpleHistogram(int32_t min, int32_t max) :
@@ -28,15 +34,16 @@ SimpleHistogram::SimpleHistogram(int32_t min, int32_t max) :
 }
 
 void SimpleHistogram::update(const std::vector<int32_t> &values) {
-    // TODO: Check if values are within histogram ranges
-    // Offset values to get indices to update histogram data
-    std::vector<int32_t> indices(values.size(), 0);
-    std::transform(std::execution::par_unseq, values.begin(), values.end(),
-                   indices.begin(),
-                   [this](int32_t v) -> int32_t { return v - this->min_; });
-    // Update histogram data
-    std::for_each(std::execution::seq, indices.begin(), indices.end(),
-                  [this](int32_t i) -> void { this->data_[i]++; });
+    for (int32_t v : values) {
+        if (v < min_) {
+            underflow_++;
+        } else if (v > max_) {
+            overflow_++;
+        } else {
+            // Offset value to get the index (v - min may exceed int32)
+            data_[static_cast<size_t>(int64_t(v) - min_)]++;
+        }
+    }
 }
 
 int64_t SimpleHistogram::get_samples() {
@@ -62,6 +69,10 @@ float SimpleHistogram::get_variance() {
            get_samples();
 }
 
+uint64_t SimpleHistogram::get_underflow() { return underflow_; }
+
+uint64_t SimpleHistogram::get_overflow() { return overflow_; }
+
 json SimpleHistogram::to_json() {
     std::unordered_map<int32_t, int32_t> hist_map;
     std::transform(this->data_.begin(), this->data_.end(),
@@ -74,15 +85,35 @@ json SimpleHistogram::to_json() {
     return json{{"hist", hist_map},
                 {"samples", get_samples()},
                 {"mean", get_mean()},
-                {"var", get_variance()}};
+                {"var", get_variance()},
+                {"underflow", underflow_},
+                {"overflow", overflow_}};
+}
+
+namespace {
+
+/** Call fn(begin, end) on chunks of [0, len). Inputs smaller than the grain
+ * size are processed by the calling thread. */
+template <typename F> void for_each_chunk(size_t len, const F &fn) {
+    constexpr size_t grain_size = 16384;
+    if (len <= grain_size) {
+        fn(0, len);
+        return;
+    }
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, len, grain_size),
+                      [&fn](const tbb::blocked_range<size_t> &r) {
+                          fn(r.begin(), r.end());
+                      });
 }
 
+} // namespace
+
 BinnedHistogram::BinnedHistogram(float min, float max, float bin_size) :
     min_(min),
     max_(max),
     bin_size_(bin_size),
     num_bins_(round((max - min) / bin_size_)),
-    data_(std::vector<int32_t>(num_bins_, 0)),
+    shards_(std::vector<uint64_t>(num_bins_ + 2, 0)),
     values_(std::vector<float>(num_bins_, 0)) {
     // Generate values present in histogram
     std::generate(
@@ -94,88 +125,374 @@ BinnedHistogram::BinnedHistogram(float min, float max, float bin_size) :
         });
 }
 
+void BinnedHistogram::update(const float *values, size_t len) {
+    // Each shard holds the bins followed by underflow and overflow counts
+    const size_t num_bins = values_.size();
+    for_each_chunk(len, [this, values, num_bins](size_t begin, size_t end) {
+        std::vector<uint64_t> &shard = shards_.local();
+        for (size_t i = begin; i < end; ++i) {
+            float index = round((values[i] - min_) / bin_size_);
+            if (index < 0) {
+                shard[num_bins]++;
+            } else if (!(index < num_bins)) {
+                shard[num_bins + 1]++;
+            } else {
+                shard[static_cast<size_t>(index)]++;
+            }
+        }
+    });
+}
+
 void BinnedHistogram::update(const std::vector<float> &values) {
-    // TODO: Check if values are within histogram ranges
-    // Offset values to get indices to update histogram data
-    std::vector<int32_t> indices(values.size(), 0);
-    std::transform(std::execution::par_unseq, values.begin(), values.end(),
-                   indices.begin(), [this](float v) -> int32_t {
-                       return round((v - this->min_) / bin_size_);
-                   });
-    // Update histogram data
-    std::for_each(std::execution::seq, indices.begin(), indices.end(),
-                  [this](int32_t i) -> void { this->data_[i]++; });
+    update(values.data(), values.size());
+}
+
+std::vector<uint64_t> BinnedHistogram::get_data() {
+    std::vector<uint64_t> data(values_.size() + 2, 0);
+    for (const std::vector<uint64_t> &shard : shards_) {
+        std::transform(shard.begin(), shard.end(), data.begin(), data.begin(),
+                       std::plus<uint64_t>());
+    }
+    return data;
 }
 
 int64_t BinnedHistogram::get_samples() {
-    return std::reduce(std::execution::par, this->data_.begin(),
-                       this->data_.end(), int64_t(0), std::plus<int64_t>());
+    std::vector<uint64_t> data = get_data();
+    return std::reduce(data.begin(), data.begin() + values_.size(),
+                       int64_t(0), std::plus<int64_t>());
 }
 
 float BinnedHistogram::get_mean() {
-    return std::transform_reduce(std::execution::par, this->data_.begin(),
-                                 this->data_.end(), this->values_.begin(), 0.0,
-                                 std::plus<float>(), std::multiplies<float>()) /
+    std::vector<uint64_t> data = get_data();
+    return std::transform_reduce(data.begin(), data.begin() + values_.size(),
+                                 values_.begin(), 0.0, std::plus<double>(),
+                                 std::multiplies<double>()) /
            get_samples();
 }
 
 float BinnedHistogram::get_variance() {
     float mean = get_mean();
-    return std::transform_reduce(std::execution::par, this->data_.begin(),
-                                 this->data_.end(), this->values_.begin(), 0.0,
-                                 std::plus<float>(),
-                                 [mean](int32_t d, int32_t v) {
+    std::vector<uint64_t> data = get_data();
+    return std::transform_reduce(data.begin(), data.begin() + values_.size(),
+                                 values_.begin(), 0.0, std::plus<double>(),
+                                 [mean](uint64_t d, float v) {
                                      return (d * std::pow(v - mean, 2));
                                  }) /
            get_samples();
 }
 
+uint64_t BinnedHistogram::get_underflow() {
+    return get_data()[values_.size()];
+}
+
+uint64_t BinnedHistogram::get_overflow() {
+    return get_data()[values_.size() + 1];
+}
+
 json BinnedHistogram::to_json() {
-    std::map<float, int32_t> hist_map;
-    std::transform(this->data_.begin(), this->data_.end(),
-                   this->values_.begin(),
-                   std::inserter(hist_map, hist_map.end()),
-                   [](int32_t d, float v) { return std::make_pair(v, d); });
+    std::vector<uint64_t> data = get_data();
+    std::map<float, uint64_t> hist_map;
+    std::transform(data.begin(), data.begin() + values_.size(),
+                   values_.begin(), std::inserter(hist_map, hist_map.end()),
+                   [](uint64_t d, float v) { return std::make_pair(v, d); });
 
     return json{{"hist", hist_map},
                 {"samples", get_samples()},
                 {"mean", get_mean()},
-                {"var", get_variance()}};
+                {"var", get_variance()},
+                {"underflow", data[values_.size()]},
+                {"overflow", data[values_.size() + 1]}};
+}
+
+void StreamingHistogram::Buckets::add(uint32_t key, uint64_t count) {
+    if (counts.empty()) {
+        first = key;
+        counts.assign(1, 0);
+    } else if (key < first) {
+        counts.insert(counts.begin(), first - key, 0);
+        first = key;
+    } else if (key - first >= counts.size()) {
+        counts.resize(key - first + 1, 0);
+    }
+    counts[key - first] += count;
+}
+
+void StreamingHistogram::Buckets::merge(const Buckets &other) {
+    if (other.counts.empty()) {
+        return;
+    }
+    // Extend the range once, then add the counts
+    add(other.first, 0);
+    add(other.first + other.counts.size() - 1, 0);
+    for (size_t k = 0; k < other.counts.size(); ++k) {
+        counts[other.first + k - first] += other.counts[k];
+    }
+}
+
+void StreamingHistogram::Shard::merge(const Shard &other) {
+    pos.merge(other.pos);
+    neg.merge(other.neg);
+    samples += other.samples;
+    sum += other.sum;
+    sum_sq += other.sum_sq;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+}
+
+StreamingHistogram::StreamingHistogram(int32_t sub_bucket_bits) :
+    shift_(23 - std::clamp(sub_bucket_bits, 0, 23)) {}
+
+uint32_t StreamingHistogram::get_key(float abs_value) const {
+    // Exponent and leading mantissa bits of an IEEE 754 float increase
+    // monotonically with its value
+    uint32_t bits;
+    std::memcpy(&bits, &abs_value, sizeof(bits));
+    return bits >> shift_;
+}
+
+float StreamingHistogram::get_value(uint32_t key) const {
+    uint32_t bits = key << shift_;
+    if (shift_ > 0) {
+        bits |= 1u << (shift_ - 1);
+    }
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+void StreamingHistogram::update(const float *values, size_t len,
+                                float offset) {
+    for_each_chunk(len, [this, values, offset](size_t begin, size_t end) {
+        Shard &shard = shards_.local();
+        for (size_t i = begin; i < end; ++i) {
+            const float v = values[i] + offset;
+            if (!std::isfinite(v)) {
+                continue;
+            }
+            if (v < 0) {
+                shard.neg.add(get_key(-v));
+            } else {
+                shard.pos.add(get_key(v));
+            }
+            shard.samples++;
+            shard.sum += v;
+            shard.sum_sq += static_cast<double>(v) * v;
+            shard.min = std::min(shard.min, v);
+            shard.max = std::max(shard.max, v);
+        }
+    });
+}
+
+StreamingHistogram::Shard StreamingHistogram::get_data() {
+    Shard data;
+    for (const Shard &shard : shards_) {
+        data.merge(shard);
+    }
+    return data;
+}
+
+int64_t StreamingHistogram::get_samples() { return get_data().samples; }
+
+float StreamingHistogram::get_mean() {
+    Shard data = get_data();
+    return data.samples == 0 ? 0.0 : data.sum / data.samples;
+}
+
+float StreamingHistogram::get_variance() {
+    Shard data = get_data();
+    if (data.samples == 0) {
+        return 0.0;
+    }
+    double mean = data.sum / data.samples;
+    return std::max(data.sum_sq / data.samples - mean * mean, 0.0);
+}
+
+float StreamingHistogram::get_min() { return get_data().min; }
+
+float StreamingHistogram::get_max() { return get_data().max; }
+
+float StreamingHistogram::get_quantile(double q) {
+    return get_quantiles({q})[0];
+}
+
+std::vector<std::pair<float, uint64_t>>
+StreamingHistogram::get_buckets(const Shard &data) {
+    // Negative buckets from the largest magnitude down, then positive buckets
+    std::vector<std::pair<float, uint64_t>> buckets;
+    for (size_t k = data.neg.counts.size(); k-- > 0;) {
+        if (data.neg.counts[k] > 0) {
+            buckets.emplace_back(-get_value(data.neg.first + k),
+                                 data.neg.counts[k]);
+        }
+    }
+    for (size_t k = 0; k < data.pos.counts.size(); ++k) {
+        if (data.pos.counts[k] > 0) {
+            buckets.emplace_back(get_value(data.pos.first + k),
+                                 data.pos.counts[k]);
+        }
+    }
+    // Mid-points of the outermost buckets may lie outside the samples
+    for (auto &bucket : buckets) {
+        bucket.first = std::clamp(bucket.first, data.min, data.max);
+    }
+    return buckets;
+}
+
+std::vector<std::pair<float, uint64_t>> StreamingHistogram::get_buckets() {
+    return get_buckets(get_data());
+}
+
+std::vector<float>
+StreamingHistogram::get_quantiles(const std::vector<double> &qs) {
+    Shard data = get_data();
+    std::vector<float> res(qs.size(), 0.0);
+    if (data.samples == 0) {
+        return res;
+    }
+    std::vector<std::pair<float, uint64_t>> buckets = get_buckets(data);
+
+    for (size_t i = 0; i < qs.size(); ++i) {
+        // Rank of the requested sample (0-based)
+        const double q = std::clamp(qs[i], 0.0, 1.0);
+        const uint64_t rank = std::llround(q * (data.samples - 1));
+        // The extreme samples are known exactly
+        if (rank == 0) {
+            res[i] = data.min;
+            continue;
+        } else if (rank == data.samples - 1) {
+            res[i] = data.max;
+            continue;
+        }
+        uint64_t seen = 0;
+        for (const auto &[value, count] : buckets) {
+            seen += count;
+            if (seen > rank) {
+                res[i] = value;
+                break;
+            }
+        }
+    }
+    return res;
+}
+
+json StreamingHistogram::to_json() {
+    static const std::vector<double> qs = {0.001, 0.01, 0.05, 0.25, 0.5,
+                                           0.75,  0.95, 0.99, 0.999};
+    Shard data = get_data();
+    std::vector<std::pair<float, uint64_t>> buckets = get_buckets(data);
+    std::map<float, uint64_t> hist_map(buckets.begin(), buckets.end());
+
+    std::vector<float> quantiles = get_quantiles(qs);
+    std::map<std::string, float> quantile_map;
+    for (size_t i = 0; i < qs.size(); ++i) {
+        std::ostringstream key;
+        key << qs[i];
+        quantile_map[key.str()] = quantiles[i];
+    }
+
+    json res{{"hist", hist_map},
+             {"samples", data.samples},
+             {"mean", get_mean()},
+             {"var", get_variance()},
+             {"quantiles", quantile_map}};
+    if (data.samples > 0) {
+        res["min"] = data.min;
+        res["max"] = data.max;
+    }
+    return res;
+}
+
+LayerHistogram::LayerHistogram(float min, float max, float bin_size) {
+    if (std::isfinite(max - min)) {
+        binned_.emplace(min, max, bin_size);
+    }
+}
+
+void LayerHistogram::update(const float *values, size_t len) {
+    if (binned_) {
+        binned_->update(values, len);
+    }
+    streaming_.update(values, len);
+}
+
+BinnedHistogram *LayerHistogram::get_binned() {
+    return binned_ ? &binned_.value() : nullptr;
+}
+
+StreamingHistogram &LayerHistogram::get_streaming() { return streaming_; }
+
+json LayerHistogram::to_json() {
+    // Sample statistics and quantiles are exact (up to the bucket resolution)
+    // in the streaming histogram. The binned histogram is reported if present.
+    json res = streaming_.to_json();
+    if (binned_) {
+        json binned = binned_->to_json();
+        res["hist"] = binned["hist"];
+        res["underflow"] = binned["underflow"];
+        res["overflow"] = binned["overflow"];
+    }
+    return res;
 }
 
 WorkloadHistograms::WorkloadHistograms() {}
 
 WorkloadHistograms::~WorkloadHistograms() {}
 
+LayerHistogram &WorkloadHistograms::get_or_add_histogram(uint32_t layer_id,
+                                                         float min, float max,
+                                                         float bin_size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (hists_.size() <= layer_id) {
+        hists_.resize(layer_id + 1);
+    }
+    if (!hists_[layer_id]) {
+        hists_[layer_id] = std::make_unique<LayerHistogram>(min, max, bin_size);
+    }
+    return *hists_[layer_id];
+}
+
+LayerHistogram &WorkloadHistograms::get_or_add_histogram(const char *l_name,
+                                                         float min, float max,
+                                                         float bin_size) {
+    return get_or_add_histogram(LayerRegistry::get_instance().intern(l_name),
+                                min, max, bin_size);
+}
+
 bool WorkloadHistograms::has_histogram(std::string l_name) {
-    auto val = hists_.find(l_name);
-    return val != hists_.end();
+    return get_histogram(l_name).has_value();
 }
 
 bool WorkloadHistograms::add_histogram(std::string l_name, float min, float max,
                                        float bin_size) {
-    return hists_.insert({l_name, BinnedHistogram(min, max, bin_size)}).second;
+    if (has_histogram(l_name)) {
+        return false;
+    }
+    get_or_add_histogram(l_name.c_str(), min, max, bin_size);
+    return true;
 }
 
-std::optional<std::reference_wrapper<BinnedHistogram>>
+std::optional<std::reference_wrapper<LayerHistogram>>
 WorkloadHistograms::get_histogram(std::string l_name) {
-    if (auto val = hists_.find(l_name); val != hists_.end()) {
-        return std::optional<std::reference_wrapper<BinnedHistogram>>(
-            val->second);
+    uint32_t layer_id = LayerRegistry::get_instance().intern(l_name.c_str());
+    std::lock_guard<std::mutex> lock(mutex_);
+    if ((layer_id < hists_.size()) && hists_[layer_id]) {
+        return std::optional<std::reference_wrapper<LayerHistogram>>(
+            *hists_[layer_id]);
     }
-    return std::optional<std::reference_wrapper<BinnedHistogram>>();
+    return std::optional<std::reference_wrapper<LayerHistogram>>();
 }
 
 json WorkloadHistograms::to_json() {
-    struct JSONConstructor {
-        void operator()(std::pair<std::string, BinnedHistogram> hist) {
-            json_obj.emplace(hist.first, hist.second.to_json());
+    std::lock_guard<std::mutex> lock(mutex_);
+    LayerRegistry &layers = LayerRegistry::get_instance();
+    json json_obj{};
+    for (uint32_t layer_id = 0; layer_id < hists_.size(); ++layer_id) {
+        if (hists_[layer_id]) {
+            json_obj.emplace(layers.get_name(layer_id),
+                             hists_[layer_id]->to_json());
         }
-        json json_obj{};
-    };
-    JSONConstructor json_cons = std::for_each(
-        this->hists_.begin(), this->hists_.end(), JSONConstructor());
-    return json_cons.json_obj;
+    }
+    return json_obj;
 }
 
 ADCHistograms::ADCHistograms() {}
@@ -0,0 +1,38 @@
+/******************************************************************************
+ * Copyright (C) 2025 Rebecca Pelke                                           *
+ * All Rights Reserved                                                        *
+ *                                                                            *
+ * This work is licensed under the terms described in the LICENSE file        *
+ * found in the root directory of this source tree.                           *
+ ******************************************************************************/
+#include "helper/layer_registry.h"
+
+namespace nq {
+
+LayerRegistry::LayerRegistry() { intern("Unknown"); }
+
+LayerRegistry &LayerRegistry::get_instance() {
+    static LayerRegistry instance;
+    return instance;
+}
+
+uint32_t LayerRegistry::intern(const char *l_name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto [it, inserted] = ids_.try_emplace(l_name, names_.size());
+    if (inserted) {
+        names_.push_back(it->first);
+    }
+    return it->second;
+}
+
+const std::string &LayerRegistry::get_name(uint32_t layer_id) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return names_.at(layer_id);
+}
+
+uint32_t LayerRegistry::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return names_.size();
+}
+
+} // namespace nq
@@ -0,0 +1,220 @@
+/******************************************************************************
+ * Copyright (C) 2025 Rebecca Pelke                                           *
+ * All Rights Reserved                                                        *
+ *                                                                            *
+ * This work is licensed under the terms described in the LICENSE file        *
+ * found in the root directory of this source tree.                           *
+ ******************************************************************************/
+#include "helper/packed_gemv.h"
+
+#include <algorithm>
+#include <limits>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define ACS_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace nq {
+
+namespace {
+
+// Dot products of one padded row (n: multiple of 32)
+
+template <typename T>
+int32_t dot_scalar(const T *w, const int16_t *x, size_t n) {
+    // Unsigned accumulation: wraps around like the int32 reference
+    uint32_t acc = 0;
+    for (size_t i = 0; i < n; ++i) {
+        acc += static_cast<uint32_t>(int32_t(w[i]) * x[i]);
+    }
+    return static_cast<int32_t>(acc);
+}
+
+#ifdef ACS_X86_KERNELS
+__attribute__((target("avx2"))) int32_t hsum_avx2(__m256i acc) {
+    __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc),
+                                _mm256_extracti128_si256(acc, 1));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(sum);
+}
+
+__attribute__((target("avx2"))) int32_t dot_avx2(const int16_t *w,
+                                                 const int16_t *x, size_t n) {
+    __m256i acc = _mm256_setzero_si256();
+    for (size_t i = 0; i < n; i += 16) {
+        const __m256i a =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(w + i));
+        const __m256i b =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(x + i));
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(a, b));
+    }
+    return hsum_avx2(acc);
+}
+
+__attribute__((target("avx2"))) int32_t dot_avx2(const int8_t *w,
+                                                 const int16_t *x, size_t n) {
+    __m256i acc = _mm256_setzero_si256();
+    for (size_t i = 0; i < n; i += 16) {
+        const __m256i a = _mm256_cvtepi8_epi16(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(w + i)));
+        const __m256i b =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(x + i));
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(a, b));
+    }
+    return hsum_avx2(acc);
+}
+
+__attribute__((target("avx512f"))) int32_t hsum_avx512(__m512i acc) {
+    alignas(64) int32_t lanes[16];
+    _mm512_store_si512(lanes, acc);
+    uint32_t sum = 0;
+    for (int32_t lane : lanes) {
+        sum += static_cast<uint32_t>(lane);
+    }
+    return static_cast<int32_t>(sum);
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vnni"))) int32_t
+dot_vnni(const int16_t *w, const int16_t *x, size_t n) {
+    __m512i acc = _mm512_setzero_si512();
+    for (size_t i = 0; i < n; i += 32) {
+        const __m512i a = _mm512_loadu_si512(w + i);
+        const __m512i b = _mm512_loadu_si512(x + i);
+        acc = _mm512_dpwssd_epi32(acc, a, b);
+    }
+    return hsum_avx512(acc);
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vnni"))) int32_t
+dot_vnni(const int8_t *w, const int16_t *x, size_t n) {
+    __m512i acc = _mm512_setzero_si512();
+    for (size_t i = 0; i < n; i += 32) {
+        const __m512i a = _mm512_cvtepi8_epi16(
+            _mm256_loadu_si256(reinterpret_cast<const __m256i *>(w + i)));
+        const __m512i b = _mm512_loadu_si512(x + i);
+        acc = _mm512_dpwssd_epi32(acc, a, b);
+    }
+    return hsum_avx512(acc);
+}
+#endif
+
+template <typename T>
+void gemv_rows(PackedGemv::Kernel kernel, const Matrix<T> &w,
+               const int16_t *x, size_t n, int32_t *res, int32_t m_matrix) {
+    for (int32_t m = 0; m < m_matrix; ++m) {
+        int32_t dot;
+        switch (kernel) {
+#ifdef ACS_X86_KERNELS
+        case PackedGemv::Kernel::AVX512_VNNI:
+            dot = dot_vnni(w[m], x, n);
+            break;
+        case PackedGemv::Kernel::AVX2:
+            dot = dot_avx2(w[m], x, n);
+            break;
+#endif
+        default:
+            dot = dot_scalar(w[m], x, n);
+            break;
+        }
+        res[m] = static_cast<int32_t>(static_cast<uint32_t>(res[m]) +
+                                      static_cast<uint32_t>(dot));
+    }
+}
+
+} // namespace
+
+PackedGemv::PackedGemv() :
+    kernel_(best_kernel()), int8_(false), m_matrix_(0), n_matrix_(0) {}
+
+PackedGemv::Kernel PackedGemv::best_kernel() {
+#ifdef ACS_X86_KERNELS
+    static const Kernel kernel = []() {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f") &&
+            __builtin_cpu_supports("avx512bw") &&
+            __builtin_cpu_supports("avx512vnni")) {
+            return Kernel::AVX512_VNNI;
+        }
+        if (__builtin_cpu_supports("avx2")) {
+            return Kernel::AVX2;
+        }
+        return Kernel::SCALAR;
+    }();
+    return kernel;
+#else
+    return Kernel::SCALAR;
+#endif
+}
+
+void PackedGemv::set_kernel(Kernel kernel) {
+    kernel_ = std::min(kernel, best_kernel());
+}
+
+void PackedGemv::clear() {
+    m_matrix_ = 0;
+    n_matrix_ = 0;
+    w8_.assign(0, 0);
+    w16_.assign(0, 0);
+}
+
+bool PackedGemv::pack(const int64_t *mat, int32_t m_matrix,
+                      int32_t n_matrix) {
+    clear();
+    const size_t size = size_t(m_matrix) * n_matrix;
+    const auto [min_it, max_it] = std::minmax_element(mat, mat + size);
+    if ((size == 0) || (*min_it < std::numeric_limits<int16_t>::min()) ||
+        (*max_it > std::numeric_limits<int16_t>::max())) {
+        return false;
+    }
+    int8_ = (*min_it >= std::numeric_limits<int8_t>::min()) &&
+            (*max_it <= std::numeric_limits<int8_t>::max());
+
+    const size_t cols = (n_matrix + pad - 1) / pad * pad;
+    if (int8_) {
+        w8_.assign(m_matrix, cols, 0);
+    } else {
+        w16_.assign(m_matrix, cols, 0);
+    }
+    for (int32_t m = 0; m < m_matrix; ++m) {
+        for (int32_t n = 0; n < n_matrix; ++n) {
+            const int64_t value = mat[size_t(m) * n_matrix + n];
+            if (int8_) {
+                w8_[m][n] = static_cast<int8_t>(value);
+            } else {
+                w16_[m][n] = static_cast<int16_t>(value);
+            }
+        }
+    }
+    vec_.assign(cols, 0);
+    m_matrix_ = m_matrix;
+    n_matrix_ = n_matrix;
+    return true;
+}
+
+bool PackedGemv::gemv(int32_t *res, const int32_t *vec, int32_t m_matrix,
+                      int32_t n_matrix) {
+    if ((m_matrix > m_matrix_) || (n_matrix > n_matrix_)) {
+        return false;
+    }
+    for (int32_t n = 0; n < n_matrix; ++n) {
+        if ((vec[n] < std::numeric_limits<int16_t>::min()) ||
+            (vec[n] > std::numeric_limits<int16_t>::max())) {
+            return false;
+        }
+        vec_[n] = static_cast<int16_t>(vec[n]);
+    }
+    // Unused columns of the packed rows are multiplied by zero
+    const size_t n = (n_matrix + pad - 1) / pad * pad;
+    std::fill(vec_.begin() + n_matrix, vec_.begin() + n, 0);
+
+    if (int8_) {
+        gemv_rows(kernel_, w8_, vec_.data(), n, res, m_matrix);
+    } else {
+        gemv_rows(kernel_, w16_, vec_.data(), n, res, m_matrix);
+    }
+    return true;
+}
+
+} // namespace nq
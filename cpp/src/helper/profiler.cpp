@@ -0,0 +1,224 @@
+/******************************************************************************
+ * Copyright (C) 2025 Rebecca Pelke                                           *
+ * All Rights Reserved                                                        *
+ *                                                                            *
+ * This work is licensed under the terms described in the LICENSE file        *
+ * found in the root directory of this source tree.                           *
+ ******************************************************************************/
+#include "helper/profiler.h"
+#include "helper/layer_registry.h"
+
+#include <chrono>
+
+namespace nq {
+
+namespace {
+
+constexpr size_t num_phases = static_cast<size_t>(ProfilePhase::NUM_PHASES);
+
+/** Trace events per thread. Further events are counted as dropped. */
+constexpr size_t max_trace_events = size_t(1) << 20;
+
+thread_local ProfileScope *current_scope = nullptr;
+thread_local uint32_t current_layer_id = LayerRegistry::unknown_layer;
+
+} // namespace
+
+const char *phase_to_string(ProfilePhase phase) {
+    switch (phase) {
+    case ProfilePhase::MVM:
+        return "mvm";
+    case ProfilePhase::WRITE:
+        return "write";
+    case ProfilePhase::INPUT_ENCODING:
+        return "input_encoding";
+    case ProfilePhase::BIT_SLICING:
+        return "bit_slicing";
+    case ProfilePhase::ACCUMULATION:
+        return "accumulation";
+    case ProfilePhase::PARASITICS:
+        return "parasitics";
+    case ProfilePhase::ADC:
+        return "adc";
+    case ProfilePhase::VARIABILITY:
+        return "variability";
+    case ProfilePhase::READ_DISTURB:
+        return "read_disturb";
+    case ProfilePhase::REFRESH:
+        return "refresh";
+    default:
+        return "unknown";
+    }
+}
+
+Profiler::Profiler() : enabled_(false), tracing_(false), epoch_ns_(now_ns()) {}
+
+Profiler &Profiler::get_instance() {
+    static Profiler instance;
+    return instance;
+}
+
+bool Profiler::is_compiled() {
+#ifdef ACS_PROFILING
+    return true;
+#else
+    return false;
+#endif
+}
+
+uint64_t Profiler::now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+void Profiler::set_enabled(bool enabled, bool trace) {
+    tracing_ = enabled && trace;
+    enabled_ = enabled;
+}
+
+void Profiler::reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &thread : threads_) {
+        thread->counters.clear();
+        thread->events.clear();
+        thread->dropped_events = 0;
+    }
+    epoch_ns_ = now_ns();
+}
+
+Profiler::ThreadData &Profiler::get_thread_data() {
+    // Owned by the profiler, so the data outlives the thread
+    thread_local ThreadData *thread_data = nullptr;
+    if (thread_data == nullptr) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        threads_.push_back(std::make_unique<ThreadData>());
+        thread_data = threads_.back().get();
+        thread_data->tid = threads_.size() - 1;
+    }
+    return *thread_data;
+}
+
+void Profiler::record(ProfilePhase phase, uint32_t layer_id, uint64_t start_ns,
+                      uint64_t total_ns, uint64_t self_ns) {
+    ThreadData &data = get_thread_data();
+    const size_t idx = layer_id * num_phases + static_cast<size_t>(phase);
+    if (idx >= data.counters.size()) {
+        data.counters.resize((layer_id + 1) * num_phases);
+    }
+    Counter &counter = data.counters[idx];
+    counter.calls++;
+    counter.total_ns += total_ns;
+    counter.self_ns += self_ns;
+
+    if (is_tracing()) {
+        if (data.events.size() < max_trace_events) {
+            data.events.push_back({phase, layer_id, start_ns, total_ns});
+        } else {
+            data.dropped_events++;
+        }
+    }
+}
+
+nlohmann::json Profiler::to_json() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<Counter> merged;
+    uint64_t dropped_events = 0;
+    for (const auto &thread : threads_) {
+        if (merged.size() < thread->counters.size()) {
+            merged.resize(thread->counters.size());
+        }
+        for (size_t i = 0; i < thread->counters.size(); ++i) {
+            merged[i].calls += thread->counters[i].calls;
+            merged[i].total_ns += thread->counters[i].total_ns;
+            merged[i].self_ns += thread->counters[i].self_ns;
+        }
+        dropped_events += thread->dropped_events;
+    }
+
+    auto counter_to_json = [](const Counter &counter) {
+        return nlohmann::json{{"calls", counter.calls},
+                              {"total_ns", counter.total_ns},
+                              {"self_ns", counter.self_ns}};
+    };
+    nlohmann::json layers = nlohmann::json::object();
+    std::vector<Counter> phases(num_phases);
+    const LayerRegistry &registry = LayerRegistry::get_instance();
+    for (size_t i = 0; i < merged.size(); ++i) {
+        if (merged[i].calls == 0) {
+            continue;
+        }
+        const char *phase = phase_to_string(ProfilePhase(i % num_phases));
+        layers[registry.get_name(i / num_phases)][phase] =
+            counter_to_json(merged[i]);
+        phases[i % num_phases].calls += merged[i].calls;
+        phases[i % num_phases].total_ns += merged[i].total_ns;
+        phases[i % num_phases].self_ns += merged[i].self_ns;
+    }
+    nlohmann::json phases_json = nlohmann::json::object();
+    for (size_t p = 0; p < num_phases; ++p) {
+        if (phases[p].calls > 0) {
+            phases_json[phase_to_string(ProfilePhase(p))] =
+                counter_to_json(phases[p]);
+        }
+    }
+
+    return {{"compiled", is_compiled()},
+            {"enabled", is_enabled()},
+            {"phases", phases_json},
+            {"layers", layers},
+            {"dropped_trace_events", dropped_events}};
+}
+
+nlohmann::json Profiler::to_chrome_trace() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const uint64_t epoch_ns = epoch_ns_;
+    const LayerRegistry &registry = LayerRegistry::get_instance();
+    nlohmann::json events = nlohmann::json::array();
+    uint64_t dropped_events = 0;
+    for (const auto &thread : threads_) {
+        for (const TraceEvent &event : thread->events) {
+            // Complete events ("X"), timestamps in microseconds
+            const std::string &layer = registry.get_name(event.layer_id);
+            events.push_back(
+                {{"name", phase_to_string(event.phase)},
+                 {"cat", layer},
+                 {"ph", "X"},
+                 {"ts", (double(event.start_ns) - double(epoch_ns)) / 1e3},
+                 {"dur", event.dur_ns / 1e3},
+                 {"pid", 0},
+                 {"tid", thread->tid},
+                 {"args", {{"layer", layer}}}});
+        }
+        dropped_events += thread->dropped_events;
+    }
+    return {{"traceEvents", events},
+            {"displayTimeUnit", "ns"},
+            {"otherData", {{"dropped_trace_events", dropped_events}}}};
+}
+
+void ProfileScope::begin() {
+    parent_ = current_scope;
+    current_scope = this;
+    start_ns_ = Profiler::now_ns();
+}
+
+void ProfileScope::end() {
+    const uint64_t total_ns = Profiler::now_ns() - start_ns_;
+    const uint64_t self_ns = total_ns > child_ns_ ? total_ns - child_ns_ : 0;
+    if (parent_) {
+        parent_->child_ns_ += total_ns;
+    }
+    current_scope = parent_;
+    Profiler::get_instance().record(phase_, current_layer_id, start_ns_,
+                                    total_ns, self_ns);
+}
+
+ProfileLayerScope::ProfileLayerScope(uint32_t layer_id) :
+    prev_layer_id_(current_layer_id) {
+    current_layer_id = layer_id;
+}
+
+ProfileLayerScope::~ProfileLayerScope() { current_layer_id = prev_layer_id_; }
+
+} // namespace nq
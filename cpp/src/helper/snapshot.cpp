@@ -0,0 +1,199 @@
+/******************************************************************************
+ * Copyright (C) 2025 Rebecca Pelke                                           *
+ * All Rights Reserved                                                        *
+ *                                                                            *
+ * This work is licensed under the terms described in the LICENSE file        *
+ * found in the root directory of this source tree.                           *
+ ******************************************************************************/
+#include "helper/snapshot.h"
+
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace nq {
+
+namespace {
+
+constexpr char snapshot_magic[8] = {'A', 'C', 'S', 'S', 'N', 'A', 'P', '\0'};
+constexpr uint32_t snapshot_version = 6;
+constexpr uint64_t snapshot_alignment = 64;
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t num_sections;
+};
+
+struct SnapshotEntry {
+    uint32_t id;
+    uint32_t dtype;
+    uint64_t rows;
+    uint64_t cols;
+    uint64_t offset;
+};
+
+uint64_t align(uint64_t offset) {
+    return (offset + snapshot_alignment - 1) & ~(snapshot_alignment - 1);
+}
+
+} // namespace
+
+bool SnapshotWriter::write(const char *path) const {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Could not open snapshot file " << path << std::endl;
+        return false;
+    }
+
+    SnapshotHeader header;
+    std::memcpy(header.magic, snapshot_magic, sizeof(header.magic));
+    header.version = snapshot_version;
+    header.num_sections = sections_.size();
+
+    // Section table with 64-byte aligned payload offsets
+    std::vector<SnapshotEntry> entries;
+    uint64_t offset = align(sizeof(SnapshotHeader) +
+                            sections_.size() * sizeof(SnapshotEntry));
+    for (const Section &section : sections_) {
+        entries.push_back({static_cast<uint32_t>(section.id), section.dtype,
+                           section.rows, section.cols, offset});
+        offset =
+            align(offset + section.rows * section.cols * section.elem_size);
+    }
+
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(entries.data()),
+               entries.size() * sizeof(SnapshotEntry));
+
+    const char padding[snapshot_alignment] = {};
+    for (size_t s = 0; s < sections_.size(); ++s) {
+        const Section &section = sections_[s];
+        uint64_t pos = file.tellp();
+        file.write(padding, entries[s].offset - pos);
+        for (const void *row : section.rows_data) {
+            file.write(static_cast<const char *>(row),
+                       section.cols * section.elem_size);
+        }
+    }
+    uint64_t pos = file.tellp();
+    file.write(padding, align(pos) - pos);
+
+    if (!file.good()) {
+        std::cerr << "Could not write snapshot file " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+SnapshotReader::~SnapshotReader() {
+    if (data_ != nullptr) {
+        munmap(const_cast<char *>(data_), size_);
+    }
+}
+
+bool SnapshotReader::open(const char *path) {
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Could not open snapshot file " << path << std::endl;
+        return false;
+    }
+    struct stat st;
+    if ((fstat(fd, &st) != 0) ||
+        (static_cast<size_t>(st.st_size) < sizeof(SnapshotHeader))) {
+        std::cerr << "Invalid snapshot file " << path << std::endl;
+        close(fd);
+        return false;
+    }
+    void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        std::cerr << "Could not map snapshot file " << path << std::endl;
+        return false;
+    }
+    data_ = static_cast<const char *>(data);
+    size_ = st.st_size;
+
+    const SnapshotHeader *header =
+        reinterpret_cast<const SnapshotHeader *>(data_);
+    if (std::memcmp(header->magic, snapshot_magic, sizeof(snapshot_magic)) !=
+        0) {
+        std::cerr << "Not a crossbar snapshot: " << path << std::endl;
+        return false;
+    }
+    if (header->version != snapshot_version) {
+        std::cerr << "Unsupported snapshot version " << header->version
+                  << " (expected " << snapshot_version << ")." << std::endl;
+        return false;
+    }
+    if (sizeof(SnapshotHeader) +
+            header->num_sections * sizeof(SnapshotEntry) >
+        size_) {
+        std::cerr << "Snapshot file " << path << " is truncated." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool SnapshotReader::has(SnapshotSection id) const {
+    uint64_t rows, cols;
+    return shape(id, rows, cols);
+}
+
+bool SnapshotReader::shape(SnapshotSection id, uint64_t &rows,
+                           uint64_t &cols) const {
+    if (data_ == nullptr) {
+        return false;
+    }
+    const SnapshotHeader *header =
+        reinterpret_cast<const SnapshotHeader *>(data_);
+    const SnapshotEntry *entries =
+        reinterpret_cast<const SnapshotEntry *>(data_ + sizeof(SnapshotHeader));
+    for (uint32_t s = 0; s < header->num_sections; ++s) {
+        if (entries[s].id == static_cast<uint32_t>(id)) {
+            rows = entries[s].rows;
+            cols = entries[s].cols;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *SnapshotReader::find(SnapshotSection id, uint32_t dtype,
+                                 uint64_t rows, uint64_t cols) const {
+    if (data_ == nullptr) {
+        return nullptr;
+    }
+    const SnapshotHeader *header =
+        reinterpret_cast<const SnapshotHeader *>(data_);
+    const SnapshotEntry *entries =
+        reinterpret_cast<const SnapshotEntry *>(data_ + sizeof(SnapshotHeader));
+    for (uint32_t s = 0; s < header->num_sections; ++s) {
+        const SnapshotEntry &entry = entries[s];
+        if (entry.id != static_cast<uint32_t>(id)) {
+            continue;
+        }
+        if ((entry.dtype != dtype) || (entry.rows != rows) ||
+            (entry.cols != cols)) {
+            std::cerr << "Snapshot section " << entry.id
+                      << " does not match the crossbar (" << entry.rows << "x"
+                      << entry.cols << " instead of " << rows << "x" << cols
+                      << ")." << std::endl;
+            return nullptr;
+        }
+        if (entry.offset + rows * cols * (dtype & 0xFF) > size_) {
+            std::cerr << "Snapshot section " << entry.id << " is truncated."
+                      << std::endl;
+            return nullptr;
+        }
+        return data_ + entry.offset;
+    }
+    std::cerr << "Snapshot section " << static_cast<uint32_t>(id)
+              << " not found." << std::endl;
+    return nullptr;
+}
+
+} // namespace nq
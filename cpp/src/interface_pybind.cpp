@@ -6,16 +6,25 @@
  * found in the root directory of this source tree.                           *
  ******************************************************************************/
 #include "oneapi/tbb.h"
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <memory>
 #include <pybind11/numpy.h>
 #include <pybind11/pybind11.h>
 #include <stdio.h>
+#include <string>
+#include <thread>
 #include <vector>
 
+#include "helper/async_executor.h"
 #include "helper/config.h"
+#include "helper/layer_registry.h"
+#include "helper/profiler.h"
+#include "xbar/adc_calibration.h"
 #include "xbar/crossbar.h"
+#include "xbar/layer_engine.h"
+#include "xbar/monte_carlo.h"
 
 #ifdef DEBUG_MODE
 #include <cstdint>
@@ -27,10 +36,15 @@
 
 /********************** Global variables **********************/
 bool cfg_loaded = nq::Config::get_cfg().load_cfg("");
-std::unique_ptr<nq::Crossbar> xbar =
-    (cfg_loaded) ? std::make_unique<nq::Crossbar>() : nullptr;
+std::shared_ptr<nq::Crossbar> xbar =
+    (cfg_loaded) ? std::make_shared<nq::Crossbar>() : nullptr;
 std::string adc_profile_cache = "";
 std::unique_ptr<tbb::global_control> gc; /** TBB Global Control */
+std::unique_ptr<nq::AsyncExecutor> async_executor; /** Async MVM workers */
+/** Tiled layers (cpy_layer), indexed by layer ID */
+std::vector<std::shared_ptr<nq::LayerEngine>> layer_engines;
+/** Device instances of the Monte Carlo evaluation (mc_cpy_mtrx) */
+std::shared_ptr<nq::MonteCarlo> monte_carlo;
 
 /********************** Helper functions **********************/
 const void check_pointer(const size_t *const size) {
@@ -40,6 +54,32 @@ const void check_pointer(const size_t *const size) {
     }
 }
 
+// Synchronous operations first wait for all asynchronous MVMs
+void wait_async() {
+    if (async_executor) {
+        async_executor->wait_all();
+    }
+}
+
+// Switch the config to the profile of the layer ("layers" config section)
+void select_layer(nq::Crossbar &crossbar, uint32_t layer_id) {
+    if (CFG.has_layer_profiles()) {
+        crossbar.select_layer(layer_id);
+    }
+}
+
+void select_layer(nq::LayerEngine &engine, uint32_t layer_id) {
+    if (CFG.has_layer_profiles()) {
+        engine.select_layer(layer_id);
+    }
+}
+
+void select_layer(nq::MonteCarlo &instances, uint32_t layer_id) {
+    if (CFG.has_layer_profiles()) {
+        instances.select_layer(layer_id);
+    }
+}
+
 const void check_xbar() {
     if (xbar == nullptr) {
         std::cerr << "Config missing. xbar not initialized." << std::endl;
@@ -47,21 +87,15 @@ const void check_xbar() {
     }
 }
 
-template <typename T>
-const uint32_t num_matrix_elems(const std::vector<std::vector<T>> &mat) {
-    uint32_t size = 0;
-    for (const auto &inner_vector : mat) {
-        size += inner_vector.size();
-    }
-    return size;
-}
-
 /************************ C interface ************************/
 extern "C" EXPORT_API void set_config(const char *cfg_file,
                                       const int num_threads = 1) {
+    wait_async();
     xbar = nullptr;
+    layer_engines.clear();
+    monte_carlo = nullptr;
     nq::Config::get_cfg().load_cfg(cfg_file);
-    xbar = std::make_unique<nq::Crossbar>();
+    xbar = std::make_shared<nq::Crossbar>();
 
     // Set maximum number of threads
     gc = std::make_unique<tbb::global_control>(
@@ -75,6 +109,7 @@ extern "C" EXPORT_API int32_t update_config(const char *json_config,
     std::cout << "Layer: " << l_name << std::endl;
     std::cout << "Update config called with JSON: " << json_config << std::endl;
 #endif
+    wait_async();
     if (xbar == nullptr) {
         std::cerr << "Error: Crossbar is not initialized. Please call "
                      "set_config() first."
@@ -89,14 +124,43 @@ extern "C" EXPORT_API int32_t update_config(const char *json_config,
 
     // Track whether parameters requiring crossbar recreation were updated
     bool recreate_xbar = false;
+    std::vector<std::string> changed_keys;
 
     // Let Config class handle the JSON parsing and updates
-    bool config_updated =
-        nq::Config::get_cfg().update_cfg(json_config, &recreate_xbar);
-
-    // Only recreate crossbar if necessary keys were updated
-    if (config_updated && recreate_xbar) {
-        xbar = std::make_unique<nq::Crossbar>();
+    bool config_updated = nq::Config::get_cfg().update_cfg(
+        json_config, &recreate_xbar, &changed_keys);
+
+    // Only recreate crossbar if its dimensions changed, all other updates
+    // are applied to the existing crossbar
+    if (config_updated) {
+        if (recreate_xbar) {
+            xbar = std::make_shared<nq::Crossbar>();
+        } else {
+            xbar->reconfigure(changed_keys);
+        }
+        for (const auto &engine : layer_engines) {
+            if (!engine) {
+                continue;
+            }
+            if (recreate_xbar) {
+                engine->retile();
+            } else {
+                engine->reconfigure(changed_keys);
+            }
+        }
+        if (monte_carlo) {
+            if (recreate_xbar) {
+                if (!monte_carlo->rewrite()) {
+                    std::cerr << "Error: The Monte Carlo instances do not "
+                                 "support the new config and were dropped."
+                              << std::endl;
+                    monte_carlo = nullptr;
+                    return -1;
+                }
+            } else {
+                monte_carlo->reconfigure(changed_keys);
+            }
+        }
     }
 #ifdef DEBUG_MODE
     std::cout << "Config update completed." << std::endl;
@@ -104,12 +168,21 @@ extern "C" EXPORT_API int32_t update_config(const char *json_config,
     return 0;
 }
 
-extern "C" EXPORT_API int32_t exe_mvm(int32_t *res, int32_t *vec, int32_t *mat,
-                                      int32_t m_matrix, int32_t n_matrix,
-                                      const char *l_name = "Unknown") {
+// Register a layer name once. The returned ID can be passed to exe_mvm_id
+// instead of the name.
+extern "C" EXPORT_API uint32_t register_layer(const char *l_name) {
+    return nq::LayerRegistry::get_instance().intern(l_name);
+}
+
+// MVM of exe_mvm_id/exe_mvm_range (out_range: nullptr for exact results)
+int32_t exe_mvm_checked(int32_t *res, int32_t *vec, int32_t *mat,
+                        int32_t m_matrix, int32_t n_matrix, uint32_t layer_id,
+                        const nq::OutputRange *out_range) {
 #ifdef DEBUG_MODE
     std::cout << "Matrix-vector multiplication" << std::endl;
-    std::cout << "Layer: " << l_name << std::endl;
+    std::cout << "Layer: "
+              << nq::LayerRegistry::get_instance().get_name(layer_id)
+              << std::endl;
     // Find max and min values in the input vector
     int32_t max_val = INT32_MIN;
     int32_t min_val = INT32_MAX;
@@ -124,6 +197,7 @@ extern "C" EXPORT_API int32_t exe_mvm(int32_t *res, int32_t *vec, int32_t *mat,
     std::cout << "Max value: " << max_val << ", Min value: " << min_val
               << std::endl;
 #endif
+    wait_async();
     if (xbar == nullptr) {
         std::cerr << "Error: Crossbar is not initialized. Please call "
                      "set_config() first."
@@ -135,7 +209,18 @@ extern "C" EXPORT_API int32_t exe_mvm(int32_t *res, int32_t *vec, int32_t *mat,
                   << std::endl;
         return -1;
     }
-    xbar->mvm(res, vec, mat, m_matrix, n_matrix, l_name);
+    if (layer_id >= nq::LayerRegistry::get_instance().size()) {
+        std::cerr << "Error: Unknown layer ID " << layer_id << "."
+                  << std::endl;
+        return -1;
+    }
+    if ((out_range != nullptr) && (out_range->min > out_range->max)) {
+        std::cerr << "Error: Empty output range [" << out_range->min << ", "
+                  << out_range->max << "]." << std::endl;
+        return -1;
+    }
+    select_layer(*xbar, layer_id);
+    xbar->mvm(res, vec, mat, m_matrix, n_matrix, layer_id, out_range);
 #ifdef DEBUG_MODE
     // Find max and min values in the result vector
     max_val = INT32_MIN;
@@ -154,6 +239,33 @@ extern "C" EXPORT_API int32_t exe_mvm(int32_t *res, int32_t *vec, int32_t *mat,
     return 0;
 }
 
+extern "C" EXPORT_API int32_t exe_mvm_id(int32_t *res, int32_t *vec,
+                                         int32_t *mat, int32_t m_matrix,
+                                         int32_t n_matrix, uint32_t layer_id) {
+    return exe_mvm_checked(res, vec, mat, m_matrix, n_matrix, layer_id,
+                           nullptr);
+}
+
+extern "C" EXPORT_API int32_t exe_mvm(int32_t *res, int32_t *vec, int32_t *mat,
+                                      int32_t m_matrix, int32_t n_matrix,
+                                      const char *l_name = "Unknown") {
+    return exe_mvm_id(res, vec, mat, m_matrix, n_matrix,
+                      register_layer(l_name));
+}
+
+// MVM whose results are clipped to [out_min, out_max] by the caller (e.g. a
+// following ReLU). The results are returned clipped, and the analog INT
+// mappings stop reading the rows whose clipped result is decided.
+extern "C" EXPORT_API int32_t exe_mvm_range(int32_t *res, int32_t *vec,
+                                            int32_t *mat, int32_t m_matrix,
+                                            int32_t n_matrix, int32_t out_min,
+                                            int32_t out_max,
+                                            const char *l_name = "Unknown") {
+    const nq::OutputRange out_range{out_min, out_max};
+    return exe_mvm_checked(res, vec, mat, m_matrix, n_matrix,
+                           register_layer(l_name), &out_range);
+}
+
 extern "C" EXPORT_API int32_t cpy_mtrx(int32_t *mat, int32_t m_matrix,
                                        int32_t n_matrix,
                                        const char *l_name = "Unknown") {
@@ -177,6 +289,7 @@ extern "C" EXPORT_API int32_t cpy_mtrx(int32_t *mat, int32_t m_matrix,
     std::cout << "Max value: " << max_val << ", Min value: " << min_val
               << std::endl;
 #endif
+    wait_async();
     if (xbar == nullptr) {
         std::cerr << "Error: Crossbar is not initialized. Please call "
                      "set_config() first."
@@ -188,97 +301,356 @@ extern "C" EXPORT_API int32_t cpy_mtrx(int32_t *mat, int32_t m_matrix,
                   << std::endl;
         return -1;
     }
+    select_layer(*xbar, register_layer(l_name));
     xbar->write(mat, m_matrix, n_matrix);
     return 0;
 }
 
+// Program a matrix of arbitrary size onto a grid of crossbar tiles (see
+// LayerEngine). The tiles are kept per layer until the next cpy_layer of the
+// layer or set_config.
+extern "C" EXPORT_API int32_t cpy_layer(int32_t *mat, int32_t m_matrix,
+                                        int32_t n_matrix,
+                                        const char *l_name = "Unknown") {
+    wait_async();
+    if (xbar == nullptr) {
+        std::cerr << "Error: Crossbar is not initialized. Please call "
+                     "set_config() first."
+                  << std::endl;
+        return -1;
+    }
+    if ((m_matrix <= 0) || (n_matrix <= 0)) {
+        std::cerr << "Error: Invalid matrix dimensions." << std::endl;
+        return -1;
+    }
+    const uint32_t layer_id = register_layer(l_name);
+    if (layer_id >= layer_engines.size()) {
+        layer_engines.resize(layer_id + 1);
+    }
+    auto engine = std::make_shared<nq::LayerEngine>();
+    select_layer(*engine, layer_id);
+    engine->write(mat, m_matrix, n_matrix);
+    layer_engines[layer_id] = engine;
+    return 0;
+}
+
+// Tiles of a layer (cpy_layer) for an MVM of m_matrix x n_matrix, nullptr
+// on error
+std::shared_ptr<nq::LayerEngine>
+get_layer_engine(uint32_t layer_id, int32_t m_matrix, int32_t n_matrix) {
+    if ((layer_id >= layer_engines.size()) || !layer_engines[layer_id]) {
+        std::cerr << "Error: No matrix programmed for layer ID " << layer_id
+                  << ". Please call cpy_layer() first." << std::endl;
+        return nullptr;
+    }
+    const nq::LayerEngine &engine = *layer_engines[layer_id];
+    if ((m_matrix != engine.get_m_matrix()) ||
+        (n_matrix != engine.get_n_matrix())) {
+        std::cerr << "Error: Matrix dimensions " << m_matrix << "x"
+                  << n_matrix << " do not match the programmed layer ("
+                  << engine.get_m_matrix() << "x" << engine.get_n_matrix()
+                  << ")." << std::endl;
+        return nullptr;
+    }
+    return layer_engines[layer_id];
+}
+
+// MVM with the tiles of a layer (cpy_layer). m_matrix and n_matrix must
+// match the programmed matrix.
+extern "C" EXPORT_API int32_t exe_layer_mvm_id(int32_t *res, int32_t *vec,
+                                               int32_t m_matrix,
+                                               int32_t n_matrix,
+                                               uint32_t layer_id) {
+    wait_async();
+    std::shared_ptr<nq::LayerEngine> engine =
+        get_layer_engine(layer_id, m_matrix, n_matrix);
+    if (!engine) {
+        return -1;
+    }
+    select_layer(*engine, layer_id);
+    engine->mvm(res, vec, layer_id);
+    return 0;
+}
+
+extern "C" EXPORT_API int32_t exe_layer_mvm(int32_t *res, int32_t *vec,
+                                            int32_t m_matrix,
+                                            int32_t n_matrix,
+                                            const char *l_name = "Unknown") {
+    return exe_layer_mvm_id(res, vec, m_matrix, n_matrix,
+                            register_layer(l_name));
+}
+
+// Program a matrix onto num_instances independent crossbars (device
+// variability instances, see MonteCarlo; BNN/TNN mappings only). The
+// instances are kept until the next mc_cpy_mtrx or set_config.
+extern "C" EXPORT_API int32_t mc_cpy_mtrx(int32_t *mat, int32_t m_matrix,
+                                          int32_t n_matrix,
+                                          int32_t num_instances,
+                                          const char *l_name = "Unknown") {
+    wait_async();
+    if (xbar == nullptr) {
+        std::cerr << "Error: Crossbar is not initialized. Please call "
+                     "set_config() first."
+                  << std::endl;
+        return -1;
+    }
+    if ((m_matrix <= 0) || (n_matrix <= 0) || (m_matrix > CFG.M) ||
+        (n_matrix > CFG.N)) {
+        std::cerr << "Error: Invalid matrix dimensions." << std::endl;
+        return -1;
+    }
+    if (num_instances <= 0) {
+        std::cerr << "Error: num_instances must be positive." << std::endl;
+        return -1;
+    }
+    auto instances = std::make_shared<nq::MonteCarlo>();
+    select_layer(*instances, register_layer(l_name));
+    if (!instances->write(mat, m_matrix, n_matrix, num_instances)) {
+        return -1;
+    }
+    monte_carlo = instances;
+    return 0;
+}
+
+// Evaluate batch input vectors (batch x n_matrix) on all Monte Carlo
+// instances. out: num_instances x batch x m_matrix results. mean and var
+// (batch x m_matrix, over the instances), mse and mismatch (per instance,
+// vs. the exact result) are optional (nullptr).
+extern "C" EXPORT_API int32_t mc_exe_mvm(int32_t *out, int32_t *vec,
+                                         int32_t batch, double *mean,
+                                         double *var, double *mse,
+                                         double *mismatch,
+                                         const char *l_name = "Unknown") {
+    wait_async();
+    if (!monte_carlo) {
+        std::cerr << "Error: No Monte Carlo instances programmed. Please "
+                     "call mc_cpy_mtrx() first."
+                  << std::endl;
+        return -1;
+    }
+    if (batch < 0) {
+        std::cerr << "Error: Invalid batch size." << std::endl;
+        return -1;
+    }
+    const uint32_t layer_id = register_layer(l_name);
+    nq::MonteCarloStats stats;
+    select_layer(*monte_carlo, layer_id);
+    monte_carlo->mvm(out, vec, batch, stats, layer_id);
+    const auto copy = [](const std::vector<double> &src, double *dst) {
+        if (dst != nullptr) {
+            std::copy(src.begin(), src.end(), dst);
+        }
+    };
+    copy(stats.mean, mean);
+    copy(stats.var, var);
+    copy(stats.mse, mse);
+    copy(stats.mismatch, mismatch);
+    return 0;
+}
+
+// The state and counter getters wait for the queued asynchronous MVMs,
+// which update the counters and (with read disturb) the cell state.
+// The matrix getters return a flat row-major buffer with *size elements
+// (gd: uint8_t, ia: float). The buffer is valid until the crossbar is
+// recreated (set_config or a structural update_config). FP16/BF16 currents
+// are converted into a scratch buffer that the next ia getter call reuses.
 extern "C" EXPORT_API const void *get_gd_p(size_t *size) {
     check_pointer(size);
+    wait_async();
     check_xbar();
     const auto &gd_p = xbar->get_gd_p();
     if (gd_p.empty()) {
         *size = 0;
         return nullptr;
     }
-    *size = num_matrix_elems(gd_p);
-    const void *ptr = static_cast<const void *>(&gd_p);
-    return ptr;
+    *size = gd_p.size();
+    return static_cast<const void *>(gd_p.data());
 }
 
 extern "C" EXPORT_API const void *get_gd_m(size_t *size) {
     check_pointer(size);
+    wait_async();
     check_xbar();
     const auto &gd_m = xbar->get_gd_m();
     if (gd_m.empty()) {
         *size = 0;
         return nullptr;
     }
-    *size = num_matrix_elems(gd_m);
-    const void *ptr = static_cast<const void *>(&gd_m);
-    return ptr;
+    *size = gd_m.size();
+    return static_cast<const void *>(gd_m.data());
 }
 
 extern "C" EXPORT_API const void *get_ia_p(size_t *size) {
     check_pointer(size);
+    wait_async();
     check_xbar();
     const auto &ia_p = xbar->get_ia_p();
     if (ia_p.empty()) {
         *size = 0;
         return nullptr;
     }
-    *size = num_matrix_elems(ia_p);
-    const void *ptr = static_cast<const void *>(&ia_p);
-    return ptr;
+    *size = ia_p.size();
+    return static_cast<const void *>(ia_p.data());
 }
 
 extern "C" EXPORT_API const void *get_ia_m(size_t *size) {
     check_pointer(size);
+    wait_async();
     check_xbar();
     const auto &ia_m = xbar->get_ia_m();
     if (ia_m.empty()) {
         *size = 0;
         return nullptr;
     }
-    *size = num_matrix_elems(ia_m);
-    const void *ptr = static_cast<const void *>(&ia_m);
-    return ptr;
+    *size = ia_m.size();
+    return static_cast<const void *>(ia_m.data());
 }
 
 extern "C" EXPORT_API const uint64_t get_write_xbar_counter() {
+    wait_async();
     check_xbar();
     return xbar->get_write_xbar_counter();
 }
 
 extern "C" EXPORT_API const uint64_t get_mvm_counter() {
+    wait_async();
     check_xbar();
     return xbar->get_mvm_counter();
 }
 
 extern "C" EXPORT_API const uint64_t get_read_num() {
+    wait_async();
     check_xbar();
     return xbar->get_read_num();
 }
 
 extern "C" EXPORT_API const uint64_t get_refresh_xbar_counter() {
+    wait_async();
     check_xbar();
     return xbar->get_refresh_xbar_counter();
 }
 
 extern "C" EXPORT_API const uint64_t get_refresh_cell_counter() {
+    wait_async();
     check_xbar();
     return xbar->get_refresh_cell_counter();
 }
 
 extern "C" EXPORT_API const bool get_rd_run_out_of_bounds() {
+    wait_async();
     check_xbar();
     return xbar->get_rd_run_out_of_bounds();
 }
 
+extern "C" EXPORT_API int32_t save_state(const char *path) {
+    wait_async();
+    if (xbar == nullptr) {
+        std::cerr << "Error: Crossbar is not initialized. Please call "
+                     "set_config() first."
+                  << std::endl;
+        return -1;
+    }
+    return xbar->save_state(path) ? 0 : -1;
+}
+
+extern "C" EXPORT_API int32_t load_state(const char *path) {
+    wait_async();
+    if (xbar == nullptr) {
+        std::cerr << "Error: Crossbar is not initialized. Please call "
+                     "set_config() first."
+                  << std::endl;
+        return -1;
+    }
+    return xbar->load_state(path) ? 0 : -1;
+}
+
+// Start an in-process ADC calibration pass. The following MVMs record the
+// ADC input currents of each layer.
+extern "C" EXPORT_API int32_t begin_adc_calibration() {
+    wait_async();
+    nq::ADCCalibration::get_instance().begin();
+    return 0;
+}
+
+// Finish the calibration pass. The clip range of each layer is derived with
+// the given policy ("percentile", "mse" or "kl") and installed as
+// adc_calib_dict (CALIB mode) without recreating the crossbar.
+extern "C" EXPORT_API int32_t end_adc_calibration(
+    const char *policy = "percentile", float percentile = 99.99) {
+    wait_async();
+    if (xbar == nullptr) {
+        std::cerr << "Error: Crossbar is not initialized. Please call "
+                     "set_config() first."
+                  << std::endl;
+        return -1;
+    }
+    const std::string policy_name = (policy == nullptr) ? "" : policy;
+    nq::ADCCalibPolicy calib_policy;
+    if (policy_name == "percentile") {
+        calib_policy = nq::ADCCalibPolicy::PERCENTILE;
+    } else if (policy_name == "mse") {
+        calib_policy = nq::ADCCalibPolicy::MSE;
+    } else if (policy_name == "kl") {
+        calib_policy = nq::ADCCalibPolicy::KL;
+    } else {
+        std::cerr << "Unknown ADC calibration policy: " << policy_name
+                  << std::endl;
+        return -1;
+    }
+    std::map<std::string, std::pair<float, float>> calib_dict;
+    return nq::ADCCalibration::get_instance().end(calib_policy, percentile,
+                                                  calib_dict)
+               ? 0
+               : -1;
+}
+
+// Enable or disable the per-phase profiling timers. With trace, every timed
+// scope is additionally recorded as a trace event.
+extern "C" EXPORT_API int32_t set_profiling(bool enable, bool trace = false) {
+    wait_async();
+    if (enable && !nq::Profiler::is_compiled()) {
+        std::cerr << "Profiling is not compiled in. Rebuild with "
+                     "-DPROFILING=ON."
+                  << std::endl;
+        return -1;
+    }
+    nq::Profiler::get_instance().set_enabled(enable, trace);
+    return 0;
+}
+
+extern "C" EXPORT_API void reset_profiling() {
+    wait_async();
+    nq::Profiler::get_instance().reset();
+}
+
+static int32_t write_profile(const char *path, const nlohmann::json &profile) {
+    std::ofstream file_stream(path);
+    if (!file_stream.is_open()) {
+        std::cerr << "Could not open profile file: " << path << std::endl;
+        return -1;
+    }
+    file_stream << profile.dump(2);
+    return 0;
+}
+
+// Write the per-phase and per-layer counters as JSON
+extern "C" EXPORT_API int32_t dump_profile(const char *path) {
+    wait_async();
+    return write_profile(path, nq::Profiler::get_instance().to_json());
+}
+
+// Write the trace events in Chrome trace-event format (chrome://tracing)
+extern "C" EXPORT_API int32_t dump_profile_trace(const char *path) {
+    wait_async();
+    return write_profile(path, nq::Profiler::get_instance().to_chrome_trace());
+}
+
 /********************* Pybind interface *********************/
+// Like exe_mvm_id: waits for queued MVMs and selects the layer profile
 int32_t exe_mvm_pb(pybind11::array_t<int32_t> res,
                    pybind11::array_t<int32_t> vec,
                    pybind11::array_t<int32_t> mat, int32_t m_matrix,
-                   int32_t n_matrix) {
+                   int32_t n_matrix, uint32_t layer_id) {
     auto res_buffer = res.request();
     auto vec_buffer = vec.request();
     auto mat_buffer = mat.request();
@@ -287,151 +659,345 @@ int32_t exe_mvm_pb(pybind11::array_t<int32_t> res,
     int32_t *vec_ptr = static_cast<int32_t *>(vec_buffer.ptr);
     int32_t *mat_ptr = static_cast<int32_t *>(mat_buffer.ptr);
 
-    xbar->mvm(res_ptr, vec_ptr, mat_ptr, m_matrix, n_matrix);
-    return 0;
+    return exe_mvm_id(res_ptr, vec_ptr, mat_ptr, m_matrix, n_matrix,
+                      layer_id);
 }
 
-int32_t cpy_mtrx_pb(pybind11::array_t<int32_t> mat, int32_t m_matrix,
-                    int32_t n_matrix) {
+int32_t exe_mvm_range_pb(pybind11::array_t<int32_t> res,
+                         pybind11::array_t<int32_t> vec,
+                         pybind11::array_t<int32_t> mat, int32_t m_matrix,
+                         int32_t n_matrix, int32_t out_min, int32_t out_max,
+                         const std::string &l_name) {
+    auto res_buffer = res.request();
+    auto vec_buffer = vec.request();
     auto mat_buffer = mat.request();
-    int32_t *mat_ptr = static_cast<int32_t *>(mat_buffer.ptr);
-    return cpy_mtrx(mat_ptr, m_matrix, n_matrix);
+
+    return exe_mvm_range(static_cast<int32_t *>(res_buffer.ptr),
+                         static_cast<int32_t *>(vec_buffer.ptr),
+                         static_cast<int32_t *>(mat_buffer.ptr), m_matrix,
+                         n_matrix, out_min, out_max, l_name.c_str());
 }
 
-pybind11::array_t<uint32_t> get_gd_p_pb() {
-    check_xbar();
+using int32_c_array =
+    pybind11::array_t<int32_t,
+                      pybind11::array::c_style | pybind11::array::forcecast>;
+
+// Raw buffers of a batched MVM. Does not hold Python objects and can
+// therefore be executed without the GIL.
+struct MvmBatch {
+    const char *vec_ptr;
+    pybind11::ssize_t vec_stride;
+    char *out_ptr;
+    pybind11::ssize_t out_stride;
+    pybind11::ssize_t out_col_stride;
+    pybind11::ssize_t batch;
+    int32_t m_matrix;
+    int32_t n_matrix;
+    uint32_t layer_id;
+
+    // The layer profile is selected by the caller (Python thread)
+    void run(nq::Crossbar &crossbar) const {
+        run_rows([&](int32_t *res, const int32_t *vec_row) {
+            crossbar.mvm(res, vec_row, nullptr, m_matrix, n_matrix, layer_id);
+        });
+    }
 
-    const auto &gd_p = xbar->get_gd_p();
-    size_t rows = gd_p.size();
-    size_t cols = (rows > 0) ? gd_p[0].size() : 0;
-
-    pybind11::array_t<uint32_t> result({rows, cols});
-    auto r = result.mutable_unchecked<2>();
-    for (size_t i = 0; i < rows; ++i) {
-        for (size_t j = 0; j < cols; ++j) {
-            r(i, j) = gd_p[i][j];
+    void run(nq::LayerEngine &engine) const {
+        run_rows([&](int32_t *res, const int32_t *vec_row) {
+            engine.mvm(res, vec_row, layer_id);
+        });
+    }
+
+    template <typename MvmFn> void run_rows(MvmFn mvm) const {
+        constexpr pybind11::ssize_t elem_size = sizeof(int32_t);
+        const bool out_direct =
+            (m_matrix <= 1) || (out_col_stride == elem_size);
+        std::vector<int32_t> scratch(out_direct ? 0 : m_matrix);
+        for (pybind11::ssize_t b = 0; b < batch; ++b) {
+            const int32_t *vec_row =
+                reinterpret_cast<const int32_t *>(vec_ptr + b * vec_stride);
+            char *out_row = out_ptr + b * out_stride;
+            int32_t *res = out_direct ? reinterpret_cast<int32_t *>(out_row)
+                                      : scratch.data();
+            std::fill(res, res + m_matrix, 0);
+            mvm(res, vec_row);
+            if (!out_direct) {
+                for (int32_t m = 0; m < m_matrix; ++m) {
+                    char *elem = out_row + m * out_col_stride;
+                    *reinterpret_cast<int32_t *>(elem) = scratch[m];
+                }
+            }
         }
     }
-    return result;
+};
+
+// Validate the arrays of a batched MVM: vec (batch x n_matrix) and out
+// (batch x m_matrix). 1-D arrays are treated as a batch of one vector. int32
+// inputs with unit column stride are read in place (arbitrary row stride);
+// any other input is cast to int32 once (stored in vec). out must be a
+// writeable int32 array and is overwritten.
+bool prepare_mvm_batch(pybind11::array &vec, pybind11::array &out,
+                       int32_t m_matrix, int32_t n_matrix,
+                       uint32_t layer_id, MvmBatch &job) {
+    if (layer_id >= nq::LayerRegistry::get_instance().size()) {
+        std::cerr << "Error: Unknown layer ID " << layer_id << "."
+                  << std::endl;
+        return false;
+    }
+    const pybind11::ssize_t ndim = vec.ndim();
+    if ((ndim < 1) || (ndim > 2) || (out.ndim() != ndim)) {
+        std::cerr << "Error: vec and out must both be 1-D or 2-D arrays."
+                  << std::endl;
+        return false;
+    }
+    const pybind11::ssize_t batch = (ndim == 2) ? vec.shape(0) : 1;
+    if ((vec.shape(ndim - 1) != n_matrix) ||
+        (out.shape(ndim - 1) != m_matrix) ||
+        ((ndim == 2) && (out.shape(0) != batch))) {
+        std::cerr << "Error: vec must have shape (batch, n_matrix) and out "
+                     "must have shape (batch, m_matrix)."
+                  << std::endl;
+        return false;
+    }
+    if (!pybind11::isinstance<pybind11::array_t<int32_t>>(out) ||
+        !out.writeable()) {
+        std::cerr << "Error: out must be a writeable int32 array."
+                  << std::endl;
+        return false;
+    }
+
+    // Input rows: in place if possible, otherwise one explicit cast
+    constexpr pybind11::ssize_t elem_size = sizeof(int32_t);
+    if (pybind11::isinstance<pybind11::array_t<int32_t>>(vec) &&
+        ((n_matrix <= 1) || (vec.strides(ndim - 1) == elem_size))) {
+        job.vec_stride = (ndim == 2) ? vec.strides(0) : 0;
+    } else {
+        vec = int32_c_array(vec);
+        job.vec_stride = n_matrix * elem_size;
+    }
+    job.vec_ptr = static_cast<const char *>(vec.data());
+    job.out_ptr = static_cast<char *>(out.mutable_data());
+    job.out_stride = (ndim == 2) ? out.strides(0) : 0;
+    job.out_col_stride = out.strides(ndim - 1);
+    job.batch = batch;
+    job.m_matrix = m_matrix;
+    job.n_matrix = n_matrix;
+    job.layer_id = layer_id;
+    return true;
 }
 
-pybind11::array_t<uint32_t> get_gd_m_pb() {
-    check_xbar();
+// Crossbar of a batched MVM on the global crossbar (nullptr on error)
+std::shared_ptr<nq::Crossbar> get_mvm_xbar(int32_t m_matrix,
+                                           int32_t n_matrix) {
+    if (xbar == nullptr) {
+        std::cerr << "Error: Crossbar is not initialized. Please call "
+                     "set_config() first."
+                  << std::endl;
+        return nullptr;
+    }
+    if (m_matrix > CFG.M || n_matrix > CFG.N) {
+        std::cerr << "Error: Matrix dimensions exceed the crossbar size."
+                  << std::endl;
+        return nullptr;
+    }
+    return xbar;
+}
 
-    const auto &gd_m = xbar->get_gd_m();
-    size_t rows = gd_m.size();
-    size_t cols = (rows > 0) ? gd_m[0].size() : 0;
-
-    pybind11::array_t<uint32_t> result({rows, cols});
-    auto r = result.mutable_unchecked<2>();
-    for (size_t i = 0; i < rows; ++i) {
-        for (size_t j = 0; j < cols; ++j) {
-            r(i, j) = gd_m[i][j];
-        }
+// Batched MVM (see prepare_mvm_batch). The GIL is released while the batch
+// is simulated. The crossbar must not be reconfigured concurrently.
+int32_t mvm_batch_pb(pybind11::array vec, pybind11::array out,
+                     int32_t m_matrix, int32_t n_matrix, uint32_t layer_id) {
+    wait_async();
+    MvmBatch job;
+    std::shared_ptr<nq::Crossbar> xbar_ref = get_mvm_xbar(m_matrix, n_matrix);
+    if (!xbar_ref ||
+        !prepare_mvm_batch(vec, out, m_matrix, n_matrix, layer_id, job)) {
+        return -1;
     }
-    return result;
+    select_layer(*xbar_ref, layer_id);
+    pybind11::gil_scoped_release release;
+    job.run(*xbar_ref);
+    return 0;
 }
 
-pybind11::array_t<float> get_ia_p_pb() {
-    check_xbar();
+// Handle of an asynchronous batched MVM. Keeps the input and output arrays
+// alive until the MVM has finished; the destructor waits for completion.
+class MvmHandle {
+  public:
+    MvmHandle(std::shared_ptr<nq::AsyncTask> task, pybind11::array vec,
+              pybind11::array out) :
+        task_(task), vec_(vec), out_(out) {}
+    MvmHandle(const MvmHandle &) = delete;
+    virtual ~MvmHandle() {
+        pybind11::gil_scoped_release release;
+        task_->wait();
+    }
 
-    const auto &ia_p = xbar->get_ia_p();
-    size_t rows = ia_p.size();
-    size_t cols = (rows > 0) ? ia_p[0].size() : 0;
-
-    pybind11::array_t<float> result({rows, cols});
-    auto r = result.mutable_unchecked<2>();
-    for (size_t i = 0; i < rows; ++i) {
-        for (size_t j = 0; j < cols; ++j) {
-            r(i, j) = ia_p[i][j];
-        }
+    bool done() const { return task_->done(); }
+    int32_t wait() {
+        pybind11::gil_scoped_release release;
+        return task_->wait();
     }
-    return result;
-}
 
-pybind11::array_t<float> get_ia_m_pb() {
-    check_xbar();
+  private:
+    std::shared_ptr<nq::AsyncTask> task_;
+    pybind11::array vec_;
+    pybind11::array out_;
+};
+
+// Select the layer profile of an asynchronous MVM on the submitting thread.
+// The queued MVMs read the shared config, so a profile switch (or a
+// reconfiguration of the target) first waits for them.
+template <typename Target>
+void select_layer_async(Target &target, uint32_t layer_id) {
+    if (CFG.has_layer_profiles() && !target.layer_selected(layer_id)) {
+        wait_async();
+        target.select_layer(layer_id);
+    }
+}
 
-    const auto &ia_m = xbar->get_ia_m();
-    size_t rows = ia_m.size();
-    size_t cols = (rows > 0) ? ia_m[0].size() : 0;
-
-    pybind11::array_t<float> result({rows, cols});
-    auto r = result.mutable_unchecked<2>();
-    for (size_t i = 0; i < rows; ++i) {
-        for (size_t j = 0; j < cols; ++j) {
-            r(i, j) = ia_m[i][j];
-        }
+// Queue a batch on the strand of target (crossbar or layer engine): MVMs on
+// the same target are executed in submission order (consistent read disturb
+// state), MVMs on different targets run in parallel.
+template <typename Target>
+std::unique_ptr<MvmHandle> submit_mvm_batch(std::shared_ptr<Target> target,
+                                            pybind11::array vec,
+                                            pybind11::array out,
+                                            int32_t m_matrix,
+                                            int32_t n_matrix,
+                                            uint32_t layer_id) {
+    if (!async_executor) {
+        async_executor = std::make_unique<nq::AsyncExecutor>(
+            std::thread::hardware_concurrency());
     }
-    return result;
+    MvmBatch job;
+    if (!target ||
+        !prepare_mvm_batch(vec, out, m_matrix, n_matrix, layer_id, job)) {
+        return std::make_unique<MvmHandle>(
+            async_executor->submit(nullptr, [] { return -1; }), vec, out);
+    }
+    select_layer_async(*target, layer_id);
+    auto task = async_executor->submit(target.get(), [target, job] {
+        job.run(*target);
+        return 0;
+    });
+    return std::make_unique<MvmHandle>(task, vec, out);
 }
 
-pybind11::array_t<uint64_t> get_cycles_p_pb() {
-    check_xbar();
+// Asynchronous batched MVM on the crossbar (see prepare_mvm_batch).
+// Synchronous calls wait for all queued MVMs.
+std::unique_ptr<MvmHandle> mvm_async_pb(pybind11::array vec,
+                                        pybind11::array out, int32_t m_matrix,
+                                        int32_t n_matrix, uint32_t layer_id) {
+    return submit_mvm_batch(get_mvm_xbar(m_matrix, n_matrix), vec, out,
+                            m_matrix, n_matrix, layer_id);
+}
 
-    const auto &cycles_p = xbar->get_cycles_p();
-    size_t rows = cycles_p.size();
-    size_t cols = (rows > 0) ? cycles_p[0].size() : 0;
-
-    pybind11::array_t<uint64_t> result({rows, cols});
-    auto r = result.mutable_unchecked<2>();
-    for (size_t i = 0; i < rows; ++i) {
-        for (size_t j = 0; j < cols; ++j) {
-            r(i, j) = cycles_p[i][j];
-        }
+// Asynchronous batched MVM with the tiles of a layer (cpy_layer). Every
+// layer has its own strand, so the MVMs of different layers run in parallel.
+std::unique_ptr<MvmHandle> layer_mvm_async_pb(pybind11::array vec,
+                                              pybind11::array out,
+                                              int32_t m_matrix,
+                                              int32_t n_matrix,
+                                              uint32_t layer_id) {
+    return submit_mvm_batch(get_layer_engine(layer_id, m_matrix, n_matrix),
+                            vec, out, m_matrix, n_matrix, layer_id);
+}
+
+int32_t wait_all_pb() {
+    pybind11::gil_scoped_release release;
+    wait_async();
+    return 0;
+}
+
+int32_t cpy_mtrx_pb(pybind11::array_t<int32_t> mat, int32_t m_matrix,
+                    int32_t n_matrix, const std::string &l_name) {
+    auto mat_buffer = mat.request();
+    int32_t *mat_ptr = static_cast<int32_t *>(mat_buffer.ptr);
+    return cpy_mtrx(mat_ptr, m_matrix, n_matrix, l_name.c_str());
+}
+
+// Read-only numpy view of a crossbar matrix. The view keeps the owner of
+// the buffer alive (capsule), even if the crossbar or its read disturb model
+// are replaced afterwards. It shows the live state, so it must not be read
+// while asynchronous MVMs are queued (wait_all first). With copy=true, an
+// independent (writeable) copy is returned instead.
+template <typename T>
+pybind11::array_t<T> matrix_view(const nq::Matrix<T> &mat, bool copy,
+                                 std::shared_ptr<const void> owner) {
+    std::vector<size_t> shape = {mat.rows(), mat.cols()};
+    if (copy) {
+        return pybind11::array_t<T>(shape, mat.data());
     }
-    return result;
+    pybind11::capsule capsule(
+        new std::shared_ptr<const void>(std::move(owner)), [](void *ptr) {
+            delete static_cast<std::shared_ptr<const void> *>(ptr);
+        });
+    pybind11::array_t<T> view(shape, mat.data(), capsule);
+    pybind11::detail::array_proxy(view.ptr())->flags &=
+        ~pybind11::detail::npy_api::NPY_ARRAY_WRITEABLE_;
+    return view;
+}
+
+// FP16/BF16 currents are converted into a scratch buffer of the mapper that
+// is overwritten by the next conversion, so they are always copied
+bool ia_view_allowed() {
+    return CFG.digital_only ||
+           (CFG.conductance_precision == nq::ConductancePrecision::FP32);
 }
 
-pybind11::array_t<uint64_t> get_cycles_m_pb() {
+pybind11::array_t<uint8_t> get_gd_p_pb(bool copy) {
+    wait_async();
     check_xbar();
+    return matrix_view(xbar->get_gd_p(), copy, xbar);
+}
 
-    const auto &cycles_m = xbar->get_cycles_m();
-    size_t rows = cycles_m.size();
-    size_t cols = (rows > 0) ? cycles_m[0].size() : 0;
-
-    pybind11::array_t<uint64_t> result({rows, cols});
-    auto r = result.mutable_unchecked<2>();
-    for (size_t i = 0; i < rows; ++i) {
-        for (size_t j = 0; j < cols; ++j) {
-            r(i, j) = cycles_m[i][j];
-        }
-    }
-    return result;
+pybind11::array_t<uint8_t> get_gd_m_pb(bool copy) {
+    wait_async();
+    check_xbar();
+    return matrix_view(xbar->get_gd_m(), copy, xbar);
 }
 
-pybind11::array_t<uint64_t> get_consecutive_reads_p_pb() {
+pybind11::array_t<float> get_ia_p_pb(bool copy) {
+    wait_async();
     check_xbar();
+    return matrix_view(xbar->get_ia_p(), copy || !ia_view_allowed(), xbar);
+}
 
-    const auto &consecutive_reads_p = xbar->get_consecutive_reads_p();
-    size_t rows = consecutive_reads_p.size();
-    size_t cols = (rows > 0) ? consecutive_reads_p[0].size() : 0;
+pybind11::array_t<float> get_ia_m_pb(bool copy) {
+    wait_async();
+    check_xbar();
+    return matrix_view(xbar->get_ia_m(), copy || !ia_view_allowed(), xbar);
+}
 
-    pybind11::array_t<uint64_t> result({rows, cols});
-    auto r = result.mutable_unchecked<2>();
-    for (size_t i = 0; i < rows; ++i) {
-        for (size_t j = 0; j < cols; ++j) {
-            r(i, j) = consecutive_reads_p[i][j];
-        }
-    }
-    return result;
+// The read disturb counters are owned by the read disturb model, which is
+// replaced on V_read updates and released if read disturb is disabled
+pybind11::array_t<uint64_t> get_cycles_p_pb(bool copy) {
+    wait_async();
+    check_xbar();
+    const auto &cycles_p = xbar->get_cycles_p();
+    return matrix_view(cycles_p, copy, xbar->get_rd_model());
 }
 
-pybind11::array_t<uint64_t> get_consecutive_reads_m_pb() {
+pybind11::array_t<uint64_t> get_cycles_m_pb(bool copy) {
+    wait_async();
     check_xbar();
+    const auto &cycles_m = xbar->get_cycles_m();
+    return matrix_view(cycles_m, copy, xbar->get_rd_model());
+}
 
-    const auto &consecutive_reads_m = xbar->get_consecutive_reads_m();
-    size_t rows = consecutive_reads_m.size();
-    size_t cols = (rows > 0) ? consecutive_reads_m[0].size() : 0;
+pybind11::array_t<uint64_t> get_consecutive_reads_p_pb(bool copy) {
+    wait_async();
+    check_xbar();
+    const auto &reads_p = xbar->get_consecutive_reads_p();
+    return matrix_view(reads_p, copy, xbar->get_rd_model());
+}
 
-    pybind11::array_t<uint64_t> result({rows, cols});
-    auto r = result.mutable_unchecked<2>();
-    for (size_t i = 0; i < rows; ++i) {
-        for (size_t j = 0; j < cols; ++j) {
-            r(i, j) = consecutive_reads_m[i][j];
-        }
-    }
-    return result;
+pybind11::array_t<uint64_t> get_consecutive_reads_m_pb(bool copy) {
+    wait_async();
+    check_xbar();
+    const auto &reads_m = xbar->get_consecutive_reads_m();
+    return matrix_view(reads_m, copy, xbar->get_rd_model());
 }
 
 void update_config_pb(const std::string &json_config) {
@@ -446,44 +1012,155 @@ void update_config_pb(const std::string &json_config) {
     update_config(json_config.c_str());
 }
 
+// Calibrated ADC current range (min, max) per layer
+pybind11::dict get_adc_calib_dict_pb() {
+    wait_async();
+    pybind11::dict calib_dict;
+    for (const auto &[l_name, range] : CFG.adc_calib_dict) {
+        calib_dict[pybind11::str(l_name)] =
+            pybind11::make_tuple(range.first, range.second);
+    }
+    return calib_dict;
+}
+
+int32_t cpy_layer_pb(int32_c_array mat, const std::string &l_name) {
+    if (mat.ndim() != 2) {
+        std::cerr << "Error: mat must be a 2-D array." << std::endl;
+        return -1;
+    }
+    return cpy_layer(mat.mutable_data(), mat.shape(0), mat.shape(1),
+                     l_name.c_str());
+}
+
+// MVM with the tiles of a layer. The GIL is released while the tiles are
+// simulated.
+int32_t layer_mvm_pb(pybind11::array_t<int32_t> res,
+                     pybind11::array_t<int32_t> vec, int32_t m_matrix,
+                     int32_t n_matrix, uint32_t layer_id) {
+    int32_t *res_ptr = static_cast<int32_t *>(res.request().ptr);
+    int32_t *vec_ptr = static_cast<int32_t *>(vec.request().ptr);
+    pybind11::gil_scoped_release release;
+    return exe_layer_mvm_id(res_ptr, vec_ptr, m_matrix, n_matrix, layer_id);
+}
+
+int32_t mc_cpy_pb(int32_c_array mat, int32_t num_instances,
+                  const std::string &l_name) {
+    if (mat.ndim() != 2) {
+        std::cerr << "Error: mat must be a 2-D array." << std::endl;
+        return -1;
+    }
+    return mc_cpy_mtrx(mat.mutable_data(), mat.shape(0), mat.shape(1),
+                       num_instances, l_name.c_str());
+}
+
+// Monte Carlo MVM of a batch (batch x n_matrix or one vector). Returns a
+// dict with the per-instance outputs ("out": num_instances x batch x
+// m_matrix) and the statistics ("digital", "mean", "var": batch x m_matrix;
+// "mse", "mismatch": per instance), or an empty dict on error. The GIL is
+// released while the instances are simulated.
+pybind11::dict mc_mvm_pb(int32_c_array vec, const std::string &l_name) {
+    wait_async();
+    if (!monte_carlo) {
+        std::cerr << "Error: No Monte Carlo instances programmed. Please "
+                     "call mc_cpy() first."
+                  << std::endl;
+        return pybind11::dict();
+    }
+    const pybind11::ssize_t m_matrix = monte_carlo->get_m_matrix();
+    const pybind11::ssize_t n_matrix = monte_carlo->get_n_matrix();
+    const pybind11::ssize_t instances = monte_carlo->get_num_instances();
+    if ((vec.ndim() < 1) || (vec.ndim() > 2) ||
+        (vec.shape(vec.ndim() - 1) != n_matrix)) {
+        std::cerr << "Error: vec must have shape (batch, n_matrix)."
+                  << std::endl;
+        return pybind11::dict();
+    }
+    const pybind11::ssize_t batch = (vec.ndim() == 2) ? vec.shape(0) : 1;
+
+    pybind11::array_t<int32_t> out({instances, batch, m_matrix});
+    nq::MonteCarloStats stats;
+    {
+        std::shared_ptr<nq::MonteCarlo> instances_ref = monte_carlo;
+        const uint32_t layer_id = register_layer(l_name.c_str());
+        const int32_t *vec_ptr = vec.data();
+        int32_t *out_ptr = out.mutable_data();
+        pybind11::gil_scoped_release release;
+        select_layer(*instances_ref, layer_id);
+        instances_ref->mvm(out_ptr, vec_ptr, batch, stats, layer_id);
+    }
+
+    const std::vector<pybind11::ssize_t> shape = {batch, m_matrix};
+    pybind11::dict result;
+    result["out"] = out;
+    result["digital"] =
+        pybind11::array_t<int64_t>(shape, stats.digital.data());
+    result["mean"] = pybind11::array_t<double>(shape, stats.mean.data());
+    result["var"] = pybind11::array_t<double>(shape, stats.var.data());
+    result["mse"] =
+        pybind11::array_t<double>(stats.mse.size(), stats.mse.data());
+    result["mismatch"] = pybind11::array_t<double>(stats.mismatch.size(),
+                                                   stats.mismatch.data());
+    return result;
+}
+
 /*********************** C++ interface ***********************/
-EXPORT_API const std::vector<std::vector<int32_t>> &get_gd_p() {
+EXPORT_API const nq::Matrix<uint8_t> &get_gd_p() {
+    wait_async();
     return xbar->get_gd_p();
 }
 
-EXPORT_API const std::vector<std::vector<int32_t>> &get_gd_m() {
+EXPORT_API const nq::Matrix<uint8_t> &get_gd_m() {
+    wait_async();
     return xbar->get_gd_m();
 }
 
-EXPORT_API const std::vector<std::vector<float>> &get_ia_p() {
+EXPORT_API const nq::Matrix<float> &get_ia_p() {
+    wait_async();
     return xbar->get_ia_p();
 }
 
-EXPORT_API const std::vector<std::vector<float>> &get_ia_m() {
+EXPORT_API const nq::Matrix<float> &get_ia_m() {
+    wait_async();
     return xbar->get_ia_m();
 }
 
-EXPORT_API const std::vector<std::vector<uint64_t>> &get_cycles_p() {
+EXPORT_API const nq::Matrix<uint64_t> &get_cycles_p() {
+    wait_async();
     return xbar->get_cycles_p();
 }
 
-EXPORT_API const std::vector<std::vector<uint64_t>> &get_cycles_m() {
+EXPORT_API const nq::Matrix<uint64_t> &get_cycles_m() {
+    wait_async();
     return xbar->get_cycles_m();
 }
 
-EXPORT_API const std::vector<std::vector<uint64_t>> &get_consecutive_reads_p() {
+EXPORT_API const nq::Matrix<uint64_t> &get_consecutive_reads_p() {
+    wait_async();
     return xbar->get_consecutive_reads_p();
 }
 
-EXPORT_API const std::vector<std::vector<uint64_t>> &get_consecutive_reads_m() {
+EXPORT_API const nq::Matrix<uint64_t> &get_consecutive_reads_m() {
+    wait_async();
     return xbar->get_consecutive_reads_m();
 }
 
+EXPORT_API std::shared_ptr<const nq::ReadDisturb> get_rd_model() {
+    wait_async();
+    return xbar->get_rd_model();
+}
+
 EXPORT_API const std::string get_adc_profile() {
+    wait_async();
     return nq::ADCHistograms::get_instance().to_json().dump();
 }
 
+EXPORT_API const std::string get_profile() {
+    wait_async();
+    return nq::Profiler::get_instance().to_json().dump();
+}
+
 EXPORT_API const void dump_adc_profile(const std::string filename) {
+    wait_async();
     std::ofstream file_stream(filename);
     if (!file_stream.is_open()) {
         std::cerr << "Could not open ADC profile dump file!";
@@ -495,30 +1172,161 @@ EXPORT_API const void dump_adc_profile(const std::string filename) {
 
 /********************* Pybind definitions *********************/
 PYBIND11_MODULE(acs_py, m) {
-    m.def("cpy", &cpy_mtrx_pb, "Copy matrix to crossbar.");
-    m.def("mvm", &exe_mvm_pb, "Execute matrix-vector multiplication.");
+    m.def("cpy", &cpy_mtrx_pb, "Copy matrix to crossbar.",
+          pybind11::arg("mat"), pybind11::arg("m_matrix"),
+          pybind11::arg("n_matrix"), pybind11::arg("l_name") = "Unknown");
+    // Layers are given by ID (register_layer) or by name
+    m.def("mvm", &exe_mvm_pb, "Execute matrix-vector multiplication.",
+          pybind11::arg("res"), pybind11::arg("vec"), pybind11::arg("mat"),
+          pybind11::arg("m_matrix"), pybind11::arg("n_matrix"),
+          pybind11::arg("layer_id"));
+    m.def(
+        "mvm",
+        [](pybind11::array_t<int32_t> res, pybind11::array_t<int32_t> vec,
+           pybind11::array_t<int32_t> mat, int32_t m_matrix, int32_t n_matrix,
+           const std::string &l_name) {
+            return exe_mvm_pb(res, vec, mat, m_matrix, n_matrix,
+                              register_layer(l_name.c_str()));
+        },
+        "Execute matrix-vector multiplication.", pybind11::arg("res"),
+        pybind11::arg("vec"), pybind11::arg("mat"), pybind11::arg("m_matrix"),
+        pybind11::arg("n_matrix"), pybind11::arg("l_name") = "Unknown");
+    m.def("mvm_range", &exe_mvm_range_pb,
+          "Execute a matrix-vector multiplication whose results are clipped "
+          "to [out_min, out_max].",
+          pybind11::arg("res"), pybind11::arg("vec"), pybind11::arg("mat"),
+          pybind11::arg("m_matrix"), pybind11::arg("n_matrix"),
+          pybind11::arg("out_min"), pybind11::arg("out_max"),
+          pybind11::arg("l_name") = "Unknown");
+    m.def("register_layer", &register_layer,
+          "Register a layer name and get its layer ID.",
+          pybind11::arg("l_name"));
+    // Layers are given by ID (register_layer) or by name
+    m.def("mvm_batch", &mvm_batch_pb,
+          "Execute a batch of matrix-vector multiplications.",
+          pybind11::arg("vec"), pybind11::arg("out"),
+          pybind11::arg("m_matrix"), pybind11::arg("n_matrix"),
+          pybind11::arg("layer_id"));
+    m.def(
+        "mvm_batch",
+        [](pybind11::array vec, pybind11::array out, int32_t m_matrix,
+           int32_t n_matrix, const std::string &l_name) {
+            return mvm_batch_pb(vec, out, m_matrix, n_matrix,
+                                register_layer(l_name.c_str()));
+        },
+        "Execute a batch of matrix-vector multiplications.",
+        pybind11::arg("vec"), pybind11::arg("out"), pybind11::arg("m_matrix"),
+        pybind11::arg("n_matrix"), pybind11::arg("l_name") = "Unknown");
+    m.def("mvm_async", &mvm_async_pb,
+          "Queue a batch of matrix-vector multiplications. Returns a handle. "
+          "Views of the crossbar state (copy=False) must not be read until "
+          "wait_all() returns.",
+          pybind11::arg("vec"), pybind11::arg("out"),
+          pybind11::arg("m_matrix"), pybind11::arg("n_matrix"),
+          pybind11::arg("layer_id"));
+    m.def(
+        "mvm_async",
+        [](pybind11::array vec, pybind11::array out, int32_t m_matrix,
+           int32_t n_matrix, const std::string &l_name) {
+            return mvm_async_pb(vec, out, m_matrix, n_matrix,
+                                register_layer(l_name.c_str()));
+        },
+        "Queue a batch of matrix-vector multiplications. Returns a handle. "
+        "Views of the crossbar state (copy=False) must not be read until "
+        "wait_all() returns.",
+        pybind11::arg("vec"), pybind11::arg("out"), pybind11::arg("m_matrix"),
+        pybind11::arg("n_matrix"), pybind11::arg("l_name") = "Unknown");
+    m.def("layer_mvm_async", &layer_mvm_async_pb,
+          "Queue a batch of matrix-vector multiplications with the tiles of "
+          "a layer. Returns a handle.",
+          pybind11::arg("vec"), pybind11::arg("out"),
+          pybind11::arg("m_matrix"), pybind11::arg("n_matrix"),
+          pybind11::arg("layer_id"));
+    m.def(
+        "layer_mvm_async",
+        [](pybind11::array vec, pybind11::array out, int32_t m_matrix,
+           int32_t n_matrix, const std::string &l_name) {
+            return layer_mvm_async_pb(vec, out, m_matrix, n_matrix,
+                                      register_layer(l_name.c_str()));
+        },
+        "Queue a batch of matrix-vector multiplications with the tiles of "
+        "a layer. Returns a handle.",
+        pybind11::arg("vec"), pybind11::arg("out"), pybind11::arg("m_matrix"),
+        pybind11::arg("n_matrix"), pybind11::arg("l_name") = "Unknown");
+    m.def("cpy_layer", &cpy_layer_pb,
+          "Copy a matrix of arbitrary size to a grid of crossbar tiles.",
+          pybind11::arg("mat"), pybind11::arg("l_name") = "Unknown");
+    m.def("layer_mvm", &layer_mvm_pb,
+          "Execute a matrix-vector multiplication with the tiles of a layer.",
+          pybind11::arg("res"), pybind11::arg("vec"),
+          pybind11::arg("m_matrix"), pybind11::arg("n_matrix"),
+          pybind11::arg("layer_id"));
+    m.def(
+        "layer_mvm",
+        [](pybind11::array_t<int32_t> res, pybind11::array_t<int32_t> vec,
+           int32_t m_matrix, int32_t n_matrix, const std::string &l_name) {
+            return layer_mvm_pb(res, vec, m_matrix, n_matrix,
+                                register_layer(l_name.c_str()));
+        },
+        "Execute a matrix-vector multiplication with the tiles of a layer.",
+        pybind11::arg("res"), pybind11::arg("vec"), pybind11::arg("m_matrix"),
+        pybind11::arg("n_matrix"), pybind11::arg("l_name") = "Unknown");
+    m.def("mc_cpy", &mc_cpy_pb,
+          "Copy a matrix to num_instances independent crossbars (Monte "
+          "Carlo over device variability, BNN/TNN mappings only).",
+          pybind11::arg("mat"), pybind11::arg("num_instances"),
+          pybind11::arg("l_name") = "Unknown");
+    m.def("mc_mvm", &mc_mvm_pb,
+          "Execute a batch of matrix-vector multiplications on all Monte "
+          "Carlo instances. Returns the outputs and statistics.",
+          pybind11::arg("vec"), pybind11::arg("l_name") = "Unknown");
+    m.def("wait_all", &wait_all_pb,
+          "Wait until all queued matrix-vector multiplications are done.");
+    pybind11::class_<MvmHandle>(m, "MvmHandle")
+        .def("done", &MvmHandle::done, "Check if the MVM has finished.")
+        .def("wait", &MvmHandle::wait,
+             "Wait until the MVM has finished and return its status.")
+        .def("__await__", [](pybind11::object self) { return self; })
+        .def("__iter__", [](pybind11::object self) { return self; })
+        .def("__next__", [](MvmHandle &handle) {
+            // Awaiting polls the handle: yield None until the MVM finished
+            if (!handle.done()) {
+                return;
+            }
+            PyErr_SetObject(PyExc_StopIteration,
+                            pybind11::int_(handle.wait()).ptr());
+            throw pybind11::error_already_set();
+        });
     m.def("set_config", &set_config, "Set a config for the crossbar.",
           pybind11::arg("cfg_file"), pybind11::arg("num_threads") = 1);
     m.def("update_config", &update_config_pb,
           "Update configuration from JSON string.");
     m.def("gd_p", &get_gd_p_pb,
-          "Get the positive (digital) conductance matrix.");
+          "Get the positive (digital) conductance matrix.",
+          pybind11::arg("copy") = false);
     m.def("gd_m", &get_gd_m_pb,
-          "Get the negative (digital) conductance matrix.");
+          "Get the negative (digital) conductance matrix.",
+          pybind11::arg("copy") = false);
     m.def("ia_p", &get_ia_p_pb,
-          "Get the positive (analog) conductance matrix.");
+          "Get the positive (analog) conductance matrix.",
+          pybind11::arg("copy") = false);
     m.def("ia_m", &get_ia_m_pb,
-          "Get the negative (analog) conductance matrix.");
+          "Get the negative (analog) conductance matrix.",
+          pybind11::arg("copy") = false);
     m.def("cycles_p", &get_cycles_p_pb,
-          "Get the number of reset-set cycles of the positive matrix.");
+          "Get the number of reset-set cycles of the positive matrix.",
+          pybind11::arg("copy") = false);
     m.def("cycles_m", &get_cycles_m_pb,
-          "Get the number of reset-set cycles of the negative matrix.");
+          "Get the number of reset-set cycles of the negative matrix.",
+          pybind11::arg("copy") = false);
     m.def(
         "consecutive_reads_p", &get_consecutive_reads_p_pb,
-        "Get the number of consecutive reads per cell of the positive matrix.");
+        "Get the number of consecutive reads per cell of the positive matrix.",
+        pybind11::arg("copy") = false);
     m.def(
         "consecutive_reads_m", &get_consecutive_reads_m_pb,
-        "Get the number of consecutive reads per cell of the negative matrix.");
+        "Get the number of consecutive reads per cell of the negative matrix.",
+        pybind11::arg("copy") = false);
     m.def("write_ops", &get_write_xbar_counter,
           "Get the number of write operations.");
     m.def("mvm_ops", &get_mvm_counter,
@@ -532,4 +1340,31 @@ PYBIND11_MODULE(acs_py, m) {
     m.def("rd_run_out_of_bounds", &get_rd_run_out_of_bounds,
           "Check if the read disturb model ran out of bounds.");
     m.def("dump_adc_profile", &dump_adc_profile, "Dump ADC profile JSON file.");
+    m.def("save_state", &save_state,
+          "Save the crossbar state to a snapshot file.",
+          pybind11::arg("path"));
+    m.def("load_state", &load_state,
+          "Restore the crossbar state from a snapshot file.",
+          pybind11::arg("path"));
+    m.def("begin_adc_calibration", &begin_adc_calibration,
+          "Start recording ADC input currents for calibration.");
+    m.def("end_adc_calibration", &end_adc_calibration,
+          "Derive and install the ADC ranges (percentile, mse or kl).",
+          pybind11::arg("policy") = "percentile",
+          pybind11::arg("percentile") = 99.99);
+    m.def("adc_calib_dict", &get_adc_calib_dict_pb,
+          "Get the ADC current range per layer (CALIB mode).");
+    m.def("set_profiling", &set_profiling,
+          "Enable the per-phase profiling timers (requires PROFILING=ON).",
+          pybind11::arg("enable"), pybind11::arg("trace") = false);
+    m.def("reset_profiling", &reset_profiling,
+          "Discard all profiling counters and trace events.");
+    m.def("get_profile", &get_profile,
+          "Get the per-phase and per-layer timers as JSON string.");
+    m.def("dump_profile", &dump_profile,
+          "Dump the per-phase and per-layer timers as JSON file.",
+          pybind11::arg("path"));
+    m.def("dump_profile_trace", &dump_profile_trace,
+          "Dump the trace events as Chrome trace JSON file.",
+          pybind11::arg("path"));
 }
@@ -51,24 +51,35 @@ void MapperBnnII::d_mvm(int32_t *res, const int32_t *vec, const int32_t *mat,
 
 void MapperBnnII::a_mvm(int32_t *res, const int32_t *vec, const int32_t *mat,
                         int32_t m_matrix, int32_t n_matrix,
-                        const char *l_name) {
+                        uint32_t layer_id) {
     std::fill(tmp_out_.begin(), tmp_out_.end(), 0.0);
 
-    for (size_t n = 0; n < n_matrix; ++n) {
-        vd_[n] = (vec[n] - 1) / (-2);
+    {
+        ACS_PROFILE_SCOPE(INPUT_ENCODING);
+        for (size_t n = 0; n < n_matrix; ++n) {
+            vd_[n] = (vec[n] - 1) / (-2);
+        }
     }
 
-    if (!CFG.parasitics) {
-        for (size_t m = 0; m < m_matrix; ++m) {
-            for (size_t n = 0; n < n_matrix; ++n) {
-                tmp_out_[m] += (ia_m_[m][n] - ia_p_[m][n]) * vd_[n];
+    if (!exact_diff_mvm(vd_, -1, m_matrix, n_matrix, 2 / i_mm_, layer_id, 0,
+                        tmp_out_)) {
+        if (!CFG.parasitics) {
+            ACS_PROFILE_SCOPE(ACCUMULATION);
+            for (size_t m = 0; m < m_matrix; ++m) {
+                const float *ia_p = ia_p_.row(m, n_matrix, ia_row_p_.data());
+                const float *ia_m = ia_m_.row(m, n_matrix, ia_row_m_.data());
+                for (size_t n = 0; n < n_matrix; ++n) {
+                    tmp_out_[m] += (ia_m[n] - ia_p[n]) * vd_[n];
+                }
             }
+            add_column_noise(gd_p_, vd_, m_matrix, n_matrix, tmp_out_);
+            add_column_noise(gd_m_, vd_, m_matrix, n_matrix, tmp_out_);
+        } else {
+            par_solver_->compute_currents(vd_, tmp_out_, m_matrix, n_matrix);
         }
-    } else {
-        par_solver_->compute_currents(vd_, tmp_out_, m_matrix, n_matrix);
-    }
 
-    adc_->convert(tmp_out_, tmp_out_, m_matrix, 2 / i_mm_, 0.0, l_name);
+        adc_->convert(tmp_out_, tmp_out_, m_matrix, 2 / i_mm_, 0.0, layer_id);
+    }
 
     for (size_t m = 0; m < m_matrix; ++m) {
         res[m] += tmp_out_[m] + sum_w_[m];
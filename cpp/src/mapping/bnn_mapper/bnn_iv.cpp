@@ -18,7 +18,7 @@ MapperBnnIV::MapperBnnIV() :
     tmp_out_(CFG.M, 0.0),
     tmp_out_p_(CFG.M, 0.0),
     tmp_out_m_(CFG.M, 0.0),
-    Mapper(false) {}
+    Mapper(false, false) {}
 
 MapperBnnIV::~MapperBnnIV() {}
 
@@ -68,33 +68,36 @@ void MapperBnnIV::d_mvm(int32_t *res, const int32_t *vec, const int32_t *mat,
 
 void MapperBnnIV::a_mvm(int32_t *res, const int32_t *vec, const int32_t *mat,
                         int32_t m_matrix, int32_t n_matrix,
-                        const char *l_name) {
+                        uint32_t layer_id) {
     std::fill(tmp_out_.begin(), tmp_out_.end(), 0.0);
     std::fill(tmp_out_p_.begin(), tmp_out_p_.end(), 0.0);
     std::fill(tmp_out_m_.begin(), tmp_out_m_.end(), 0.0);
     int32_t vec_sum = 0;
 
-    for (size_t n = 0; n < n_matrix; ++n) {
-        vec_sum += vec[n];
-        if (vec[n] == +1) {
-            vd_p_[n] = 1;
-            vd_m_[n] = 0;
-        } else if (vec[n] == -1) {
-            vd_m_[n] = 1;
-            vd_p_[n] = 0;
-        } else {
-            std::cerr << "BNN input is neither +1 nor -1.";
-            abort();
+    {
+        ACS_PROFILE_SCOPE(INPUT_ENCODING);
+        for (size_t n = 0; n < n_matrix; ++n) {
+            vec_sum += vec[n];
+            if (vec[n] == +1) {
+                vd_p_[n] = 1;
+                vd_m_[n] = 0;
+            } else if (vec[n] == -1) {
+                vd_m_[n] = 1;
+                vd_p_[n] = 0;
+            } else {
+                std::cerr << "BNN input is neither +1 nor -1.";
+                abort();
+            }
         }
     }
 
     if (!CFG.parasitics) {
-        for (size_t m = 0; m < m_matrix; ++m) {
-            for (size_t n = 0; n < n_matrix; ++n) {
-                tmp_out_p_[m] += (ia_p_[m][n] * vd_p_[n]);
-                tmp_out_m_[m] += (ia_p_[m][n] * vd_m_[n]);
-            }
-        }
+        column_currents(ia_p_, gd_p_bits_, vd_p_, m_matrix, n_matrix,
+                        tmp_out_p_);
+        add_column_noise(gd_p_, vd_p_, m_matrix, n_matrix, tmp_out_p_);
+        column_currents(ia_p_, gd_p_bits_, vd_m_, m_matrix, n_matrix,
+                        tmp_out_m_);
+        add_column_noise(gd_p_, vd_m_, m_matrix, n_matrix, tmp_out_m_);
     } else {
         // Compute separate output currents for vd_p and vd_m (assuming separate
         // cycles)
@@ -103,8 +106,8 @@ void MapperBnnIV::a_mvm(int32_t *res, const int32_t *vec, const int32_t *mat,
     }
 
     adc_->convert(tmp_out_p_, tmp_out_p_, m_matrix, 2 / i_mm_,
-                  -vec_sum * CFG.HRS, l_name);
-    adc_->convert(tmp_out_m_, tmp_out_m_, m_matrix, 2 / i_mm_, 0.0, l_name);
+                  -vec_sum * CFG.HRS, layer_id);
+    adc_->convert(tmp_out_m_, tmp_out_m_, m_matrix, 2 / i_mm_, 0.0, layer_id);
 
     for (size_t m = 0; m < m_matrix; ++m) {
         res[m] += tmp_out_m_[m] - tmp_out_p_[m] + vec_sum;
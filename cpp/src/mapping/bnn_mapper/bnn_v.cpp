@@ -58,35 +58,57 @@ void MapperBnnV::d_mvm(int32_t *res, const int32_t *vec, const int32_t *mat,
 }
 
 void MapperBnnV::a_mvm(int32_t *res, const int32_t *vec, const int32_t *mat,
-                       int32_t m_matrix, int32_t n_matrix, const char *l_name) {
+                       int32_t m_matrix, int32_t n_matrix, uint32_t layer_id) {
     std::fill(tmp_out_.begin(), tmp_out_.end(), 0.0);
 
-    for (size_t n = 0; n < n_matrix; ++n) {
-        if (vec[n] == +1) {
-            vd_p_[n] = 1;
-            vd_m_[n] = 0;
-        } else if (vec[n] == -1) {
-            vd_m_[n] = 1;
-            vd_p_[n] = 0;
-        } else {
-            std::cerr << "BNN input is neither +1 nor -1.";
-            abort();
+    {
+        ACS_PROFILE_SCOPE(INPUT_ENCODING);
+        for (size_t n = 0; n < n_matrix; ++n) {
+            if (vec[n] == +1) {
+                vd_p_[n] = 1;
+                vd_m_[n] = 0;
+            } else if (vec[n] == -1) {
+                vd_m_[n] = 1;
+                vd_p_[n] = 0;
+            } else {
+                std::cerr << "BNN input is neither +1 nor -1.";
+                abort();
+            }
         }
     }
 
-    if (!CFG.parasitics) {
-        for (size_t m = 0; m < m_matrix; ++m) {
-            for (size_t n = 0; n < n_matrix; ++n) {
-                tmp_out_[m] += ia_p_[m][n] * vd_p_[n] + ia_m_[m][n] * vd_m_[n];
-            }
+    if (use_exact_path(m_matrix, n_matrix)) {
+        // One cell per input, levels: number of inputs on LRS cells
+        {
+            ACS_PROFILE_SCOPE(ACCUMULATION);
+            pack_bits(vd_p_, n_matrix, vd_bits_);
+            pack_bits(vd_m_, n_matrix, vd_bits_m_);
+            std::fill(levels_.begin(), levels_.begin() + m_matrix, 0);
+            add_levels(gd_p_bits_, vd_bits_, 1, m_matrix, n_matrix);
+            add_levels(gd_m_bits_, vd_bits_m_, 1, m_matrix, n_matrix);
         }
+        convert_levels(tmp_out_, m_matrix, n_matrix * exact_hrs_, 0, CFG.N,
+                       2 / i_mm_, -n_matrix * CFG.HRS, layer_id, 0);
     } else {
-        par_solver_->compute_currents(vd_p_, vd_m_, tmp_out_, m_matrix,
-                                      n_matrix);
-    }
+        if (!CFG.parasitics) {
+            ACS_PROFILE_SCOPE(ACCUMULATION);
+            for (size_t m = 0; m < m_matrix; ++m) {
+                const float *ia_p = ia_p_.row(m, n_matrix, ia_row_p_.data());
+                const float *ia_m = ia_m_.row(m, n_matrix, ia_row_m_.data());
+                for (size_t n = 0; n < n_matrix; ++n) {
+                    tmp_out_[m] += ia_p[n] * vd_p_[n] + ia_m[n] * vd_m_[n];
+                }
+            }
+            add_column_noise(gd_p_, vd_p_, m_matrix, n_matrix, tmp_out_);
+            add_column_noise(gd_m_, vd_m_, m_matrix, n_matrix, tmp_out_);
+        } else {
+            par_solver_->compute_currents(vd_p_, vd_m_, tmp_out_, m_matrix,
+                                          n_matrix);
+        }
 
-    adc_->convert(tmp_out_, tmp_out_, m_matrix, 2 / i_mm_, -n_matrix * CFG.HRS,
-                  l_name);
+        adc_->convert(tmp_out_, tmp_out_, m_matrix, 2 / i_mm_,
+                      -n_matrix * CFG.HRS, layer_id);
+    }
 
     for (size_t m = 0; m < m_matrix; ++m) {
         res[m] += tmp_out_[m] - n_matrix;
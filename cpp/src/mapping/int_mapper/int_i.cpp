@@ -84,89 +84,42 @@ void MapperIntI::d_mvm(int32_t *res, const int32_t *vec, const int32_t *mat,
 }
 
 void MapperIntI::a_mvm(int32_t *res, const int32_t *vec, const int32_t *mat,
-                       int32_t m_matrix, int32_t n_matrix, const char *l_name) {
+                       int32_t m_matrix, int32_t n_matrix, uint32_t layer_id) {
     // The splitted matrix is of size CFG.SPLITsize*M x N (CFG.SPLITsize values
     // per original matrix value) Two matrices exist: ia+ (ia_p_) and ia-
     // (ia_m_).
-    const std::vector<uint32_t> &split = CFG.SPLIT;
-    const uint32_t tmp_size = m_matrix * split.size();
     std::fill(tmp_out_fp_.begin(), tmp_out_fp_.end(), 0);
 
-    for (size_t n = 0; n < n_matrix; ++n) {
-        if (vec[n] >= 0) {
-            vd_p_[n] = vec[n];
-            vd_m_[n] = 0;
-        } else {
-            vd_p_[n] = 0;
-            vd_m_[n] = -vec[n];
+    {
+        ACS_PROFILE_SCOPE(INPUT_ENCODING);
+        for (size_t n = 0; n < n_matrix; ++n) {
+            if (vec[n] >= 0) {
+                vd_p_[n] = vec[n];
+                vd_m_[n] = 0;
+            } else {
+                vd_p_[n] = 0;
+                vd_m_[n] = -vec[n];
+            }
         }
     }
 
     // For each bit in vd_p execute one MVM operation with ia_p_ and one with
     // ia_m_ For positive inputs vd_p: bit 7 is always 0 (sign bit) -> CFG.I_BIT
-    // - 1 Subract both results in the analog domain
-    for (size_t i_bit = 0; i_bit < CFG.I_BIT - 1; ++i_bit) {
-        // Slice input vector
-        slice_vd(vd_p_, vd_slice_, n_matrix, i_bit);
-        // Calculcate multiplications with negative and positive weights
-        if (!CFG.parasitics) {
-            for (size_t t_m = 0; t_m < tmp_size; ++t_m) {
-                for (size_t n = 0; n < n_matrix; ++n) {
-                    tmp_out_fp_[t_m] +=
-                        (ia_p_[t_m][n] - ia_m_[t_m][n]) * vd_slice_[n];
-                }
-            }
-        } else {
-            par_solver_->compute_currents(vd_slice_, tmp_out_fp_,
-                                          m_matrix * split.size(), n_matrix);
-        }
-
-        // Addition of the partial results caused by splitted weights
-        for (size_t m = 0; m < m_matrix; ++m) {
-            for (size_t s = 0; s < split.size(); ++s) {
-                res[m] += adc_->convert(
-                    tmp_out_fp_[m * split.size() + s],
-                    (std::pow(2, shift_[s]) * std::pow(2, i_bit)) /
-                        i_step_size_[s],
-                    0.0, l_name);
-            }
-        }
-
-        // Reset tmp_out vector
-        std::fill(tmp_out_fp_.begin(), tmp_out_fp_.end(), 0);
+    // - 1 Subract both results in the analog domain. The reads of vd_m are
+    // subtracted from the result.
+    planes_.clear();
+    for (uint32_t i_bit = 0; i_bit < CFG.I_BIT - 1; i_bit += CFG.dac_bits) {
+        planes_.push_back({&vd_p_, i_bit, CFG.I_BIT - 1, 1});
     }
-
-    // For each bit in vd_m execute one MVM operation with ia_p_ and one with
-    // ia_m_ Subract both results in the analog domain
-    for (size_t i_bit = 0; i_bit < CFG.I_BIT; ++i_bit) {
-        // Slice input vector
-        slice_vd(vd_m_, vd_slice_, n_matrix, i_bit);
-        // Calculcate multiplications with negative and positive weights
-        if (!CFG.parasitics) {
-            for (size_t t_m = 0; t_m < tmp_size; ++t_m) {
-                for (size_t n = 0; n < n_matrix; ++n) {
-                    tmp_out_fp_[t_m] +=
-                        (ia_p_[t_m][n] - ia_m_[t_m][n]) * vd_slice_[n];
-                }
-            }
-        } else {
-            par_solver_->compute_currents(vd_slice_, tmp_out_fp_, tmp_size,
-                                          n_matrix);
-        }
-
-        // Addition of the partial results caused by splitted weights
-        for (size_t m = 0; m < m_matrix; ++m) {
-            for (size_t s = 0; s < split.size(); ++s) {
-                res[m] += adc_->convert(
-                    tmp_out_fp_[m * split.size() + s],
-                    (std::pow(2, shift_[s]) * std::pow(2, i_bit)) /
-                        -i_step_size_[s],
-                    0.0, l_name);
-            }
-        }
-
-        // Reset tmp_out vector
-        std::fill(tmp_out_fp_.begin(), tmp_out_fp_.end(), 0);
+    for (uint32_t i_bit = 0; i_bit < CFG.I_BIT; i_bit += CFG.dac_bits) {
+        planes_.push_back({&vd_m_, i_bit, CFG.I_BIT, -1});
+    }
+    begin_planes(res, m_matrix, n_matrix);
+    for (size_t k = 0; (k < planes_.size()) && (rows_done() < m_matrix);
+         ++k) {
+        a_read_plane_diff(res, planes_[k], m_matrix, n_matrix, layer_id,
+                          vd_slice_, tmp_out_fp_);
+        end_plane(k, res, m_matrix);
     }
 }
 
@@ -12,19 +12,28 @@
 namespace nq {
 
 MapperIntV::MapperIntV() :
+    delta_(0.0),
     vd_p_(CFG.N, 0),
     tmp_out_int_(CFG.M * CFG.SPLIT.size(), 0),
     tmp_out_fp_(CFG.M * CFG.SPLIT.size(), 0.0),
     res_fp_(CFG.M * CFG.SPLIT.size(), 0.0),
     vd_slice_(CFG.N, 0),
-    Mapper(false) {
-    // Calculation of the delta factor
+    Mapper(false, false) {
+    if (!CFG.digital_only) {
+        update_delta();
+    }
+}
+
+void MapperIntV::update_analog_params() {
+    Mapper::update_analog_params();
+    update_delta();
+}
+
+// Calculation of the delta factor
+void MapperIntV::update_delta() {
     delta_ = 0.0;
     if (CFG.m_mode == MappingMode::I_UINT_W_OFFS) {
-        int curr_w_bit = CFG.W_BIT;
         for (size_t i = 0; i < CFG.SPLIT.size(); ++i) {
-            shift_[i] = curr_w_bit - CFG.SPLIT[i];
-            curr_w_bit -= CFG.SPLIT[i];
             delta_ += (1 << shift_[i]) * ((1 << CFG.SPLIT[i]) - 1);
         }
         delta_ = CFG.HRS / i_mm_ * delta_;
@@ -81,7 +90,7 @@ void MapperIntV::d_mvm(int32_t *res, const int32_t *vec, const int32_t *mat,
 }
 
 void MapperIntV::a_mvm(int32_t *res, const int32_t *vec, const int32_t *mat,
-                       int32_t m_matrix, int32_t n_matrix, const char *l_name) {
+                       int32_t m_matrix, int32_t n_matrix, uint32_t layer_id) {
     // The splitted matrix is of size CFG.SPLITsize*M x N (CFG.SPLITsize values
     // per original matrix value) Only one matrix exist: ia+ (ia_p_) The input
     // is already positive only
@@ -92,19 +101,36 @@ void MapperIntV::a_mvm(int32_t *res, const int32_t *vec, const int32_t *mat,
 
     // Construct input vector and calculate sum over all inputs
     int64_t inp_sum = 0;
-    for (size_t n = 0; n < n_matrix; ++n) {
-        vd_p_[n] = vec[n];
-        inp_sum += vec[n];
+    {
+        ACS_PROFILE_SCOPE(INPUT_ENCODING);
+        for (size_t n = 0; n < n_matrix; ++n) {
+            vd_p_[n] = vec[n];
+            inp_sum += vec[n];
+        }
     }
 
+    const float offset_weight = delta_ + (1 << (CFG.W_BIT - 1));
+
     // For each bit in vec execute one MVM operation with ia_p_
-    for (size_t i_bit = 0; i_bit < CFG.I_BIT; ++i_bit) {
-        // Slice input vector
-        slice_vd(vd_p_, vd_slice_, n_matrix, i_bit);
+    planes_.clear();
+    for (uint32_t i_bit = 0; i_bit < CFG.I_BIT; i_bit += CFG.dac_bits) {
+        planes_.push_back({&vd_p_, i_bit, CFG.I_BIT, 1});
+    }
+    begin_planes(res, m_matrix, n_matrix);
+    for (size_t k = 0; (k < planes_.size()) && (rows_done() < m_matrix);
+         ++k) {
+        const uint32_t i_bit = planes_[k].i_bit;
+        // Slice input vector (dac_bits per read)
+        slice_vd(vd_p_, vd_slice_, n_matrix, i_bit, CFG.I_BIT);
         if (!CFG.parasitics) {
+            ACS_PROFILE_SCOPE(ACCUMULATION);
             for (size_t t_m = 0; t_m < tmp_size; ++t_m) {
+                if (row_done(t_m / split.size())) {
+                    continue;
+                }
+                const float *ia_p = ia_p_.row(t_m, n_matrix, ia_row_p_.data());
                 for (size_t n = 0; n < n_matrix; ++n) {
-                    tmp_out_fp_[t_m] += ia_p_[t_m][n] * vd_slice_[n];
+                    tmp_out_fp_[t_m] += ia_p[n] * vd_slice_[n];
                 }
             }
         } else {
@@ -112,26 +138,53 @@ void MapperIntV::a_mvm(int32_t *res, const int32_t *vec, const int32_t *mat,
                                           n_matrix);
         }
 
-        // Addition of the partial results caused by splitted weights
-        for (size_t m = 0; m < m_matrix; ++m) {
-            for (size_t s = 0; s < split.size(); ++s) {
-                // No rounding is done here, so multiply instead of shift
-                // tmp_out / i_step_size_[s] is a floating-point value
-                res_fp_[m] += adc_->convert(
-                    tmp_out_fp_[m * split.size() + s],
-                    (std::pow(2, shift_[s]) * std::pow(2, i_bit)) /
-                        i_step_size_[s],
-                    0.0, l_name);
+        {
+            ACS_PROFILE_SCOPE(ADC);
+            observe_open_rows(tmp_out_fp_, m_matrix, layer_id);
+
+            // Addition of the partial results caused by splitted weights
+            for (size_t m = 0; m < m_matrix; ++m) {
+                if (row_done(m)) {
+                    continue;
+                }
+                for (size_t s = 0; s < split.size(); ++s) {
+                    // No rounding is done here, so multiply instead of shift
+                    // tmp_out / i_step_size_[s] is a floating-point value
+                    res_fp_[m] += adc_->convert(
+                        tmp_out_fp_[m * split.size() + s],
+                        (std::pow(2, shift_[s]) * std::pow(2, i_bit)) /
+                            i_step_size_[s],
+                        0.0, layer_id);
+                }
             }
         }
 
         // Reset tmp_out vector
         std::fill(tmp_out_fp_.begin(), tmp_out_fp_.end(), 0);
+
+        // With an output range, the offset term of the read inputs is
+        // subtracted per read, so res_fp_ holds the partial results
+        if (out_range_) {
+            int64_t slice_sum = 0;
+            for (size_t n = 0; n < n_matrix; ++n) {
+                slice_sum += vd_slice_[n];
+            }
+            const float read_offset =
+                std::ldexp(double(slice_sum), i_bit) * offset_weight;
+            for (size_t m = 0; m < m_matrix; ++m) {
+                if (!row_done(m)) {
+                    res_fp_[m] -= read_offset;
+                }
+            }
+            end_plane(k, res, m_matrix, res_fp_.data());
+        }
     }
 
     // Rescaling of the results and rounding
     for (size_t m = 0; m < m_matrix; ++m) {
-        res_fp_[m] -= inp_sum * (delta_ + (1 << (CFG.W_BIT - 1)));
+        if (!out_range_) {
+            res_fp_[m] -= inp_sum * offset_weight;
+        }
         res[m] += static_cast<int32_t>(round(res_fp_[m]));
     }
 }
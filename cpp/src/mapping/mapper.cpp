@@ -25,42 +25,52 @@
 #include "mapping/tnn_mapper/tnn_v.h"
 
 #include <algorithm>
+#include <cmath>
 #include <execution>
 #include <iostream>
+#include <limits>
+
+#include "oneapi/tbb/blocked_range.h"
+#include "oneapi/tbb/blocked_range2d.h"
+#include "oneapi/tbb/enumerable_thread_specific.h"
+#include "oneapi/tbb/parallel_for.h"
 
 namespace nq {
 
-Mapper::Mapper(bool is_diff_weight_mapping) :
+namespace {
+
+/** Storage format of the cell currents (the analog model is not used in
+ * digital mode) */
+ConductancePrecision ia_precision() {
+    return CFG.digital_only ? ConductancePrecision::FP32
+                            : CFG.conductance_precision;
+}
+
+// Sample classes of the random streams of a crossbar
+constexpr uint64_t d2d_samples = 0;
+constexpr uint64_t c2c_samples = 1;
+
+} // namespace
+
+Mapper::Mapper(bool is_diff_weight_mapping, bool has_m_array) :
     is_diff_weight_mapping_(is_diff_weight_mapping),
-    gd_p_(CFG.M * CFG.SPLIT.size(), std::vector<int32_t>(CFG.N, 0)),
-    gd_m_(CFG.M * CFG.SPLIT.size(), std::vector<int32_t>(CFG.N, 0)),
+    has_m_array_(has_m_array),
+    gd_p_(CFG.M * CFG.SPLIT.size(), CFG.N, 0),
     shift_(CFG.SPLIT.size(), 0),
     sum_w_(CFG.M, 0),
-    ia_p_(CFG.M * CFG.SPLIT.size(), std::vector<float>(CFG.N, CFG.HRS)),
-    ia_m_(CFG.M * CFG.SPLIT.size(), std::vector<float>(CFG.N, CFG.HRS)),
-    ia_p_orig_(CFG.M * CFG.SPLIT.size(), std::vector<float>(CFG.N, CFG.HRS)),
-    ia_m_orig_(CFG.M * CFG.SPLIT.size(), std::vector<float>(CFG.N, CFG.HRS)),
     i_step_size_(CFG.SPLIT.size(), 0.0),
-    adc_(ADCFactory::createADC(CFG.adc_type)) {
-
-    if (!CFG.digital_only) {
-        i_mm_ = CFG.LRS - CFG.HRS;
-        std::random_device hrs_rd;
-        std::random_device lrs_rd;
-        std::mt19937 hrs_gen(hrs_rd());
-        std::mt19937 lrs_gen(lrs_rd());
-        if (CFG.HRS_NOISE > 0.0f) {
-            hrs_var_ = std::normal_distribution<float>(0.0f, CFG.HRS_NOISE);
-        }
-        if (CFG.LRS_NOISE > 0.0f) {
-            lrs_var_ = std::normal_distribution<float>(0.0f, CFG.LRS_NOISE);
-        }
-
-        if (CFG.parasitics) {
-            par_solver_ =
-                std::make_shared<ParasiticSolver>(CFG.w_res, CFG.V_read);
-        }
-    }
+    adc_(ADCFactory::createADC(CFG.adc_type)),
+    exact_hrs_(0.0),
+    exact_lrs_(0.0),
+    exact_path_(false),
+    exact_m_(0),
+    exact_n_(0),
+    bit_words_((CFG.N + 63) / 64),
+    rd_refresh_rng_(CFG.rng_seed),
+    rd_refresh_epoch_(0),
+    rng_stream_(0),
+    d2d_draw_(0),
+    c2c_reads_(0) {
 
     if (CFG.is_int_mapping(CFG.m_mode) || (CFG.m_mode == MappingMode::TNN_IV)) {
         int curr_w_bit = CFG.W_BIT;
@@ -69,11 +79,59 @@ Mapper::Mapper(bool is_diff_weight_mapping) :
             curr_w_bit -= CFG.SPLIT[i];
         }
         num_segments_ = CFG.SPLIT.size();
+    }
 
+    if (has_m_array_) {
+        gd_m_.assign(CFG.M * CFG.SPLIT.size(), CFG.N, 0);
+    }
+    if (!CFG.digital_only) {
+        ia_p_.assign(CFG.M * CFG.SPLIT.size(), CFG.N, CFG.HRS,
+                     ia_precision());
+        ia_row_p_.assign(CFG.N, 0.0);
+        if (has_m_array_) {
+            ia_m_.assign(CFG.M * CFG.SPLIT.size(), CFG.N, CFG.HRS,
+                         ia_precision());
+            ia_row_m_.assign(CFG.N, 0.0);
+        }
+        Mapper::update_analog_params();
+        reset_par_solver();
+    }
+}
+
+void Mapper::update_analog_params() {
+    i_mm_ = CFG.LRS - CFG.HRS;
+    rd_refresh_rng_ = CounterRNG(CFG.rng_seed);
+
+    if (CFG.is_int_mapping(CFG.m_mode) || (CFG.m_mode == MappingMode::TNN_IV)) {
         for (size_t s = 0; s < num_segments_; ++s) {
             i_step_size_[s] = i_mm_ / ((1 << CFG.SPLIT[s]) - 1);
         }
     }
+
+    // Nominal current of each conductance level (as written by a_write)
+    rd_level_current_.clear();
+    if (CFG.read_disturb) {
+        if (CFG.is_int_mapping(CFG.m_mode)) {
+            for (size_t s = 0; s < num_segments_; ++s) {
+                rd_level_current_.emplace_back(1 << CFG.SPLIT[s]);
+                for (int32_t l = 0; l < (1 << CFG.SPLIT[s]); ++l) {
+                    rd_level_current_[s][l] = l * i_step_size_[s] + CFG.HRS;
+                }
+            }
+        } else {
+            rd_level_current_.push_back({CFG.HRS, CFG.LRS});
+        }
+    }
+}
+
+void Mapper::reset_adc() { adc_ = ADCFactory::createADC(CFG.adc_type); }
+
+void Mapper::reset_par_solver() {
+    if (CFG.parasitics) {
+        par_solver_ = std::make_shared<ParasiticSolver>(CFG.w_res, CFG.V_read);
+    } else {
+        par_solver_ = nullptr;
+    }
 }
 
 std::unique_ptr<Mapper> Mapper::create_from_config() {
@@ -121,6 +179,7 @@ std::unique_ptr<Mapper> Mapper::create_from_config() {
 void Mapper::d_write_diff(const int32_t *mat, int32_t m_matrix,
                           int32_t n_matrix) {
     const std::vector<uint32_t> &split = CFG.SPLIT;
+    w_bounds_m_ = -1;
     for (size_t m = 0; m < m_matrix; ++m) {
         int32_t sum_n = 0;
         for (size_t n = 0; n < n_matrix; ++n) {
@@ -141,6 +200,7 @@ void Mapper::d_write_diff(const int32_t *mat, int32_t m_matrix,
         }
         sum_w_[m] = sum_n;
     }
+    d_pack(m_matrix, n_matrix);
 }
 
 void Mapper::d_write_diff_bnn(const int32_t *mat, int32_t m_matrix,
@@ -193,6 +253,7 @@ void Mapper::d_write_diff_tnn(const int32_t *mat, int32_t m_matrix,
 void Mapper::d_write_offs(const int32_t *mat, int32_t m_matrix,
                           int32_t n_matrix) {
     const std::vector<uint32_t> &split = CFG.SPLIT;
+    w_bounds_m_ = -1;
     for (size_t m = 0; m < m_matrix; ++m) {
         for (size_t n = 0; n < n_matrix; ++n) {
             int mat_val = mat[n_matrix * m + n] + (1 << (CFG.W_BIT - 1));
@@ -203,6 +264,7 @@ void Mapper::d_write_offs(const int32_t *mat, int32_t m_matrix,
             }
         }
     }
+    d_pack(m_matrix, n_matrix);
 }
 
 void Mapper::d_write_tc_tnn(const int32_t *mat, int32_t m_matrix,
@@ -234,13 +296,91 @@ void Mapper::d_write_tc_tnn(const int32_t *mat, int32_t m_matrix,
     }
 }
 
+// Packed digital GEMV for INT mappings.
+// The effective weight of a matrix value is the shift-add of its slices (minus
+// the offset of I_UINT_W_OFFS). d_mvm_packed multiplies it with the effective
+// input of the mapping. All sums wrap around like the int32 sums of the
+// slice-based d_mvm, so both give the same results.
+void Mapper::d_pack(int32_t m_matrix, int32_t n_matrix) {
+    d_gemv_.clear();
+    if (!CFG.digital_only) {
+        return;
+    }
+    const size_t num_split = CFG.SPLIT.size();
+    const int64_t offset = (CFG.m_mode == MappingMode::I_UINT_W_OFFS)
+                               ? (int64_t(1) << (CFG.W_BIT - 1))
+                               : 0;
+    std::vector<int64_t> weights(size_t(m_matrix) * n_matrix);
+    for (size_t m = 0; m < m_matrix; ++m) {
+        for (size_t n = 0; n < n_matrix; ++n) {
+            int64_t weight = -offset;
+            for (size_t s = 0; s < num_split; ++s) {
+                const size_t gd_idx = m * num_split + s;
+                const int64_t level_m = has_m_array_ ? gd_m_[gd_idx][n] : 0;
+                weight += (gd_p_[gd_idx][n] - level_m) *
+                          (int64_t(1) << shift_[s]);
+            }
+            weights[m * n_matrix + n] = weight;
+        }
+    }
+    d_gemv_.pack(weights.data(), m_matrix, n_matrix);
+    d_vec_.resize(CFG.N);
+}
+
+bool Mapper::d_mvm_packed(int32_t *res, const int32_t *vec,
+                          const int32_t *mat, int32_t m_matrix,
+                          int32_t n_matrix) {
+    if (!CFG.packed_gemv || d_gemv_.empty()) {
+        return false;
+    }
+
+    // Effective inputs (see d_mvm of the mappers)
+    const uint32_t msb = uint32_t(1) << (CFG.I_BIT - 1);
+    for (size_t n = 0; n < n_matrix; ++n) {
+        switch (CFG.m_mode) {
+        case MappingMode::I_OFFS_W_DIFF:
+            d_vec_[n] = static_cast<int32_t>(msb + uint32_t(vec[n]));
+            break;
+        case MappingMode::I_TC_W_DIFF:
+            d_vec_[n] = static_cast<int32_t>((uint32_t(vec[n]) & (msb - 1)) -
+                                             (uint32_t(vec[n]) & msb));
+            break;
+        default:
+            d_vec_[n] = vec[n];
+            break;
+        }
+    }
+
+    if (CFG.packed_gemv_check) {
+        d_check_.assign(res, res + m_matrix);
+    }
+    if (!d_gemv_.gemv(res, d_vec_.data(), m_matrix, n_matrix)) {
+        return false;
+    }
+    if (CFG.m_mode == MappingMode::I_OFFS_W_DIFF) {
+        for (size_t m = 0; m < m_matrix; ++m) {
+            res[m] -= (sum_w_[m] << (CFG.I_BIT - 1));
+        }
+    }
+
+    if (CFG.packed_gemv_check) {
+        d_mvm(d_check_.data(), vec, mat, m_matrix, n_matrix);
+        if (!std::equal(d_check_.begin(), d_check_.end(), res)) {
+            std::cerr << "Packed GEMV differs from the slice-based MVM."
+                      << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+    }
+    return true;
+}
+
 void Mapper::a_write_p_m(int32_t m_matrix, int32_t n_matrix) {
     float hrs = CFG.HRS;
     for (size_t m = 0; m < m_matrix * num_segments_; ++m) {
         float step = i_step_size_[m % num_segments_];
         for (size_t n = 0; n < n_matrix; ++n) {
-            ia_p_[m][n] = gd_p_[m][n] * step + hrs;
-            ia_m_[m][n] = gd_m_[m][n] * step + hrs;
+            ia_p_.set(m, n, gd_p_[m][n] * step + hrs);
+            ia_m_.set(m, n, gd_m_[m][n] * step + hrs);
         }
     }
 }
@@ -248,17 +388,29 @@ void Mapper::a_write_p_m(int32_t m_matrix, int32_t n_matrix) {
 void Mapper::a_write_p_m_bnn_tnn(int32_t m_matrix, int32_t n_matrix) {
     float hrs = CFG.HRS;
     float step = CFG.LRS - hrs;
+    const bool orig = keep_orig();
+    const CounterRNG rng(CFG.rng_seed);
+    const uint64_t key =
+        rng.bits(rng.bits(rng_stream_, d2d_samples), d2d_draw_);
     for (size_t m = 0; m < m_matrix; ++m) {
         for (size_t n = 0; n < n_matrix; ++n) {
-            ia_p_[m][n] =
-                add_gaussian_noise(gd_p_[m][n] * step + hrs, gd_p_[m][n]);
-            ia_p_orig_[m][n] = ia_p_[m][n];
+            const uint64_t cell = m * CFG.N + n;
+            const float ia_p =
+                add_gaussian_noise(gd_p_[m][n] * step + hrs, gd_p_[m][n],
+                                   d2d_sample(rng, key + cell, 0));
+            ia_p_.set(m, n, ia_p);
 
-            ia_m_[m][n] =
-                add_gaussian_noise(gd_m_[m][n] * step + hrs, gd_m_[m][n]);
-            ia_m_orig_[m][n] = ia_m_[m][n];
+            const float ia_m =
+                add_gaussian_noise(gd_m_[m][n] * step + hrs, gd_m_[m][n],
+                                   d2d_sample(rng, key + cell, 1));
+            ia_m_.set(m, n, ia_m);
+            if (orig) {
+                ia_p_orig_.set(m, n, ia_p);
+                ia_m_orig_.set(m, n, ia_m);
+            }
         }
     }
+    update_exact_path(m_matrix, n_matrix, true);
 }
 
 void Mapper::a_write_p(int32_t m_matrix, int32_t n_matrix) {
@@ -266,7 +418,7 @@ void Mapper::a_write_p(int32_t m_matrix, int32_t n_matrix) {
     for (size_t m = 0; m < m_matrix * num_segments_; ++m) {
         float step = i_step_size_[m % num_segments_];
         for (size_t n = 0; n < n_matrix; ++n) {
-            ia_p_[m][n] = gd_p_[m][n] * step + hrs;
+            ia_p_.set(m, n, gd_p_[m][n] * step + hrs);
         }
     }
 }
@@ -274,128 +426,133 @@ void Mapper::a_write_p(int32_t m_matrix, int32_t n_matrix) {
 void Mapper::a_write_p_bnn(int32_t m_matrix, int32_t n_matrix) {
     float hrs = CFG.HRS;
     float step = CFG.LRS - hrs;
+    const bool orig = keep_orig();
+    const CounterRNG rng(CFG.rng_seed);
+    const uint64_t key =
+        rng.bits(rng.bits(rng_stream_, d2d_samples), d2d_draw_);
     for (size_t m = 0; m < m_matrix; ++m) {
         for (size_t n = 0; n < n_matrix; ++n) {
-            ia_p_[m][n] =
-                add_gaussian_noise(gd_p_[m][n] * step + hrs, gd_p_[m][n]);
-            ia_p_orig_[m][n] = ia_p_[m][n];
+            const uint64_t cell = m * CFG.N + n;
+            const float ia_p =
+                add_gaussian_noise(gd_p_[m][n] * step + hrs, gd_p_[m][n],
+                                   d2d_sample(rng, key + cell, 0));
+            ia_p_.set(m, n, ia_p);
+            if (orig) {
+                ia_p_orig_.set(m, n, ia_p);
+            }
         }
     }
+    update_exact_path(m_matrix, n_matrix, false);
 }
 
 // Add Gaussian noise to a given state (current in uA).
-// Gaussian noise has mean of 0 and standard deviation of stddev
+// normal is a standard normal sample, scaled by the standard deviation of the
+// state (HRS_NOISE or LRS_NOISE).
 // Current cannot be negative.
 // For BNN and TNN only
-float Mapper::add_gaussian_noise(float state, int32_t mask) {
-    static std::random_device rd;
-    static std::mt19937 gen(rd());
+float Mapper::add_gaussian_noise(float state, int32_t mask, float normal) {
     if (mask == 0) {
         if (CFG.HRS_NOISE <= 0.0f) {
             return state;
         }
-        return std::max(state + hrs_var_(gen), 0.0f);
+        return std::max(state + CFG.HRS_NOISE * normal, 0.0f);
     } else if (mask == 1) {
         if (CFG.LRS_NOISE <= 0.0f) {
             return state;
         }
-        return std::max(state + lrs_var_(gen), 0.0f);
+        return std::max(state + CFG.LRS_NOISE * normal, 0.0f);
     } else {
         std::cerr << "Unexpected crossbar value: " << mask << std::endl;
         std::exit(EXIT_FAILURE);
     }
 }
 
-const std::vector<std::vector<int32_t>> &Mapper::get_gd_p() const {
+// Device-to-device sample of a cell (key) of ia_p_ (array 0) or ia_m_
+// (array 1). It only depends on rng_seed, the stream, and the draw, so a_write
+// re-applies the same device variability until the next draw.
+float Mapper::d2d_sample(const CounterRNG &rng, uint64_t key,
+                         uint64_t array) const {
+    return CFG.d2d_var ? rng.normal(key, array) : 0.0f;
+}
+
+const Matrix<uint8_t> &Mapper::get_gd_p() const {
     return gd_p_;
 }
 
-const std::vector<std::vector<int32_t>> &Mapper::get_gd_m() const {
+const Matrix<uint8_t> &Mapper::get_gd_m() const {
     return gd_m_;
 }
 
-const std::vector<std::vector<float>> &Mapper::get_ia_p() const {
-    return ia_p_;
+const Matrix<float> &Mapper::get_ia_p() const {
+    return ia_p_.to_float();
 }
 
-const std::vector<std::vector<float>> &Mapper::get_ia_m() const {
-    return ia_m_;
+const Matrix<float> &Mapper::get_ia_m() const {
+    return ia_m_.to_float();
 }
 
 void Mapper::rd_update_conductance(std::shared_ptr<const ReadDisturb> rd_model,
                                    const uint64_t read_num) {
-    // Update ia_p_
-    const std::vector<std::vector<uint64_t>> &cycles_p =
-        rd_model->get_cycles_p();
-
-    for (size_t i = 0; i < cycles_p.size(); i++) {
-        for (size_t j = 0; j < cycles_p[i].size(); j++) {
-            if (gd_p_[i][j] == 1) {
-                // Update the conductance value of LRS only
-                float LRS_scaling_factor =
-                    rd_model->calc_G0_scaling_factor(read_num, cycles_p[i][j]);
-                ia_p_[i][j] = CFG.LRS * LRS_scaling_factor;
-            }
-        }
-    }
+    ACS_PROFILE_SCOPE(READ_DISTURB);
+    rd_update_array(ia_p_, gd_p_, rd_model->get_cycles_p(), nullptr, read_num,
+                    *rd_model);
 
     if (!is_diff_weight_mapping_) {
         // No need to update ia_m_ for non-diff weight mapping
         return;
     }
-
-    // Update ia_m_ as well
-    const std::vector<std::vector<uint64_t>> &cycles_m =
-        rd_model->get_cycles_m();
-    for (size_t i = 0; i < cycles_m.size(); i++) {
-        for (size_t j = 0; j < cycles_m[i].size(); j++) {
-            if (gd_m_[i][j] == 1) {
-                // Update the conductance value of LRS only
-                float LRS_scaling_factor =
-                    rd_model->calc_G0_scaling_factor(read_num, cycles_m[i][j]);
-                ia_m_[i][j] = CFG.LRS * LRS_scaling_factor;
-            }
-        }
-    }
+    rd_update_array(ia_m_, gd_m_, rd_model->get_cycles_m(), nullptr, read_num,
+                    *rd_model);
 }
 
 void Mapper::rd_update_conductance(
     std::shared_ptr<const ReadDisturb> rd_model,
-    const std::vector<std::vector<uint64_t>> &consecutive_reads_p,
-    const std::vector<std::vector<uint64_t>> &consecutive_reads_m) {
-    // Update ia_p_
-    const std::vector<std::vector<uint64_t>> &cycles_p =
-        rd_model->get_cycles_p();
-
-    for (size_t i = 0; i < cycles_p.size(); i++) {
-        for (size_t j = 0; j < cycles_p[i].size(); j++) {
-            if (gd_p_[i][j] == 1) {
-                // Update the conductance value of LRS only
-                float LRS_scaling_factor = rd_model->calc_G0_scaling_factor(
-                    consecutive_reads_p[i][j], cycles_p[i][j]);
-                ia_p_[i][j] = CFG.LRS * LRS_scaling_factor;
-            }
-        }
-    }
+    const Matrix<uint64_t> &consecutive_reads_p,
+    const Matrix<uint64_t> &consecutive_reads_m) {
+    ACS_PROFILE_SCOPE(READ_DISTURB);
+    rd_update_array(ia_p_, gd_p_, rd_model->get_cycles_p(),
+                    &consecutive_reads_p, 0, *rd_model);
 
     if (!is_diff_weight_mapping_) {
         // No need to update ia_m_ for non-diff weight mapping
         return;
     }
+    rd_update_array(ia_m_, gd_m_, rd_model->get_cycles_m(),
+                    &consecutive_reads_m, 0, *rd_model);
+}
 
-    // Update ia_m_ as well
-    const std::vector<std::vector<uint64_t>> &cycles_m =
-        rd_model->get_cycles_m();
-    for (size_t i = 0; i < cycles_m.size(); i++) {
-        for (size_t j = 0; j < cycles_m[i].size(); j++) {
-            if (gd_m_[i][j] == 1) {
-                // Update the conductance value of LRS only
-                float LRS_scaling_factor = rd_model->calc_G0_scaling_factor(
-                    consecutive_reads_m[i][j], cycles_m[i][j]);
-                ia_m_[i][j] = CFG.LRS * LRS_scaling_factor;
+// Update the conductance of all programmed cells (level > 0), HRS cells are
+// not affected. The number of reads is either given per cell (reads) or
+// the same for all cells (read_num).
+void Mapper::rd_update_array(ConductanceMatrix &ia, const Matrix<uint8_t> &gd,
+                             const Matrix<uint64_t> &cycles,
+                             const Matrix<uint64_t> *reads,
+                             const uint64_t read_num,
+                             const ReadDisturb &rd_model) {
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>(0, cycles.rows()),
+        [&](const tbb::blocked_range<size_t> &rows) {
+            for (size_t i = rows.begin(); i < rows.end(); ++i) {
+                for (size_t j = 0; j < cycles.cols(); ++j) {
+                    int32_t level = gd[i][j];
+                    if (level == 0) {
+                        continue;
+                    }
+                    float scaling_factor = rd_model.calc_G0_scaling_factor(
+                        reads ? (*reads)[i][j] : read_num, cycles[i][j],
+                        level);
+                    ia.set(i, j, rd_level_current(i, level) * scaling_factor);
+                }
             }
-        }
+        });
+}
+
+// Nominal current of a cell in crossbar row 'row' on conductance level 'level'
+float Mapper::rd_level_current(size_t row, int32_t level) const {
+    if (rd_level_current_.size() == 1) {
+        return rd_level_current_[0][level];
     }
+    return rd_level_current_[row % rd_level_current_.size()][level];
 }
 
 // SOFTWARE refresh strategy for read disturb mitigation
@@ -404,6 +561,7 @@ void Mapper::rd_update_conductance(
 bool Mapper::rd_check_software_refresh(
     std::shared_ptr<const ReadDisturb> rd_model, const uint64_t read_num,
     const uint64_t write_num) {
+    ACS_PROFILE_SCOPE(REFRESH);
     float tt = rd_model->calc_transition_time(write_num);
     float t_stress = read_num * CFG.t_read;
     if (t_stress >= CFG.read_disturb_mitigation_fp * tt) {
@@ -413,83 +571,672 @@ bool Mapper::rd_check_software_refresh(
 }
 
 // CELL_BASED refresh strategy for read disturb mitigation
+// The conductance matrices are scanned in parallel tiles. Each thread collects
+// the refreshed cells in its own candidate list. The state of a refreshed cell
+// is drawn from a counter-based RNG keyed by (cell, epoch). Hence, the result
+// is the same for any number of threads.
 int Mapper::rd_cell_based_refresh(std::shared_ptr<ReadDisturb> rd_model) {
-    // Count refresh operations
-    int refresh_count = 0;
-
-    float tolerance = CFG.read_disturb_update_tolerance;
-    float lrs = CFG.LRS;
-
-    for (size_t m = 0; m < ia_p_.size(); ++m) {
-        for (size_t n = 0; n < ia_p_[m].size(); ++n) {
-            if (gd_p_[m][n] == 1) {
-                // Cell [m][n] is LRS cell -> Check conductance
-                if ((ia_p_[m][n] < (1 - tolerance) * lrs) ||
-                    (ia_p_[m][n] > (1 + tolerance) * lrs)) {
-                    // Refresh needed
-                    ia_p_[m][n] = add_gaussian_noise(lrs, 1);
-                    // Update cycle count
-                    rd_model->update_cycle_p(m, n, 1);
-                    // Reset consecutive reads
-                    rd_model->reset_consecutive_reads_p(m, n);
-                    // Increment refresh count
-                    refresh_count++;
-                }
-            }
-        }
+    ACS_PROFILE_SCOPE(REFRESH);
+    const uint64_t epoch = rd_refresh_epoch_++;
+    const size_t cols = CFG.N;
+    std::vector<uint64_t> candidates;
+
+    rd_refresh_scan(ia_p_, gd_p_, 0, epoch, candidates);
+    for (uint64_t cell : candidates) {
+        // Update cycle count and reset consecutive reads
+        rd_model->update_cycle_p(cell / cols, cell % cols, 1);
+        rd_model->reset_consecutive_reads_p(cell / cols, cell % cols);
     }
+    // Count refresh operations
+    int refresh_count = candidates.size();
 
     if (!is_diff_weight_mapping_) {
         // No need to check ia_m_ for non-diff weight mapping
         return refresh_count;
     }
 
-    for (size_t m = 0; m < ia_m_.size(); ++m) {
-        for (size_t n = 0; n < ia_m_[m].size(); ++n) {
-            if (gd_m_[m][n] == 1) {
-                // Cell [m][n] is LRS cell -> Check conductance
-                if ((ia_m_[m][n] < (1 - tolerance) * lrs) ||
-                    (ia_m_[m][n] > (1 + tolerance) * lrs)) {
-                    // Refresh needed
-                    ia_m_[m][n] = add_gaussian_noise(lrs, 1);
-                    // Update cycle count
-                    rd_model->update_cycle_m(m, n, 1);
-                    // Reset consecutive reads
-                    rd_model->reset_consecutive_reads_m(m, n);
-                    // Increment refresh count
-                    refresh_count++;
+    candidates.clear();
+    rd_refresh_scan(ia_m_, gd_m_, ia_p_.rows() * cols, epoch, candidates);
+    for (uint64_t cell : candidates) {
+        rd_model->update_cycle_m(cell / cols, cell % cols, 1);
+        rd_model->reset_consecutive_reads_m(cell / cols, cell % cols);
+    }
+    refresh_count += candidates.size();
+    return refresh_count;
+}
+
+// Refresh all programmed cells of ia whose conductance is out of tolerance.
+// The flat indices of the refreshed cells are appended to candidates.
+void Mapper::rd_refresh_scan(ConductanceMatrix &ia, const Matrix<uint8_t> &gd,
+                             uint64_t key_offset, uint64_t epoch,
+                             std::vector<uint64_t> &candidates) {
+    const float tolerance = CFG.read_disturb_update_tolerance;
+    // State variability is only modeled for BNN/TNN mappings
+    const float lrs_noise =
+        CFG.is_int_mapping(CFG.m_mode) ? 0.0f : CFG.LRS_NOISE;
+    const size_t cols = CFG.N;
+
+    tbb::enumerable_thread_specific<std::vector<uint64_t>> local_candidates;
+    tbb::parallel_for(
+        tbb::blocked_range2d<size_t>(0, ia.rows(), 16, 0, cols, 256),
+        [&](const tbb::blocked_range2d<size_t> &tile) {
+            std::vector<uint64_t> &local = local_candidates.local();
+            for (size_t m = tile.rows().begin(); m < tile.rows().end(); ++m) {
+                for (size_t n = tile.cols().begin(); n < tile.cols().end();
+                     ++n) {
+                    // Only programmed cells are affected by read disturb
+                    if (gd[m][n] == 0) {
+                        continue;
+                    }
+                    float nominal = rd_level_current(m, gd[m][n]);
+                    const float current = ia.get(m, n);
+                    if ((current >= (1 - tolerance) * nominal) &&
+                        (current <= (1 + tolerance) * nominal)) {
+                        continue;
+                    }
+                    uint64_t cell = m * cols + n;
+                    float noise = 0.0f;
+                    if (lrs_noise > 0.0f) {
+                        noise = lrs_noise * rd_refresh_rng_.normal(
+                                                key_offset + cell, epoch);
+                    }
+                    ia.set(m, n, std::max(nominal + noise, 0.0f));
+                    local.push_back(cell);
                 }
             }
-        }
+        });
+
+    for (const std::vector<uint64_t> &local : local_candidates) {
+        candidates.insert(candidates.end(), local.begin(), local.end());
     }
-    return refresh_count;
 }
 
 bool Mapper::is_diff_weight_mapping() const { return is_diff_weight_mapping_; }
 
-void Mapper::slice_vd(std::vector<int32_t> &vd, std::vector<int32_t> &vd_slice,
-                      size_t n, size_t i_bit) {
+void Mapper::slice_vd(const std::vector<int32_t> &vd,
+                      std::vector<int32_t> &vd_slice, size_t n, size_t i_bit,
+                      size_t end_bit) {
+    ACS_PROFILE_SCOPE(BIT_SLICING);
+    const size_t bits = std::min<size_t>(CFG.dac_bits, end_bit - i_bit);
+    const int32_t mask = (1 << bits) - 1;
     std::transform(std::execution::par, vd.begin(), vd.begin() + n,
                    vd_slice.begin(),
-                   [i_bit](int32_t v) { return (v >> i_bit) & 1; });
+                   [i_bit, mask](int32_t v) { return (v >> i_bit) & mask; });
+}
+
+void Mapper::begin_planes(const int32_t *res, int32_t m_matrix,
+                          int32_t n_matrix) {
+    if (out_range_ == nullptr) {
+        return;
+    }
+    // MSB first, the reads of the same bit keep their order
+    std::stable_sort(planes_.begin(), planes_.end(),
+                     [](const InputPlane &a, const InputPlane &b) {
+                         return a.i_bit > b.i_bit;
+                     });
+    update_weight_bounds(m_matrix, n_matrix);
+
+    // A read adds sign * 2^i_bit * (w * chunk), the chunk values are at
+    // most the largest chunk of the input vector
+    const size_t num_planes = planes_.size();
+    rem_p_.assign(num_planes + 1, 0.0);
+    rem_m_.assign(num_planes + 1, 0.0);
+    for (size_t k = num_planes; k-- > 0;) {
+        const InputPlane &plane = planes_[k];
+        const uint32_t bits =
+            std::min<uint32_t>(CFG.dac_bits, plane.end_bit - plane.i_bit);
+        const int32_t mask = (1 << bits) - 1;
+        int32_t level = 0;
+        for (size_t n = 0; n < n_matrix; ++n) {
+            level = std::max(level, ((*plane.vd)[n] >> plane.i_bit) & mask);
+        }
+        const double weight = std::ldexp(double(level), plane.i_bit);
+        rem_p_[k] = rem_p_[k + 1] + ((plane.sign > 0) ? weight : 0.0);
+        rem_m_[k] = rem_m_[k + 1] + ((plane.sign < 0) ? weight : 0.0);
+    }
+    row_done_.assign(m_matrix, 0);
+    rows_done_ = 0;
+    decide_rows(0, res, m_matrix, nullptr);
+}
+
+void Mapper::end_plane(size_t k, const int32_t *res, int32_t m_matrix,
+                       const float *res_fp) {
+    if (out_range_ == nullptr) {
+        return;
+    }
+    decide_rows(k + 1, res, m_matrix, res_fp);
+}
+
+void Mapper::decide_rows(size_t next, const int32_t *res, int32_t m_matrix,
+                         const float *res_fp) {
+    const double rem_p = rem_p_[next];
+    const double rem_m = rem_m_[next];
+    for (size_t m = 0; m < m_matrix; ++m) {
+        if (row_done_[m]) {
+            continue;
+        }
+        double partial = res[m];
+        if (res_fp != nullptr) {
+            partial += res_fp[m];
+        }
+        // Range of the remaining reads (w_neg_sum_ <= 0 <= w_pos_sum_)
+        const double low = partial + rem_p * w_neg_sum_[m] -
+                           rem_m * w_pos_sum_[m];
+        const double high = partial + rem_p * w_pos_sum_[m] -
+                            rem_m * w_neg_sum_[m];
+        if ((high <= out_range_->min) || (low >= out_range_->max)) {
+            row_done_[m] = 1;
+            ++rows_done_;
+        }
+    }
+}
+
+void Mapper::update_weight_bounds(int32_t m_matrix, int32_t n_matrix) {
+    if ((w_bounds_m_ == m_matrix) && (w_bounds_n_ == n_matrix)) {
+        return;
+    }
+    // Weights of the differential (gd_p_ - gd_m_) and offset (gd_p_ minus
+    // 2^(W_BIT - 1)) INT mappings
+    const size_t num_segments = CFG.SPLIT.size();
+    const int32_t offset = has_m_array_ ? 0 : (1 << (CFG.W_BIT - 1));
+    w_pos_sum_.assign(m_matrix, 0);
+    w_neg_sum_.assign(m_matrix, 0);
+    for (size_t m = 0; m < m_matrix; ++m) {
+        for (size_t n = 0; n < n_matrix; ++n) {
+            int32_t w = -offset;
+            for (size_t s = 0; s < num_segments; ++s) {
+                const size_t gd_idx = m * num_segments + s;
+                int32_t level = gd_p_[gd_idx][n];
+                if (has_m_array_) {
+                    level -= gd_m_[gd_idx][n];
+                }
+                w += level * (1 << shift_[s]);
+            }
+            if (w > 0) {
+                w_pos_sum_[m] += w;
+            } else {
+                w_neg_sum_[m] += w;
+            }
+        }
+    }
+    w_bounds_m_ = m_matrix;
+    w_bounds_n_ = n_matrix;
+}
+
+void Mapper::a_read_plane_diff(int32_t *res, const InputPlane &plane,
+                               int32_t m_matrix, int32_t n_matrix,
+                               uint32_t layer_id,
+                               std::vector<int32_t> &vd_slice,
+                               std::vector<float> &tmp_out) {
+    const std::vector<uint32_t> &split = CFG.SPLIT;
+    const uint32_t tmp_size = m_matrix * split.size();
+
+    // Slice input vector (dac_bits per read)
+    slice_vd(*plane.vd, vd_slice, n_matrix, plane.i_bit, plane.end_bit);
+    // Calculcate multiplications with negative and positive weights
+    if (!CFG.parasitics) {
+        ACS_PROFILE_SCOPE(ACCUMULATION);
+        for (size_t t_m = 0; t_m < tmp_size; ++t_m) {
+            if (row_done(t_m / split.size())) {
+                continue;
+            }
+            const float *ia_p = ia_p_.row(t_m, n_matrix, ia_row_p_.data());
+            const float *ia_m = ia_m_.row(t_m, n_matrix, ia_row_m_.data());
+            for (size_t n = 0; n < n_matrix; ++n) {
+                tmp_out[t_m] += (ia_p[n] - ia_m[n]) * vd_slice[n];
+            }
+        }
+    } else {
+        par_solver_->compute_currents(vd_slice, tmp_out, tmp_size, n_matrix);
+    }
+
+    {
+        ACS_PROFILE_SCOPE(ADC);
+        observe_open_rows(tmp_out, m_matrix, layer_id);
+
+        // Addition of the partial results caused by splitted weights
+        for (size_t m = 0; m < m_matrix; ++m) {
+            if (row_done(m)) {
+                continue;
+            }
+            for (size_t s = 0; s < split.size(); ++s) {
+                res[m] += adc_->convert(
+                    tmp_out[m * split.size() + s],
+                    (std::pow(2, shift_[s]) * std::pow(2, plane.i_bit)) /
+                        (plane.sign * i_step_size_[s]),
+                    0.0, layer_id);
+            }
+        }
+    }
+
+    // Reset tmp_out vector
+    std::fill(tmp_out.begin(), tmp_out.end(), 0);
+}
+
+void Mapper::observe_open_rows(const std::vector<float> &tmp_out,
+                               int32_t m_matrix, uint32_t layer_id) {
+    const size_t num_segments = CFG.SPLIT.size();
+    if (rows_done() == 0) {
+        adc_->observe(tmp_out.data(), m_matrix * num_segments, 0.0, layer_id);
+        return;
+    }
+    for (size_t m = 0; m < m_matrix; ++m) {
+        if (!row_done(m)) {
+            adc_->observe(&tmp_out[m * num_segments], num_segments, 0.0,
+                          layer_id);
+        }
+    }
+}
+
+namespace {
+
+/** Exponent of the lowest set bit of a finite, nonzero float x
+ * (x is a multiple of 2^result). */
+int lowest_bit_exponent(float x) {
+    int exp;
+    const float mantissa = std::frexp(std::fabs(x), &exp);
+    const uint32_t bits = static_cast<uint32_t>(std::ldexp(mantissa, 24));
+    return exp - 24 + __builtin_ctz(bits);
+}
+
+} // namespace
+
+// Exact analog fast path for BNN/TNN mappings.
+// Without state noise, every cell carries either the HRS or the LRS current.
+// If both currents are multiples of a power of two u and every partial column
+// sum (at most 2 * N cells) is below 2^24 * u, the float accumulation of a_mvm
+// never rounds. The column currents then follow exactly from the number of
+// active inputs on LRS cells, which is counted on bit-packed rows (popcount).
+// The check is repeated after every write, so the fast path gives the same
+// results as the float accumulation. with_m: the mapping uses ia_m_.
+void Mapper::update_exact_path(int32_t m_matrix, int32_t n_matrix,
+                               bool with_m) {
+    exact_path_ = false;
+    const float hrs = CFG.HRS;
+    const float step = CFG.LRS - hrs;
+    // Currents as they are stored (conductance_precision)
+    exact_hrs_ = ia_p_.round(int32_t(0) * step + hrs);
+    exact_lrs_ = ia_p_.round(int32_t(1) * step + hrs);
+    if (!std::isfinite(exact_hrs_) || !std::isfinite(exact_lrs_)) {
+        return;
+    }
+    int lsb = std::numeric_limits<int>::max();
+    for (float current : {exact_hrs_, exact_lrs_}) {
+        if (current != 0.0f) {
+            lsb = std::min(lsb, lowest_bit_exponent(current));
+        }
+    }
+    const double max_sum =
+        2.0 * CFG.N * std::max(std::fabs(exact_hrs_), std::fabs(exact_lrs_));
+    if ((max_sum > 0.0) && (std::ldexp(max_sum, -lsb) > double(1 << 24))) {
+        return;
+    }
+
+    // All cells of the region must carry the nominal current of their level
+    auto nominal = [&](const Matrix<uint8_t> &gd,
+                       const ConductanceMatrix &ia) {
+        for (size_t m = 0; m < m_matrix; ++m) {
+            for (size_t n = 0; n < n_matrix; ++n) {
+                if (((gd[m][n] != 0) && (gd[m][n] != 1)) ||
+                    (ia.get(m, n) != (gd[m][n] ? exact_lrs_ : exact_hrs_))) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    };
+    if (!nominal(gd_p_, ia_p_) || (with_m && !nominal(gd_m_, ia_m_))) {
+        return;
+    }
+
+    auto pack_rows = [&](const Matrix<uint8_t> &gd,
+                         std::vector<uint64_t> &bits) {
+        bits.assign(gd.rows() * bit_words_, 0);
+        for (size_t m = 0; m < m_matrix; ++m) {
+            for (size_t n = 0; n < n_matrix; ++n) {
+                bits[m * bit_words_ + n / 64] |= uint64_t(gd[m][n]) << (n % 64);
+            }
+        }
+    };
+    pack_rows(gd_p_, gd_p_bits_);
+    if (with_m) {
+        pack_rows(gd_m_, gd_m_bits_);
+    } else {
+        gd_m_bits_.clear();
+    }
+    vd_bits_.resize(bit_words_);
+    vd_bits_m_.resize(bit_words_);
+    levels_.resize(gd_p_.rows());
+    exact_m_ = m_matrix;
+    exact_n_ = n_matrix;
+    exact_path_ = true;
+}
+
+bool Mapper::use_exact_path(int32_t m_matrix, int32_t n_matrix) const {
+    // Effects that change the currents after the write
+    return exact_path_ && CFG.exact_fast_path && !CFG.parasitics &&
+           !CFG.read_disturb && !CFG.c2c_var && (m_matrix <= exact_m_) &&
+           (n_matrix <= exact_n_);
+}
+
+bool Mapper::pack_bits(const std::vector<int32_t> &vd, int32_t n_matrix,
+                       std::vector<uint64_t> &bits) const {
+    std::fill(bits.begin(), bits.begin() + (n_matrix + 63) / 64, 0);
+    bool binary = true;
+    for (size_t n = 0; n < n_matrix; ++n) {
+        binary &= (vd[n] == 0) || (vd[n] == 1);
+        bits[n / 64] |= uint64_t(vd[n] & 1) << (n % 64);
+    }
+    return binary;
+}
+
+void Mapper::add_levels(const std::vector<uint64_t> &gd_bits,
+                        const std::vector<uint64_t> &bits, int32_t sign,
+                        int32_t m_matrix, int32_t n_matrix) {
+    const size_t words = (n_matrix + 63) / 64;
+    for (size_t m = 0; m < m_matrix; ++m) {
+        const uint64_t *row = &gd_bits[m * bit_words_];
+        int32_t count = 0;
+        for (size_t w = 0; w < words; ++w) {
+            count += __builtin_popcountll(row[w] & bits[w]);
+        }
+        levels_[m] += sign * count;
+    }
+}
+
+void Mapper::convert_levels(std::vector<float> &tmp, int32_t m_matrix,
+                            float base, int32_t min_level, int32_t max_level,
+                            float scale, float offset, uint32_t layer_id,
+                            uint32_t slot) {
+    const float step = exact_lrs_ - exact_hrs_;
+    for (size_t m = 0; m < m_matrix; ++m) {
+        tmp[m] = base + levels_[m] * step;
+    }
+    adc_->convert_levels(tmp, levels_, tmp, m_matrix, base, step, min_level,
+                         max_level, scale, offset, layer_id, slot);
+}
+
+bool Mapper::exact_diff_mvm(const std::vector<int32_t> &vd, int32_t sign,
+                            int32_t m_matrix, int32_t n_matrix, float scale,
+                            uint32_t layer_id, uint32_t slot,
+                            std::vector<float> &tmp) {
+    if (!use_exact_path(m_matrix, n_matrix) ||
+        !pack_bits(vd, n_matrix, vd_bits_)) {
+        return false;
+    }
+    {
+        ACS_PROFILE_SCOPE(ACCUMULATION);
+        std::fill(levels_.begin(), levels_.begin() + m_matrix, 0);
+        add_levels(gd_p_bits_, vd_bits_, sign, m_matrix, n_matrix);
+        add_levels(gd_m_bits_, vd_bits_, -sign, m_matrix, n_matrix);
+    }
+    convert_levels(tmp, m_matrix, 0.0, -CFG.N, CFG.N, scale, 0.0, layer_id,
+                   slot);
+    return true;
+}
+
+void Mapper::column_currents(const ConductanceMatrix &ia,
+                             const std::vector<uint64_t> &gd_bits,
+                             const std::vector<int32_t> &vd, int32_t m_matrix,
+                             int32_t n_matrix, std::vector<float> &out) {
+    ACS_PROFILE_SCOPE(ACCUMULATION);
+    if (use_exact_path(m_matrix, n_matrix) &&
+        pack_bits(vd, n_matrix, vd_bits_)) {
+        int32_t active = 0;
+        for (size_t w = 0; w < (n_matrix + 63) / 64; ++w) {
+            active += __builtin_popcountll(vd_bits_[w]);
+        }
+        std::fill(levels_.begin(), levels_.begin() + m_matrix, 0);
+        add_levels(gd_bits, vd_bits_, 1, m_matrix, n_matrix);
+        const float base = active * exact_hrs_;
+        const float step = exact_lrs_ - exact_hrs_;
+        for (size_t m = 0; m < m_matrix; ++m) {
+            out[m] = base + levels_[m] * step;
+        }
+        return;
+    }
+    std::fill(out.begin(), out.end(), 0.0);
+    for (size_t m = 0; m < m_matrix; ++m) {
+        const float *ia_row = ia.row(m, n_matrix, ia_row_p_.data());
+        for (size_t n = 0; n < n_matrix; ++n) {
+            out[m] += ia_row[n] * vd[n];
+        }
+    }
+}
+
+void Mapper::column_currents_pm(const std::vector<int32_t> &vd_p,
+                                const std::vector<int32_t> &vd_m,
+                                int32_t m_matrix, int32_t n_matrix,
+                                std::vector<float> &out) {
+    ACS_PROFILE_SCOPE(ACCUMULATION);
+    float *out_p_p = out.data();
+    float *out_p_m = out_p_p + m_matrix;
+    float *out_m_p = out_p_m + m_matrix;
+    float *out_m_m = out_m_p + m_matrix;
+    if (use_exact_path(m_matrix, n_matrix) &&
+        pack_bits(vd_p, n_matrix, vd_bits_) &&
+        pack_bits(vd_m, n_matrix, vd_bits_m_)) {
+        const size_t words = (n_matrix + 63) / 64;
+        int32_t active_p = 0;
+        int32_t active_m = 0;
+        for (size_t w = 0; w < words; ++w) {
+            active_p += __builtin_popcountll(vd_bits_[w]);
+            active_m += __builtin_popcountll(vd_bits_m_[w]);
+        }
+        const float base_p = active_p * exact_hrs_;
+        const float base_m = active_m * exact_hrs_;
+        const float step = exact_lrs_ - exact_hrs_;
+        for (size_t m = 0; m < m_matrix; ++m) {
+            const uint64_t *row_p = &gd_p_bits_[m * bit_words_];
+            const uint64_t *row_m = &gd_m_bits_[m * bit_words_];
+            int32_t p_p = 0, p_m = 0, m_p = 0, m_m = 0;
+            for (size_t w = 0; w < words; ++w) {
+                p_p += __builtin_popcountll(row_p[w] & vd_bits_[w]);
+                p_m += __builtin_popcountll(row_p[w] & vd_bits_m_[w]);
+                m_p += __builtin_popcountll(row_m[w] & vd_bits_[w]);
+                m_m += __builtin_popcountll(row_m[w] & vd_bits_m_[w]);
+            }
+            out_p_p[m] = base_p + p_p * step;
+            out_p_m[m] = base_m + p_m * step;
+            out_m_p[m] = base_p + m_p * step;
+            out_m_m[m] = base_m + m_m * step;
+        }
+        return;
+    }
+    // Every row of ia_p_/ia_m_ is read (and converted) once for both inputs
+    for (size_t m = 0; m < m_matrix; ++m) {
+        const float *ia_p = ia_p_.row(m, n_matrix, ia_row_p_.data());
+        const float *ia_m = ia_m_.row(m, n_matrix, ia_row_m_.data());
+        float p_p = 0.0, p_m = 0.0, m_p = 0.0, m_m = 0.0;
+        for (size_t n = 0; n < n_matrix; ++n) {
+            p_p += ia_p[n] * vd_p[n];
+            p_m += ia_p[n] * vd_m[n];
+            m_p += ia_m[n] * vd_p[n];
+            m_m += ia_m[n] * vd_m[n];
+        }
+        out_p_p[m] = p_p;
+        out_p_m[m] = p_m;
+        out_m_p[m] = m_p;
+        out_m_m[m] = m_m;
+    }
+}
+
+void Mapper::add_column_noise(const Matrix<uint8_t> &gd,
+                              const std::vector<int32_t> &vd,
+                              int32_t m_matrix, int32_t n_matrix,
+                              std::vector<float> &out) {
+    add_column_noise(gd, vd, m_matrix, n_matrix, out.data());
+}
+
+// The sum of independent Gaussian cell noises is Gaussian with the summed
+// variance. The clipping of a single noisy cell current at 0 (per_cell) is
+// not modeled. Like per_cell, the samples are keyed by rng_seed, the stream,
+// the column, and the read.
+void Mapper::add_column_noise(const Matrix<uint8_t> &gd,
+                              const std::vector<int32_t> &vd,
+                              int32_t m_matrix, int32_t n_matrix,
+                              float *out) {
+    if (!CFG.c2c_var || (CFG.c2c_model != C2CModel::COLUMN_AGGREGATE)) {
+        return;
+    }
+    ACS_PROFILE_SCOPE(VARIABILITY);
+    const CounterRNG rng(CFG.rng_seed);
+    const uint64_t key = rng.bits(rng_stream_, c2c_samples);
+    const uint64_t read = c2c_reads_++;
+    const float hrs_var = std::pow(std::max(CFG.HRS_NOISE, 0.0f), 2);
+    const float lrs_var = std::pow(std::max(CFG.LRS_NOISE, 0.0f), 2);
+    // Noise of a cell is scaled by its input
+    int64_t active = 0;
+    for (size_t n = 0; n < n_matrix; ++n) {
+        active += vd[n] * vd[n];
+    }
+    for (size_t m = 0; m < m_matrix; ++m) {
+        const uint8_t *gd_row = gd[m];
+        int64_t lrs = 0;
+        for (size_t n = 0; n < n_matrix; ++n) {
+            lrs += gd_row[n] * vd[n] * vd[n];
+        }
+        const float var = hrs_var * (active - lrs) + lrs_var * lrs;
+        if (var > 0.0f) {
+            out[m] += std::sqrt(var) * rng.normal(key + m, 2 * read);
+        }
+    }
+}
+
+// The currents as written are allocated when per-cell C2C variability is used
+// for the first time. Until then, ia_p_/ia_m_ hold them.
+bool Mapper::keep_orig() {
+    if (ia_p_orig_.empty() && CFG.c2c_var &&
+        (CFG.c2c_model == C2CModel::PER_CELL)) {
+        ia_p_orig_ = ia_p_;
+        ia_m_orig_ = ia_m_;
+    }
+    return !ia_p_orig_.empty();
 }
 
 void Mapper::a_add_c2c_var(int32_t m_matrix, int32_t n_matrix) {
+    ACS_PROFILE_SCOPE(VARIABILITY);
+    keep_orig();
+    // The samples of a read are keyed by cell, so they do not depend on the
+    // thread that runs the MVM
+    const CounterRNG rng(CFG.rng_seed);
+    const uint64_t key = rng.bits(rng_stream_, c2c_samples);
+    const uint64_t read = c2c_reads_++;
     for (size_t m = 0; m < m_matrix; ++m) {
         for (size_t n = 0; n < n_matrix; ++n) {
-            ia_p_[m][n] = add_gaussian_noise(ia_p_orig_[m][n], gd_p_[m][n]);
-            ia_m_[m][n] = add_gaussian_noise(ia_m_orig_[m][n], gd_m_[m][n]);
+            const uint64_t cell = m * CFG.N + n;
+            ia_p_.set(m, n,
+                      add_gaussian_noise(ia_p_orig_.get(m, n), gd_p_[m][n],
+                                         rng.normal(key + cell, 2 * read)));
+            if (has_m_array_) {
+                ia_m_.set(m, n, add_gaussian_noise(
+                                    ia_m_orig_.get(m, n), gd_m_[m][n],
+                                    rng.normal(key + cell, 2 * read + 1)));
+            }
         }
     }
 }
 
 void Mapper::a_remove_c2c_var(int32_t m_matrix, int32_t n_matrix) {
+    ACS_PROFILE_SCOPE(VARIABILITY);
+    keep_orig();
     for (size_t m = 0; m < m_matrix; ++m) {
         for (size_t n = 0; n < n_matrix; ++n) {
-            ia_p_[m][n] = ia_p_orig_[m][n];
-            ia_m_[m][n] = ia_m_orig_[m][n];
+            ia_p_.set(m, n, ia_p_orig_.get(m, n));
+            if (has_m_array_) {
+                ia_m_.set(m, n, ia_m_orig_.get(m, n));
+            }
         }
     }
 }
 
+void Mapper::save_state(SnapshotWriter &writer) const {
+    writer.add(SnapshotSection::GD_P, gd_p_);
+    writer.add(SnapshotSection::GD_M, gd_m_);
+    writer.add(SnapshotSection::SUM_W, sum_w_);
+    ia_p_.save(writer, SnapshotSection::IA_P);
+    ia_m_.save(writer, SnapshotSection::IA_M);
+    ia_p_orig_.save(writer, SnapshotSection::IA_P_ORIG);
+    ia_m_orig_.save(writer, SnapshotSection::IA_M_ORIG);
+    writer.add(SnapshotSection::MAPPER_COUNTERS,
+               std::vector<uint64_t>{rd_refresh_epoch_, d2d_draw_, c2c_reads_});
+    if (par_solver_) {
+        par_solver_->save_state(writer);
+    }
+}
+
+bool Mapper::check_state(const SnapshotReader &reader) const {
+    // The currents as written are only saved if they were allocated
+    uint64_t orig_rows = 0;
+    uint64_t orig_cols = 0;
+    if (!reader.shape(SnapshotSection::IA_P_ORIG, orig_rows, orig_cols)) {
+        return false;
+    }
+    const ConductanceMatrix empty;
+    const bool orig = (orig_rows * orig_cols > 0);
+    const ConductanceMatrix &ia_p_orig = orig ? ia_p_ : empty;
+    const ConductanceMatrix &ia_m_orig = orig ? ia_m_ : empty;
+    return reader.check<uint8_t>(SnapshotSection::GD_P, gd_p_.rows(),
+                                 gd_p_.cols()) &&
+           reader.check<uint8_t>(SnapshotSection::GD_M, gd_m_.rows(),
+                                 gd_m_.cols()) &&
+           reader.check<int32_t>(SnapshotSection::SUM_W, 1, sum_w_.size()) &&
+           ia_p_.check(reader, SnapshotSection::IA_P) &&
+           ia_m_.check(reader, SnapshotSection::IA_M) &&
+           ia_p_orig.check(reader, SnapshotSection::IA_P_ORIG) &&
+           ia_m_orig.check(reader, SnapshotSection::IA_M_ORIG) &&
+           reader.check<uint64_t>(SnapshotSection::MAPPER_COUNTERS, 1, 3) &&
+           (!par_solver_ || par_solver_->check_state(reader));
+}
+
+bool Mapper::load_state(const SnapshotReader &reader, int32_t m_written,
+                        int32_t n_written) {
+    // Nothing is overwritten unless the complete state can be loaded
+    if (!check_state(reader)) {
+        return false;
+    }
+    uint64_t orig_rows = 0;
+    uint64_t orig_cols = 0;
+    reader.shape(SnapshotSection::IA_P_ORIG, orig_rows, orig_cols);
+    if (orig_rows * orig_cols == 0) {
+        ia_p_orig_ = ConductanceMatrix{};
+        ia_m_orig_ = ConductanceMatrix{};
+    } else {
+        ia_p_orig_ = ia_p_;
+        ia_m_orig_ = ia_m_;
+    }
+
+    bool ok = reader.read(SnapshotSection::GD_P, gd_p_) &&
+              reader.read(SnapshotSection::GD_M, gd_m_) &&
+              reader.read(SnapshotSection::SUM_W, sum_w_) &&
+              ia_p_.load(reader, SnapshotSection::IA_P) &&
+              ia_m_.load(reader, SnapshotSection::IA_M) &&
+              ia_p_orig_.load(reader, SnapshotSection::IA_P_ORIG) &&
+              ia_m_orig_.load(reader, SnapshotSection::IA_M_ORIG);
+    if (!ok) {
+        return false;
+    }
+    w_bounds_m_ = -1;
+    std::vector<uint64_t> counters(3);
+    if (!reader.read(SnapshotSection::MAPPER_COUNTERS, counters)) {
+        return false;
+    }
+    rd_refresh_epoch_ = counters[0];
+    d2d_draw_ = counters[1];
+    c2c_reads_ = counters[2];
+    exact_path_ = false;
+    d_gemv_.clear();
+    if ((m_written > 0) && !CFG.digital_only &&
+        !CFG.is_int_mapping(CFG.m_mode)) {
+        update_exact_path(m_written, n_written, has_m_array_);
+    }
+    if ((m_written > 0) && CFG.is_int_mapping(CFG.m_mode)) {
+        d_pack(m_written, n_written);
+    }
+    if (par_solver_) {
+        return par_solver_->load_state(reader);
+    }
+    return true;
+}
+
 } // namespace nq
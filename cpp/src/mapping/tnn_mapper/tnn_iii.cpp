@@ -64,26 +64,37 @@ void MapperTnnIII::d_mvm(int32_t *res, const int32_t *vec, const int32_t *mat,
 
 void MapperTnnIII::a_mvm(int32_t *res, const int32_t *vec, const int32_t *mat,
                          int32_t m_matrix, int32_t n_matrix,
-                         const char *l_name) {
+                         uint32_t layer_id) {
     // Threat the input as two bit two's complement number.
     // Input bit 0
     uint32_t mask = 0b01;
-    for (size_t n = 0; n < n_matrix; ++n) {
-        vd_p_[n] = (vec[n] + 1) & mask;
+    {
+        ACS_PROFILE_SCOPE(INPUT_ENCODING);
+        for (size_t n = 0; n < n_matrix; ++n) {
+            vd_p_[n] = (vec[n] + 1) & mask;
+        }
     }
     std::fill(tmp_out_.begin(), tmp_out_.end(), 0.0);
 
-    if (!CFG.parasitics) {
-        for (size_t m = 0; m < m_matrix; ++m) {
-            for (size_t n = 0; n < n_matrix; ++n) {
-                tmp_out_[m] += (ia_p_[m][n] - ia_m_[m][n]) * vd_p_[n];
+    if (!exact_diff_mvm(vd_p_, 1, m_matrix, n_matrix, 1 / i_mm_, layer_id,
+                        0, tmp_out_)) {
+        if (!CFG.parasitics) {
+            ACS_PROFILE_SCOPE(ACCUMULATION);
+            for (size_t m = 0; m < m_matrix; ++m) {
+                const float *ia_p = ia_p_.row(m, n_matrix, ia_row_p_.data());
+                const float *ia_m = ia_m_.row(m, n_matrix, ia_row_m_.data());
+                for (size_t n = 0; n < n_matrix; ++n) {
+                    tmp_out_[m] += (ia_p[n] - ia_m[n]) * vd_p_[n];
+                }
             }
+            add_column_noise(gd_p_, vd_p_, m_matrix, n_matrix, tmp_out_);
+            add_column_noise(gd_m_, vd_p_, m_matrix, n_matrix, tmp_out_);
+        } else {
+            par_solver_->compute_currents(vd_p_, tmp_out_, m_matrix, n_matrix);
         }
-    } else {
-        par_solver_->compute_currents(vd_p_, tmp_out_, m_matrix, n_matrix);
-    }
 
-    adc_->convert(tmp_out_, tmp_out_, m_matrix, 1 / i_mm_, 0.0, l_name);
+        adc_->convert(tmp_out_, tmp_out_, m_matrix, 1 / i_mm_, 0.0, layer_id);
+    }
 
     for (size_t m = 0; m < m_matrix; ++m) {
         res[m] += tmp_out_[m];
@@ -95,17 +106,25 @@ void MapperTnnIII::a_mvm(int32_t *res, const int32_t *vec, const int32_t *mat,
         vd_p_[n] = ((vec[n] + 1) & mask) >> 1;
     }
     std::fill(tmp_out_.begin(), tmp_out_.end(), 0.0);
-    if (!CFG.parasitics) {
-        for (size_t m = 0; m < m_matrix; ++m) {
-            for (size_t n = 0; n < n_matrix; ++n) {
-                tmp_out_[m] += (ia_p_[m][n] - ia_m_[m][n]) * vd_p_[n];
+    if (!exact_diff_mvm(vd_p_, 1, m_matrix, n_matrix, 2 / i_mm_, layer_id,
+                        1, tmp_out_)) {
+        if (!CFG.parasitics) {
+            ACS_PROFILE_SCOPE(ACCUMULATION);
+            for (size_t m = 0; m < m_matrix; ++m) {
+                const float *ia_p = ia_p_.row(m, n_matrix, ia_row_p_.data());
+                const float *ia_m = ia_m_.row(m, n_matrix, ia_row_m_.data());
+                for (size_t n = 0; n < n_matrix; ++n) {
+                    tmp_out_[m] += (ia_p[n] - ia_m[n]) * vd_p_[n];
+                }
             }
+            add_column_noise(gd_p_, vd_p_, m_matrix, n_matrix, tmp_out_);
+            add_column_noise(gd_m_, vd_p_, m_matrix, n_matrix, tmp_out_);
+        } else {
+            par_solver_->compute_currents(vd_p_, tmp_out_, m_matrix, n_matrix);
         }
-    } else {
-        par_solver_->compute_currents(vd_p_, tmp_out_, m_matrix, n_matrix);
-    }
 
-    adc_->convert(tmp_out_, tmp_out_, m_matrix, 2 / i_mm_, 0.0, l_name);
+        adc_->convert(tmp_out_, tmp_out_, m_matrix, 2 / i_mm_, 0.0, layer_id);
+    }
 
     for (size_t m = 0; m < m_matrix; ++m) {
         res[m] += tmp_out_[m];
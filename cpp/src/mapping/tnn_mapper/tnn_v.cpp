@@ -15,10 +15,8 @@ namespace nq {
 MapperTnnV::MapperTnnV() :
     vd_p_(CFG.N, 0),
     vd_m_(CFG.N, 0),
-    tmp_out_(CFG.M, 0.0),
-    tmp_out_lsb_(CFG.M, 0.0),
-    tmp_out_msb_(CFG.M, 0.0),
-    tmp_out_fp_(CFG.M, 0.0),
+    tmp_out_(4 * CFG.M, 0.0),
+    par_out_(2 * CFG.M, 0.0),
     Mapper(false) {}
 
 MapperTnnV::~MapperTnnV() {}
@@ -79,9 +77,8 @@ void MapperTnnV::d_mvm(int32_t *res, const int32_t *vec, const int32_t *mat,
 }
 
 void MapperTnnV::a_mvm(int32_t *res, const int32_t *vec, const int32_t *mat,
-                       int32_t m_matrix, int32_t n_matrix, const char *l_name) {
+                       int32_t m_matrix, int32_t n_matrix, uint32_t layer_id) {
     const std::vector<uint32_t> &split = CFG.SPLIT;
-    std::fill(tmp_out_fp_.begin(), tmp_out_fp_.end(), 0.0);
 
     if (split != std::vector<uint32_t>{1, 1}) {
         std::cerr << "Not implemented: SPLIT must be {1, 1} for TNN_V."
@@ -91,112 +88,66 @@ void MapperTnnV::a_mvm(int32_t *res, const int32_t *vec, const int32_t *mat,
 
     // Calculate sum over all inputs
     int64_t inp_sum = 0;
-    for (size_t n = 0; n < n_matrix; ++n) {
-        inp_sum += vec[n];
-    }
+    {
+        ACS_PROFILE_SCOPE(INPUT_ENCODING);
+        for (size_t n = 0; n < n_matrix; ++n) {
+            inp_sum += vec[n];
+        }
 
-    for (size_t n = 0; n < n_matrix; ++n) {
-        if (vec[n] == +1) {
-            vd_p_[n] = 1;
-            vd_m_[n] = 0;
-        } else if (vec[n] == -1) {
-            vd_m_[n] = 1;
-            vd_p_[n] = 0;
-        } else if (vec[n] == 0) {
-            vd_m_[n] = 0;
-            vd_p_[n] = 0;
-        } else {
-            std::cerr << "TNN input is neither 0 nor +1 nor -1.";
-            abort();
+        for (size_t n = 0; n < n_matrix; ++n) {
+            if (vec[n] == +1) {
+                vd_p_[n] = 1;
+                vd_m_[n] = 0;
+            } else if (vec[n] == -1) {
+                vd_m_[n] = 1;
+                vd_p_[n] = 0;
+            } else if (vec[n] == 0) {
+                vd_m_[n] = 0;
+                vd_p_[n] = 0;
+            } else {
+                std::cerr << "TNN input is neither 0 nor +1 nor -1.";
+                abort();
+            }
         }
     }
 
     // Analog correction term
     float analog_correction = 3 * inp_sum * CFG.HRS;
 
+    // Column currents of the four reads, one block of m_matrix each: LSB
+    // weights ia_p_ with positive/negative input, then MSB weights ia_m_
+    float *lsb_p = &tmp_out_[0];
+    float *lsb_m = &tmp_out_[m_matrix];
+    float *msb_p = &tmp_out_[2 * m_matrix];
+    float *msb_m = &tmp_out_[3 * m_matrix];
     if (!CFG.parasitics) {
-        // LSB weights ia_p_ ; positive input
-        std::fill(tmp_out_.begin(), tmp_out_.end(), 0.0);
-        for (size_t m = 0; m < m_matrix; ++m) {
-            for (size_t n = 0; n < n_matrix; ++n) {
-                tmp_out_[m] += ia_p_[m][n] * vd_p_[n];
-            }
-        }
-        adc_->convert(tmp_out_, tmp_out_, m_matrix, 1 / i_mm_, 0.0, l_name);
-        for (size_t m = 0; m < m_matrix; ++m) {
-            tmp_out_fp_[m] += tmp_out_[m];
-        }
-
-        // LSB weights ia_p_ ; negative input
-        std::fill(tmp_out_.begin(), tmp_out_.end(), 0.0);
-        for (size_t m = 0; m < m_matrix; ++m) {
-            for (size_t n = 0; n < n_matrix; ++n) {
-                tmp_out_[m] += ia_p_[m][n] * vd_m_[n];
-            }
-        }
-        adc_->convert(tmp_out_, tmp_out_, m_matrix, 1 / i_mm_,
-                      analog_correction, l_name);
-        for (size_t m = 0; m < m_matrix; ++m) {
-            tmp_out_fp_[m] -= tmp_out_[m];
-        }
-
-        // MSB weights ia_m_ ; positive input
-        std::fill(tmp_out_.begin(), tmp_out_.end(), 0.0);
-        for (size_t m = 0; m < m_matrix; ++m) {
-            for (size_t n = 0; n < n_matrix; ++n) {
-                tmp_out_[m] += ia_m_[m][n] * vd_p_[n];
-            }
-        }
-        adc_->convert(tmp_out_, tmp_out_, m_matrix, 2 / i_mm_, 0.0, l_name);
-        for (size_t m = 0; m < m_matrix; ++m) {
-            tmp_out_fp_[m] += tmp_out_[m];
-        }
-
-        // MSB weights ia_m_ ; negative input
-        std::fill(tmp_out_.begin(), tmp_out_.end(), 0.0);
-        for (size_t m = 0; m < m_matrix; ++m) {
-            for (size_t n = 0; n < n_matrix; ++n) {
-                tmp_out_[m] += ia_m_[m][n] * vd_m_[n];
-            }
-        }
-        adc_->convert(tmp_out_, tmp_out_, m_matrix, 2 / i_mm_, 0.0, l_name);
-        for (size_t m = 0; m < m_matrix; ++m) {
-            tmp_out_fp_[m] -= tmp_out_[m];
-        }
+        column_currents_pm(vd_p_, vd_m_, m_matrix, n_matrix, tmp_out_);
+        add_column_noise(gd_p_, vd_p_, m_matrix, n_matrix, lsb_p);
+        add_column_noise(gd_p_, vd_m_, m_matrix, n_matrix, lsb_m);
+        add_column_noise(gd_m_, vd_p_, m_matrix, n_matrix, msb_p);
+        add_column_noise(gd_m_, vd_m_, m_matrix, n_matrix, msb_m);
     } else {
-        // Positive input
-        par_solver_->compute_currents(vd_p_, tmp_out_, 2 * m_matrix, n_matrix);
-        for (size_t m = 0; m < m_matrix; m++) {
-            tmp_out_lsb_[m] = tmp_out_[2 * m];
-            tmp_out_msb_[m] = tmp_out_[2 * m + 1];
-        }
-        adc_->convert(tmp_out_lsb_, tmp_out_lsb_, m_matrix, 1 / i_mm_, 0.0,
-                      l_name);
-        adc_->convert(tmp_out_msb_, tmp_out_msb_, m_matrix, 2 / i_mm_, 0.0,
-                      l_name);
-        for (size_t m = 0; m < m_matrix; m++) {
-            tmp_out_fp_[m] += tmp_out_lsb_[m];
-            tmp_out_fp_[m] += tmp_out_msb_[m];
-        }
-
-        // Negative input
-        par_solver_->compute_currents(vd_m_, tmp_out_, 2 * m_matrix, n_matrix);
+        // The solver returns the LSB/MSB columns interleaved
+        par_solver_->compute_currents(vd_p_, par_out_, 2 * m_matrix, n_matrix);
         for (size_t m = 0; m < m_matrix; m++) {
-            tmp_out_lsb_[m] = tmp_out_[2 * m];
-            tmp_out_msb_[m] = tmp_out_[2 * m + 1];
+            lsb_p[m] = par_out_[2 * m];
+            msb_p[m] = par_out_[2 * m + 1];
         }
-        adc_->convert(tmp_out_lsb_, tmp_out_lsb_, m_matrix, 1 / i_mm_,
-                      analog_correction, l_name);
-        adc_->convert(tmp_out_msb_, tmp_out_msb_, m_matrix, 2 / i_mm_, 0.0,
-                      l_name);
+        par_solver_->compute_currents(vd_m_, par_out_, 2 * m_matrix, n_matrix);
         for (size_t m = 0; m < m_matrix; m++) {
-            tmp_out_fp_[m] -= tmp_out_lsb_[m];
-            tmp_out_fp_[m] -= tmp_out_msb_[m];
+            lsb_m[m] = par_out_[2 * m];
+            msb_m[m] = par_out_[2 * m + 1];
         }
     }
 
+    // All four reads in one ADC call
+    const float scales[4] = {1 / i_mm_, 1 / i_mm_, 2 / i_mm_, 2 / i_mm_};
+    const float offsets[4] = {0.0, analog_correction, 0.0, 0.0};
+    adc_->convert_segments(tmp_out_, tmp_out_, m_matrix, 4, scales, offsets,
+                           layer_id);
     for (size_t m = 0; m < m_matrix; ++m) {
-        res[m] += tmp_out_fp_[m];
+        res[m] += tmp_out_[m] - tmp_out_[m_matrix + m] +
+                  tmp_out_[2 * m_matrix + m] - tmp_out_[3 * m_matrix + m];
         res[m] -= inp_sum;
     }
 }
@@ -8,22 +8,33 @@
 
 #include "xbar/adc.h"
 #include "helper/config.h"
+#include "helper/profiler.h"
+#include "xbar/adc_calibration.h"
 
 #include <algorithm>
 #include <cmath>
 #include <execution>
 #include <iostream>
 
+#include "oneapi/tbb/blocked_range.h"
+#include "oneapi/tbb/parallel_for.h"
+
 namespace nq {
 
 ADC::ADC() :
     resolution_(CFG.resolution),
     steps_(std::pow(2, resolution_)),
-    hists_(ADCHistograms::get_instance()) {}
+    hists_(ADCHistograms::get_instance()),
+    profile_layer_(0),
+    profile_hist_(nullptr),
+    calib_layer_(0),
+    calib_hist_(nullptr),
+    calib_generation_(0) {}
 
 void ADC::convert(const std::vector<float> &in, std::vector<float> &out,
                   const int32_t len, float scale, float offset,
-                  const char *l_name) {
+                  uint32_t layer_id) {
+    ACS_PROFILE_SCOPE(ADC);
     // Check if len is less than input vector length.
     if (in.size() < len) {
         std::cerr << "Requested ADC conversion length: " << len
@@ -32,9 +43,7 @@ void ADC::convert(const std::vector<float> &in, std::vector<float> &out,
         std::exit(EXIT_FAILURE);
     }
 
-    if (CFG.adc_profile) {
-        profile_inputs(in, len, l_name);
-    }
+    observe(in.data(), len, offset, layer_id);
 
     // Resize output vector
     if (out.size() < len) {
@@ -43,23 +52,110 @@ void ADC::convert(const std::vector<float> &in, std::vector<float> &out,
 
     // Apply offset and scale
     std::transform(std::execution::par, in.begin(), in.begin() + len,
-                   out.begin(), [this, scale, offset, l_name](float current) {
-                       return convert(current, scale, offset, l_name);
+                   out.begin(), [this, scale, offset, layer_id](float current) {
+                       return convert(current, scale, offset, layer_id);
                    });
 }
 
-std::pair<float, float> ADC::get_currents(const char *l_name) {
+void ADC::convert_segments(const std::vector<float> &in,
+                           std::vector<float> &out, const int32_t len,
+                           const int32_t segments, const float *scales,
+                           const float *offsets, uint32_t layer_id) {
+    ACS_PROFILE_SCOPE(ADC);
+    const size_t total = size_t(len) * segments;
+    if (in.size() < total) {
+        std::cerr << "Requested ADC conversion length: " << total
+                  << ", is greater than input "
+                  << "vector length: " << in.size() << "!" << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+
+    for (int32_t s = 0; s < segments; ++s) {
+        observe(in.data() + size_t(s) * len, len, offsets[s], layer_id);
+    }
+
+    if (out.size() < total) {
+        out.resize(total, 0.0);
+    }
+
+    // One parallel pass over all segments
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, total),
+                      [&](const tbb::blocked_range<size_t> &r) {
+                          for (size_t i = r.begin(); i < r.end(); ++i) {
+                              const size_t s = i / len;
+                              out[i] = convert(in[i], scales[s], offsets[s],
+                                               layer_id);
+                          }
+                      });
+}
+
+void ADC::convert_levels(const std::vector<float> &in,
+                         const std::vector<int32_t> &levels,
+                         std::vector<float> &out, const int32_t len,
+                         float base, float step, int32_t min_level,
+                         int32_t max_level, float scale, float offset,
+                         uint32_t layer_id, uint32_t slot) {
+    ACS_PROFILE_SCOPE(ADC);
+    if ((in.size() < len) || (levels.size() < len) ||
+        (slot >= num_level_slots)) {
+        std::cerr << "Invalid ADC level conversion (length: " << len
+                  << ", slot: " << slot << ")." << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+
+    observe(in.data(), len, offset, layer_id);
+
+    if (out.size() < len) {
+        out.resize(len, 0.0);
+    }
+
+    const size_t idx = size_t(layer_id) * num_level_slots + slot;
+    if (idx >= level_tables_.size()) {
+        level_tables_.resize(idx + 1);
+    }
+    LevelTable &table = level_tables_[idx];
+    // Infinite ADCs have no range (MAX mode)
+    const std::pair<float, float> currents =
+        (CFG.adc_type == ADCType::INF_ADC) ? std::make_pair(0.0f, 0.0f)
+                                           : get_currents(layer_id);
+    if ((table.base != base) || (table.step != step) ||
+        (table.min_level != min_level) || (table.max_level != max_level) ||
+        (table.scale != scale) || (table.offset != offset) ||
+        (table.currents != currents)) {
+        table.base = base;
+        table.step = step;
+        table.min_level = min_level;
+        table.max_level = max_level;
+        table.scale = scale;
+        table.offset = offset;
+        table.currents = currents;
+        table.out.assign(max_level - min_level + 1, 0.0);
+        table.valid.assign(max_level - min_level + 1, false);
+    }
+
+    for (int32_t i = 0; i < len; ++i) {
+        const int32_t level = levels[i] - min_level;
+        if (!table.valid[level]) {
+            table.out[level] = convert(in[i], scale, offset, layer_id);
+            table.valid[level] = true;
+        }
+        out[i] = table.out[level];
+    }
+}
+
+std::pair<float, float> ADC::get_currents(uint32_t layer_id) {
     switch (CFG.adc_calib_mode) {
     case ADCCalibMode::MAX:
         return std::make_pair<float, float>(maximum_min_current(),
                                             maximum_max_current());
     case ADCCalibMode::CALIB:
-        if (auto val = CFG.adc_calib_dict.find(l_name);
-            val != CFG.adc_calib_dict.end()) {
-            return val->second;
+        if ((layer_id < CFG.adc_calib_ranges.size()) &&
+            CFG.adc_calib_ranges[layer_id]) {
+            return *CFG.adc_calib_ranges[layer_id];
         } else {
             std::cerr << "Unable to find calibrated ADC currents for layer: "
-                      << l_name << std::endl;
+                      << LayerRegistry::get_instance().get_name(layer_id)
+                      << std::endl;
             std::exit(EXIT_FAILURE);
         }
     default:
@@ -72,26 +168,43 @@ float ADC::clip(float current, float min_curr, float max_curr) {
     return std::min(std::max(current, min_curr), max_curr);
 }
 
-void ADC::profile_inputs(const std::vector<float> &in, const int32_t len,
-                         const char *l_name) {
-    // Check if a histogram already exists for the given layer, otherwise
-    // create one.
-    if (!hists_.get().has_histogram(l_name)) {
-        hists_.get().add_histogram(l_name, maximum_min_current(),
-                                   maximum_max_current(),
-                                   CFG.adc_profile_bin_size);
+void ADC::observe(const float *in, const int32_t len, float offset,
+                  uint32_t layer_id) {
+    if (CFG.adc_profile) {
+        profile_inputs(in, len, layer_id);
     }
 
-    // Update values in layer histogram
-    std::reference_wrapper<BinnedHistogram> l_hist(
-        hists_.get().get_histogram(l_name).value());
-    l_hist.get().update(std::vector<float>(in.begin(), in.begin() + len));
+    // The ADC clips the input current plus offset
+    ADCCalibration &calib = ADCCalibration::get_instance();
+    if (calib.is_active()) {
+        if ((calib_hist_ == nullptr) ||
+            (calib_generation_ != calib.get_generation()) ||
+            (calib_layer_ != layer_id)) {
+            calib_hist_ = &calib.get_or_add_histogram(layer_id);
+            calib_generation_ = calib.get_generation();
+            calib_layer_ = layer_id;
+        }
+        calib_hist_->update(in, len, offset);
+    }
+}
+
+void ADC::profile_inputs(const float *in, const int32_t len,
+                         uint32_t layer_id) {
+    // Consecutive conversions usually belong to the same layer. The
+    // histogram lookup (and creation) is only done when the layer changes.
+    if ((profile_hist_ == nullptr) || (profile_layer_ != layer_id)) {
+        profile_hist_ = &hists_.get().get_or_add_histogram(
+            layer_id, maximum_min_current(), maximum_max_current(),
+            CFG.adc_profile_bin_size);
+        profile_layer_ = layer_id;
+    }
+    profile_hist_->update(in, len);
 }
 
 ADCInfinite::ADCInfinite() : ADC() {}
 
 float ADCInfinite::convert(const float current, float scale, float offset,
-                           const char *l_name) {
+                           uint32_t layer_id) {
     return (current + offset) * scale;
 }
 
@@ -106,10 +219,10 @@ float ADCInfinite::maximum_min_current() {
 ADCUnsigned::ADCUnsigned() : ADC() {}
 
 float ADCUnsigned::convert(const float current, float scale, float offset,
-                           const char *l_name) {
+                           uint32_t layer_id) {
     float tmp;
     // Get current ranges
-    std::pair<float, float> currs = get_currents(l_name);
+    std::pair<float, float> currs = get_currents(layer_id);
     float min_curr = currs.first;
     float max_curr = currs.second;
     float curr_range = max_curr - min_curr;
@@ -135,8 +248,10 @@ float ADCUnsigned::convert(const float current, float scale, float offset,
     return round(tmp * scale);
 }
 
+float ADC::max_dac_level() { return (1 << CFG.dac_bits) - 1; }
+
 float ADCUnsigned::maximum_max_current() {
-    return static_cast<float>(CFG.N) * CFG.LRS;
+    return static_cast<float>(CFG.N) * CFG.LRS * max_dac_level();
 }
 
 float ADCUnsigned::maximum_min_current() { return 0.0; }
@@ -147,11 +262,11 @@ ADCSigned::ADCSigned() : ADCUnsigned() {
 }
 
 float ADCSigned::maximum_max_current() {
-    return static_cast<float>(CFG.N) * (CFG.LRS - CFG.HRS);
+    return static_cast<float>(CFG.N) * (CFG.LRS - CFG.HRS) * max_dac_level();
 }
 
 float ADCSigned::maximum_min_current() {
-    return -static_cast<float>(CFG.N) * (CFG.LRS - CFG.HRS);
+    return -static_cast<float>(CFG.N) * (CFG.LRS - CFG.HRS) * max_dac_level();
 }
 
 std::unique_ptr<ADC> ADCFactory::createADC(ADCType type) {
@@ -0,0 +1,248 @@
+/******************************************************************************
+ * Copyright (C) 2025 Rebecca Pelke                                           *
+ * All Rights Reserved                                                        *
+ *                                                                            *
+ * This work is licensed under the terms described in the LICENSE file        *
+ * found in the root directory of this source tree.                           *
+ ******************************************************************************/
+
+#include "xbar/adc_calibration.h"
+#include "helper/config.h"
+#include "helper/layer_registry.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <numeric>
+
+namespace nq {
+
+namespace {
+
+using Buckets = std::vector<std::pair<float, uint64_t>>;
+
+/** Number of bins of the reference distribution (KL policy) */
+constexpr int64_t kl_bins = 2048;
+
+/** Tail fractions (per side) of the candidate ranges (MSE and KL policy):
+ * 0 and four steps per decade from 1e-7 to 1e-1 */
+std::vector<double> candidate_tails() {
+    std::vector<double> tails = {0.0};
+    for (int32_t k = 0; k <= 24; ++k) {
+        tails.push_back(std::pow(10.0, -7.0 + k / 4.0));
+    }
+    return tails;
+}
+
+/** Clipping error plus quantization noise of the range [lo, hi]. */
+double range_mse(const Buckets &buckets, float lo, float hi, int64_t levels) {
+    const double step = (levels > 1) ? (double(hi) - lo) / (levels - 1) : 0.0;
+    const double quant_err = step * step / 12.0;
+    double err = 0.0;
+    for (const auto &[value, count] : buckets) {
+        if (value < lo) {
+            err += count * std::pow(double(lo) - value, 2);
+        } else if (value > hi) {
+            err += count * std::pow(double(value) - hi, 2);
+        } else {
+            err += count * quant_err;
+        }
+    }
+    return err;
+}
+
+/** KL divergence between the clipped distribution (outliers folded into the
+ * edge bins) and its quantized version with the given number of levels.
+ * hist is a fine histogram of the currents starting at hist_min. */
+double range_kl(const std::vector<double> &hist, float hist_min,
+                float bin_width, float lo, float hi, int64_t levels) {
+    const int64_t num_bins = hist.size();
+    const int64_t first = std::clamp<int64_t>(
+        std::floor((lo - hist_min) / bin_width), 0, num_bins - 1);
+    const int64_t last = std::clamp<int64_t>(
+        std::ceil((hi - hist_min) / bin_width), first + 1, num_bins);
+    const int64_t width = last - first;
+
+    std::vector<double> p(hist.begin() + first, hist.begin() + last);
+    p.front() += std::accumulate(hist.begin(), hist.begin() + first, 0.0);
+    p.back() += std::accumulate(hist.begin() + last, hist.end(), 0.0);
+
+    // Merge the (unclipped) bins into the quantization levels and spread
+    // each level uniformly over its non-empty bins
+    std::vector<double> q(width, 0.0);
+    const int64_t num_levels = std::min(levels, width);
+    for (int64_t l = 0; l < num_levels; ++l) {
+        const int64_t begin = l * width / num_levels;
+        const int64_t end = (l + 1) * width / num_levels;
+        double sum = 0.0;
+        int64_t non_empty = 0;
+        for (int64_t b = begin; b < end; ++b) {
+            sum += hist[first + b];
+            non_empty += (hist[first + b] > 0);
+        }
+        for (int64_t b = begin; b < end; ++b) {
+            if (hist[first + b] > 0) {
+                q[b] = sum / non_empty;
+            }
+        }
+    }
+
+    const double p_sum = std::accumulate(p.begin(), p.end(), 0.0);
+    const double q_sum = std::accumulate(q.begin(), q.end(), 0.0);
+    // Edge bins can be non-empty in p only (folded outliers)
+    const double eps = 1e-4 / width;
+    double kl = 0.0;
+    for (int64_t b = 0; b < width; ++b) {
+        if (p[b] > 0) {
+            const double p_b = p[b] / p_sum;
+            const double q_b = std::max(q_sum > 0 ? q[b] / q_sum : 0.0, eps);
+            kl += p_b * std::log(p_b / q_b);
+        }
+    }
+    return kl;
+}
+
+} // namespace
+
+ADCCalibration::ADCCalibration() : active_(false), generation_(0) {}
+
+ADCCalibration &ADCCalibration::get_instance() {
+    static ADCCalibration instance;
+    return instance;
+}
+
+void ADCCalibration::begin() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    hists_.clear();
+    generation_++;
+    active_ = true;
+}
+
+bool ADCCalibration::is_active() const { return active_; }
+
+uint64_t ADCCalibration::get_generation() const { return generation_; }
+
+StreamingHistogram &ADCCalibration::get_or_add_histogram(uint32_t layer_id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (layer_id >= hists_.size()) {
+        hists_.resize(layer_id + 1);
+    }
+    if (!hists_[layer_id]) {
+        hists_[layer_id] = std::make_unique<StreamingHistogram>();
+    }
+    return *hists_[layer_id];
+}
+
+bool ADCCalibration::end(
+    ADCCalibPolicy policy, float percentile,
+    std::map<std::string, std::pair<float, float>> &calib_dict) {
+    active_ = false;
+    calib_dict.clear();
+    if (CFG.digital_only || (CFG.adc_type == ADCType::INF_ADC)) {
+        std::cerr << "ADC calibration requires SYM_RANGE_ADC or "
+                     "POS_RANGE_ONLY_ADC."
+                  << std::endl;
+        return false;
+    }
+    if ((policy == ADCCalibPolicy::PERCENTILE) &&
+        !((percentile > 0.0) && (percentile <= 100.0))) {
+        std::cerr << "ADC calibration percentile must be in (0, 100]."
+                  << std::endl;
+        return false;
+    }
+
+    // Quantization levels of ADCSigned / ADCUnsigned
+    const bool symmetric = (CFG.adc_type == ADCType::SYM_RANGE_ADC);
+    const int64_t levels = (int64_t(1) << CFG.resolution) - (symmetric ? 1 : 0);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const LayerRegistry &registry = LayerRegistry::get_instance();
+        for (uint32_t id = 0; id < hists_.size(); ++id) {
+            if (hists_[id] && (hists_[id]->get_samples() > 0)) {
+                calib_dict[registry.get_name(id)] = clip_range(
+                    *hists_[id], policy, percentile, levels, symmetric);
+            }
+        }
+    }
+    if (calib_dict.empty()) {
+        std::cerr << "No ADC conversions observed during calibration."
+                  << std::endl;
+        return false;
+    }
+
+    CFG.set_adc_calib_dict(calib_dict);
+    return true;
+}
+
+std::pair<float, float> ADCCalibration::clip_range(StreamingHistogram &hist,
+                                                   ADCCalibPolicy policy,
+                                                   float percentile,
+                                                   int64_t levels,
+                                                   bool symmetric) {
+    std::vector<double> tails;
+    if (policy == ADCCalibPolicy::PERCENTILE) {
+        tails.push_back(1.0 - percentile / 100.0);
+    } else {
+        tails = candidate_tails();
+    }
+
+    // Candidate ranges between the lower and upper tail quantiles
+    std::vector<double> qs;
+    for (double tail : tails) {
+        qs.push_back(tail);
+        qs.push_back(1.0 - tail);
+    }
+    std::vector<float> quantiles = hist.get_quantiles(qs);
+    std::vector<std::pair<float, float>> ranges;
+    for (size_t t = 0; t < tails.size(); ++t) {
+        float lo = quantiles[2 * t];
+        float hi = quantiles[2 * t + 1];
+        if (symmetric) {
+            hi = std::max(std::fabs(lo), std::fabs(hi));
+            lo = -hi;
+        }
+        // The ADC needs a range of non-zero width
+        if (!(hi > lo)) {
+            lo = std::min(lo, 0.0f);
+            hi = std::max(hi, 0.0f);
+            if (hi == lo) {
+                hi = lo + 1.0;
+            }
+        }
+        ranges.emplace_back(lo, hi);
+    }
+    if (policy == ADCCalibPolicy::PERCENTILE) {
+        return ranges[0];
+    }
+
+    // Candidates are ordered from the widest to the narrowest range, ties
+    // keep the wider range
+    Buckets buckets = hist.get_buckets();
+    std::vector<double> errors;
+    if (policy == ADCCalibPolicy::MSE) {
+        for (const auto &[lo, hi] : ranges) {
+            errors.push_back(range_mse(buckets, lo, hi, levels));
+        }
+    } else {
+        // Fine histogram over the widest candidate range
+        const float hist_min = ranges[0].first;
+        const float bin_width = (ranges[0].second - hist_min) / kl_bins;
+        std::vector<double> fine_hist(kl_bins, 0.0);
+        for (const auto &[value, count] : buckets) {
+            int64_t b = std::clamp<int64_t>((value - hist_min) / bin_width, 0,
+                                            kl_bins - 1);
+            fine_hist[b] += count;
+        }
+        for (const auto &[lo, hi] : ranges) {
+            errors.push_back(
+                range_kl(fine_hist, hist_min, bin_width, lo, hi, levels));
+        }
+    }
+    size_t best = std::min_element(errors.begin(), errors.end()) -
+                  errors.begin();
+    return ranges[best];
+}
+
+} // namespace nq
@@ -7,52 +7,64 @@
  ******************************************************************************/
 #include "xbar/crossbar.h"
 #include "helper/config.h"
+#include "helper/profiler.h"
 
+#include <algorithm>
 #include <iostream>
 
 namespace nq {
 
-Crossbar::Crossbar() :
+Crossbar::Crossbar(uint64_t rng_stream) :
     mapper_(Mapper::create_from_config()),
     write_xbar_counter_(0),
     mvm_counter_(0),
     rd_model_(nullptr),
     consecutive_mvm_counter_(0),
     refresh_xbar_counter_(0),
-    refresh_cell_counter_(0) {
+    refresh_cell_counter_(0),
+    m_written_(0),
+    n_written_(0),
+    applied_layer_(CFG.get_active_layer()) {
+    mapper_->set_rng_stream(rng_stream);
     if (CFG.read_disturb) {
-        rd_model_ = std::make_shared<ReadDisturb>(CFG.V_read);
+        rd_model_ = std::make_shared<ReadDisturb>(CFG.V_read,
+                                                 mapper_->has_m_array());
     }
 }
 
 void Crossbar::write(const int32_t *mat, int32_t m_matrix, int32_t n_matrix) {
+    ACS_PROFILE_SCOPE(WRITE);
     write_xbar_counter_++;
+    m_written_ = m_matrix;
+    n_written_ = n_matrix;
     consecutive_mvm_counter_ = 0;
     if (CFG.read_disturb) {
+        const bool has_m_array = mapper_->has_m_array();
         std::vector<std::vector<bool>> update_p(
             CFG.M * CFG.SPLIT.size(), std::vector<bool>(CFG.N, false));
         std::vector<std::vector<bool>> update_m(
-            CFG.M * CFG.SPLIT.size(), std::vector<bool>(CFG.N, false));
+            has_m_array ? CFG.M * CFG.SPLIT.size() : 0,
+            std::vector<bool>(CFG.N, false));
 
         // Copy gd_p and gd_m before changing them
-        const std::vector<std::vector<int32_t>> prev_gd_p = mapper_->get_gd_p();
-        const std::vector<std::vector<int32_t>> prev_gd_m = mapper_->get_gd_m();
+        const Matrix<uint8_t> prev_gd_p = mapper_->get_gd_p();
+        const Matrix<uint8_t> prev_gd_m = mapper_->get_gd_m();
 
         mapper_->d_write(mat, m_matrix, n_matrix);
 
         // Get the current gd_p and gd_m after writing
-        const std::vector<std::vector<int32_t>> &curr_gd_p =
-            mapper_->get_gd_p();
-        const std::vector<std::vector<int32_t>> &curr_gd_m =
-            mapper_->get_gd_m();
+        const Matrix<uint8_t> &curr_gd_p = mapper_->get_gd_p();
+        const Matrix<uint8_t> &curr_gd_m = mapper_->get_gd_m();
 
         // Compare the previous and current gd_p and gd_m to find updates
+        // A programmed cell is reset whenever its level changes
         for (size_t i = 0; i < update_p.size(); i++) {
             for (size_t j = 0; j < update_p[i].size(); j++) {
-                if (prev_gd_p[i][j] == 1 && curr_gd_p[i][j] == 0) {
+                if (prev_gd_p[i][j] > 0 && curr_gd_p[i][j] != prev_gd_p[i][j]) {
                     update_p[i][j] = true;
                 }
-                if (prev_gd_m[i][j] == 1 && curr_gd_m[i][j] == 0) {
+                if (has_m_array && prev_gd_m[i][j] > 0 &&
+                    curr_gd_m[i][j] != prev_gd_m[i][j]) {
                     update_m[i][j] = true;
                 }
             }
@@ -69,22 +81,33 @@ void Crossbar::write(const int32_t *mat, int32_t m_matrix, int32_t n_matrix) {
         mapper_->d_write(mat, m_matrix, n_matrix);
     }
     if (!CFG.digital_only) {
+        mapper_->new_d2d_draw();
         mapper_->a_write(m_matrix, n_matrix);
     }
 }
 
 void Crossbar::mvm(int32_t *res, const int32_t *vec, const int32_t *mat,
-                   int32_t m_matrix, int32_t n_matrix, const char *l_name) {
+                   int32_t m_matrix, int32_t n_matrix, uint32_t layer_id,
+                   const OutputRange *out_range) {
+    ACS_PROFILE_LAYER(layer_id);
+    ACS_PROFILE_SCOPE(MVM);
     mvm_counter_++;
     consecutive_mvm_counter_++;
     if (CFG.digital_only) {
-        mapper_->d_mvm(res, vec, mat, m_matrix, n_matrix);
+        if (!mapper_->d_mvm_packed(res, vec, mat, m_matrix, n_matrix)) {
+            mapper_->d_mvm(res, vec, mat, m_matrix, n_matrix);
+        }
     } else {
-        if (CFG.c2c_var) {
+        // The column_aggregate model adds its noise inside a_mvm
+        const bool c2c_per_cell =
+            CFG.c2c_var && (CFG.c2c_model == C2CModel::PER_CELL);
+        if (c2c_per_cell) {
             mapper_->a_add_c2c_var(m_matrix, n_matrix);
         }
-        mapper_->a_mvm(res, vec, mat, m_matrix, n_matrix, l_name);
-        if (CFG.c2c_var) {
+        mapper_->set_output_range(out_range);
+        mapper_->a_mvm(res, vec, mat, m_matrix, n_matrix, layer_id);
+        mapper_->set_output_range(nullptr);
+        if (c2c_per_cell) {
             mapper_->a_remove_c2c_var(m_matrix, n_matrix);
         }
 
@@ -112,32 +135,32 @@ void Crossbar::mvm(int32_t *res, const int32_t *vec, const int32_t *mat,
                         write_xbar_counter_ + refresh_xbar_counter_);
 
                     if (refresh_needed) {
+                        ACS_PROFILE_SCOPE(REFRESH);
                         refresh_xbar_counter_++;
 
-                        // Increase the set-reset cycle for every LRS cell since
-                        // all LRS cells are reprogrammed by resetting and
-                        // setting again
+                        // Increase the set-reset cycle for every programmed
+                        // cell since all programmed cells are reprogrammed by
+                        // resetting and setting again
                         std::vector<std::vector<bool>> update_p(
                             CFG.M * CFG.SPLIT.size(),
                             std::vector<bool>(CFG.N, false));
                         std::vector<std::vector<bool>> update_m(
-                            CFG.M * CFG.SPLIT.size(),
+                            mapper_->has_m_array() ? CFG.M * CFG.SPLIT.size()
+                                                   : 0,
                             std::vector<bool>(CFG.N, false));
 
                         // Get the current gd_p and gd_m
-                        const std::vector<std::vector<int32_t>> &curr_gd_p =
-                            mapper_->get_gd_p();
-                        const std::vector<std::vector<int32_t>> &curr_gd_m =
-                            mapper_->get_gd_m();
+                        const Matrix<uint8_t> &curr_gd_p = mapper_->get_gd_p();
+                        const Matrix<uint8_t> &curr_gd_m = mapper_->get_gd_m();
 
                         for (size_t i = 0; i < update_p.size(); i++) {
                             for (size_t j = 0; j < update_p[i].size(); j++) {
-                                if (curr_gd_p[i][j] == 1) {
+                                if (curr_gd_p[i][j] > 0) {
                                     update_p[i][j] = true;
                                     refresh_cell_counter_++;
                                 }
                                 if (mapper_->is_diff_weight_mapping()) {
-                                    if (curr_gd_m[i][j] == 1) {
+                                    if (curr_gd_m[i][j] > 0) {
                                         update_m[i][j] = true;
                                         refresh_cell_counter_++;
                                     }
@@ -160,7 +183,10 @@ void Crossbar::mvm(int32_t *res, const int32_t *vec, const int32_t *mat,
             case ReadDisturbMitigationStrategy::CELL_BASED:
                 // Cell-based refresh
                 // Update consecutive reads first
-                rd_model_->update_consecutive_reads(m_matrix, n_matrix);
+                {
+                    ACS_PROFILE_SCOPE(READ_DISTURB);
+                    rd_model_->update_consecutive_reads(m_matrix, n_matrix);
+                }
 
                 if (consecutive_mvm_counter_ % CFG.read_disturb_update_freq ==
                     0) {
@@ -183,6 +209,80 @@ void Crossbar::mvm(int32_t *res, const int32_t *vec, const int32_t *mat,
             }
         }
     }
+
+    // Decided rows hold a partial result outside the output range
+    if (out_range != nullptr) {
+        for (size_t m = 0; m < m_matrix; ++m) {
+            res[m] = std::clamp(res[m], out_range->min, out_range->max);
+        }
+    }
+}
+
+void Crossbar::reconfigure(const std::vector<std::string> &changed_keys) {
+    // The update returns to the base parameters
+    layer_changed_keys_ = changed_keys;
+    CFG.reset_layer(applied_layer_, layer_changed_keys_);
+    apply_changed_keys(layer_changed_keys_);
+}
+
+void Crossbar::apply_changed_keys(
+    const std::vector<std::string> &changed_keys) {
+    auto changed = [&changed_keys](std::initializer_list<const char *> keys) {
+        return std::any_of(keys.begin(), keys.end(), [&](const char *key) {
+            return std::find(changed_keys.begin(), changed_keys.end(), key) !=
+                   changed_keys.end();
+        });
+    };
+
+    if (changed({"adc_type", "resolution"})) {
+        mapper_->reset_adc();
+    }
+    if (CFG.digital_only) {
+        return;
+    }
+
+    // Cell currents, state noise, and nominal read disturb levels. The
+    // rewrite re-applies the device-to-device draw of the last write, so a
+    // switch between layer profiles and back gives the same currents.
+    bool rewrite = false;
+    if (changed({"HRS", "LRS", "HRS_NOISE", "LRS_NOISE", "read_disturb",
+                 "d2d_var", "rng_seed"})) {
+        mapper_->update_analog_params();
+        rewrite = true;
+    }
+    if (changed({"parasitics", "w_res", "V_read"})) {
+        mapper_->reset_par_solver();
+        rewrite = true;
+    }
+
+    // Read disturb model, the per-cell counters are kept
+    if (!CFG.read_disturb) {
+        rd_model_ = nullptr;
+    } else if (!rd_model_ ||
+               changed({"V_read", "read_disturb_level_scaling"})) {
+        auto rd_model = std::make_shared<ReadDisturb>(
+            CFG.V_read, mapper_->has_m_array());
+        if (rd_model_) {
+            rd_model->copy_cell_state(*rd_model_);
+        }
+        rd_model_ = rd_model;
+    }
+
+    // Reprogram the stored weights (resets read disturb degradation)
+    if (rewrite && (m_written_ > 0)) {
+        mapper_->a_write(m_written_, n_written_);
+    }
+}
+
+void Crossbar::select_layer(uint32_t layer_id) {
+    if (CFG.select_layer(layer_id, applied_layer_, layer_changed_keys_)) {
+        apply_changed_keys(layer_changed_keys_);
+    }
+}
+
+bool Crossbar::layer_selected(uint32_t layer_id) const {
+    return CFG.same_profile(CFG.get_active_layer(), layer_id) &&
+           CFG.same_profile(applied_layer_, layer_id);
 }
 
 Crossbar::~Crossbar() {
@@ -247,23 +347,23 @@ Crossbar::~Crossbar() {
     }
 }
 
-const std::vector<std::vector<int32_t>> &Crossbar::get_gd_p() const {
+const Matrix<uint8_t> &Crossbar::get_gd_p() const {
     return mapper_->get_gd_p();
 }
 
-const std::vector<std::vector<int32_t>> &Crossbar::get_gd_m() const {
+const Matrix<uint8_t> &Crossbar::get_gd_m() const {
     return mapper_->get_gd_m();
 }
 
-const std::vector<std::vector<float>> &Crossbar::get_ia_p() const {
+const Matrix<float> &Crossbar::get_ia_p() const {
     return mapper_->get_ia_p();
 }
 
-const std::vector<std::vector<float>> &Crossbar::get_ia_m() const {
+const Matrix<float> &Crossbar::get_ia_m() const {
     return mapper_->get_ia_m();
 }
 
-const std::vector<std::vector<uint64_t>> &Crossbar::get_cycles_p() const {
+const Matrix<uint64_t> &Crossbar::get_cycles_p() const {
     if (!rd_model_) {
         std::cerr << "Read disturb is disabled; " << __func__
                   << " returns empty/default values." << std::endl;
@@ -272,7 +372,7 @@ const std::vector<std::vector<uint64_t>> &Crossbar::get_cycles_p() const {
     return rd_model_->get_cycles_p();
 }
 
-const std::vector<std::vector<uint64_t>> &Crossbar::get_cycles_m() const {
+const Matrix<uint64_t> &Crossbar::get_cycles_m() const {
     if (!rd_model_) {
         std::cerr << "Read disturb is disabled; " << __func__
                   << " returns empty/default values." << std::endl;
@@ -281,8 +381,7 @@ const std::vector<std::vector<uint64_t>> &Crossbar::get_cycles_m() const {
     return rd_model_->get_cycles_m();
 }
 
-const std::vector<std::vector<uint64_t>> &
-Crossbar::get_consecutive_reads_p() const {
+const Matrix<uint64_t> &Crossbar::get_consecutive_reads_p() const {
     if (!rd_model_) {
         std::cerr << "Read disturb is disabled; " << __func__
                   << " returns empty/default values." << std::endl;
@@ -291,8 +390,7 @@ Crossbar::get_consecutive_reads_p() const {
     return rd_model_->get_consecutive_reads_p();
 }
 
-const std::vector<std::vector<uint64_t>> &
-Crossbar::get_consecutive_reads_m() const {
+const Matrix<uint64_t> &Crossbar::get_consecutive_reads_m() const {
     if (!rd_model_) {
         std::cerr << "Read disturb is disabled; " << __func__
                   << " returns empty/default values." << std::endl;
@@ -301,6 +399,10 @@ Crossbar::get_consecutive_reads_m() const {
     return rd_model_->get_consecutive_reads_m();
 }
 
+std::shared_ptr<const ReadDisturb> Crossbar::get_rd_model() const {
+    return rd_model_;
+}
+
 uint64_t Crossbar::get_write_xbar_counter() const {
     return write_xbar_counter_;
 }
@@ -326,4 +428,80 @@ bool Crossbar::get_rd_run_out_of_bounds() const {
     return rd_model_->get_run_out_of_bounds();
 }
 
+// Configuration that determines the shape of the stored state
+static std::vector<uint64_t> snapshot_config() {
+    return {static_cast<uint64_t>(CFG.m_mode),
+            CFG.M,
+            CFG.N,
+            CFG.SPLIT.size(),
+            CFG.digital_only,
+            CFG.read_disturb,
+            static_cast<uint64_t>(CFG.conductance_precision)};
+}
+
+bool Crossbar::save_state(const char *path) const {
+    const std::vector<uint64_t> config = snapshot_config();
+    const std::vector<uint64_t> counters = {
+        write_xbar_counter_,
+        mvm_counter_,
+        consecutive_mvm_counter_,
+        refresh_xbar_counter_,
+        refresh_cell_counter_,
+        static_cast<uint64_t>(m_written_),
+        static_cast<uint64_t>(n_written_)};
+
+    SnapshotWriter writer;
+    writer.add(SnapshotSection::XBAR_CONFIG, config);
+    writer.add(SnapshotSection::XBAR_COUNTERS, counters);
+    mapper_->save_state(writer);
+    if (rd_model_) {
+        rd_model_->save_state(writer);
+    }
+    return writer.write(path);
+}
+
+bool Crossbar::load_state(const char *path) {
+    SnapshotReader reader;
+    if (!reader.open(path)) {
+        return false;
+    }
+    std::vector<uint64_t> config(snapshot_config().size());
+    if (!reader.read(SnapshotSection::XBAR_CONFIG, config)) {
+        return false;
+    }
+    if (config != snapshot_config()) {
+        std::cerr << "Snapshot " << path
+                  << " was created with a different crossbar configuration."
+                  << std::endl;
+        return false;
+    }
+    // Validate all sections before any state is overwritten
+    std::vector<uint64_t> counters(7);
+    if (!reader.read(SnapshotSection::XBAR_COUNTERS, counters) ||
+        !mapper_->check_state(reader) ||
+        (rd_model_ && !rd_model_->check_state(reader))) {
+        return false;
+    }
+    // Dimensions of the last write (rewrites, exact path, packed weights)
+    if ((counters[5] > CFG.M) || (counters[6] > CFG.N)) {
+        std::cerr << "Snapshot " << path << " has an invalid written region ("
+                  << counters[5] << " x " << counters[6] << ")." << std::endl;
+        return false;
+    }
+    const int32_t m_written = static_cast<int32_t>(counters[5]);
+    const int32_t n_written = static_cast<int32_t>(counters[6]);
+    if (!mapper_->load_state(reader, m_written, n_written) ||
+        (rd_model_ && !rd_model_->load_state(reader))) {
+        return false;
+    }
+    write_xbar_counter_ = counters[0];
+    mvm_counter_ = counters[1];
+    consecutive_mvm_counter_ = counters[2];
+    refresh_xbar_counter_ = counters[3];
+    refresh_cell_counter_ = counters[4];
+    m_written_ = m_written;
+    n_written_ = n_written;
+    return true;
+}
+
 } // namespace nq
@@ -0,0 +1,116 @@
+/******************************************************************************
+ * Copyright (C) 2025 Rebecca Pelke                                           *
+ * All Rights Reserved                                                        *
+ *                                                                            *
+ * This work is licensed under the terms described in the LICENSE file        *
+ * found in the root directory of this source tree.                           *
+ ******************************************************************************/
+#include "xbar/layer_engine.h"
+#include "helper/config.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "oneapi/tbb/parallel_for.h"
+
+namespace nq {
+
+void LayerEngine::write(const int32_t *mat, int32_t m_matrix,
+                        int32_t n_matrix) {
+    if ((m_matrix <= 0) || (n_matrix <= 0)) {
+        std::cerr << "LayerEngine: invalid matrix dimensions " << m_matrix
+                  << "x" << n_matrix << "." << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+    mat_.assign(mat, mat + size_t(m_matrix) * n_matrix);
+    m_matrix_ = m_matrix;
+    n_matrix_ = n_matrix;
+    retile();
+}
+
+void LayerEngine::retile() {
+    tiles_.clear();
+    if (mat_.empty()) {
+        grid_rows_ = 0;
+        grid_cols_ = 0;
+        return;
+    }
+    const int32_t xbar_m = CFG.M;
+    const int32_t xbar_n = CFG.N;
+    grid_rows_ = (m_matrix_ + xbar_m - 1) / xbar_m;
+    grid_cols_ = (n_matrix_ + xbar_n - 1) / xbar_n;
+    tiles_.resize(grid_rows_ * grid_cols_);
+
+    for (size_t r = 0; r < grid_rows_; ++r) {
+        for (size_t c = 0; c < grid_cols_; ++c) {
+            Tile &tile = tiles_[r * grid_cols_ + c];
+            tile.m_offset = r * xbar_m;
+            tile.n_offset = c * xbar_n;
+            tile.m_tile = std::min(xbar_m, m_matrix_ - tile.m_offset);
+            tile.n_tile = std::min(xbar_n, n_matrix_ - tile.n_offset);
+            tile.mat.resize(size_t(tile.m_tile) * tile.n_tile);
+            for (int32_t m = 0; m < tile.m_tile; ++m) {
+                const int32_t *row =
+                    &mat_[size_t(tile.m_offset + m) * n_matrix_ +
+                          tile.n_offset];
+                std::copy(row, row + tile.n_tile,
+                          tile.mat.begin() + size_t(m) * tile.n_tile);
+            }
+            tile.res.resize(tile.m_tile);
+            tile.crossbar = std::make_unique<Crossbar>(
+                rng_stream_base + r * grid_cols_ + c);
+            tile.crossbar->write(tile.mat.data(), tile.m_tile, tile.n_tile);
+        }
+    }
+}
+
+void LayerEngine::mvm(int32_t *res, const int32_t *vec, uint32_t layer_id) {
+    tbb::parallel_for(size_t(0), tiles_.size(), [&](size_t t) {
+        Tile &tile = tiles_[t];
+        std::fill(tile.res.begin(), tile.res.end(), 0);
+        tile.crossbar->mvm(tile.res.data(), vec + tile.n_offset,
+                           tile.mat.data(), tile.m_tile, tile.n_tile,
+                           layer_id);
+    });
+
+    // Partial sums in grid order
+    for (const Tile &tile : tiles_) {
+        for (int32_t m = 0; m < tile.m_tile; ++m) {
+            res[tile.m_offset + m] += tile.res[m];
+        }
+    }
+}
+
+void LayerEngine::reconfigure(const std::vector<std::string> &changed_keys) {
+    for (Tile &tile : tiles_) {
+        tile.crossbar->reconfigure(changed_keys);
+    }
+}
+
+void LayerEngine::select_layer(uint32_t layer_id) {
+    // Also without crossbars (a write follows), every crossbar applies the
+    // keys of its own last profile
+    CFG.activate_layer(layer_id);
+    for (Tile &tile : tiles_) {
+        tile.crossbar->select_layer(layer_id);
+    }
+}
+
+bool LayerEngine::layer_selected(uint32_t layer_id) const {
+    return CFG.same_profile(CFG.get_active_layer(), layer_id) &&
+           std::all_of(tiles_.begin(), tiles_.end(), [&](const Tile &tile) {
+               return tile.crossbar->layer_selected(layer_id);
+           });
+}
+
+const Crossbar &LayerEngine::get_tile(size_t r, size_t c) const {
+    if ((r >= grid_rows_) || (c >= grid_cols_)) {
+        std::cerr << "LayerEngine: tile (" << r << ", " << c
+                  << ") is outside of the " << grid_rows_ << "x"
+                  << grid_cols_ << " grid." << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+    return *tiles_[r * grid_cols_ + c].crossbar;
+}
+
+} // namespace nq
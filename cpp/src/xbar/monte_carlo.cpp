@@ -0,0 +1,158 @@
+/******************************************************************************
+ * Copyright (C) 2025 Rebecca Pelke                                           *
+ * All Rights Reserved                                                        *
+ *                                                                            *
+ * This work is licensed under the terms described in the LICENSE file        *
+ * found in the root directory of this source tree.                           *
+ ******************************************************************************/
+#include "xbar/monte_carlo.h"
+#include "helper/config.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "oneapi/tbb/parallel_for.h"
+
+namespace nq {
+
+bool MonteCarlo::check_config(int32_t m_matrix, int32_t n_matrix) {
+    if ((m_matrix <= 0) || (n_matrix <= 0) ||
+        (static_cast<uint32_t>(m_matrix) > CFG.M) ||
+        (static_cast<uint32_t>(n_matrix) > CFG.N)) {
+        std::cerr << "MonteCarlo: the matrix (" << m_matrix << "x" << n_matrix
+                  << ") does not fit the crossbar (" << CFG.M << "x" << CFG.N
+                  << ")." << std::endl;
+        return false;
+    }
+    // INT mappings and digital crossbars are programmed without state
+    // noise, all instances would be identical
+    if (CFG.digital_only || CFG.is_int_mapping(CFG.m_mode)) {
+        std::cerr << "MonteCarlo: the mapping draws no device-to-device "
+                     "variability (BNN/TNN mappings only)."
+                  << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool MonteCarlo::write(const int32_t *mat, int32_t m_matrix, int32_t n_matrix,
+                       int32_t num_instances) {
+    if (num_instances <= 0) {
+        std::cerr << "MonteCarlo: invalid number of instances "
+                  << num_instances << "." << std::endl;
+        return false;
+    }
+    if (!check_config(m_matrix, n_matrix)) {
+        return false;
+    }
+    mat_.assign(mat, mat + size_t(m_matrix) * n_matrix);
+    m_matrix_ = m_matrix;
+    n_matrix_ = n_matrix;
+    instances_.resize(num_instances);
+    return rewrite();
+}
+
+bool MonteCarlo::rewrite() {
+    if (!check_config(m_matrix_, n_matrix_)) {
+        return false;
+    }
+    tbb::parallel_for(size_t(0), instances_.size(), [&](size_t k) {
+        instances_[k] = std::make_unique<Crossbar>(rng_stream_base + k);
+        instances_[k]->write(mat_.data(), m_matrix_, n_matrix_);
+    });
+    return true;
+}
+
+void MonteCarlo::mvm(int32_t *out, const int32_t *vec, int32_t batch,
+                     MonteCarloStats &stats, uint32_t layer_id) {
+    const size_t num_instances = instances_.size();
+    const size_t outputs = size_t(batch) * m_matrix_;
+
+    // Digital reference
+    stats.digital.assign(outputs, 0);
+    for (int32_t b = 0; b < batch; ++b) {
+        const int32_t *vec_row = vec + size_t(b) * n_matrix_;
+        for (int32_t m = 0; m < m_matrix_; ++m) {
+            const int32_t *mat_row = &mat_[size_t(m) * n_matrix_];
+            int64_t acc = 0;
+            for (int32_t n = 0; n < n_matrix_; ++n) {
+                acc += int64_t(mat_row[n]) * vec_row[n];
+            }
+            stats.digital[size_t(b) * m_matrix_ + m] = acc;
+        }
+    }
+
+    // One task per instance, errors vs digital per instance
+    stats.mse.assign(num_instances, 0.0);
+    stats.mismatch.assign(num_instances, 0.0);
+    tbb::parallel_for(size_t(0), num_instances, [&](size_t k) {
+        int32_t *res = out + k * outputs;
+        for (int32_t b = 0; b < batch; ++b) {
+            int32_t *res_row = res + size_t(b) * m_matrix_;
+            std::fill(res_row, res_row + m_matrix_, 0);
+            instances_[k]->mvm(res_row, vec + size_t(b) * n_matrix_,
+                               mat_.data(), m_matrix_, n_matrix_, layer_id);
+        }
+        double sq_error = 0.0;
+        size_t mismatches = 0;
+        for (size_t o = 0; o < outputs; ++o) {
+            const double error = double(res[o]) - stats.digital[o];
+            sq_error += error * error;
+            mismatches += (res[o] != stats.digital[o]);
+        }
+        stats.mse[k] = (outputs > 0) ? sq_error / outputs : 0.0;
+        stats.mismatch[k] = (outputs > 0) ? double(mismatches) / outputs : 0.0;
+    });
+
+    // Mean and sample variance over the instances (two passes)
+    stats.mean.assign(outputs, 0.0);
+    stats.var.assign(outputs, 0.0);
+    for (size_t k = 0; k < num_instances; ++k) {
+        const int32_t *res = out + k * outputs;
+        for (size_t o = 0; o < outputs; ++o) {
+            stats.mean[o] += res[o];
+        }
+    }
+    for (double &mean : stats.mean) {
+        mean /= num_instances;
+    }
+    if (num_instances < 2) {
+        return;
+    }
+    for (size_t k = 0; k < num_instances; ++k) {
+        const int32_t *res = out + k * outputs;
+        for (size_t o = 0; o < outputs; ++o) {
+            const double diff = res[o] - stats.mean[o];
+            stats.var[o] += diff * diff;
+        }
+    }
+    for (double &var : stats.var) {
+        var /= num_instances - 1;
+    }
+}
+
+void MonteCarlo::reconfigure(const std::vector<std::string> &changed_keys) {
+    for (auto &instance : instances_) {
+        instance->reconfigure(changed_keys);
+    }
+}
+
+void MonteCarlo::select_layer(uint32_t layer_id) {
+    // Also without crossbars (a write follows), every crossbar applies the
+    // keys of its own last profile
+    CFG.activate_layer(layer_id);
+    for (auto &instance : instances_) {
+        instance->select_layer(layer_id);
+    }
+}
+
+const Crossbar &MonteCarlo::get_instance(int32_t k) const {
+    if ((k < 0) || (static_cast<size_t>(k) >= instances_.size())) {
+        std::cerr << "MonteCarlo: instance " << k << " does not exist ("
+                  << instances_.size() << " instances)." << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+    return *instances_[k];
+}
+
+} // namespace nq
@@ -12,6 +12,7 @@
 
 #include "helper/config.h"
 #include "helper/definitions.h"
+#include "helper/profiler.h"
 #include "xbar/parasitics.h"
 
 namespace nq {
@@ -35,26 +36,28 @@ ParasiticSolver::ParasiticSolver(const float wire_resistance,
     }
 }
 
-void ParasiticSolver::set_conductance_matrix(
-    std::vector<std::vector<float>> &ia, int32_t m_matrix, int32_t n_matrix) {
-    auto empty_vec = std::vector<std::vector<float>>{};
-    set_conductance_matrix(ia, empty_vec, m_matrix, n_matrix);
+void ParasiticSolver::set_conductance_matrix(const ConductanceMatrix &ia,
+                                             int32_t m_matrix,
+                                             int32_t n_matrix) {
+    auto empty_mat = ConductanceMatrix{};
+    set_conductance_matrix(ia, empty_mat, m_matrix, n_matrix);
 }
 
-void ParasiticSolver::set_conductance_matrix(
-    std::vector<std::vector<float>> &ia_p,
-    std::vector<std::vector<float>> &ia_m, int32_t m_matrix, int32_t n_matrix) {
+void ParasiticSolver::set_conductance_matrix(const ConductanceMatrix &ia_p,
+                                             const ConductanceMatrix &ia_m,
+                                             int32_t m_matrix,
+                                             int32_t n_matrix) {
 
     // Divide currents matrices with read voltage to get the actual conductance
     // values.
-    auto div_v_read = [this](std::vector<std::vector<float>> &ia,
+    auto div_v_read = [this](const ConductanceMatrix &ia,
                              std::vector<std::vector<float>> &ga) -> void {
         ga.assign(this->m_xbar_ * CFG.SPLIT.size(),
                   std::vector<float>(this->n_xbar_, CFG.HRS));
 
         for (size_t m = 0; m < m_xbar_; m++) {
             for (size_t n = 0; n < n_xbar_; n++) {
-                ga[m][n] = ia[m][n] / -(this->v_read_);
+                ga[m][n] = ia.get(m, n) / -(this->v_read_);
             }
         }
     };
@@ -84,18 +87,25 @@ void ParasiticSolver::compute_currents(std::vector<int32_t> &vd_p,
                                        std::vector<int32_t> &vd_m,
                                        std::vector<float> &res,
                                        int32_t m_matrix, int32_t n_matrix) {
+    ACS_PROFILE_SCOPE(PARASITICS);
 
     // Encode input vectors for given mapping mode
     auto vd_m_opt = !vd_m.empty() ? std::optional<std::vector<int32_t>>{vd_m}
                                   : std::optional<std::vector<int32_t>>{};
     (this->*input_enc_func_)(vd_p, vd_m_opt, vd_, n_matrix);
 
-    // Gate conductance matrix rows based on input voltage vector.
+    // Gate conductance matrix rows based on input voltage vector. A row
+    // driven with DAC level v > 1 (dac_bits) contributes v times its current.
     size_t num_cols = ga_mat_[0].size();
     ga_mat_gated_.assign(n_xbar_, std::vector<float>(num_cols, 0));
     for (size_t n = 0; n < n_xbar_; n++) {
-        if (vd_[n])
+        if (vd_[n] == 1) {
             ga_mat_gated_[n] = ga_mat_[n];
+        } else if (vd_[n]) {
+            std::transform(ga_mat_[n].begin(), ga_mat_[n].end(),
+                           ga_mat_gated_[n].begin(),
+                           [v = float(vd_[n])](float g) { return g * v; });
+        }
     }
 
     // Calculate column conductances
@@ -223,7 +233,9 @@ void ParasiticSolver::i_enc_double(std::vector<int32_t> &vd_p,
 
 void ParasiticSolver::o_enc_single(std::vector<float> &tmp_res,
                                    std::vector<float> &res, int32_t m_matrix) {
-    res.assign(m_xbar_, 0);
+    // m_matrix exceeds m_xbar_ if a mapping reads two columns per output
+    // (TNN_IV/TNN_V)
+    res.assign(std::max<size_t>(m_xbar_, m_matrix), 0);
     for (size_t m = 0; m < m_matrix; m++) {
         res[m] = tmp_res[m] * -v_read_; // Assuming negative read voltage
     }
@@ -237,4 +249,30 @@ void ParasiticSolver::o_enc_double(std::vector<float> &tmp_res,
                  -v_read_; // Assuming negative read voltage
     }
 }
+void ParasiticSolver::save_state(SnapshotWriter &writer) const {
+    writer.add(SnapshotSection::PAR_GA_MAT, ga_mat_);
+    writer.add(SnapshotSection::PAR_GA_WIRE, ga_wire_);
+}
+
+bool ParasiticSolver::check_state(const SnapshotReader &reader) const {
+    uint64_t rows, cols, wires, unused;
+    return reader.shape(SnapshotSection::PAR_GA_MAT, rows, cols) &&
+           reader.shape(SnapshotSection::PAR_GA_WIRE, unused, wires) &&
+           reader.check<float>(SnapshotSection::PAR_GA_MAT, rows, cols) &&
+           reader.check<float>(SnapshotSection::PAR_GA_WIRE, 1, wires);
+}
+
+bool ParasiticSolver::load_state(const SnapshotReader &reader) {
+    if (!check_state(reader)) {
+        return false;
+    }
+    uint64_t rows, cols, wires, unused;
+    reader.shape(SnapshotSection::PAR_GA_MAT, rows, cols);
+    reader.shape(SnapshotSection::PAR_GA_WIRE, unused, wires);
+    ga_mat_.assign(rows, std::vector<float>(cols, 0));
+    ga_wire_.assign(wires, 0);
+    return reader.read(SnapshotSection::PAR_GA_MAT, ga_mat_) &&
+           reader.read(SnapshotSection::PAR_GA_WIRE, ga_wire_);
+}
+
 } // namespace nq
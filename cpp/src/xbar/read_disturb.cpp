@@ -8,17 +8,17 @@
 #include "xbar/read_disturb.h"
 #include "helper/config.h"
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 
 namespace nq {
 
-ReadDisturb::ReadDisturb(const float V_read) :
-    cycles_p_(CFG.M * CFG.SPLIT.size(), std::vector<uint64_t>(CFG.N, 0)),
-    cycles_m_(CFG.M * CFG.SPLIT.size(), std::vector<uint64_t>(CFG.N, 0)),
-    consecutive_reads_p_(CFG.M * CFG.SPLIT.size(),
-                         std::vector<uint64_t>(CFG.N, 0)),
-    consecutive_reads_m_(CFG.M * CFG.SPLIT.size(),
-                         std::vector<uint64_t>(CFG.N, 0)),
+ReadDisturb::ReadDisturb(const float V_read, bool has_m_array) :
+    has_m_array_(has_m_array),
+    cycles_p_(CFG.M * CFG.SPLIT.size(), CFG.N, 0),
+    cycles_m_(has_m_array ? CFG.M * CFG.SPLIT.size() : 0,
+              has_m_array ? CFG.N : 0, 0),
     t0_(1.55e-8),
     fitting_param_(1.43339),
     c1_(0.0068),
@@ -31,23 +31,32 @@ ReadDisturb::ReadDisturb(const float V_read) :
     V_read_(V_read),
     exp_tt_(calc_exp_tt(V_read)),
     p_(calc_p(V_read)),
-    run_out_of_bounds_(false) {}
+    run_out_of_bounds_(false) {
+    // Power factor of each conductance level (index 0: HRS, not disturbed)
+    uint32_t max_split = *std::max_element(CFG.SPLIT.begin(), CFG.SPLIT.end());
+    size_t num_levels = CFG.is_int_mapping(CFG.m_mode) ? (1 << max_split) : 2;
+    p_levels_.assign(num_levels, p_);
+    for (size_t l = 1; l < num_levels; ++l) {
+        if (l <= CFG.read_disturb_level_scaling.size()) {
+            p_levels_[l] = p_ * CFG.read_disturb_level_scaling[l - 1];
+        }
+    }
+    extend_tt_table(0);
+}
 
-const std::vector<std::vector<uint64_t>> &ReadDisturb::get_cycles_p() const {
+const Matrix<uint64_t> &ReadDisturb::get_cycles_p() const {
     return cycles_p_;
 }
 
-const std::vector<std::vector<uint64_t>> &ReadDisturb::get_cycles_m() const {
+const Matrix<uint64_t> &ReadDisturb::get_cycles_m() const {
     return cycles_m_;
 }
 
-const std::vector<std::vector<uint64_t>> &
-ReadDisturb::get_consecutive_reads_p() const {
+const Matrix<uint64_t> &ReadDisturb::get_consecutive_reads_p() const {
     return consecutive_reads_p_;
 }
 
-const std::vector<std::vector<uint64_t>> &
-ReadDisturb::get_consecutive_reads_m() const {
+const Matrix<uint64_t> &ReadDisturb::get_consecutive_reads_m() const {
     return consecutive_reads_m_;
 }
 
@@ -55,22 +64,73 @@ ReadDisturb::get_consecutive_reads_m() const {
 void ReadDisturb::update_cycles(
     const std::vector<std::vector<bool>> &update_p,
     const std::vector<std::vector<bool>> &update_m) {
-    for (size_t i = 0; i < cycles_p_.size(); ++i) {
-        for (size_t j = 0; j < cycles_p_[i].size(); ++j) {
+    for (size_t i = 0; i < cycles_p_.rows(); ++i) {
+        for (size_t j = 0; j < cycles_p_.cols(); ++j) {
             cycles_p_[i][j] += update_p[i][j];
-            cycles_m_[i][j] += update_m[i][j];
+            uint64_t cycles = cycles_p_[i][j];
+            if (has_m_array_) {
+                cycles_m_[i][j] += update_m[i][j];
+                cycles = std::max(cycles, cycles_m_[i][j]);
+            }
+            extend_tt_table(cycles);
         }
     }
 }
 
+uint64_t ReadDisturb::max_cycles() const {
+    uint64_t max_cycles = 0;
+    for (const Matrix<uint64_t> *cycles : {&cycles_p_, &cycles_m_}) {
+        if (!cycles->empty()) {
+            max_cycles = std::max(
+                max_cycles,
+                *std::max_element(cycles->data(),
+                                  cycles->data() + cycles->size()));
+        }
+    }
+    return max_cycles;
+}
+
+void ReadDisturb::alloc_consecutive_reads() {
+    consecutive_reads_p_.assign(CFG.M * CFG.SPLIT.size(), CFG.N, 0);
+    if (has_m_array_) {
+        consecutive_reads_m_.assign(CFG.M * CFG.SPLIT.size(), CFG.N, 0);
+    }
+}
+
+// Scaling factor of a cell's conductance on the given conductance level
+// (1 is the LRS of binary cells).
 float ReadDisturb::calc_G0_scaling_factor(const uint64_t read_num,
-                                          const uint64_t N_cycles) const {
-    float tt = calc_transition_time(N_cycles);
+                                          const uint64_t N_cycles,
+                                          const uint32_t level) const {
+    float tt = lookup_transition_time(N_cycles);
     float t_stress = read_num * CFG.t_read;
     if (t_stress < tt) {
         return 1.0f;
     } else {
-        return std::pow((t_stress / tt), -p_);
+        return std::pow((t_stress / tt), -p_levels_[level]);
+    }
+}
+
+// Transition times are tabulated for all cycle counts that occur in the
+// crossbar (up to a limit). The table is only extended by the non-const
+// cycle updates, so lookups are safe from multiple threads.
+float ReadDisturb::lookup_transition_time(const uint64_t N_cycles) const {
+    if (N_cycles < tt_table_.size()) {
+        return tt_table_[N_cycles];
+    }
+    return calc_transition_time(N_cycles);
+}
+
+void ReadDisturb::extend_tt_table(const uint64_t N_cycles) {
+    constexpr uint64_t max_table_size = 1 << 16;
+    if (N_cycles < tt_table_.size() || N_cycles >= max_table_size) {
+        return;
+    }
+    size_t new_size = std::min<uint64_t>(
+        std::max<uint64_t>(N_cycles + 1, 2 * tt_table_.size()),
+        max_table_size);
+    for (size_t c = tt_table_.size(); c < new_size; ++c) {
+        tt_table_.push_back(calc_transition_time(c));
     }
 }
 
@@ -78,12 +138,12 @@ float ReadDisturb::calc_G0_scaling_factor(const uint64_t read_num,
 float ReadDisturb::calc_transition_time(const uint64_t N_cycles) const {
     double exp = k_ * std::pow(N_cycles, m_);
     if (exp >= 1.0) {
-        if (!run_out_of_bounds_) {
+        // Warn once, also if several threads run out of bounds
+        if (!run_out_of_bounds_.exchange(true)) {
             std::cerr
                 << "Warning: N_cycle too big for read disturb model. Model not "
                    "defined for N_cycles >= "
                 << N_cycles << ". ";
-            run_out_of_bounds_ = true;
         }
         return 0.0f;
     }
@@ -103,28 +163,43 @@ float ReadDisturb::calc_p(const float V_read) const {
 
 void ReadDisturb::update_cycle_p(int m, int n, uint64_t cycles) {
     cycles_p_[m][n] += cycles;
+    extend_tt_table(cycles_p_[m][n]);
 }
 
 void ReadDisturb::update_cycle_m(int m, int n, uint64_t cycles) {
     cycles_m_[m][n] += cycles;
+    extend_tt_table(cycles_m_[m][n]);
 }
 
 void ReadDisturb::update_consecutive_reads(int32_t m_matrix, int32_t n_matrix) {
+    if (consecutive_reads_p_.empty()) {
+        alloc_consecutive_reads();
+    }
     for (size_t m = 0; m < m_matrix * CFG.SPLIT.size(); ++m) {
         for (size_t n = 0; n < n_matrix; ++n) {
             consecutive_reads_p_[m][n]++;
-            consecutive_reads_m_[m][n]++;
+            if (has_m_array_) {
+                consecutive_reads_m_[m][n]++;
+            }
         }
     }
 }
 
 void ReadDisturb::reset_all_consecutive_reads() {
-    for (size_t m = 0; m < CFG.M * CFG.SPLIT.size(); ++m) {
-        for (size_t n = 0; n < CFG.N; ++n) {
-            consecutive_reads_p_[m][n] = 0;
-            consecutive_reads_m_[m][n] = 0;
-        }
+    if (consecutive_reads_p_.empty()) {
+        alloc_consecutive_reads();
     }
+    consecutive_reads_p_.fill(0);
+    consecutive_reads_m_.fill(0);
+}
+
+void ReadDisturb::copy_cell_state(const ReadDisturb &other) {
+    cycles_p_ = other.cycles_p_;
+    cycles_m_ = other.cycles_m_;
+    consecutive_reads_p_ = other.consecutive_reads_p_;
+    consecutive_reads_m_ = other.consecutive_reads_m_;
+    run_out_of_bounds_ = other.run_out_of_bounds_.load();
+    extend_tt_table(max_cycles());
 }
 
 void ReadDisturb::reset_consecutive_reads_p(int m, int n) {
@@ -137,4 +212,59 @@ void ReadDisturb::reset_consecutive_reads_m(int m, int n) {
 
 bool ReadDisturb::get_run_out_of_bounds() const { return run_out_of_bounds_; }
 
+void ReadDisturb::save_state(SnapshotWriter &writer) const {
+    writer.add(SnapshotSection::RD_CYCLES_P, cycles_p_);
+    writer.add(SnapshotSection::RD_CYCLES_M, cycles_m_);
+    writer.add(SnapshotSection::RD_CONSECUTIVE_READS_P, consecutive_reads_p_);
+    writer.add(SnapshotSection::RD_CONSECUTIVE_READS_M, consecutive_reads_m_);
+}
+
+bool ReadDisturb::check_state(const SnapshotReader &reader) const {
+    // The consecutive reads are only saved if they were allocated
+    uint64_t rows = 0;
+    uint64_t cols = 0;
+    if (!reader.shape(SnapshotSection::RD_CONSECUTIVE_READS_P, rows, cols)) {
+        return false;
+    }
+    // Shape of the consecutive reads after load_state
+    const bool consecutive = (rows * cols > 0);
+    const uint64_t reads_rows = consecutive ? CFG.M * CFG.SPLIT.size() : 0;
+    const uint64_t reads_cols = consecutive ? CFG.N : 0;
+    return reader.check<uint64_t>(SnapshotSection::RD_CYCLES_P,
+                                  cycles_p_.rows(), cycles_p_.cols()) &&
+           reader.check<uint64_t>(SnapshotSection::RD_CYCLES_M,
+                                  cycles_m_.rows(), cycles_m_.cols()) &&
+           reader.check<uint64_t>(SnapshotSection::RD_CONSECUTIVE_READS_P,
+                                  reads_rows, reads_cols) &&
+           reader.check<uint64_t>(SnapshotSection::RD_CONSECUTIVE_READS_M,
+                                  has_m_array_ ? reads_rows : 0,
+                                  has_m_array_ ? reads_cols : 0);
+}
+
+bool ReadDisturb::load_state(const SnapshotReader &reader) {
+    if (!check_state(reader)) {
+        return false;
+    }
+    uint64_t rows = 0;
+    uint64_t cols = 0;
+    reader.shape(SnapshotSection::RD_CONSECUTIVE_READS_P, rows, cols);
+    if (rows * cols == 0) {
+        consecutive_reads_p_.assign(0, 0);
+        consecutive_reads_m_.assign(0, 0);
+    } else {
+        alloc_consecutive_reads();
+    }
+
+    if (!reader.read(SnapshotSection::RD_CYCLES_P, cycles_p_) ||
+        !reader.read(SnapshotSection::RD_CYCLES_M, cycles_m_) ||
+        !reader.read(SnapshotSection::RD_CONSECUTIVE_READS_P,
+                     consecutive_reads_p_) ||
+        !reader.read(SnapshotSection::RD_CONSECUTIVE_READS_M,
+                     consecutive_reads_m_)) {
+        return false;
+    }
+    extend_tt_table(max_cycles());
+    return true;
+}
+
 } // namespace nq
@@ -0,0 +1,117 @@
+/******************************************************************************
+ * Copyright (C) 2025 Rebecca Pelke                                           *
+ * All Rights Reserved                                                        *
+ *                                                                            *
+ * This work is licensed under the terms described in the LICENSE file        *
+ * found in the root directory of this source tree.                           *
+ ******************************************************************************/
+#include <cmath>
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "helper/config.h"
+#include "helper/layer_registry.h"
+#include "inc/test_helper.h"
+#include "xbar/adc.h"
+#include "xbar/adc_calibration.h"
+
+// Normally distributed currents (sigma = 1) with a few large outliers
+std::vector<float> get_currents() {
+    std::mt19937 gen(42);
+    std::normal_distribution<float> dist(0.0, 1.0);
+    std::vector<float> currents(100000);
+    for (float &current : currents) {
+        current = dist(gen);
+    }
+    currents[0] = 100.0;
+    currents[1] = -80.0;
+    return currents;
+}
+
+std::pair<float, float> calibrate(nq::ADCCalibPolicy policy,
+                                  const std::vector<float> &currents,
+                                  float offset = 0.0) {
+    std::unique_ptr<nq::ADC> adc =
+        nq::ADCFactory::createADC(nq::Config::get_cfg().adc_type);
+    std::vector<float> out(currents.size());
+
+    nq::ADCCalibration &calib = nq::ADCCalibration::get_instance();
+    calib.begin();
+    const uint32_t fc1 = nq::LayerRegistry::get_instance().intern("fc1");
+    adc->convert(currents, out, currents.size(), 1.0, offset, fc1);
+    std::map<std::string, std::pair<float, float>> calib_dict;
+    EXPECT_TRUE(calib.end(policy, 99.9, calib_dict));
+    EXPECT_EQ(calib_dict.size(), 1);
+    return calib_dict["fc1"];
+}
+
+// Percentile ranges ignore outliers and are installed in CALIB mode
+TEST(ADCCalibrationTests, Percentile) {
+    nq::Config &cfg = nq::Config::get_cfg();
+    ASSERT_TRUE(cfg.load_cfg(get_cfg_file("analog/SYM_ADC_1.json").c_str()));
+    ASSERT_EQ(cfg.adc_calib_mode, nq::ADCCalibMode::MAX);
+
+    auto [lo, hi] = calibrate(nq::ADCCalibPolicy::PERCENTILE, get_currents());
+    // 0.1% per tail: 99.9th percentile of N(0, 1) is 3.09 (symmetric ADC)
+    EXPECT_NEAR(hi, 3.09, 0.05);
+    EXPECT_FLOAT_EQ(lo, -hi);
+    EXPECT_EQ(cfg.adc_calib_mode, nq::ADCCalibMode::CALIB);
+    EXPECT_FLOAT_EQ(cfg.adc_calib_dict["fc1"].second, hi);
+
+    // The running ADC uses the calibrated range
+    std::unique_ptr<nq::ADC> adc = nq::ADCFactory::createADC(cfg.adc_type);
+    const uint32_t fc1 = nq::LayerRegistry::get_instance().intern("fc1");
+    EXPECT_FLOAT_EQ(adc->convert(100.0, 10.0, 0.0, fc1),
+                    std::round(hi * 10));
+}
+
+// The offset of a conversion is part of the calibrated range
+TEST(ADCCalibrationTests, PositiveRangeWithOffset) {
+    nq::Config &cfg = nq::Config::get_cfg();
+    ASSERT_TRUE(cfg.load_cfg(get_cfg_file("analog/POS_ADC_1.json").c_str()));
+    std::vector<float> currents(1001);
+    for (size_t i = 0; i < currents.size(); ++i) {
+        currents[i] = i * 0.1;
+    }
+    auto [lo, hi] = calibrate(nq::ADCCalibPolicy::PERCENTILE, currents, 50.0);
+    // Up to the bucket resolution of the streaming histogram
+    EXPECT_NEAR(lo, 50.1, 0.2);
+    EXPECT_NEAR(hi, 149.9, 0.6);
+}
+
+// MSE and KL clip the tails for low resolutions and keep them for high ones
+TEST(ADCCalibrationTests, MseAndKl) {
+    nq::Config &cfg = nq::Config::get_cfg();
+    ASSERT_TRUE(cfg.load_cfg(get_cfg_file("analog/SYM_ADC_1.json").c_str()));
+    std::vector<float> currents = get_currents();
+
+    cfg.resolution = 4;
+    auto [mse_lo, mse_hi] = calibrate(nq::ADCCalibPolicy::MSE, currents);
+    EXPECT_GT(mse_hi, 1.5);
+    EXPECT_LT(mse_hi, 5.0);
+    EXPECT_FLOAT_EQ(mse_lo, -mse_hi);
+    auto [kl_lo, kl_hi] = calibrate(nq::ADCCalibPolicy::KL, currents);
+    EXPECT_GT(kl_hi, 1.5);
+    EXPECT_LT(kl_hi, 10.0);
+
+    cfg.resolution = 20;
+    auto [fine_lo, fine_hi] = calibrate(nq::ADCCalibPolicy::MSE, currents);
+    EXPECT_GT(fine_hi, mse_hi);
+}
+
+// Calibration fails without observed conversions or with an INF_ADC
+TEST(ADCCalibrationTests, Errors) {
+    nq::Config &cfg = nq::Config::get_cfg();
+    ASSERT_TRUE(cfg.load_cfg(get_cfg_file("analog/SYM_ADC_1.json").c_str()));
+    nq::ADCCalibration &calib = nq::ADCCalibration::get_instance();
+    std::map<std::string, std::pair<float, float>> calib_dict;
+    calib.begin();
+    EXPECT_FALSE(calib.end(nq::ADCCalibPolicy::MSE, 99.9, calib_dict));
+
+    cfg.adc_type = nq::ADCType::INF_ADC;
+    calib.begin();
+    EXPECT_FALSE(calib.end(nq::ADCCalibPolicy::MSE, 99.9, calib_dict));
+    EXPECT_EQ(cfg.adc_calib_mode, nq::ADCCalibMode::MAX);
+}
@@ -92,3 +92,34 @@ int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
 }
+
+// In-process calibration installs the layer range without a new crossbar
+TEST(ADCTests, InProcessCalibration) {
+    const int32_t m_matrix = 3;
+    const int32_t n_matrix = 5;
+    int32_t mat[m_matrix * n_matrix] = {-128, -128, -128, -128, -128,
+                                        127,  127,  127,  127,  127,
+                                        -12,  88,   65,   0,    -99};
+    int32_t vec[n_matrix] = {-1, -1, -1, -1, -1};
+    int32_t res[m_matrix] = {0, 0, 0};
+
+    std::string cfg = get_cfg_file("analog/SYM_ADC_1.json");
+    set_config(cfg.c_str());
+    ASSERT_EQ(cpy_mtrx(mat, m_matrix, n_matrix), 0);
+    size_t size;
+    const void *gd_p = get_gd_p(&size);
+
+    ASSERT_EQ(end_adc_calibration("unknown"), -1);
+    ASSERT_EQ(begin_adc_calibration(), 0);
+    ASSERT_EQ(exe_mvm(res, vec, mat, m_matrix, n_matrix, "fc1"), 0);
+    ASSERT_THAT(res, ::testing::ElementsAre(640, -635, -42));
+    ASSERT_EQ(end_adc_calibration("percentile", 100.0), 0);
+
+    // Same crossbar, now with the (narrower) calibrated ADC range. The layer
+    // is addressed by its registered ID.
+    ASSERT_EQ(get_gd_p(&size), gd_p);
+    std::fill(res, res + m_matrix, 0);
+    const uint32_t fc1 = register_layer("fc1");
+    ASSERT_EQ(exe_mvm_id(res, vec, mat, m_matrix, n_matrix, fc1), 0);
+    ASSERT_THAT(res, ::testing::ElementsAre(640, -635, -42));
+}
@@ -0,0 +1,92 @@
+/******************************************************************************
+ * Copyright (C) 2025 Rebecca Pelke                                           *
+ * All Rights Reserved                                                        *
+ *                                                                            *
+ * This work is licensed under the terms described in the LICENSE file        *
+ * found in the root directory of this source tree.                           *
+ ******************************************************************************/
+#include <atomic>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+#include "helper/async_executor.h"
+
+// Tasks of one strand run in submission order, never concurrently
+TEST(AsyncTests, StrandOrder) {
+    nq::AsyncExecutor executor(4);
+    const int strand_a = 0, strand_b = 0;
+    std::vector<int> order_a, order_b;
+    std::atomic<int> active_a(0);
+    bool overlap = false;
+
+    std::vector<std::shared_ptr<nq::AsyncTask>> tasks;
+    for (int i = 0; i < 200; ++i) {
+        tasks.push_back(executor.submit(&strand_a, [&, i] {
+            overlap |= (active_a.fetch_add(1) != 0);
+            order_a.push_back(i);
+            active_a--;
+            return 0;
+        }));
+        tasks.push_back(executor.submit(&strand_b, [&, i] {
+            order_b.push_back(i);
+            return i;
+        }));
+    }
+    executor.wait_all();
+
+    EXPECT_FALSE(overlap);
+    ASSERT_EQ(order_a.size(), 200u);
+    ASSERT_EQ(order_b.size(), 200u);
+    for (int i = 0; i < 200; ++i) {
+        EXPECT_EQ(order_a[i], i);
+        EXPECT_EQ(order_b[i], i);
+        EXPECT_TRUE(tasks[2 * i]->done());
+        EXPECT_EQ(tasks[2 * i + 1]->wait(), i);
+    }
+    EXPECT_EQ(executor.num_pending(), 0u);
+}
+
+// Tasks of different strands run in parallel
+TEST(AsyncTests, StrandsRunInParallel) {
+    nq::AsyncExecutor executor(2);
+    const int strand_a = 0, strand_b = 0;
+    std::atomic<bool> started_b(false);
+
+    // Task on strand a can only finish if task on strand b runs concurrently
+    auto task_a = executor.submit(&strand_a, [&] {
+        auto deadline =
+            std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (!started_b && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::yield();
+        }
+        return started_b ? 0 : -1;
+    });
+    auto task_b = executor.submit(&strand_b, [&] {
+        started_b = true;
+        return 0;
+    });
+    EXPECT_EQ(task_a->wait(), 0);
+    EXPECT_EQ(task_b->wait(), 0);
+}
+
+// Drained strands are removed, new tasks of the key get a new strand
+TEST(AsyncTests, DrainedStrandsAreRemoved) {
+    nq::AsyncExecutor executor(2);
+    std::vector<int> keys(100);
+    for (int round = 0; round < 2; ++round) {
+        std::atomic<int> sum(0);
+        for (int &key : keys) {
+            executor.submit(&key, [&] { return ++sum; });
+        }
+        executor.wait_all();
+        EXPECT_EQ(sum, 100);
+        EXPECT_EQ(executor.num_strands(), 0u);
+    }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
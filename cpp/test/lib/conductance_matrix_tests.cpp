@@ -0,0 +1,114 @@
+/******************************************************************************
+ * Copyright (C) 2025 Rebecca Pelke                                           *
+ * All Rights Reserved                                                        *
+ *                                                                            *
+ * This work is licensed under the terms described in the LICENSE file        *
+ * found in the root directory of this source tree.                           *
+ ******************************************************************************/
+#include <cmath>
+#include <cstdio>
+#include <gtest/gtest.h>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "helper/conductance_matrix.h"
+
+using nq::ConductanceMatrix;
+using nq::ConductancePrecision;
+
+// Known fp16 bit patterns, including ties (round to nearest even), the
+// largest value, overflow and subnormals
+TEST(ConductanceMatrixTests, Fp16Conversion) {
+    EXPECT_EQ(nq::float_to_fp16(1.0f), 0x3c00);
+    EXPECT_EQ(nq::float_to_fp16(-2.0f), 0xc000);
+    EXPECT_EQ(nq::float_to_fp16(0.0f), 0x0000);
+    EXPECT_EQ(nq::float_to_fp16(65504.0f), 0x7bff);
+    EXPECT_EQ(nq::float_to_fp16(65520.0f), 0x7c00);
+    EXPECT_EQ(nq::float_to_fp16(std::ldexp(1.0f, -24)), 0x0001);
+    EXPECT_EQ(nq::float_to_fp16(std::ldexp(1.0f, -26)), 0x0000);
+    EXPECT_EQ(nq::float_to_fp16(1.0f + std::ldexp(1.0f, -11)), 0x3c00);
+    EXPECT_EQ(nq::float_to_fp16(1.0f + 3 * std::ldexp(1.0f, -11)), 0x3c02);
+    EXPECT_EQ(nq::float_to_fp16(std::numeric_limits<float>::infinity()),
+              0x7c00);
+    EXPECT_TRUE(std::isnan(
+        nq::fp16_to_float(nq::float_to_fp16(std::nanf("")))));
+
+    // Every finite fp16 value converts back to itself
+    for (uint32_t bits = 0; bits < 0x10000; ++bits) {
+        if ((bits & 0x7c00) == 0x7c00) {
+            continue;
+        }
+        const uint16_t half = static_cast<uint16_t>(bits);
+        ASSERT_EQ(nq::float_to_fp16(nq::fp16_to_float(half)), half) << bits;
+    }
+}
+
+TEST(ConductanceMatrixTests, Bf16Conversion) {
+    EXPECT_EQ(nq::float_to_bf16(1.0f), 0x3f80);
+    EXPECT_EQ(nq::float_to_bf16(1.0f + std::ldexp(1.0f, -8)), 0x3f80);
+    EXPECT_EQ(nq::float_to_bf16(1.0f + 3 * std::ldexp(1.0f, -8)), 0x3f82);
+    EXPECT_EQ(nq::bf16_to_float(0xbf80), -1.0f);
+    EXPECT_TRUE(std::isnan(
+        nq::bf16_to_float(nq::float_to_bf16(std::nanf("")))));
+}
+
+// row() (F16C if available) and to_float() return the values of get()
+TEST(ConductanceMatrixTests, RowsMatchGet) {
+    std::mt19937 gen(3);
+    std::uniform_real_distribution<float> dist(-40.0f, 40.0f);
+    for (ConductancePrecision precision :
+         {ConductancePrecision::FP32, ConductancePrecision::FP16,
+          ConductancePrecision::BF16}) {
+        const size_t rows = 5;
+        const size_t cols = 37;
+        ConductanceMatrix mat(rows, cols, 0.0f, precision);
+        for (size_t r = 0; r < rows; ++r) {
+            for (size_t c = 0; c < cols; ++c) {
+                const float value = dist(gen);
+                mat.set(r, c, value);
+                EXPECT_EQ(mat.get(r, c), mat.round(value));
+                EXPECT_NEAR(mat.get(r, c), value, std::abs(value) / 128);
+            }
+        }
+        std::vector<float> buf(cols);
+        const nq::Matrix<float> &copy = mat.to_float();
+        for (size_t r = 0; r < rows; ++r) {
+            const float *row = mat.row(r, cols, buf.data());
+            for (size_t c = 0; c < cols; ++c) {
+                ASSERT_EQ(row[c], mat.get(r, c));
+                ASSERT_EQ(copy[r][c], mat.get(r, c));
+            }
+        }
+        if (precision == ConductancePrecision::FP32) {
+            // No copies
+            EXPECT_EQ(mat.row(1, cols, buf.data()), copy[1]);
+        }
+    }
+}
+
+// The values survive a snapshot in their storage format
+TEST(ConductanceMatrixTests, Snapshot) {
+    const std::string path = ::testing::TempDir() + "conductance.snap";
+    ConductanceMatrix mat(3, 4, 1.1f, ConductancePrecision::FP16);
+    mat.set(2, 3, -7.3f);
+    nq::SnapshotWriter writer;
+    mat.save(writer, nq::SnapshotSection::IA_P);
+    ASSERT_TRUE(writer.write(path.c_str()));
+
+    ConductanceMatrix loaded(3, 4, 0.0f, ConductancePrecision::FP16);
+    nq::SnapshotReader reader;
+    ASSERT_TRUE(reader.open(path.c_str()));
+    ASSERT_TRUE(loaded.load(reader, nq::SnapshotSection::IA_P));
+    EXPECT_EQ(loaded.to_float(), mat.to_float());
+
+    // Different storage format
+    ConductanceMatrix fp32(3, 4, 0.0f, ConductancePrecision::FP32);
+    EXPECT_FALSE(fp32.load(reader, nq::SnapshotSection::IA_P));
+    std::remove(path.c_str());
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
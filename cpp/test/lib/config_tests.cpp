@@ -6,11 +6,15 @@
  * found in the root directory of this source tree.                           *
  ******************************************************************************/
 
+#include <algorithm>
 #include <cstdlib>
+#include <fstream>
 #include <gtest/gtest.h>
 #include <string>
+#include <vector>
 
 #include "helper/config.h"
+#include "helper/layer_registry.h"
 #include "inc/test_helper.h"
 
 void check_cfg_fields(const nq::Config &cfg) {
@@ -51,3 +55,81 @@ TEST(ConfigTests, LoadCfgFromEnvVar) {
     ASSERT_TRUE(cfg.load_cfg(""));
     check_cfg_fields(cfg);
 }
+
+// Per-layer profiles are resolved at load time and switched by layer ID
+TEST(ConfigTests, LayerProfiles) {
+    nq::Config &cfg = nq::Config::get_cfg();
+    ASSERT_TRUE(cfg.load_cfg(get_cfg_file("analog/LAYERS.json").c_str()));
+    ASSERT_TRUE(cfg.has_layer_profiles());
+    nq::LayerRegistry &layers = nq::LayerRegistry::get_instance();
+    std::vector<std::string> changed_keys;
+
+    ASSERT_TRUE(cfg.select_layer(layers.intern("coarse"), changed_keys));
+    EXPECT_EQ(cfg.resolution, 3);
+    EXPECT_FLOAT_EQ(cfg.HRS, 5.0);
+    EXPECT_EQ(changed_keys, std::vector<std::string>{"resolution"});
+    EXPECT_FALSE(cfg.select_layer(layers.intern("coarse"), changed_keys));
+
+    // Switching between two profiles reports the keys of both
+    ASSERT_TRUE(cfg.select_layer(layers.intern("low_hrs"), changed_keys));
+    EXPECT_EQ(cfg.resolution, 20);
+    EXPECT_FLOAT_EQ(cfg.HRS, 2.0);
+    EXPECT_FLOAT_EQ(cfg.LRS, 42.0);
+    std::sort(changed_keys.begin(), changed_keys.end());
+    EXPECT_EQ(changed_keys,
+              (std::vector<std::string>{"HRS", "LRS", "resolution"}));
+
+    // Layers without a profile use the base config
+    ASSERT_TRUE(cfg.select_layer(layers.intern("fc1"), changed_keys));
+    EXPECT_FLOAT_EQ(cfg.HRS, 5.0);
+    EXPECT_EQ(cfg.resolution, 20);
+
+    // Updates of the base config are applied to all profiles
+    ASSERT_TRUE(cfg.select_layer(layers.intern("coarse"), changed_keys));
+    ASSERT_TRUE(cfg.update_cfg(R"({"LRS": 50.0})", nullptr, &changed_keys));
+    EXPECT_EQ(cfg.resolution, 20);
+    EXPECT_EQ(changed_keys,
+              (std::vector<std::string>{"resolution", "LRS"}));
+    ASSERT_TRUE(cfg.select_layer(layers.intern("coarse"), changed_keys));
+    EXPECT_EQ(cfg.resolution, 3);
+    EXPECT_FLOAT_EQ(cfg.LRS, 50.0);
+}
+
+// Parameters that determine the crossbar structure cannot be overridden
+TEST(ConfigTests, LayerProfileStructuralOverride) {
+    std::ifstream base_file(get_cfg_file("analog/LAYERS.json"));
+    nlohmann::json cfg_data = nlohmann::json::parse(base_file);
+    cfg_data["layers"]["coarse"]["M"] = 16;
+    const std::string path =
+        (std::filesystem::temp_directory_path() / "acs_layers_test.json")
+            .string();
+    std::ofstream(path) << cfg_data.dump();
+
+    nq::Config &cfg = nq::Config::get_cfg();
+    EXPECT_FALSE(cfg.load_cfg(path.c_str()));
+    std::filesystem::remove(path);
+}
+
+// The level of a cell is stored in 8 bits
+TEST(ConfigTests, SplitTooWide) {
+    const std::string cfg_path = get_cfg_file("analog/POS_ADC_1.json");
+    nq::Config &cfg = nq::Config::get_cfg();
+    ASSERT_TRUE(cfg.load_cfg(cfg_path.c_str()));
+    EXPECT_TRUE(cfg.update_cfg(R"({"SPLIT": [4, 4]})"));
+    ASSERT_DEATH(cfg.update_cfg(R"({"SPLIT": [4, 9]})"),
+                 "SPLIT entries larger than 8 bits are not supported.");
+}
+
+TEST(ConfigTests, ConductancePrecision) {
+    const std::string cfg_path = get_cfg_file("analog/POS_ADC_1.json");
+    nq::Config &cfg = nq::Config::get_cfg();
+    ASSERT_TRUE(cfg.load_cfg(cfg_path.c_str()));
+    EXPECT_EQ(cfg.conductance_precision, nq::ConductancePrecision::FP32);
+    bool recreate_xbar = false;
+    EXPECT_TRUE(cfg.update_cfg(R"({"conductance_precision": "bf16"})",
+                               &recreate_xbar));
+    EXPECT_EQ(cfg.conductance_precision, nq::ConductancePrecision::BF16);
+    EXPECT_TRUE(recreate_xbar);
+    ASSERT_DEATH(cfg.update_cfg(R"({"conductance_precision": "fp8"})"),
+                 "Unknown conductance precision.");
+}
@@ -0,0 +1,269 @@
+/******************************************************************************
+ * Copyright (C) 2025 Rebecca Pelke                                           *
+ * All Rights Reserved                                                        *
+ *                                                                            *
+ * This work is licensed under the terms described in the LICENSE file        *
+ * found in the root directory of this source tree.                           *
+ ******************************************************************************/
+#include <algorithm>
+#include <cstdlib>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <string>
+
+#include "inc/test_helper.h"
+
+const int32_t m_matrix = 3;
+const int32_t n_matrix = 2;
+int32_t vec[n_matrix] = {120, 55};
+int32_t mat[m_matrix * n_matrix] = {100, -32, 1, 0, -12, 1};
+
+// HRS/LRS updates reprogram the stored weights without recreating the
+// crossbar (I_UINT_W_OFFS also depends on HRS for the offset correction)
+TEST(ConfigUpdateTests, CellCurrentsInPlace) {
+    std::string cfg = get_cfg_file("analog/I_UINT_W_OFFS.json");
+    const char *update = R"({"HRS": 2.0, "LRS": 42.0})";
+
+    // Reference: currents updated before the weights are written
+    set_config(cfg.c_str());
+    ASSERT_EQ(update_config(update), 0);
+    ASSERT_EQ(cpy_mtrx(mat, m_matrix, n_matrix), 0);
+    const nq::Matrix<float> ref_ia_p = get_ia_p();
+    int32_t ref[m_matrix] = {0, 0, 0};
+    ASSERT_EQ(exe_mvm(ref, vec, mat, m_matrix, n_matrix), 0);
+
+    set_config(cfg.c_str());
+    ASSERT_EQ(cpy_mtrx(mat, m_matrix, n_matrix), 0);
+    const uint8_t *gd_p = get_gd_p().data();
+    const nq::Matrix<float> old_ia_p = get_ia_p();
+    ASSERT_EQ(update_config(update), 0);
+    EXPECT_EQ(get_gd_p().data(), gd_p) << "Crossbar was recreated.";
+    EXPECT_NE(get_ia_p(), old_ia_p);
+    EXPECT_EQ(get_ia_p(), ref_ia_p);
+
+    int32_t res[m_matrix] = {0, 0, 0};
+    ASSERT_EQ(exe_mvm(res, vec, mat, m_matrix, n_matrix), 0);
+    EXPECT_THAT(res, ::testing::ElementsAreArray(ref));
+    // Stale offset correction (delta) would shift all results
+    const int32_t exact[m_matrix] = {10240, 120, -1385};
+    for (int32_t m = 0; m < m_matrix; ++m) {
+        EXPECT_NEAR(res[m], exact[m], 2);
+    }
+}
+
+// ADC updates swap the ADC of the existing crossbar
+TEST(ConfigUpdateTests, AdcInPlace) {
+    std::string cfg = get_cfg_file("analog/I_DIFF_W_DIFF_1XB.json");
+    const char *update = R"({"resolution": 3})";
+
+    set_config(cfg.c_str());
+    ASSERT_EQ(update_config(update), 0);
+    ASSERT_EQ(cpy_mtrx(mat, m_matrix, n_matrix), 0);
+    int32_t ref[m_matrix] = {0, 0, 0};
+    ASSERT_EQ(exe_mvm(ref, vec, mat, m_matrix, n_matrix), 0);
+
+    set_config(cfg.c_str());
+    ASSERT_EQ(cpy_mtrx(mat, m_matrix, n_matrix), 0);
+    const uint8_t *gd_p = get_gd_p().data();
+    int32_t res[m_matrix] = {0, 0, 0};
+    ASSERT_EQ(exe_mvm(res, vec, mat, m_matrix, n_matrix), 0);
+    ASSERT_THAT(res, ::testing::ElementsAre(10240, 120, -1385));
+
+    ASSERT_EQ(update_config(update), 0);
+    EXPECT_EQ(get_gd_p().data(), gd_p) << "Crossbar was recreated.";
+    std::fill(res, res + m_matrix, 0);
+    ASSERT_EQ(exe_mvm(res, vec, mat, m_matrix, n_matrix), 0);
+    EXPECT_THAT(res, ::testing::ElementsAreArray(ref));
+    EXPECT_NE(res[0], 10240) << "ADC resolution was not updated.";
+}
+
+// Dimension updates recreate the crossbar
+TEST(ConfigUpdateTests, StructuralRecreation) {
+    std::string cfg = get_cfg_file("analog/I_DIFF_W_DIFF_1XB.json");
+    set_config(cfg.c_str());
+    ASSERT_EQ(cpy_mtrx(mat, m_matrix, n_matrix), 0);
+    ASSERT_EQ(update_config(R"({"M": 16, "SPLIT": [4, 4]})"), 0);
+    EXPECT_EQ(get_gd_p().rows(), 16 * 2);
+    EXPECT_EQ(get_gd_p()[0][0], 0);
+}
+
+// Layer profiles are selected by the l_name of each call
+TEST(ConfigUpdateTests, LayerProfiles) {
+    set_config(get_cfg_file("analog/I_DIFF_W_DIFF_1XB.json").c_str());
+    ASSERT_EQ(update_config(R"({"resolution": 3})"), 0);
+    ASSERT_EQ(cpy_mtrx(mat, m_matrix, n_matrix), 0);
+    int32_t coarse_ref[m_matrix] = {0, 0, 0};
+    ASSERT_EQ(exe_mvm(coarse_ref, vec, mat, m_matrix, n_matrix), 0);
+
+    set_config(get_cfg_file("analog/LAYERS.json").c_str());
+    ASSERT_EQ(cpy_mtrx(mat, m_matrix, n_matrix, "fc1"), 0);
+    const uint8_t *gd_p = get_gd_p().data();
+    const nq::Matrix<float> ia_p = get_ia_p();
+    const int32_t exact[m_matrix] = {10240, 120, -1385};
+    for (int32_t i = 0; i < 2; ++i) {
+        int32_t res[m_matrix] = {0, 0, 0};
+        ASSERT_EQ(exe_mvm(res, vec, mat, m_matrix, n_matrix, "fc1"), 0);
+        EXPECT_THAT(res, ::testing::ElementsAreArray(exact));
+
+        std::fill(res, res + m_matrix, 0);
+        ASSERT_EQ(exe_mvm(res, vec, mat, m_matrix, n_matrix, "coarse"), 0);
+        EXPECT_THAT(res, ::testing::ElementsAreArray(coarse_ref));
+        EXPECT_EQ(get_ia_p(), ia_p);
+
+        // Other cell currents reprogram the crossbar
+        std::fill(res, res + m_matrix, 0);
+        ASSERT_EQ(exe_mvm(res, vec, mat, m_matrix, n_matrix, "low_hrs"), 0);
+        EXPECT_NE(get_ia_p(), ia_p);
+        for (int32_t m = 0; m < m_matrix; ++m) {
+            EXPECT_NEAR(res[m], exact[m], 2);
+        }
+    }
+    EXPECT_EQ(get_gd_p().data(), gd_p) << "Crossbar was recreated.";
+}
+
+// The crossbar and the tiles of a layer track their profiles separately: a
+// profile that another one selected first is still applied to each of them
+TEST(ConfigUpdateTests, LayerProfilesXbarAndEngine) {
+    set_config(get_cfg_file("analog/I_DIFF_W_DIFF_1XB.json").c_str());
+    ASSERT_EQ(update_config(R"({"resolution": 3})"), 0);
+    ASSERT_EQ(cpy_mtrx(mat, m_matrix, n_matrix), 0);
+    int32_t coarse_ref[m_matrix] = {0, 0, 0};
+    ASSERT_EQ(exe_mvm(coarse_ref, vec, mat, m_matrix, n_matrix), 0);
+    const int32_t exact[m_matrix] = {10240, 120, -1385};
+
+    set_config(get_cfg_file("analog/LAYERS.json").c_str());
+    ASSERT_EQ(cpy_mtrx(mat, m_matrix, n_matrix, "fc1"), 0);
+    ASSERT_EQ(cpy_layer(mat, m_matrix, n_matrix, "coarse"), 0);
+    for (int32_t i = 0; i < 2; ++i) {
+        int32_t res[m_matrix] = {0, 0, 0};
+        ASSERT_EQ(exe_layer_mvm(res, vec, m_matrix, n_matrix, "coarse"), 0);
+        EXPECT_THAT(res, ::testing::ElementsAreArray(coarse_ref));
+
+        std::fill(res, res + m_matrix, 0);
+        ASSERT_EQ(exe_mvm(res, vec, mat, m_matrix, n_matrix, "coarse"), 0);
+        EXPECT_THAT(res, ::testing::ElementsAreArray(coarse_ref));
+
+        std::fill(res, res + m_matrix, 0);
+        ASSERT_EQ(exe_mvm(res, vec, mat, m_matrix, n_matrix, "fc1"), 0);
+        EXPECT_THAT(res, ::testing::ElementsAreArray(exact));
+    }
+
+    // Updates return every crossbar to the base config
+    ASSERT_EQ(cpy_mtrx(mat, m_matrix, n_matrix, "coarse"), 0);
+    ASSERT_EQ(update_config(R"({"LRS": 31.0})"), 0);
+    int32_t res[m_matrix] = {0, 0, 0};
+    ASSERT_EQ(exe_mvm(res, vec, mat, m_matrix, n_matrix, "fc1"), 0);
+    for (int32_t m = 0; m < m_matrix; ++m) {
+        EXPECT_NEAR(res[m], exact[m], 2);
+    }
+    std::fill(res, res + m_matrix, 0);
+    ASSERT_EQ(exe_layer_mvm(res, vec, m_matrix, n_matrix, "coarse"), 0);
+    EXPECT_THAT(res, ::testing::ElementsAreArray(coarse_ref));
+}
+
+// The device-to-device samples only depend on rng_seed: reprogramming with
+// other cell currents (layer profile, update) re-applies them
+TEST(ConfigUpdateTests, DeviceVariabilityKept) {
+    int32_t bnn_mat[m_matrix * n_matrix] = {1, -1, -1, 1, 1, 1};
+    int32_t bnn_vec[n_matrix] = {1, -1};
+    const char *update = R"({"rng_seed": 3,
+                             "layers": {"low_noise": {"HRS_NOISE": 0.5}}})";
+    set_config(get_cfg_file("variability/variability.json").c_str());
+    ASSERT_EQ(update_config(update), 0);
+    ASSERT_EQ(cpy_mtrx(bnn_mat, m_matrix, n_matrix), 0);
+    const nq::Matrix<float> ia_p = get_ia_p();
+
+    int32_t res[m_matrix] = {0, 0, 0};
+    ASSERT_EQ(
+        exe_mvm(res, bnn_vec, bnn_mat, m_matrix, n_matrix, "low_noise"), 0);
+    EXPECT_NE(get_ia_p(), ia_p);
+    ASSERT_EQ(exe_mvm(res, bnn_vec, bnn_mat, m_matrix, n_matrix), 0);
+    EXPECT_EQ(get_ia_p(), ia_p);
+
+    // rng_seed and d2d_var reprogram the crossbar
+    ASSERT_EQ(update_config(R"({"rng_seed": 4})"), 0);
+    EXPECT_NE(get_ia_p(), ia_p);
+    ASSERT_EQ(update_config(R"({"rng_seed": 3})"), 0);
+    EXPECT_EQ(get_ia_p(), ia_p);
+    ASSERT_EQ(update_config(R"({"d2d_var": false})"), 0);
+    for (int32_t m = 0; m < m_matrix; ++m) {
+        for (int32_t n = 0; n < n_matrix; ++n) {
+            EXPECT_FLOAT_EQ(get_ia_p()[m][n],
+                            bnn_mat[m * n_matrix + n] > 0 ? 30.0f : 10.0f);
+        }
+    }
+    ASSERT_EQ(update_config(R"({"d2d_var": true})"), 0);
+    EXPECT_EQ(get_ia_p(), ia_p);
+
+    // Same samples after a new set_config with the same rng_seed
+    set_config(get_cfg_file("variability/variability.json").c_str());
+    ASSERT_EQ(update_config(update), 0);
+    ASSERT_EQ(cpy_mtrx(bnn_mat, m_matrix, n_matrix), 0);
+    EXPECT_EQ(get_ia_p(), ia_p);
+}
+
+// State that a config does not use is not allocated. The currents as
+// written are allocated when C2C variability is enabled.
+TEST(ConfigUpdateTests, LazyState) {
+    set_config(get_cfg_file("digital/BNN_I.json").c_str());
+    EXPECT_TRUE(get_ia_p().empty());
+    EXPECT_FALSE(get_gd_m().empty());
+
+    set_config(get_cfg_file("analog/BNN_III.json").c_str());
+    EXPECT_FALSE(get_ia_p().empty());
+    EXPECT_TRUE(get_ia_m().empty());
+    EXPECT_TRUE(get_gd_m().empty());
+
+    int32_t bnn_mat[m_matrix * n_matrix] = {1, -1, -1, 1, 1, 1};
+    int32_t bnn_vec[n_matrix] = {1, -1};
+    const int32_t exact[m_matrix] = {2, -2, 0};
+    for (const char *cfg : {"analog/BNN_I.json", "analog/BNN_III.json"}) {
+        set_config(get_cfg_file(cfg).c_str());
+        ASSERT_EQ(cpy_mtrx(bnn_mat, m_matrix, n_matrix), 0);
+        int32_t res[m_matrix] = {0, 0, 0};
+        ASSERT_EQ(exe_mvm(res, bnn_vec, bnn_mat, m_matrix, n_matrix), 0);
+        EXPECT_THAT(res, ::testing::ElementsAreArray(exact)) << cfg;
+
+        ASSERT_EQ(update_config(R"({"c2c_var": true, "d2d_var": false,
+                                    "HRS_NOISE": 0.1, "LRS_NOISE": 0.1})"),
+                  0);
+        const nq::Matrix<float> ia_p = get_ia_p();
+        for (int32_t i = 0; i < 3; ++i) {
+            ASSERT_EQ(exe_mvm(res, bnn_vec, bnn_mat, m_matrix, n_matrix), 0);
+            // The C2C noise is removed after every MVM
+            EXPECT_EQ(get_ia_p(), ia_p) << cfg;
+        }
+    }
+}
+
+// A view of the read disturb counters holds their owner, which V_read
+// updates replace and disabling read disturb releases
+TEST(ConfigUpdateTests, ReadDisturbViewKept) {
+    set_config(get_cfg_file("analog/READ_DISTURB_INT.json").c_str());
+    int32_t rd_mat[4] = {1, -2, 3, 0};
+    int32_t rd_mat_new[4] = {-1, 2, 0, 3};
+    ASSERT_EQ(cpy_mtrx(rd_mat, 2, 2), 0);
+    ASSERT_EQ(cpy_mtrx(rd_mat_new, 2, 2), 0);
+
+    const std::shared_ptr<const nq::ReadDisturb> owner = get_rd_model();
+    ASSERT_NE(owner, nullptr);
+    const nq::Matrix<uint64_t> &view = owner->get_cycles_p();
+    const nq::Matrix<uint64_t> cycles_p = view;
+    EXPECT_NE(std::count(cycles_p.data(), cycles_p.data() + cycles_p.size(),
+                         0),
+              cycles_p.size());
+
+    ASSERT_EQ(update_config(R"({"V_read": -0.5})"), 0);
+    EXPECT_NE(get_rd_model(), owner);
+    EXPECT_EQ(get_cycles_p(), cycles_p);
+    EXPECT_EQ(view, cycles_p);
+
+    ASSERT_EQ(update_config(R"({"read_disturb": false})"), 0);
+    EXPECT_EQ(get_rd_model(), nullptr);
+    EXPECT_EQ(view, cycles_p);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
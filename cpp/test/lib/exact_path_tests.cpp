@@ -0,0 +1,115 @@
+/******************************************************************************
+ * Copyright (C) 2025 Rebecca Pelke                                           *
+ * All Rights Reserved                                                        *
+ *                                                                            *
+ * This work is licensed under the terms described in the LICENSE file        *
+ * found in the root directory of this source tree.                           *
+ ******************************************************************************/
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "inc/test_helper.h"
+
+namespace {
+
+const int32_t m_matrix = 32;
+const int32_t n_matrix = 32;
+
+std::vector<int32_t> random_values(size_t size, bool ternary,
+                                   std::mt19937 &gen) {
+    std::uniform_int_distribution<int32_t> dist(ternary ? -1 : 0, 1);
+    std::vector<int32_t> values(size);
+    for (int32_t &value : values) {
+        value = dist(gen);
+        if (!ternary) {
+            value = 2 * value - 1;
+        }
+    }
+    return values;
+}
+
+// MVM results of several inputs, with or without the exact fast path
+std::vector<int32_t> run_mvms(const std::string &cfg, const char *update,
+                              bool fast_path) {
+    set_config(get_cfg_file(cfg).c_str());
+    update_config(update);
+    update_config(fast_path ? R"({"exact_fast_path": true})"
+                            : R"({"exact_fast_path": false})");
+    const bool ternary = cfg.find("TNN") != std::string::npos;
+    std::mt19937 gen(42);
+    std::vector<int32_t> mat =
+        random_values(m_matrix * n_matrix, ternary, gen);
+    EXPECT_EQ(cpy_mtrx(mat.data(), m_matrix, n_matrix, "fc1"), 0);
+
+    std::vector<int32_t> results;
+    for (int32_t i = 0; i < 20; ++i) {
+        std::vector<int32_t> vec = random_values(n_matrix, ternary, gen);
+        std::vector<int32_t> res(m_matrix, 0);
+        // Alternate the layers (one lookup table per layer)
+        EXPECT_EQ(exe_mvm(res.data(), vec.data(), mat.data(), m_matrix,
+                          n_matrix, (i % 2) ? "fc1" : "fc2"),
+                  0);
+        results.insert(results.end(), res.begin(), res.end());
+    }
+    return results;
+}
+
+} // namespace
+
+// The fast path gives the same results as the float accumulation, also with
+// clipping/quantization (low resolution) and currents that are not exactly
+// representable (fallback)
+TEST(ExactPathTests, SameResults) {
+    const std::vector<std::string> cfgs = {
+        "analog/BNN_I.json",         "analog/BNN_II.json",
+        "analog/BNN_III.json",       "analog/BNN_IV.json",
+        "analog/BNN_V.json",         "analog/BNN_VI.json",
+        "analog/TNN_I.json",         "analog/TNN_II.json",
+        "analog/TNN_III.json",       "analog/TNN_IV_split.json",
+        "analog/TNN_V_split.json"};
+    const std::vector<const char *> updates = {
+        R"({})", R"({"resolution": 4})", R"({"resolution": 7})",
+        R"({"HRS": 0.1, "LRS": 30.3})", R"({"adc_type": "INF_ADC"})"};
+
+    for (const std::string &cfg : cfgs) {
+        for (const char *update : updates) {
+            EXPECT_THAT(run_mvms(cfg, update, true),
+                        ::testing::ElementsAreArray(
+                            run_mvms(cfg, update, false)))
+                << cfg << " " << update;
+        }
+    }
+}
+
+// Hot updates of the cell currents reprogram the crossbar and the fast path
+TEST(ExactPathTests, ConfigUpdate) {
+    std::mt19937 gen(7);
+    std::vector<int32_t> mat = random_values(m_matrix * n_matrix, false, gen);
+    std::vector<int32_t> vec = random_values(n_matrix, false, gen);
+    std::vector<int32_t> ref(m_matrix, 0);
+    std::vector<int32_t> res(m_matrix, 0);
+
+    set_config(get_cfg_file("analog/BNN_I.json").c_str());
+    ASSERT_EQ(update_config(R"({"HRS": 2.0, "LRS": 42.0, "resolution": 5})"),
+              0);
+    ASSERT_EQ(update_config(R"({"exact_fast_path": false})"), 0);
+    ASSERT_EQ(cpy_mtrx(mat.data(), m_matrix, n_matrix), 0);
+    ASSERT_EQ(exe_mvm(ref.data(), vec.data(), mat.data(), m_matrix, n_matrix),
+              0);
+
+    set_config(get_cfg_file("analog/BNN_I.json").c_str());
+    ASSERT_EQ(cpy_mtrx(mat.data(), m_matrix, n_matrix), 0);
+    ASSERT_EQ(update_config(R"({"HRS": 2.0, "LRS": 42.0, "resolution": 5})"),
+              0);
+    ASSERT_EQ(exe_mvm(res.data(), vec.data(), mat.data(), m_matrix, n_matrix),
+              0);
+    EXPECT_THAT(res, ::testing::ElementsAreArray(ref));
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,140 @@
+/******************************************************************************
+ * Copyright (C) 2025 Rebecca Pelke                                           *
+ * All Rights Reserved                                                        *
+ *                                                                            *
+ * This work is licensed under the terms described in the LICENSE file        *
+ * found in the root directory of this source tree.                           *
+ ******************************************************************************/
+#include <gtest/gtest.h>
+#include <limits>
+#include <thread>
+#include <vector>
+
+#include "helper/histogram.h"
+#include "helper/layer_registry.h"
+
+// Concurrent updates land in separate shards and are merged on read
+TEST(HistogramTests, ShardedUpdates) {
+    nq::BinnedHistogram hist(0.0, 10.0, 1.0);
+    // Large enough to be split across worker threads
+    std::vector<float> values(100000);
+    for (size_t i = 0; i < values.size(); ++i) {
+        values[i] = static_cast<float>(i % 10);
+    }
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&hist, &values] {
+            hist.update(values.data(), values.size());
+            // Small updates are binned by the calling thread
+            hist.update(values.data(), 10);
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(hist.get_samples(), 4 * (100000 + 10));
+    json hist_json = hist.to_json();
+    EXPECT_EQ(hist_json["samples"].get<int64_t>(), 4 * (100000 + 10));
+    // Bins are reported at their mid-points
+    EXPECT_NEAR(hist_json["mean"].get<float>(), 5.0, 1e-4);
+    EXPECT_NEAR(hist_json["var"].get<float>(), 8.25, 1e-3);
+}
+
+// Layer histograms are created once and keep their address
+TEST(HistogramTests, LayerLookup) {
+    nq::WorkloadHistograms hists;
+    nq::LayerHistogram &conv1 =
+        hists.get_or_add_histogram("conv1", 0.0, 4.0, 1.0);
+    nq::LayerHistogram &fc1 = hists.get_or_add_histogram("fc1", 0.0, 4.0);
+    EXPECT_NE(&conv1, &fc1);
+    EXPECT_EQ(&conv1, &hists.get_or_add_histogram("conv1", 0.0, 8.0, 2.0));
+    EXPECT_TRUE(hists.has_histogram("conv1"));
+    EXPECT_FALSE(hists.add_histogram("fc1", 0.0, 4.0));
+
+    const float values[] = {0.0, 1.0, 1.0, 2.0};
+    conv1.update(values, 4);
+    EXPECT_EQ(hists.to_json()["conv1"]["samples"].get<int64_t>(), 4);
+    EXPECT_EQ(hists.to_json()["fc1"]["samples"].get<int64_t>(), 0);
+}
+
+// Names and registered layer IDs address the same histogram
+TEST(HistogramTests, LayerIds) {
+    nq::LayerRegistry &layers = nq::LayerRegistry::get_instance();
+    EXPECT_EQ(layers.intern("Unknown"), nq::LayerRegistry::unknown_layer);
+    const uint32_t conv2 = layers.intern("conv2");
+    EXPECT_EQ(layers.intern("conv2"), conv2);
+    EXPECT_EQ(layers.get_name(conv2), "conv2");
+    EXPECT_EQ(layers.size(), conv2 + 1);
+
+    nq::WorkloadHistograms hists;
+    nq::LayerHistogram &hist = hists.get_or_add_histogram(conv2, 0.0, 4.0);
+    EXPECT_EQ(&hist, &hists.get_or_add_histogram("conv2", 0.0, 4.0));
+    EXPECT_TRUE(hists.has_histogram("conv2"));
+    EXPECT_TRUE(hists.to_json().contains("conv2"));
+}
+
+// Values outside of the range are counted, not binned
+TEST(HistogramTests, BinnedOutOfRange) {
+    nq::BinnedHistogram hist(-2.0, 2.0, 1.0);
+    const float values[] = {-100.0, -2.0, 0.0, 1.0, 1.6, 3.0, 1e30};
+    hist.update(values, 7);
+    EXPECT_EQ(hist.get_samples(), 3);
+    EXPECT_EQ(hist.get_underflow(), 1);
+    EXPECT_EQ(hist.get_overflow(), 3);
+}
+
+// Integer values outside of [min, max] are counted, not stored
+TEST(HistogramTests, SimpleOutOfRange) {
+    nq::SimpleHistogram hist(-2, 2);
+    hist.update({std::numeric_limits<int32_t>::min(), -3, -2, 0, 2, 3,
+                 std::numeric_limits<int32_t>::max()});
+    EXPECT_EQ(hist.get_samples(), 3);
+    EXPECT_EQ(hist.get_underflow(), 2);
+    EXPECT_EQ(hist.get_overflow(), 2);
+    EXPECT_FLOAT_EQ(hist.get_mean(), 0.0);
+}
+
+// Quantiles of the streaming histogram are exact up to the bucket resolution
+TEST(HistogramTests, StreamingQuantiles) {
+    nq::StreamingHistogram hist;
+    std::vector<float> values(200001);
+    for (size_t i = 0; i < values.size(); ++i) {
+        values[i] = (static_cast<float>(i) - 100000.0) * 1e-6;
+    }
+    hist.update(values.data(), values.size());
+    const float inf = std::numeric_limits<float>::infinity();
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    const float non_finite[] = {inf, -inf, nan};
+    hist.update(non_finite, 3);
+
+    EXPECT_EQ(hist.get_samples(), 200001);
+    EXPECT_FLOAT_EQ(hist.get_min(), -0.1);
+    EXPECT_FLOAT_EQ(hist.get_max(), 0.1);
+    EXPECT_NEAR(hist.get_mean(), 0.0, 1e-6);
+    EXPECT_NEAR(hist.get_variance(), 0.01 / 3, 1e-5);
+
+    std::vector<float> qs = hist.get_quantiles({0.0, 0.01, 0.5, 0.99, 1.0});
+    EXPECT_FLOAT_EQ(qs[0], -0.1);
+    EXPECT_NEAR(qs[1], -0.098, 0.098 / 256);
+    EXPECT_NEAR(qs[2], 0.0, 1e-6);
+    EXPECT_NEAR(qs[3], 0.098, 0.098 / 256);
+    EXPECT_FLOAT_EQ(qs[4], 0.1);
+    json hist_json = hist.to_json();
+    EXPECT_FLOAT_EQ(hist_json["quantiles"]["0.99"].get<float>(), qs[3]);
+}
+
+// Unbounded ranges (e.g. INF_ADC) are profiled by the streaming histogram only
+TEST(HistogramTests, UnboundedLayer) {
+    nq::LayerHistogram hist(std::numeric_limits<float>::lowest(),
+                            std::numeric_limits<float>::max(), 10.0);
+    EXPECT_EQ(hist.get_binned(), nullptr);
+    const float values[] = {-3e20, 0.0, 5.0, 2e25};
+    hist.update(values, 4);
+    json hist_json = hist.to_json();
+    EXPECT_EQ(hist_json["samples"].get<int64_t>(), 4);
+    EXPECT_FLOAT_EQ(hist_json["min"].get<float>(), -3e20);
+    EXPECT_FLOAT_EQ(hist_json["max"].get<float>(), 2e25);
+    EXPECT_FALSE(hist_json.contains("underflow"));
+}
@@ -13,27 +13,49 @@
 #include <filesystem>
 #include <gtest/gtest.h>
 #include <iostream>
+#include <memory>
 #include <string>
 
+#include "helper/matrix.h"
+#include "xbar/read_disturb.h"
+
 // C interface of acs_py
 extern "C" {
 int32_t exe_mvm(int32_t *res, int32_t *vec, int32_t *mat, int32_t m_matrix,
                 int32_t n_matrix, const char *l_name = "Unknown");
+uint32_t register_layer(const char *l_name);
+int32_t exe_mvm_id(int32_t *res, int32_t *vec, int32_t *mat, int32_t m_matrix,
+                   int32_t n_matrix, uint32_t layer_id);
+int32_t exe_mvm_range(int32_t *res, int32_t *vec, int32_t *mat,
+                      int32_t m_matrix, int32_t n_matrix, int32_t out_min,
+                      int32_t out_max, const char *l_name = "Unknown");
 int32_t cpy_mtrx(int32_t *mat, int32_t m_matrix, int32_t n_matrix,
                  const char *l_name = "Unknown");
+int32_t cpy_layer(int32_t *mat, int32_t m_matrix, int32_t n_matrix,
+                  const char *l_name = "Unknown");
+int32_t exe_layer_mvm(int32_t *res, int32_t *vec, int32_t m_matrix,
+                      int32_t n_matrix, const char *l_name = "Unknown");
 void set_config(const char *cfg_file, const int n_threads = 1);
 int32_t update_config(const char *json_config, const char *l_name = "Unknown");
 const void *get_ia_p(size_t *size);
 const void *get_ia_m(size_t *size);
 const void *get_gd_p(size_t *size);
 const void *get_gd_m(size_t *size);
+int32_t save_state(const char *path);
+int32_t load_state(const char *path);
+int32_t begin_adc_calibration();
+int32_t end_adc_calibration(const char *policy = "percentile",
+                            float percentile = 99.99);
 }
 
 // C++ interface of acs_py
-extern const std::vector<std::vector<float>> &get_ia_p();
-extern const std::vector<std::vector<float>> &get_ia_m();
-extern const std::vector<std::vector<int32_t>> &get_gd_p();
-extern const std::vector<std::vector<int32_t>> &get_gd_m();
+extern const nq::Matrix<float> &get_ia_p();
+extern const nq::Matrix<float> &get_ia_m();
+extern const nq::Matrix<uint8_t> &get_gd_p();
+extern const nq::Matrix<uint8_t> &get_gd_m();
+extern const nq::Matrix<uint64_t> &get_cycles_p();
+extern const nq::Matrix<uint64_t> &get_consecutive_reads_p();
+extern std::shared_ptr<const nq::ReadDisturb> get_rd_model();
 extern const std::string get_adc_profile();
 
 std::string get_cfg_file(const std::string &file_name) {
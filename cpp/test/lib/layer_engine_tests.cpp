@@ -0,0 +1,137 @@
+/******************************************************************************
+ * Copyright (C) 2025 Rebecca Pelke                                           *
+ * All Rights Reserved                                                        *
+ *                                                                            *
+ * This work is licensed under the terms described in the LICENSE file        *
+ * found in the root directory of this source tree.                           *
+ ******************************************************************************/
+#include <algorithm>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "inc/test_helper.h"
+
+namespace {
+
+// Larger than the 4x3 crossbars of the tests (3x3 grid, partial tiles)
+const int32_t m_matrix = 10;
+const int32_t n_matrix = 7;
+
+std::vector<int32_t> random_values(size_t size, uint32_t seed) {
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<int32_t> dist(-128, 127);
+    std::vector<int32_t> values(size);
+    for (int32_t &value : values) {
+        value = dist(gen);
+    }
+    return values;
+}
+
+std::vector<int32_t> exact_mvm(const std::vector<int32_t> &mat,
+                               const std::vector<int32_t> &vec) {
+    std::vector<int32_t> res(m_matrix, 0);
+    for (int32_t m = 0; m < m_matrix; ++m) {
+        for (int32_t n = 0; n < n_matrix; ++n) {
+            res[m] += mat[m * n_matrix + n] * vec[n];
+        }
+    }
+    return res;
+}
+
+} // namespace
+
+// Digital and analog tiles give the exact result for any matrix size
+TEST(LayerEngineTests, TiledMvm) {
+    std::vector<int32_t> mat = random_values(m_matrix * n_matrix, 1);
+    std::vector<int32_t> vec = random_values(n_matrix, 2);
+    const std::vector<int32_t> exact = exact_mvm(mat, vec);
+
+    for (const char *cfg : {"digital/I_DIFF_W_DIFF_1XB.json",
+                            "analog/I_DIFF_W_DIFF_1XB.json"}) {
+        set_config(get_cfg_file(cfg).c_str(), 4);
+        ASSERT_EQ(update_config(R"({"M": 4, "N": 3})"), 0);
+        // A single crossbar rejects the matrix
+        ASSERT_EQ(cpy_mtrx(mat.data(), m_matrix, n_matrix), -1);
+
+        ASSERT_EQ(cpy_layer(mat.data(), m_matrix, n_matrix, "fc1"), 0);
+        std::vector<int32_t> res(m_matrix, 0);
+        ASSERT_EQ(
+            exe_layer_mvm(res.data(), vec.data(), m_matrix, n_matrix, "fc1"),
+            0);
+        EXPECT_THAT(res, ::testing::ElementsAreArray(exact)) << cfg;
+    }
+}
+
+// The tiles give the same result as manually tiled MVMs on one crossbar
+TEST(LayerEngineTests, ManualTiling) {
+    std::vector<int32_t> mat = random_values(m_matrix * n_matrix, 3);
+    std::vector<int32_t> vec = random_values(n_matrix, 4);
+    set_config(get_cfg_file("analog/I_DIFF_W_DIFF_1XB.json").c_str());
+    ASSERT_EQ(update_config(R"({"M": 4, "N": 3, "resolution": 6})"), 0);
+
+    std::vector<int32_t> ref(m_matrix, 0);
+    for (int32_t m_off = 0; m_off < m_matrix; m_off += 4) {
+        for (int32_t n_off = 0; n_off < n_matrix; n_off += 3) {
+            const int32_t m_tile = std::min(4, m_matrix - m_off);
+            const int32_t n_tile = std::min(3, n_matrix - n_off);
+            std::vector<int32_t> tile(m_tile * n_tile);
+            for (int32_t m = 0; m < m_tile; ++m) {
+                for (int32_t n = 0; n < n_tile; ++n) {
+                    tile[m * n_tile + n] =
+                        mat[(m_off + m) * n_matrix + n_off + n];
+                }
+            }
+            ASSERT_EQ(cpy_mtrx(tile.data(), m_tile, n_tile), 0);
+            ASSERT_EQ(exe_mvm(ref.data() + m_off, vec.data() + n_off,
+                              tile.data(), m_tile, n_tile),
+                      0);
+        }
+    }
+
+    ASSERT_EQ(cpy_layer(mat.data(), m_matrix, n_matrix), 0);
+    std::vector<int32_t> res(m_matrix, 0);
+    ASSERT_EQ(exe_layer_mvm(res.data(), vec.data(), m_matrix, n_matrix), 0);
+    EXPECT_THAT(res, ::testing::ElementsAreArray(ref));
+}
+
+// Structural updates rebuild the tiles with the new crossbar size
+TEST(LayerEngineTests, Retile) {
+    std::vector<int32_t> mat = random_values(m_matrix * n_matrix, 5);
+    std::vector<int32_t> vec = random_values(n_matrix, 6);
+    const std::vector<int32_t> exact = exact_mvm(mat, vec);
+    set_config(get_cfg_file("analog/I_DIFF_W_DIFF_1XB.json").c_str());
+    ASSERT_EQ(update_config(R"({"M": 4, "N": 3})"), 0);
+    ASSERT_EQ(cpy_layer(mat.data(), m_matrix, n_matrix, "fc1"), 0);
+
+    ASSERT_EQ(update_config(R"({"M": 16, "N": 2})"), 0);
+    std::vector<int32_t> res(m_matrix, 0);
+    ASSERT_EQ(
+        exe_layer_mvm(res.data(), vec.data(), m_matrix, n_matrix, "fc1"), 0);
+    EXPECT_THAT(res, ::testing::ElementsAreArray(exact));
+}
+
+TEST(LayerEngineTests, InvalidCalls) {
+    std::vector<int32_t> mat = random_values(m_matrix * n_matrix, 7);
+    std::vector<int32_t> vec = random_values(n_matrix, 8);
+    std::vector<int32_t> res(m_matrix, 0);
+    set_config(get_cfg_file("digital/I_DIFF_W_DIFF_1XB.json").c_str());
+    EXPECT_EQ(exe_layer_mvm(res.data(), vec.data(), m_matrix, n_matrix,
+                            "not_programmed"),
+              -1);
+    ASSERT_EQ(cpy_layer(mat.data(), m_matrix, n_matrix, "fc1"), 0);
+    EXPECT_EQ(exe_layer_mvm(res.data(), vec.data(), m_matrix, n_matrix - 1,
+                            "fc1"),
+              -1);
+    // set_config discards the tiles
+    set_config(get_cfg_file("digital/I_DIFF_W_DIFF_1XB.json").c_str());
+    EXPECT_EQ(
+        exe_layer_mvm(res.data(), vec.data(), m_matrix, n_matrix, "fc1"), -1);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,181 @@
+/******************************************************************************
+ * Copyright (C) 2025 Rebecca Pelke                                           *
+ * All Rights Reserved                                                        *
+ *                                                                            *
+ * This work is licensed under the terms described in the LICENSE file        *
+ * found in the root directory of this source tree.                           *
+ ******************************************************************************/
+#include <cmath>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+
+#include "inc/test_helper.h"
+
+extern "C" {
+int32_t mc_cpy_mtrx(int32_t *mat, int32_t m_matrix, int32_t n_matrix,
+                    int32_t num_instances, const char *l_name = "Unknown");
+int32_t mc_exe_mvm(int32_t *out, int32_t *vec, int32_t batch, double *mean,
+                   double *var, double *mse, double *mismatch,
+                   const char *l_name = "Unknown");
+}
+
+namespace {
+
+const int32_t m_matrix = 32;
+const int32_t n_matrix = 32;
+const int32_t batch = 4;
+const int32_t num_instances = 16;
+
+std::vector<int32_t> random_signs(size_t size, uint32_t seed) {
+    std::mt19937 gen(seed);
+    std::vector<int32_t> values(size);
+    for (int32_t &value : values) {
+        value = (gen() & 1) ? 1 : -1;
+    }
+    return values;
+}
+
+// Exact results of the batch (batch x m_matrix)
+std::vector<int32_t> exact_mvm(const std::vector<int32_t> &mat,
+                               const std::vector<int32_t> &vec) {
+    std::vector<int32_t> res(batch * m_matrix, 0);
+    for (int32_t b = 0; b < batch; ++b) {
+        for (int32_t m = 0; m < m_matrix; ++m) {
+            for (int32_t n = 0; n < n_matrix; ++n) {
+                res[b * m_matrix + m] +=
+                    mat[m * n_matrix + n] * vec[b * n_matrix + n];
+            }
+        }
+    }
+    return res;
+}
+
+struct McResult {
+    std::vector<int32_t> out;
+    std::vector<double> mean;
+    std::vector<double> var;
+    std::vector<double> mse;
+    std::vector<double> mismatch;
+};
+
+McResult run_mc(std::vector<int32_t> &mat, std::vector<int32_t> &vec) {
+    McResult r;
+    r.out.resize(num_instances * batch * m_matrix);
+    r.mean.resize(batch * m_matrix);
+    r.var.resize(batch * m_matrix);
+    r.mse.resize(num_instances);
+    r.mismatch.resize(num_instances);
+    EXPECT_EQ(mc_cpy_mtrx(mat.data(), m_matrix, n_matrix, num_instances), 0);
+    EXPECT_EQ(mc_exe_mvm(r.out.data(), vec.data(), batch, r.mean.data(),
+                         r.var.data(), r.mse.data(), r.mismatch.data()),
+              0);
+    return r;
+}
+
+} // namespace
+
+// Without state noise, every instance gives the exact result
+TEST(MonteCarloTests, NoiseFree) {
+    std::vector<int32_t> mat = random_signs(m_matrix * n_matrix, 1);
+    std::vector<int32_t> vec = random_signs(batch * n_matrix, 2);
+    set_config(get_cfg_file("variability/variability.json").c_str(), 4);
+    ASSERT_EQ(update_config(R"({"HRS_NOISE": 0.0, "LRS_NOISE": 0.0})"), 0);
+    McResult r = run_mc(mat, vec);
+
+    const std::vector<int32_t> exact = exact_mvm(mat, vec);
+    for (int32_t k = 0; k < num_instances; ++k) {
+        const std::vector<int32_t> out(
+            r.out.begin() + k * batch * m_matrix,
+            r.out.begin() + (k + 1) * batch * m_matrix);
+        EXPECT_THAT(out, ::testing::ElementsAreArray(exact));
+        EXPECT_EQ(r.mse[k], 0.0);
+        EXPECT_EQ(r.mismatch[k], 0.0);
+    }
+    for (int32_t o = 0; o < batch * m_matrix; ++o) {
+        EXPECT_EQ(r.var[o], 0.0);
+        EXPECT_EQ(r.mean[o], r.out[o]);
+    }
+}
+
+// With state noise, the instances are independent device samples and the
+// statistics match the per-instance outputs
+TEST(MonteCarloTests, Statistics) {
+    std::vector<int32_t> mat = random_signs(m_matrix * n_matrix, 3);
+    std::vector<int32_t> vec = random_signs(batch * n_matrix, 4);
+    set_config(get_cfg_file("variability/variability.json").c_str(), 4);
+    ASSERT_EQ(update_config(R"({"HRS_NOISE": 3.0, "LRS_NOISE": 3.0})"), 0);
+    McResult r = run_mc(mat, vec);
+
+    const size_t outputs = batch * m_matrix;
+    int32_t differing = 0;
+    for (size_t o = 0; o < outputs; ++o) {
+        double mean = 0.0;
+        for (int32_t k = 0; k < num_instances; ++k) {
+            mean += r.out[k * outputs + o];
+        }
+        mean /= num_instances;
+        double var = 0.0;
+        for (int32_t k = 0; k < num_instances; ++k) {
+            var += std::pow(r.out[k * outputs + o] - mean, 2);
+        }
+        var /= num_instances - 1;
+        EXPECT_NEAR(r.mean[o], mean, 1e-9);
+        EXPECT_NEAR(r.var[o], var, 1e-9);
+        differing += (r.out[o] != r.out[outputs + o]);
+    }
+    EXPECT_GT(differing, 0);
+
+    // Errors of the first instance vs the digital result
+    const std::vector<int32_t> exact = exact_mvm(mat, vec);
+    double mse = 0.0;
+    for (size_t o = 0; o < outputs; ++o) {
+        mse += std::pow(r.out[o] - exact[o], 2);
+    }
+    EXPECT_NEAR(r.mse[0], mse / outputs, 1e-9);
+}
+
+// Only the matrix dimensions of a crossbar are accepted
+TEST(MonteCarloTests, InvalidArguments) {
+    std::vector<int32_t> mat(33 * 2, 1);
+    std::vector<int32_t> out(1);
+    std::vector<int32_t> vec(2, 1);
+    set_config(get_cfg_file("variability/variability.json").c_str());
+    EXPECT_EQ(mc_exe_mvm(out.data(), vec.data(), 1, nullptr, nullptr,
+                         nullptr, nullptr),
+              -1);
+    EXPECT_EQ(mc_cpy_mtrx(mat.data(), 33, 2, 4), -1);
+    EXPECT_EQ(mc_cpy_mtrx(mat.data(), 2, 2, 0), -1);
+
+    // INT mappings draw no device-to-device variability
+    ASSERT_EQ(update_config(R"({"m_mode": "I_UINT_W_OFFS",
+                                "adc_type": "INF_ADC"})"),
+              0);
+    EXPECT_EQ(mc_cpy_mtrx(mat.data(), 2, 2, 4), -1);
+}
+
+// A structural update that the programmed matrix does not fit drops the
+// instances instead of terminating
+TEST(MonteCarloTests, StructuralUpdate) {
+    std::vector<int32_t> mat = random_signs(m_matrix * n_matrix, 5);
+    std::vector<int32_t> vec = random_signs(n_matrix, 6);
+    std::vector<int32_t> out(num_instances * m_matrix);
+    set_config(get_cfg_file("variability/variability.json").c_str());
+    ASSERT_EQ(mc_cpy_mtrx(mat.data(), m_matrix, n_matrix, num_instances), 0);
+
+    ASSERT_EQ(update_config(R"({"M": 64})"), 0);
+    EXPECT_EQ(mc_exe_mvm(out.data(), vec.data(), 1, nullptr, nullptr,
+                         nullptr, nullptr),
+              0);
+
+    EXPECT_EQ(update_config(R"({"M": 16})"), -1);
+    EXPECT_EQ(mc_exe_mvm(out.data(), vec.data(), 1, nullptr, nullptr,
+                         nullptr, nullptr),
+              -1);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -5,12 +5,15 @@
  * This work is licensed under the terms described in the LICENSE file        *
  * found in the root directory of this source tree.                           *
  ******************************************************************************/
+#include <algorithm>
 #include <cstdlib>
 #include <dlfcn.h>
 #include <filesystem>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include <random>
 #include <string>
+#include <vector>
 
 #include "inc/test_helper.h"
 
@@ -459,6 +462,238 @@ TEST(INTLibTests, TNN_V_split) {
     }
 }
 
+// The packed GEMV of the digital INT mappings gives the same results as the
+// slice-based MVM (packed_gemv_check compares both for every MVM)
+TEST(INTLibTests, DigitalPackedGemv) {
+    const int32_t m_matrix = 32;
+    const int32_t n_matrix = 32;
+    const std::vector<std::string> cfgs = {
+        "I_DIFF_W_DIFF_1XB.json", "I_DIFF_W_DIFF_2XB.json",
+        "I_OFFS_W_DIFF.json",     "I_TC_W_DIFF.json",
+        "I_UINT_W_DIFF.json",     "I_UINT_W_OFFS.json"};
+
+    for (const std::string &cfg : cfgs) {
+        const bool uint_input = cfg.find("I_UINT") != std::string::npos;
+        std::vector<int32_t> results[2];
+        for (bool packed : {true, false}) {
+            set_config(get_cfg_file("digital/" + cfg).c_str());
+            ASSERT_EQ(update_config(packed ? R"({"packed_gemv_check": true})"
+                                           : R"({"packed_gemv": false})"),
+                      0);
+            std::mt19937 gen(3);
+            std::uniform_int_distribution<int32_t> w_dist(-128, 127);
+            std::uniform_int_distribution<int32_t> i_dist(
+                uint_input ? 0 : -128, uint_input ? 255 : 127);
+            std::vector<int32_t> mat(m_matrix * n_matrix);
+            for (int32_t &value : mat) {
+                value = w_dist(gen);
+            }
+            ASSERT_EQ(cpy_mtrx(mat.data(), m_matrix, n_matrix), 0);
+            for (int32_t i = 0; i < 10; ++i) {
+                std::vector<int32_t> vec(n_matrix);
+                for (int32_t &value : vec) {
+                    value = i_dist(gen);
+                }
+                // Partial MVMs use the top-left part of the matrix
+                const int32_t m = (i % 2) ? m_matrix : 7;
+                const int32_t n = (i % 2) ? n_matrix : 19;
+                std::vector<int32_t> res(m, i);
+                ASSERT_EQ(exe_mvm(res.data(), vec.data(), mat.data(), m, n),
+                          0);
+                results[packed].insert(results[packed].end(), res.begin(),
+                                       res.end());
+            }
+        }
+        EXPECT_THAT(results[1], ::testing::ElementsAreArray(results[0]))
+            << cfg;
+    }
+}
+
+// HRS and LRS are exactly representable in fp16 and bf16, so the narrow
+// storage gives the fp32 results (the kernels accumulate in fp32)
+TEST(INTLibTests, ConductancePrecision) {
+    const int32_t m_matrix = 32;
+    const int32_t n_matrix = 29;
+    const std::vector<std::string> cfgs = {"BNN_I.json", "BNN_III.json",
+                                           "TNN_I.json", "TNN_IV_split.json"};
+
+    for (const std::string &cfg : cfgs) {
+        const bool tnn = cfg.find("TNN") != std::string::npos;
+        std::vector<int32_t> results[3];
+        const char *precisions[] = {"fp32", "fp16", "bf16"};
+        for (int32_t p = 0; p < 3; ++p) {
+            set_config(get_cfg_file("analog/" + cfg).c_str());
+            const std::string update =
+                std::string(R"({"exact_fast_path": false, )") +
+                R"("conductance_precision": ")" + precisions[p] + "\"}";
+            ASSERT_EQ(update_config(update.c_str()), 0);
+            std::mt19937 gen(5);
+            std::uniform_int_distribution<int32_t> dist(tnn ? -1 : 0, 1);
+            auto value = [&]() {
+                const int32_t v = dist(gen);
+                return tnn ? v : 2 * v - 1;
+            };
+            std::vector<int32_t> mat(m_matrix * n_matrix);
+            for (int32_t &w : mat) {
+                w = value();
+            }
+            ASSERT_EQ(cpy_mtrx(mat.data(), m_matrix, n_matrix), 0);
+            for (int32_t i = 0; i < 5; ++i) {
+                std::vector<int32_t> vec(n_matrix);
+                for (int32_t &x : vec) {
+                    x = value();
+                }
+                std::vector<int32_t> res(m_matrix, 0);
+                ASSERT_EQ(exe_mvm(res.data(), vec.data(), mat.data(),
+                                  m_matrix, n_matrix),
+                          0);
+                results[p].insert(results[p].end(), res.begin(), res.end());
+            }
+        }
+        EXPECT_THAT(results[1], ::testing::ElementsAreArray(results[0]))
+            << cfg;
+        EXPECT_THAT(results[2], ::testing::ElementsAreArray(results[0]))
+            << cfg;
+    }
+}
+
+// Multi-bit DAC inputs reproduce the MVM, with and without parasitics
+// (negligible wire resistance). One bit per read is exact; with dac_bits > 1
+// the ADC range grows with the largest DAC level, so its steps (and the float
+// rounding of the larger currents) become slightly coarser.
+TEST(INTLibTests, DacBits) {
+    const int32_t m_matrix = 7;
+    const int32_t n_matrix = 13;
+    const std::vector<std::string> cfgs = {
+        "I_DIFF_W_DIFF_1XB.json", "I_DIFF_W_DIFF_2XB.json",
+        "I_OFFS_W_DIFF.json",     "I_TC_W_DIFF.json",
+        "I_UINT_W_DIFF.json",     "I_UINT_W_OFFS.json"};
+
+    for (const std::string &cfg : cfgs) {
+        const bool uint_input = cfg.find("I_UINT") != std::string::npos;
+        std::mt19937 gen(7);
+        std::uniform_int_distribution<int32_t> w_dist(-127, 127);
+        std::uniform_int_distribution<int32_t> i_dist(uint_input ? 0 : -128,
+                                                      uint_input ? 255 : 127);
+        std::vector<int32_t> mat(m_matrix * n_matrix);
+        for (int32_t &w : mat) {
+            w = w_dist(gen);
+        }
+        std::vector<int32_t> vec(n_matrix);
+        for (int32_t &x : vec) {
+            x = i_dist(gen);
+        }
+        std::vector<int32_t> exact(m_matrix, 0);
+        for (int32_t m = 0; m < m_matrix; ++m) {
+            for (int32_t n = 0; n < n_matrix; ++n) {
+                exact[m] += mat[m * n_matrix + n] * vec[n];
+            }
+        }
+
+        for (const char *parasitics : {"false", "true"}) {
+            // No parasitic model for I_TC_W_DIFF
+            if ((cfg == "I_TC_W_DIFF.json") &&
+                (std::string(parasitics) == "true")) {
+                continue;
+            }
+            for (int32_t dac_bits : {1, 2, 4, 8}) {
+                set_config(get_cfg_file("analog/" + cfg).c_str());
+                const std::string update =
+                    std::string(R"({"resolution": 26, "parasitics": )") +
+                    parasitics + R"(, "w_res": 1e-9, "V_read": -0.4, )" +
+                    R"("dac_bits": )" + std::to_string(dac_bits) + "}";
+                ASSERT_EQ(update_config(update.c_str()), 0);
+                ASSERT_EQ(cpy_mtrx(mat.data(), m_matrix, n_matrix), 0);
+                std::vector<int32_t> res(m_matrix, 0);
+                ASSERT_EQ(exe_mvm(res.data(), vec.data(), mat.data(),
+                                  m_matrix, n_matrix),
+                          0);
+                const int32_t tolerance = (dac_bits == 1) ? 0 : 8;
+                for (int32_t m = 0; m < m_matrix; ++m) {
+                    EXPECT_NEAR(res[m], exact[m], tolerance)
+                        << cfg << ", dac_bits " << dac_bits
+                        << ", parasitics " << parasitics << ", row " << m;
+                }
+            }
+        }
+    }
+}
+
+// With an output range, the results equal the clipped exact results, while
+// the analog INT mappings stop reading the rows that are already decided
+// (BNN/TNN mappings only clip)
+TEST(INTLibTests, OutputRange) {
+    const int32_t m_matrix = 32;
+    const int32_t n_matrix = 32;
+    const std::vector<std::string> cfgs = {
+        "I_DIFF_W_DIFF_1XB.json", "I_DIFF_W_DIFF_2XB.json",
+        "I_OFFS_W_DIFF.json",     "I_TC_W_DIFF.json",
+        "I_UINT_W_DIFF.json",     "I_UINT_W_OFFS.json",
+        "TNN_IV_split.json"};
+    const std::vector<std::pair<int32_t, int32_t>> ranges = {
+        {0, 1000}, {-3000, 2000}, {INT32_MIN, 0}, {0, INT32_MAX}};
+
+    for (bool d : digital) {
+        for (const std::string &cfg : cfgs) {
+            const bool uint_input = cfg.find("I_UINT") != std::string::npos;
+            const bool tnn = cfg.find("TNN") != std::string::npos;
+            std::mt19937 gen(11);
+            std::uniform_int_distribution<int32_t> w_dist(tnn ? -1 : -127,
+                                                          tnn ? 1 : 127);
+            std::uniform_int_distribution<int32_t> i_dist(
+                uint_input ? 0 : (tnn ? -1 : -128),
+                uint_input ? 255 : (tnn ? 1 : 127));
+            std::vector<int32_t> mat(m_matrix * n_matrix);
+            for (int32_t &w : mat) {
+                w = w_dist(gen);
+            }
+            std::vector<int32_t> vec(n_matrix);
+            for (int32_t &x : vec) {
+                x = i_dist(gen);
+            }
+            std::vector<int32_t> exact(m_matrix, 0);
+            for (int32_t m = 0; m < m_matrix; ++m) {
+                for (int32_t n = 0; n < n_matrix; ++n) {
+                    exact[m] += mat[m * n_matrix + n] * vec[n];
+                }
+            }
+
+            set_config(get_cfg_file(digital_to_foldername(d) + cfg).c_str());
+            if (!d && !tnn) {
+                ASSERT_EQ(update_config(R"({"resolution": 26})"), 0);
+            }
+            ASSERT_EQ(cpy_mtrx(mat.data(), m_matrix, n_matrix), 0);
+            if (tnn) {
+                // Only clipped, compare with the clipped analog results
+                std::fill(exact.begin(), exact.end(), 0);
+                ASSERT_EQ(exe_mvm(exact.data(), vec.data(), mat.data(),
+                                  m_matrix, n_matrix),
+                          0);
+            }
+            for (const auto &range : ranges) {
+                std::vector<int32_t> res(m_matrix, 0);
+                ASSERT_EQ(exe_mvm_range(res.data(), vec.data(), mat.data(),
+                                        m_matrix, n_matrix, range.first,
+                                        range.second),
+                          0);
+                for (int32_t m = 0; m < m_matrix; ++m) {
+                    EXPECT_EQ(res[m], std::clamp(exact[m], range.first,
+                                                 range.second))
+                        << digital_to_foldername(d) << cfg << ", range ["
+                        << range.first << ", " << range.second << "], row "
+                        << m;
+                }
+            }
+        }
+    }
+
+    // Empty range
+    std::vector<int32_t> res(1, 0);
+    std::vector<int32_t> vec(1, 1);
+    EXPECT_EQ(exe_mvm_range(res.data(), vec.data(), vec.data(), 1, 1, 1, 0),
+              -1);
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -0,0 +1,126 @@
+/******************************************************************************
+ * Copyright (C) 2025 Rebecca Pelke                                           *
+ * All Rights Reserved                                                        *
+ *                                                                            *
+ * This work is licensed under the terms described in the LICENSE file        *
+ * found in the root directory of this source tree.                           *
+ ******************************************************************************/
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+
+#include "helper/packed_gemv.h"
+
+namespace {
+
+std::vector<int64_t> random_values(size_t size, int64_t min, int64_t max,
+                                   std::mt19937 &gen) {
+    std::uniform_int_distribution<int64_t> dist(min, max);
+    std::vector<int64_t> values(size);
+    for (int64_t &value : values) {
+        value = dist(gen);
+    }
+    return values;
+}
+
+// Scalar reference with int32 wrap-around
+std::vector<int32_t> reference(const std::vector<int64_t> &mat,
+                               const std::vector<int32_t> &vec,
+                               int32_t m_matrix, int32_t n_packed,
+                               int32_t n_matrix) {
+    std::vector<int32_t> res(m_matrix, 0);
+    for (int32_t m = 0; m < m_matrix; ++m) {
+        uint32_t acc = 0;
+        for (int32_t n = 0; n < n_matrix; ++n) {
+            acc += uint32_t(mat[m * n_packed + n]) * uint32_t(vec[n]);
+        }
+        res[m] = int32_t(acc);
+    }
+    return res;
+}
+
+const nq::PackedGemv::Kernel kernels[] = {
+    nq::PackedGemv::Kernel::SCALAR, nq::PackedGemv::Kernel::AVX2,
+    nq::PackedGemv::Kernel::AVX512_VNNI};
+
+} // namespace
+
+// All kernels give the exact result for int8 and int16 weights, also for
+// sizes that are not a multiple of the vector width
+TEST(PackedGemvTests, Kernels) {
+    std::mt19937 gen(1);
+    for (int64_t w_max : {int64_t(127), int64_t(32767)}) {
+        for (int32_t n_matrix : {1, 17, 32, 100}) {
+            const int32_t m_matrix = 9;
+            std::vector<int64_t> mat =
+                random_values(m_matrix * n_matrix, -w_max - 1, w_max, gen);
+            std::vector<int64_t> vec64 =
+                random_values(n_matrix, -32768, 32767, gen);
+            std::vector<int32_t> vec(vec64.begin(), vec64.end());
+            const std::vector<int32_t> ref =
+                reference(mat, vec, m_matrix, n_matrix, n_matrix);
+
+            nq::PackedGemv gemv;
+            ASSERT_TRUE(gemv.pack(mat.data(), m_matrix, n_matrix));
+            EXPECT_EQ(gemv.is_int8(), w_max == 127);
+            for (nq::PackedGemv::Kernel kernel : kernels) {
+                gemv.set_kernel(kernel);
+                std::vector<int32_t> res(m_matrix, 0);
+                ASSERT_TRUE(
+                    gemv.gemv(res.data(), vec.data(), m_matrix, n_matrix));
+                EXPECT_THAT(res, ::testing::ElementsAreArray(ref))
+                    << "kernel " << int(gemv.get_kernel()) << ", n "
+                    << n_matrix;
+            }
+        }
+    }
+}
+
+// Smaller MVMs use the top-left part of the packed matrix, the results are
+// added to res
+TEST(PackedGemvTests, PartialMvm) {
+    std::mt19937 gen(2);
+    const int32_t m_packed = 8;
+    const int32_t n_packed = 40;
+    std::vector<int64_t> mat =
+        random_values(m_packed * n_packed, -200, 200, gen);
+    std::vector<int64_t> vec64 = random_values(n_packed, -128, 127, gen);
+    std::vector<int32_t> vec(vec64.begin(), vec64.end());
+    std::vector<int32_t> ref = reference(mat, vec, 5, n_packed, 35);
+    for (int32_t &value : ref) {
+        value += 3;
+    }
+
+    nq::PackedGemv gemv;
+    ASSERT_TRUE(gemv.pack(mat.data(), m_packed, n_packed));
+    for (nq::PackedGemv::Kernel kernel : kernels) {
+        gemv.set_kernel(kernel);
+        std::vector<int32_t> res(5, 3);
+        ASSERT_TRUE(gemv.gemv(res.data(), vec.data(), 5, 35));
+        EXPECT_THAT(res, ::testing::ElementsAreArray(ref));
+    }
+}
+
+// Values that do not fit int16 are rejected (fallback to the slices)
+TEST(PackedGemvTests, OutOfRange) {
+    nq::PackedGemv gemv;
+    std::vector<int64_t> mat = {1, 2, 40000, 4};
+    EXPECT_FALSE(gemv.pack(mat.data(), 2, 2));
+    EXPECT_TRUE(gemv.empty());
+
+    mat[2] = 3;
+    ASSERT_TRUE(gemv.pack(mat.data(), 2, 2));
+    std::vector<int32_t> res = {7, 7};
+    std::vector<int32_t> vec = {1, -40000};
+    EXPECT_FALSE(gemv.gemv(res.data(), vec.data(), 2, 2));
+    EXPECT_THAT(res, ::testing::ElementsAre(7, 7));
+    // Larger than the packed matrix
+    vec = {1, 1, 1};
+    EXPECT_FALSE(gemv.gemv(res.data(), vec.data(), 2, 3));
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -10,6 +10,7 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include <string>
+#include <vector>
 
 #include "inc/test_helper.h"
 
@@ -493,6 +494,46 @@ TEST(ParasiticsTests, TNN_V_split) {
     ASSERT_THAT(res2, ::testing::ElementsAre(2, -2, 1));
 }
 
+// A full crossbar (m_matrix = M) reads 2 * M columns per input
+TEST(ParasiticsTests, TNN_IV_V_full_crossbar) {
+    const int32_t m_matrix = 32;
+    const int32_t n_matrix = 32;
+    std::vector<int32_t> mat(m_matrix * n_matrix);
+    std::vector<int32_t> vec(n_matrix);
+    for (int32_t i = 0; i < m_matrix * n_matrix; ++i) {
+        mat[i] = (i * 7 + i / n_matrix) % 3 - 1;
+    }
+    for (int32_t n = 0; n < n_matrix; ++n) {
+        vec[n] = (n * 5) % 3 - 1;
+    }
+    std::vector<int32_t> exact(m_matrix, 0);
+    for (int32_t m = 0; m < m_matrix; ++m) {
+        for (int32_t n = 0; n < n_matrix; ++n) {
+            exact[m] += mat[m * n_matrix + n] * vec[n];
+        }
+    }
+
+    for (const char *cfg : {"analog/TNN_IV_split.json",
+                            "analog/TNN_V_split.json"}) {
+        set_config(get_cfg_file(cfg).c_str());
+        update_config(R"(
+          {
+             "parasitics": true,
+             "w_res": 1e-9,
+             "V_read": -0.4
+          }
+        )");
+        int32_t status = cpy_mtrx(mat.data(), m_matrix, n_matrix);
+        ASSERT_EQ(status, 0) << "Matrix write operation failed.";
+
+        std::vector<int32_t> res(m_matrix, 0);
+        status = exe_mvm(res.data(), vec.data(), mat.data(), m_matrix,
+                         n_matrix);
+        ASSERT_EQ(status, 0) << "Matrix-vector multiplication failed.";
+        EXPECT_THAT(res, ::testing::ElementsAreArray(exact)) << cfg;
+    }
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
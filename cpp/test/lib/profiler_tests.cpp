@@ -0,0 +1,134 @@
+/******************************************************************************
+ * Copyright (C) 2025 Rebecca Pelke                                           *
+ * All Rights Reserved                                                        *
+ *                                                                            *
+ * This work is licensed under the terms described in the LICENSE file        *
+ * found in the root directory of this source tree.                           *
+ ******************************************************************************/
+#include <chrono>
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+#include "helper/layer_registry.h"
+#include "helper/profiler.h"
+
+namespace {
+
+void busy_wait(std::chrono::microseconds duration) {
+    const auto end = std::chrono::steady_clock::now() + duration;
+    while (std::chrono::steady_clock::now() < end) {
+    }
+}
+
+void profiled_mvm() {
+    ACS_PROFILE_SCOPE(MVM);
+    busy_wait(std::chrono::microseconds(200));
+    {
+        ACS_PROFILE_SCOPE(ADC);
+        busy_wait(std::chrono::microseconds(500));
+    }
+}
+
+} // namespace
+
+class ProfilerTests : public ::testing::Test {
+  protected:
+    void SetUp() override {
+        nq::Profiler::get_instance().reset();
+        nq::Profiler::get_instance().set_enabled(true);
+    }
+    void TearDown() override {
+        nq::Profiler::get_instance().set_enabled(false);
+    }
+};
+
+// Nested scopes are excluded from the self time of the enclosing scope
+TEST_F(ProfilerTests, NestedScopes) {
+    profiled_mvm();
+    profiled_mvm();
+    const nlohmann::json profile = nq::Profiler::get_instance().to_json();
+    EXPECT_TRUE(profile["compiled"]);
+    EXPECT_TRUE(profile["enabled"]);
+
+    const nlohmann::json &mvm = profile["phases"]["mvm"];
+    const nlohmann::json &adc = profile["phases"]["adc"];
+    EXPECT_EQ(mvm["calls"], 2);
+    EXPECT_EQ(adc["calls"], 2);
+    EXPECT_EQ(adc["total_ns"], adc["self_ns"]);
+    EXPECT_GE(adc["self_ns"].get<uint64_t>(), 1000000u);
+    EXPECT_EQ(mvm["total_ns"].get<uint64_t>(),
+              mvm["self_ns"].get<uint64_t>() + adc["total_ns"].get<uint64_t>());
+    EXPECT_GE(mvm["self_ns"].get<uint64_t>(), 400000u);
+    EXPECT_FALSE(profile["phases"].contains("parasitics"));
+}
+
+// Scopes are counted per layer, outside of a layer scope as "Unknown"
+TEST_F(ProfilerTests, LayerBreakdown) {
+    const uint32_t fc1 = nq::LayerRegistry::get_instance().intern("fc1");
+    {
+        ACS_PROFILE_LAYER(fc1);
+        profiled_mvm();
+    }
+    profiled_mvm();
+    profiled_mvm();
+    const nlohmann::json layers =
+        nq::Profiler::get_instance().to_json()["layers"];
+    EXPECT_EQ(layers["fc1"]["mvm"]["calls"], 1);
+    EXPECT_EQ(layers["fc1"]["adc"]["calls"], 1);
+    EXPECT_EQ(layers["Unknown"]["mvm"]["calls"], 2);
+}
+
+// Counters of all threads are merged on export
+TEST_F(ProfilerTests, Threads) {
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back(profiled_mvm);
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(nq::Profiler::get_instance().to_json()["phases"]["mvm"]["calls"],
+              4);
+}
+
+// Trace events are complete events ("X") in microseconds
+TEST_F(ProfilerTests, ChromeTrace) {
+    nq::Profiler::get_instance().set_enabled(true, true);
+    profiled_mvm();
+    const nlohmann::json trace = nq::Profiler::get_instance().to_chrome_trace();
+    const nlohmann::json &events = trace["traceEvents"];
+    ASSERT_EQ(events.size(), 2u);
+    // Inner scopes end first
+    EXPECT_EQ(events[0]["name"], "adc");
+    EXPECT_EQ(events[1]["name"], "mvm");
+    for (const auto &event : events) {
+        EXPECT_EQ(event["ph"], "X");
+        EXPECT_EQ(event["cat"], "Unknown");
+        EXPECT_GE(event["ts"].get<double>(), 0.0);
+    }
+    EXPECT_GE(events[0]["ts"].get<double>(), events[1]["ts"].get<double>());
+    EXPECT_LE(events[0]["dur"].get<double>(), events[1]["dur"].get<double>());
+    EXPECT_GE(events[1]["dur"].get<double>(), 700.0);
+    EXPECT_EQ(trace["otherData"]["dropped_trace_events"], 0);
+}
+
+// Nothing is recorded while disabled, reset discards all counters
+TEST_F(ProfilerTests, DisableAndReset) {
+    nq::Profiler::get_instance().set_enabled(false);
+    profiled_mvm();
+    EXPECT_TRUE(nq::Profiler::get_instance().to_json()["phases"].empty());
+
+    nq::Profiler::get_instance().set_enabled(true, true);
+    profiled_mvm();
+    EXPECT_FALSE(nq::Profiler::get_instance().to_json()["phases"].empty());
+    nq::Profiler::get_instance().reset();
+    EXPECT_TRUE(nq::Profiler::get_instance().to_json()["phases"].empty());
+    EXPECT_TRUE(
+        nq::Profiler::get_instance().to_chrome_trace()["traceEvents"].empty());
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,144 @@
+/******************************************************************************
+ * Copyright (C) 2025 Rebecca Pelke                                           *
+ * All Rights Reserved                                                        *
+ *                                                                            *
+ * This work is licensed under the terms described in the LICENSE file        *
+ * found in the root directory of this source tree.                           *
+ ******************************************************************************/
+#include <cstdlib>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <string>
+
+#include "inc/test_helper.h"
+
+const std::string snapshot_file() {
+    return (std::filesystem::temp_directory_path() / "acs_snapshot_test.bin")
+        .string();
+}
+
+TEST(SnapshotTests, ForkReadDisturb) {
+    const int32_t m_matrix = 2;
+    const int32_t n_matrix = 2;
+    int32_t vec[n_matrix] = {3, -7};
+    int32_t mat[m_matrix * n_matrix] = {100, -32, 7, 55};
+    int32_t res[m_matrix] = {0, 0};
+
+    std::string cfg = get_cfg_file("analog/READ_DISTURB_INT.json");
+    set_config(cfg.c_str());
+    update_config(R"({"t_read": 1e-3})");
+    ASSERT_EQ(cpy_mtrx(mat, m_matrix, n_matrix), 0);
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_EQ(exe_mvm(res, vec, mat, m_matrix, n_matrix), 0);
+    }
+
+    const std::string path = snapshot_file();
+    ASSERT_EQ(save_state(path.c_str()), 0) << "Saving the state failed.";
+    const nq::Matrix<float> saved_ia_p = get_ia_p();
+    const nq::Matrix<uint64_t> saved_reads =
+        get_consecutive_reads_p();
+
+    // Continue the first run
+    for (int i = 0; i < 5; ++i) {
+        ASSERT_EQ(exe_mvm(res, vec, mat, m_matrix, n_matrix), 0);
+    }
+    const nq::Matrix<float> run1_ia_p = get_ia_p();
+    ASSERT_NE(run1_ia_p, saved_ia_p) << "Read disturb did not change ia_p.";
+
+    // Fork a second run from the snapshot
+    ASSERT_EQ(load_state(path.c_str()), 0) << "Loading the state failed.";
+    ASSERT_EQ(get_ia_p(), saved_ia_p);
+    ASSERT_EQ(get_consecutive_reads_p(), saved_reads);
+    for (int i = 0; i < 5; ++i) {
+        ASSERT_EQ(exe_mvm(res, vec, mat, m_matrix, n_matrix), 0);
+    }
+    ASSERT_EQ(get_ia_p(), run1_ia_p);
+
+    std::filesystem::remove(path);
+}
+
+TEST(SnapshotTests, ConfigMismatch) {
+    const int32_t m_matrix = 2;
+    const int32_t n_matrix = 2;
+    int32_t mat[m_matrix * n_matrix] = {1, -1, 1, 1};
+
+    std::string cfg = get_cfg_file("analog/READ_DISTURB_INT.json");
+    set_config(cfg.c_str());
+    ASSERT_EQ(cpy_mtrx(mat, m_matrix, n_matrix), 0);
+    const std::string path = snapshot_file();
+    ASSERT_EQ(save_state(path.c_str()), 0);
+
+    cfg = get_cfg_file("analog/BNN_I.json");
+    set_config(cfg.c_str());
+    ASSERT_EQ(load_state(path.c_str()), -1);
+    ASSERT_EQ(load_state("/nonexistent/acs_snapshot.bin"), -1);
+
+    std::filesystem::remove(path);
+}
+
+// A snapshot that does not match the crossbar state (here: no parasitic
+// solver state) is rejected before any state is overwritten
+TEST(SnapshotTests, MismatchKeepsState) {
+    const int32_t m_matrix = 2;
+    const int32_t n_matrix = 2;
+    int32_t mat[m_matrix * n_matrix] = {100, -32, 7, 55};
+    int32_t other_mat[m_matrix * n_matrix] = {-3, 12, 0, 1};
+
+    std::string cfg = get_cfg_file("analog/READ_DISTURB_INT.json");
+    set_config(cfg.c_str());
+    ASSERT_EQ(cpy_mtrx(mat, m_matrix, n_matrix), 0);
+    const std::string path = snapshot_file();
+    ASSERT_EQ(save_state(path.c_str()), 0);
+
+    ASSERT_EQ(update_config(R"({"parasitics": true, "w_res": 1.0})"), 0);
+    ASSERT_EQ(cpy_mtrx(other_mat, m_matrix, n_matrix), 0);
+    const nq::Matrix<uint8_t> gd_p = get_gd_p();
+    const nq::Matrix<float> ia_p = get_ia_p();
+    const nq::Matrix<uint64_t> cycles_p = get_cycles_p();
+    ASSERT_EQ(load_state(path.c_str()), -1);
+    EXPECT_EQ(get_gd_p(), gd_p);
+    EXPECT_EQ(get_ia_p(), ia_p);
+    EXPECT_EQ(get_cycles_p(), cycles_p);
+
+    std::filesystem::remove(path);
+}
+
+// A restored crossbar only reprograms the written sub-array on a
+// reconfiguration, like the crossbar the snapshot was taken from
+TEST(SnapshotTests, SubArrayReconfigure) {
+    const int32_t m_matrix = 3;
+    const int32_t n_matrix = 2;
+    int32_t vec[n_matrix] = {120, 55};
+    int32_t mat[m_matrix * n_matrix] = {100, -32, 1, 0, -12, 1};
+    const char *parasitics =
+        R"({"parasitics": true, "w_res": 0.01, "V_read": -0.4})";
+    const char *update = R"({"HRS": 4.0})";
+    std::string cfg = get_cfg_file("analog/I_DIFF_W_DIFF_1XB.json");
+
+    // Reference: reconfigure the crossbar the weights were written to
+    set_config(cfg.c_str());
+    ASSERT_EQ(update_config(parasitics), 0);
+    ASSERT_EQ(cpy_mtrx(mat, m_matrix, n_matrix), 0);
+    const std::string path = snapshot_file();
+    ASSERT_EQ(save_state(path.c_str()), 0);
+    ASSERT_EQ(update_config(update), 0);
+    const nq::Matrix<float> ref_ia_p = get_ia_p();
+    int32_t ref[m_matrix] = {0, 0, 0};
+    ASSERT_EQ(exe_mvm(ref, vec, mat, m_matrix, n_matrix), 0);
+
+    set_config(cfg.c_str());
+    ASSERT_EQ(update_config(parasitics), 0);
+    ASSERT_EQ(load_state(path.c_str()), 0);
+    ASSERT_EQ(update_config(update), 0);
+    EXPECT_EQ(get_ia_p(), ref_ia_p);
+    int32_t res[m_matrix] = {0, 0, 0};
+    ASSERT_EQ(exe_mvm(res, vec, mat, m_matrix, n_matrix), 0);
+    EXPECT_THAT(res, ::testing::ElementsAreArray(ref));
+
+    std::filesystem::remove(path);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -1,6 +1,8 @@
 #include <cstdlib>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include <random>
+#include <vector>
 
 #include "inc/test_helper.h"
 
@@ -15,8 +17,8 @@ TEST(VarTests, VarTest) {
     int32_t status = cpy_mtrx(mat, m_matrix, n_matrix);
     ASSERT_EQ(status, 0) << "Matrix write operation failed.";
 
-    const std::vector<std::vector<float>> &ia_p_vec = get_ia_p();
-    const std::vector<std::vector<float>> &ia_m_vec = get_ia_m();
+    const nq::Matrix<float> &ia_p_vec = get_ia_p();
+    const nq::Matrix<float> &ia_m_vec = get_ia_m();
 
     for (int32_t m = 0; m < m_matrix; m++) {
         for (int32_t n = 0; n < n_matrix; n++) {
@@ -30,6 +32,137 @@ TEST(VarTests, VarTest) {
     }
 }
 
+TEST(VarTests, FlatBufferTest) {
+    const int32_t m_matrix = 3;
+    const int32_t n_matrix = 2;
+    int32_t mat[m_matrix * n_matrix] = {1, 1, -1, -1, 1, -1};
+
+    std::string cfg = get_cfg_file("variability/variability.json");
+    set_config(cfg.c_str());
+
+    int32_t status = cpy_mtrx(mat, m_matrix, n_matrix);
+    ASSERT_EQ(status, 0) << "Matrix write operation failed.";
+
+    const nq::Matrix<float> &ia_p_vec = get_ia_p();
+    const nq::Matrix<uint8_t> &gd_p_vec = get_gd_p();
+    size_t ia_size = 0;
+    size_t gd_size = 0;
+    const float *ia_p = static_cast<const float *>(get_ia_p(&ia_size));
+    const uint8_t *gd_p = static_cast<const uint8_t *>(get_gd_p(&gd_size));
+    ASSERT_EQ(ia_size, ia_p_vec.rows() * ia_p_vec.cols());
+    ASSERT_EQ(gd_size, gd_p_vec.rows() * gd_p_vec.cols());
+
+    // C getters return the matrices as flat row-major buffers
+    for (size_t m = 0; m < ia_p_vec.rows(); m++) {
+        for (size_t n = 0; n < ia_p_vec.cols(); n++) {
+            ASSERT_EQ(ia_p[m * ia_p_vec.cols() + n], ia_p_vec[m][n]);
+            ASSERT_EQ(gd_p[m * gd_p_vec.cols() + n], gd_p_vec[m][n]);
+        }
+    }
+}
+
+namespace {
+
+// Mean and variance of the deviation from the ideal BNN MVM result
+std::pair<double, double> c2c_error_stats(int32_t *mat, int32_t *vec,
+                                          const std::vector<int32_t> &ideal,
+                                          int32_t m_matrix, int32_t n_matrix,
+                                          int32_t num_mvms) {
+    double sum = 0.0;
+    double sum_sq = 0.0;
+    std::vector<int32_t> res(m_matrix);
+    for (int32_t i = 0; i < num_mvms; i++) {
+        std::fill(res.begin(), res.end(), 0);
+        EXPECT_EQ(exe_mvm(res.data(), vec, mat, m_matrix, n_matrix), 0);
+        for (int32_t m = 0; m < m_matrix; m++) {
+            const double err = res[m] - ideal[m];
+            sum += err;
+            sum_sq += err * err;
+        }
+    }
+    const double count = double(num_mvms) * m_matrix;
+    const double mean = sum / count;
+    return {mean, sum_sq / count - mean * mean};
+}
+
+} // namespace
+
+// The column_aggregate model gives the output distribution of per-cell C2C
+// noise and leaves the programmed currents unchanged
+TEST(VarTests, C2CColumnAggregate) {
+    const int32_t m_matrix = 32;
+    const int32_t n_matrix = 32;
+    std::vector<int32_t> mat(m_matrix * n_matrix);
+    std::mt19937 gen(5);
+    for (int32_t &w : mat) {
+        w = (gen() & 1) ? 1 : -1;
+    }
+    std::vector<int32_t> vec(n_matrix, 1);
+    std::vector<int32_t> ideal(m_matrix, 0);
+    for (int32_t m = 0; m < m_matrix; m++) {
+        for (int32_t n = 0; n < n_matrix; n++) {
+            ideal[m] += mat[m * n_matrix + n];
+        }
+    }
+
+    std::string cfg = get_cfg_file("variability/variability.json");
+    set_config(cfg.c_str());
+    ASSERT_EQ(update_config(R"({"d2d_var": false, "c2c_var": true})"), 0);
+    ASSERT_EQ(cpy_mtrx(mat.data(), m_matrix, n_matrix), 0);
+    const auto per_cell = c2c_error_stats(mat.data(), vec.data(), ideal,
+                                          m_matrix, n_matrix, 500);
+
+    ASSERT_EQ(update_config(R"({"c2c_model": "column_aggregate"})"), 0);
+    const nq::Matrix<float> ia_p = get_ia_p();
+    const auto column = c2c_error_stats(mat.data(), vec.data(), ideal,
+                                        m_matrix, n_matrix, 500);
+
+    // Standard deviation of a column current: sqrt(32 * (1 + 4)) uA
+    EXPECT_GT(per_cell.second, 1.0);
+    EXPECT_NEAR(column.first, per_cell.first, 0.1);
+    EXPECT_NEAR(column.second, per_cell.second, 0.1 * per_cell.second);
+    EXPECT_EQ(get_ia_p(), ia_p);
+}
+
+namespace {
+
+// Results of num_mvms MVMs with C2C variability after a fresh set_config
+std::vector<int32_t> c2c_mvms(const char *update, int32_t num_threads) {
+    const int32_t m_matrix = 16;
+    const int32_t n_matrix = 16;
+    const int32_t num_mvms = 8;
+    std::vector<int32_t> mat(m_matrix * n_matrix, 1);
+    std::vector<int32_t> vec(n_matrix, 1);
+    std::string cfg = get_cfg_file("variability/variability.json");
+    set_config(cfg.c_str(), num_threads);
+    EXPECT_EQ(update_config(update), 0);
+    EXPECT_EQ(cpy_mtrx(mat.data(), m_matrix, n_matrix), 0);
+    std::vector<int32_t> res(num_mvms * m_matrix, 0);
+    for (int32_t i = 0; i < num_mvms; i++) {
+        EXPECT_EQ(exe_mvm(&res[i * m_matrix], vec.data(), mat.data(),
+                          m_matrix, n_matrix),
+                  0);
+    }
+    return res;
+}
+
+} // namespace
+
+// The C2C samples of both models follow rng_seed, independent of the number
+// of threads
+TEST(VarTests, C2CSeed) {
+    for (const char *model : {"per_cell", "column_aggregate"}) {
+        const std::string update =
+            std::string(R"({"c2c_var": true, "c2c_model": ")") + model +
+            R"(", "rng_seed": )";
+        const std::string seed_7 = update + "7}";
+        const std::string seed_8 = update + "8}";
+        const std::vector<int32_t> res = c2c_mvms(seed_7.c_str(), 1);
+        EXPECT_EQ(c2c_mvms(seed_7.c_str(), 4), res) << model;
+        EXPECT_NE(c2c_mvms(seed_8.c_str(), 1), res) << model;
+    }
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
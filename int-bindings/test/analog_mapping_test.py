@@ -187,6 +187,50 @@ class TestAnalogMapping(unittest.TestCase):
         np.testing.assert_array_equal(neg_mat[1][:2], [30, 30])
         np.testing.assert_array_equal(neg_mat[2][:2], [5, 30])
 
+    def test_ia_views(self):
+        m_matrix = 3
+        n_matrix = 2
+        mat = np.array([1, 1, -1, -1, 1, -1], dtype=np.int32)
+
+        acs_py.set_config(os.path.abspath(f"{repo_path}/cpp/test/lib/configs/analog/BNN_I.json"))
+        view = acs_py.ia_p()
+        copy = acs_py.ia_p(copy=True)
+        assert not view.flags.writeable
+        assert copy.flags.writeable
+
+        # The view follows the crossbar state, the copy does not
+        acs_py.cpy(mat, m_matrix, n_matrix)
+        np.testing.assert_array_equal(view[0][:2], [30, 30])
+        np.testing.assert_array_equal(copy[0][:2], [5, 5])
+
+        # The view keeps the old crossbar alive after a new config is set
+        acs_py.set_config(os.path.abspath(f"{repo_path}/cpp/test/lib/configs/analog/BNN_I.json"))
+        np.testing.assert_array_equal(view[0][:2], [30, 30])
+        np.testing.assert_array_equal(acs_py.ia_p()[0][:2], [5, 5])
+
+    def test_adc_calibration(self):
+        m_matrix = 3
+        n_matrix = 5
+        mat = np.array([-128] * 5 + [127] * 5 + [-12, 88, 65, 0, -99], dtype=np.int32)
+        vec = np.array([[-1, -1, -1, -1, -1], [1, 0, 1, 0, 1]], dtype=np.int32)
+        out = np.zeros((2, m_matrix), dtype=np.int32)
+
+        acs_py.set_config(os.path.abspath(f"{repo_path}/cpp/test/lib/configs/analog/SYM_ADC_1.json"))
+        acs_py.cpy(mat, m_matrix, n_matrix)
+        assert acs_py.adc_calib_dict() == {}
+
+        acs_py.begin_adc_calibration()
+        assert acs_py.mvm_batch(vec, out, m_matrix, n_matrix, l_name="fc1") == 0
+        assert acs_py.end_adc_calibration(policy="mse") == 0
+
+        # Symmetric ADC: calibrated range is symmetric around zero
+        calib_dict = acs_py.adc_calib_dict()
+        assert list(calib_dict.keys()) == ["fc1"]
+        lo, hi = calib_dict["fc1"]
+        assert lo == -hi and hi > 0
+        assert acs_py.mvm_batch(vec, out, m_matrix, n_matrix, l_name="fc1") == 0
+        assert acs_py.end_adc_calibration(policy="unknown") == -1
+
 
 if __name__ == "__main__":
     unittest.main()
@@ -52,16 +52,17 @@ class TestConfigUpdate(unittest.TestCase):
         mat = np.array([100, -32, 1, 0, 12, 1], dtype=np.int32)
         vec = np.array([-120, 55], dtype=np.int32)
 
-        # Get initial matrix conductances
+        # Get initial matrix conductances (the crossbar and its buffers are
+        # kept by the update, so take a copy)
         acs_py.cpy(mat, m_matrix, n_matrix)
-        initial_ia_p = acs_py.ia_p()
+        initial_ia_p = acs_py.ia_p(copy=True)
 
-        # Update HRS (should recreate crossbar)
+        # Update HRS (reprograms the conductances in place)
         new_hrs = 1000.0    # Different from default
         update_json = json.dumps({"HRS": new_hrs})
         acs_py.update_config(update_json)
 
-        # Copy matrix again after crossbar recreation
+        # Copy matrix again (same weights, new HRS)
         acs_py.cpy(mat, m_matrix, n_matrix)
         updated_ia_p = acs_py.ia_p()
 
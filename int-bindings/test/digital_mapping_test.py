@@ -5,6 +5,7 @@
 # This is work is licensed under the terms described in the LICENSE file     #
 # found in the root directory of this source tree.                           #
 ##############################################################################
+import asyncio
 import unittest
 import numpy as np
 import acs_py
@@ -30,6 +31,69 @@ class TestDigitalMapping(unittest.TestCase):
         acs_py.mvm(res, vec, mat, m_matrix, n_matrix)
         np.testing.assert_array_equal(res, np.array([-13759, -119, -1386], dtype=np.int32))
 
+    def test_mvm_batch(self):
+        m_matrix = 3
+        n_matrix = 2
+        mat = np.array([100, -32, 1, 0, 12, 1], dtype=np.int32)
+        # Strided int64 batch (every second row) and strided int32 batch
+        vec_rows = np.array([[-120, 55], [0, 0], [7, -3], [0, 0], [1, 1], [0, 0]])
+        vec64 = vec_rows.astype(np.int64)[::2]
+        vec32 = vec_rows.astype(np.int32)[::2]
+        expected = np.array([[-13760, -120, -1385], [796, 7, 81], [68, 1, 13]],
+                            dtype=np.int32)
+
+        acs_py.set_config(
+            os.path.abspath(f"{repo_path}/cpp/test/lib/configs/digital/I_DIFF_W_DIFF_1XB.json"))
+        acs_py.cpy(mat, m_matrix, n_matrix)
+
+        # The output is overwritten, not accumulated
+        out = np.ones((3, m_matrix), dtype=np.int32)
+        assert acs_py.mvm_batch(vec64, out, m_matrix, n_matrix) == 0
+        np.testing.assert_array_equal(out, expected)
+
+        out_t = np.zeros((m_matrix, 3), dtype=np.int32).T
+        assert acs_py.mvm_batch(vec32, out_t, m_matrix, n_matrix) == 0
+        np.testing.assert_array_equal(out_t, expected)
+
+        # Wrong output dtype or shape is rejected
+        assert acs_py.mvm_batch(vec32, out.astype(np.int64), m_matrix, n_matrix) == -1
+        assert acs_py.mvm_batch(vec32, out[:2], m_matrix, n_matrix) == -1
+
+    def test_mvm_async(self):
+        m_matrix = 3
+        n_matrix = 2
+        mat = np.array([100, -32, 1, 0, 12, 1], dtype=np.int32)
+        vec = np.array([[-120, 55], [7, -3], [1, 1]], dtype=np.int32)
+        expected = np.array([[-13760, -120, -1385], [796, 7, 81], [68, 1, 13]],
+                            dtype=np.int32)
+
+        acs_py.set_config(
+            os.path.abspath(f"{repo_path}/cpp/test/lib/configs/digital/I_DIFF_W_DIFF_1XB.json"))
+        acs_py.cpy(mat, m_matrix, n_matrix)
+
+        outs = [np.zeros((3, m_matrix), dtype=np.int32) for _ in range(4)]
+        handles = [acs_py.mvm_async(vec, out, m_matrix, n_matrix) for out in outs]
+        assert handles[0].wait() == 0
+        acs_py.wait_all()
+        assert all(h.done() for h in handles)
+        for out in outs:
+            np.testing.assert_array_equal(out, expected)
+        # Synchronous calls see all queued MVMs
+        assert acs_py.mvm_ops() == 3 * len(outs)
+
+        async def run():
+            out = np.zeros((3, m_matrix), dtype=np.int32)
+            status = await acs_py.mvm_async(vec.astype(np.int64), out, m_matrix, n_matrix)
+            return status, out
+
+        status, out = asyncio.run(run())
+        assert status == 0
+        np.testing.assert_array_equal(out, expected)
+
+        # Invalid arguments complete immediately with status -1
+        bad = acs_py.mvm_async(vec, np.zeros((2, m_matrix), dtype=np.int32), m_matrix, n_matrix)
+        assert bad.wait() == -1
+
     def test_digital_I_DIFF_W_DIFF_2XB(self):
         m_matrix = 3
         n_matrix = 2
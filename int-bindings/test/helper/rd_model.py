@@ -22,9 +22,9 @@ class ReadDisturbGoldenModel():
         return self.t0 * self.fitting_parameter**self.exp_tt * (
             1 - self.k * N_cycle**self.m)**self.exp_tt
 
-    def G_scaling(self, t_stress, N_cycle):
+    def G_scaling(self, t_stress, N_cycle, p_scaling=1.0):
         tau = self.transition_time(N_cycle)
         if (t_stress < tau):
             return 1
         else:
-            return (t_stress / tau)**(-self.p)
+            return (t_stress / tau)**(-self.p * p_scaling)
@@ -5,6 +5,7 @@
 # This is work is licensed under the terms described in the LICENSE file     #
 # found in the root directory of this source tree.                           #
 ##############################################################################
+import json
 import unittest
 import numpy as np
 import acs_py
@@ -70,6 +71,40 @@ class TestReadDisturbModel(unittest.TestCase):
         assert acs_py.cycles_m()[0][0] > acs_py.cycles_p()[0][0]
         assert acs_py.consecutive_reads_m()[0][0] < acs_py.consecutive_reads_p()[0][0]
 
+    def test_refresh_thread_independence(self):
+        m_matrix = 64
+        n_matrix = 64
+        rng = np.random.default_rng(0)
+        mat = rng.choice([-1, 1], size=m_matrix * n_matrix).astype(np.int32)
+        vec = np.ones(n_matrix, dtype=np.int32)
+        res = np.zeros(m_matrix, dtype=np.int32)
+
+        states = []
+        for num_threads in [1, 4]:
+            acs_py.set_config(
+                os.path.abspath(
+                    f"{repo_path}/cpp/test/lib/configs/analog/READ_DISTURB_MITIGATION_HW.json"),
+                num_threads)
+            acs_py.update_config(json.dumps({
+                "M": m_matrix,
+                "N": n_matrix,
+                "LRS_NOISE": 0.5,
+                "rng_seed": 1234
+            }))
+            acs_py.cpy(mat, m_matrix, n_matrix)
+
+            # Stop right after the first (noisy) cell-based refresh
+            while acs_py.refresh_cell_ops() == 0:
+                acs_py.mvm(res, vec, mat, m_matrix, n_matrix)
+
+            states.append((acs_py.ia_p(), acs_py.ia_m(), acs_py.cycles_p(),
+                           acs_py.cycles_m(), acs_py.refresh_cell_ops()))
+
+        # Refreshed cells are noisy, but independent of the number of threads
+        assert np.any((states[0][0] != 5.0) & (states[0][0] != 30.0))
+        for single, multi in zip(states[0], states[1]):
+            np.testing.assert_array_equal(single, multi)
+
 
 if __name__ == "__main__":
     unittest.main()
@@ -123,6 +123,43 @@ class TestReadDisturbModel(unittest.TestCase):
         acs_py.mvm(res, vec, mat, m_matrix, n_matrix)
         assert acs_py.rd_run_out_of_bounds() == True
 
+    def test_int_multi_level(self):
+        rd_gm = ReadDisturbGoldenModel(-0.4, 100e-9)
+        I_HRS = 5.0
+        I_LRS = 30.0
+        split = [1, 3, 4]
+        level_scaling = [1.0, 1.5, 2.0]
+
+        m_matrix = 2
+        n_matrix = 2
+        mat = np.array([100, -37, 5, 0], dtype=np.int32)
+        vec = np.array([1, 2], dtype=np.int32)
+        res = np.array([0, 0], dtype=np.int32)
+
+        acs_py.set_config(
+            os.path.abspath(f"{repo_path}/cpp/test/lib/configs/analog/READ_DISTURB_INT.json"))
+        acs_py.cpy(mat, m_matrix, n_matrix)
+
+        t_stress = 1e-3
+        num_reads = int(round(t_stress / rd_gm.t_read))
+        for r in range(num_reads):
+            acs_py.mvm(res, vec, mat, m_matrix, n_matrix)
+
+        for gd, ia in [(acs_py.gd_p(), acs_py.ia_p()), (acs_py.gd_m(), acs_py.ia_m())]:
+            for row in range(gd.shape[0]):
+                step = (I_LRS - I_HRS) / ((1 << split[row % len(split)]) - 1)
+                for col in range(gd.shape[1]):
+                    level = int(gd[row][col])
+                    I_nominal = level * step + I_HRS
+                    if level == 0:
+                        # HRS cells are not disturbed
+                        np.testing.assert_allclose(ia[row][col], I_HRS, atol=0.0)
+                        continue
+                    p_scaling = level_scaling[level - 1] if level <= len(level_scaling) else 1.0
+                    I_new = I_nominal * rd_gm.G_scaling(t_stress, 0, p_scaling)
+                    assert ia[row][col] < I_nominal
+                    np.testing.assert_allclose(ia[row][col], I_new, rtol=1e-5)
+
 
 if __name__ == "__main__":
     unittest.main()
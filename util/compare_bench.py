@@ -0,0 +1,70 @@
+#!/usr/bin/env python3
+##############################################################################
+# Copyright (C) 2025 Rebecca Pelke                                           #
+# All Rights Reserved                                                        #
+#                                                                            #
+# This is work is licensed under the terms described in the LICENSE file     #
+# found in the root directory of this source tree.                           #
+##############################################################################
+# Compare two acs_bench JSON results (--benchmark_out_format=json) and flag
+# benchmarks that got slower than the threshold. Exit code 1 on regressions.
+import argparse
+import json
+import sys
+
+
+def load_times(path: str, metric: str) -> dict:
+    with open(path) as f:
+        data = json.load(f)
+    times = {}
+    for bench in data["benchmarks"]:
+        # Repetitions: compare the median if available
+        if bench.get("run_type") == "aggregate" and bench.get("aggregate_name") != "median":
+            continue
+        if bench.get("error_occurred"):
+            continue
+        times[bench["run_name"]] = bench[metric]
+    return times
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description="Compare two acs_bench JSON results.")
+    parser.add_argument("baseline", help="JSON result of the reference version")
+    parser.add_argument("contender", help="JSON result of the new version")
+    parser.add_argument("--threshold",
+                        type=float,
+                        default=0.05,
+                        help="Relative slowdown that counts as regression (default: 0.05)")
+    parser.add_argument("--metric",
+                        choices=["real_time", "cpu_time"],
+                        default="cpu_time",
+                        help="Time to compare (default: cpu_time)")
+    args = parser.parse_args()
+
+    baseline = load_times(args.baseline, args.metric)
+    contender = load_times(args.contender, args.metric)
+
+    regressions = []
+    print(f"{'Benchmark':<60} {'Baseline':>12} {'Contender':>12} {'Change':>8}")
+    for name, base_time in baseline.items():
+        if name not in contender:
+            print(f"{name:<60} {base_time:>12.3f} {'missing':>12}")
+            continue
+        change = contender[name] / base_time - 1.0
+        flag = ""
+        if change > args.threshold:
+            regressions.append(name)
+            flag = "  REGRESSION"
+        print(f"{name:<60} {base_time:>12.3f} {contender[name]:>12.3f} {change:>+8.1%}{flag}")
+    for name in contender.keys() - baseline.keys():
+        print(f"{name:<60} {'new':>12} {contender[name]:>12.3f}")
+
+    if regressions:
+        print(f"\n{len(regressions)} benchmark(s) slower than {args.threshold:.0%}.")
+        return 1
+    print(f"\nNo regressions (threshold {args.threshold:.0%}).")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())